@@ -0,0 +1,626 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+#include <crystal.h>
+#include <jansson.h>
+#include <openssl/bio.h>
+#include <openssl/evp.h>
+#include <openssl/buffer.h>
+
+#include "ela_did.h"
+#include "diddocument.h"
+#include "crypto.h"
+#include "common.h"
+#include "BRBase58.h"
+
+#define DEFAULT_ITERATIONS          1000
+#define DEFAULT_STORE_WORKERS       4
+
+static const char *storepass = "bench-passwd";
+static const char *message = "The quick brown fox jumps over the lazy dog.";
+
+static const char *credential_types[] = {
+    "BasicProfileCredential",
+    "EmailCredential",
+    "PhoneCredential",
+    "InternetAccountCredential",
+    "TwitterCredential",
+    "PassportCredential",
+    "EducationCredential",
+    "EmploymentCredential"
+};
+
+typedef struct BenchContext {
+    DIDStore *store;
+    DIDDocument *doc;
+    DIDURL *signkey;
+    char signature[MAX_SIGNATURE_LEN];
+    const char *json;
+    char *base64;
+    const char *publickey;
+    uint8_t *buffer;
+} BenchContext;
+
+typedef struct BenchCase {
+    const char *name;
+    int (*run)(BenchContext *context);
+} BenchCase;
+
+static int bench_sign(BenchContext *context)
+{
+    return DIDDocument_Sign(context->doc, context->signkey, storepass,
+            context->signature, 1, (unsigned char*)message, strlen(message));
+}
+
+static int bench_verify(BenchContext *context)
+{
+    return DIDDocument_Verify(context->doc, context->signkey, context->signature,
+            1, (unsigned char*)message, strlen(message));
+}
+
+static int bench_isgenuine(BenchContext *context)
+{
+    return DIDDocument_IsGenuine(context->doc) == 1 ? 0 : -1;
+}
+
+static int bench_parse(BenchContext *context)
+{
+    DIDDocument *doc;
+
+    doc = DIDDocument_FromJson(context->json);
+    if (!doc)
+        return -1;
+
+    DIDDocument_Destroy(doc);
+    return 0;
+}
+
+// The jansson DOM path the reader replaced, kept as the baseline.
+static int bench_parse_dom(BenchContext *context)
+{
+    DIDDocument *doc;
+    json_t *root;
+    json_error_t error;
+
+    root = json_loads(context->json, 0, &error);
+    if (!root)
+        return -1;
+
+    doc = DIDDocument_FromJson_Internal(root, true);
+    json_decref(root);
+    if (!doc)
+        return -1;
+
+    DIDDocument_Destroy(doc);
+    return 0;
+}
+
+static int bench_b64_encode(BenchContext *context)
+{
+    return b64_url_encode(context->base64, (const uint8_t*)context->json,
+            strlen(context->json)) < 0 ? -1 : 0;
+}
+
+static int bench_b64_decode(BenchContext *context)
+{
+    return b64_url_decode(context->buffer, context->base64) < 0 ? -1 : 0;
+}
+
+// The OpenSSL BIO codec the table driven one replaced, kept as the baseline.
+static int bench_b64_encode_bio(BenchContext *context)
+{
+    BIO *bio, *b64;
+    BUF_MEM *mem;
+    char *p;
+
+    b64 = BIO_new(BIO_f_base64());
+    bio = BIO_push(b64, BIO_new(BIO_s_mem()));
+    BIO_set_flags(bio, BIO_FLAGS_BASE64_NO_NL);
+    BIO_write(bio, context->json, strlen(context->json));
+    BIO_flush(bio);
+    BIO_get_mem_ptr(bio, &mem);
+    BIO_set_close(bio, BIO_NOCLOSE);
+    BIO_free_all(bio);
+
+    memcpy(context->buffer, mem->data, mem->length);
+    context->buffer[mem->length] = 0;
+    BUF_MEM_free(mem);
+
+    for (p = (char*)context->buffer; *p; p++) {
+        if (*p == '+')
+            *p = '-';
+        else if (*p == '/')
+            *p = '_';
+        else if (*p == '=')
+            *p = 0;
+    }
+
+    return 0;
+}
+
+static int bench_b64_decode_bio(BenchContext *context)
+{
+    BIO *bio, *b64;
+    size_t len;
+    char *padded, *p;
+    int rc;
+
+    len = strlen(context->base64);
+    padded = (char*)malloc(len + 3);
+    if (!padded)
+        return -1;
+
+    strcpy(padded, context->base64);
+    for (; len % 4; len++)
+        strcat(padded, "=");
+    for (p = padded; *p; p++) {
+        if (*p == '-')
+            *p = '+';
+        else if (*p == '_')
+            *p = '/';
+    }
+
+    bio = BIO_new_mem_buf(padded, len);
+    b64 = BIO_new(BIO_f_base64());
+    bio = BIO_push(b64, bio);
+    BIO_set_flags(bio, BIO_FLAGS_BASE64_NO_NL);
+    rc = BIO_read(bio, context->buffer, len);
+    BIO_free_all(bio);
+    free(padded);
+    return rc < 0 ? -1 : 0;
+}
+
+static int bench_b58_decode(BenchContext *context)
+{
+    return b58_decode(context->buffer, PUBLICKEY_BYTES, context->publickey) == PUBLICKEY_BYTES ? 0 : -1;
+}
+
+// The BRBase58 decoder sized the output with a first pass.
+static int bench_b58_decode_br(BenchContext *context)
+{
+    size_t size;
+
+    size = BRBase58Decode(NULL, 0, context->publickey);
+    if (size > PUBLICKEY_BYTES)
+        return -1;
+
+    return BRBase58Decode(context->buffer, size, context->publickey) == PUBLICKEY_BYTES ? 0 : -1;
+}
+
+static BenchCase cases[] = {
+    { "sign",             bench_sign           },
+    { "verify",           bench_verify         },
+    { "isgenuine",        bench_isgenuine      },
+    { "parse",            bench_parse          },
+    { "parse-dom",        bench_parse_dom      },
+    { "b64-encode",       bench_b64_encode     },
+    { "b64-encode-bio",   bench_b64_encode_bio },
+    { "b64-decode",       bench_b64_decode     },
+    { "b64-decode-bio",   bench_b64_decode_bio },
+    { "b58-decode",       bench_b58_decode     },
+    { "b58-decode-br",    bench_b58_decode_br  },
+    { NULL,               NULL                 }
+};
+
+//The store cases run on many threads, so they are timed by the wall clock.
+static double wall_clock(void)
+{
+#ifdef HAVE_SYS_TIME_H
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static int count_did(DID *did, void *context)
+{
+    if (did)
+        (*(int*)context)++;
+
+    return 0;
+}
+
+static int fill_store(DIDStore *store, int dids)
+{
+    RootIdentity *rootidentity;
+    DIDDocument *doc;
+    const char *mnemonic;
+    int count = 0, i;
+
+    if (DIDStore_ListDIDs(store, 0, count_did, &count) < 0)
+        return -1;
+
+    //the store is kept between runs, it is slow to build.
+    if (count >= dids)
+        return 0;
+
+    mnemonic = Mnemonic_Generate("english");
+    if (!mnemonic)
+        return -1;
+
+    rootidentity = RootIdentity_Create(mnemonic, "", true, store, storepass);
+    Mnemonic_Free((void*)mnemonic);
+    if (!rootidentity)
+        return -1;
+
+    for (i = count; i < dids; i++) {
+        doc = RootIdentity_NewDID(rootidentity, storepass, NULL, true);
+        if (!doc) {
+            RootIdentity_Destroy(rootidentity);
+            return -1;
+        }
+        DIDDocument_Destroy(doc);
+    }
+
+    RootIdentity_Destroy(rootidentity);
+    return 0;
+}
+
+static int bench_store(const char *root, int dids, int workers)
+{
+    char zipfile[PATH_MAX], target[PATH_MAX];
+    int threads[2] = { 1, workers }, i, rc = -1;
+    DIDStore *store, *imported;
+    double start;
+
+    store = DIDStore_Open(root);
+    if (!store)
+        return -1;
+
+    printf("Preparing store with %d DIDs...\n", dids);
+    if (fill_store(store, dids) < 0)
+        goto cleanup;
+
+    snprintf(zipfile, sizeof(zipfile), "%s.zip", root);
+    snprintf(target, sizeof(target), "%s.import", root);
+
+    //the single thread export and import are the baseline.
+    for (i = 0; i < 2; i++) {
+        if (i > 0 && threads[i] == threads[0])
+            break;
+
+        start = wall_clock();
+        if (DIDStore_ExportStoreEx(store, storepass, zipfile, "export-passwd",
+                threads[i], NULL, NULL) < 0)
+            goto cleanup;
+        printf("%-16s %8d dids %3d workers %10.3f s\n", "store-export", dids,
+                threads[i], wall_clock() - start);
+
+        delete_file(target);
+        imported = DIDStore_Open(target);
+        if (!imported)
+            goto cleanup;
+
+        start = wall_clock();
+        rc = DIDStore_ImportStoreEx(imported, storepass, zipfile, "export-passwd",
+                threads[i], NULL, NULL);
+        DIDStore_Close(imported);
+        if (rc < 0)
+            goto cleanup;
+        printf("%-16s %8d dids %3d workers %10.3f s\n", "store-import", dids,
+                threads[i], wall_clock() - start);
+        rc = -1;
+    }
+
+    rc = 0;
+
+cleanup:
+    delete_file(zipfile);
+    delete_file(target);
+    DIDStore_Close(store);
+    return rc;
+}
+
+static int count_credential(DIDURL *id, void *context)
+{
+    if (id)
+        (*(int*)context)++;
+
+    return 0;
+}
+
+static int fill_credentials(DIDStore *store, DIDDocument *doc, int credentials)
+{
+    const char *types[2];
+    char fragment[32];
+    Credential *credential;
+    Issuer *issuer;
+    DIDURL *id;
+    DID *did;
+    int i, rc = 0;
+
+    did = DIDDocument_GetSubject(doc);
+    issuer = Issuer_Create(did, NULL, store);
+    if (!issuer)
+        return -1;
+
+    //every credential is self-proclaimed plus one of the bench types.
+    types[1] = "SelfProclaimedCredential";
+    for (i = 0; i < credentials && rc == 0; i++) {
+        snprintf(fragment, sizeof(fragment), "credential-%d", i);
+        id = DIDURL_NewFromDid(did, fragment);
+        if (!id) {
+            rc = -1;
+            break;
+        }
+
+        types[0] = credential_types[i % (sizeof(credential_types) / sizeof(char*))];
+        credential = Issuer_CreateCredentialByString(issuer, did, id, types, 2,
+                "{\"name\":\"bench\"}", DIDDocument_GetExpires(doc), storepass);
+        DIDURL_Destroy(id);
+        if (!credential) {
+            rc = -1;
+            break;
+        }
+
+        rc = DIDStore_StoreCredential(store, credential);
+        Credential_Destroy(credential);
+    }
+
+    Issuer_Destroy(issuer);
+    return rc;
+}
+
+static int bench_credentials(const char *root, int credentials, int iterations)
+{
+    size_t ntypes = sizeof(credential_types) / sizeof(char*);
+    RootIdentity *rootidentity;
+    DIDDocument *doc = NULL;
+    const char *mnemonic;
+    DIDStore *store;
+    clock_t start;
+    double elapsed;
+    int count, i, rc = -1;
+    DID *did;
+
+    delete_file(root);
+    store = DIDStore_Open(root);
+    if (!store)
+        return -1;
+
+    mnemonic = Mnemonic_Generate("english");
+    if (!mnemonic)
+        goto cleanup;
+
+    rootidentity = RootIdentity_Create(mnemonic, "", true, store, storepass);
+    Mnemonic_Free((void*)mnemonic);
+    if (!rootidentity)
+        goto cleanup;
+
+    doc = RootIdentity_NewDID(rootidentity, storepass, NULL, true);
+    RootIdentity_Destroy(rootidentity);
+    if (!doc)
+        goto cleanup;
+
+    printf("Preparing a DID with %d credentials...\n", credentials);
+    if (fill_credentials(store, doc, credentials) < 0)
+        goto cleanup;
+
+    did = DIDDocument_GetSubject(doc);
+
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        count = 0;
+        if (DIDStore_SelectCredentials(store, did, NULL, credential_types[i % ntypes],
+                count_credential, &count) < 0)
+            goto cleanup;
+    }
+    elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("%-16s %8d ops %10.3f s %12.1f ops/s\n", "select-type", iterations,
+            elapsed, elapsed > 0 ? iterations / elapsed : 0);
+
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        count = 0;
+        if (DIDStore_ListCredentials(store, did, count_credential, &count) < 0)
+            goto cleanup;
+    }
+    elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("%-16s %8d ops %10.3f s %12.1f ops/s\n", "list-credentials", iterations,
+            elapsed, elapsed > 0 ? iterations / elapsed : 0);
+
+    rc = 0;
+
+cleanup:
+    if (doc)
+        DIDDocument_Destroy(doc);
+    DIDStore_Close(store);
+    delete_file(root);
+    return rc;
+}
+
+static void usage(void)
+{
+    fprintf(stdout, "DID Bench\n");
+    fprintf(stdout, "Usage didbench [OPTION]\n");
+    fprintf(stdout, "\n");
+    fprintf(stdout, "  -n, --iterations=N           The iterations of each case, default %d.\n", DEFAULT_ITERATIONS);
+    fprintf(stdout, "  -c, --case=NAME              Only run the named case.\n");
+    fprintf(stdout, "  -s, --store=N                Export and import a store of N DIDs, e.g. 10000.\n");
+    fprintf(stdout, "  -w, --workers=N              The workers of the store case, default %d.\n", DEFAULT_STORE_WORKERS);
+    fprintf(stdout, "  -v, --credentials=N          Select and list the credentials of a DID with N credentials.\n");
+    fprintf(stdout, "\n");
+}
+
+static int setup_context(BenchContext *context, const char *root)
+{
+    RootIdentity *rootidentity;
+    const char *mnemonic;
+
+    memset(context, 0, sizeof(BenchContext));
+
+    context->store = DIDStore_Open(root);
+    if (!context->store)
+        return -1;
+
+    mnemonic = Mnemonic_Generate("english");
+    if (!mnemonic)
+        return -1;
+
+    rootidentity = RootIdentity_Create(mnemonic, "", true, context->store, storepass);
+    Mnemonic_Free((void*)mnemonic);
+    if (!rootidentity)
+        return -1;
+
+    context->doc = RootIdentity_NewDID(rootidentity, storepass, NULL, true);
+    RootIdentity_Destroy(rootidentity);
+    if (!context->doc)
+        return -1;
+
+    context->signkey = DIDDocument_GetDefaultPublicKey(context->doc);
+    if (!context->signkey)
+        return -1;
+
+    context->json = DIDDocument_ToJson(context->doc, true);
+    if (!context->json)
+        return -1;
+
+    //the codec cases work on the document text and the default key.
+    context->base64 = (char*)malloc(strlen(context->json) * 4 / 3 + 16);
+    context->buffer = (uint8_t*)malloc(strlen(context->json) * 4 / 3 + 16);
+    if (!context->base64 || !context->buffer ||
+            b64_url_encode(context->base64, (const uint8_t*)context->json, strlen(context->json)) < 0)
+        return -1;
+
+    context->publickey = PublicKey_GetPublicKeyBase58(
+            DIDDocument_GetPublicKey(context->doc, context->signkey));
+    if (!context->publickey)
+        return -1;
+
+    return bench_sign(context);
+}
+
+static void cleanup_context(BenchContext *context)
+{
+    if (context->json)
+        free((void*)context->json);
+    if (context->base64)
+        free(context->base64);
+    if (context->buffer)
+        free(context->buffer);
+    if (context->doc)
+        DIDDocument_Destroy(context->doc);
+    if (context->store)
+        DIDStore_Close(context->store);
+}
+
+int main(int argc, char *argv[])
+{
+    char root[PATH_MAX];
+    const char *only = NULL;
+    BenchContext context;
+    BenchCase *bench;
+    clock_t start;
+    double elapsed;
+    int iterations = DEFAULT_ITERATIONS, i, rc = -1;
+    int dids = 0, workers = DEFAULT_STORE_WORKERS, credentials = 0;
+
+    int opt;
+    int idx;
+    struct option options[] = {
+        { "iterations",     required_argument,   NULL, 'n' },
+        { "case",           required_argument,   NULL, 'c' },
+        { "store",          required_argument,   NULL, 's' },
+        { "workers",        required_argument,   NULL, 'w' },
+        { "credentials",    required_argument,   NULL, 'v' },
+        { "help",           no_argument,         NULL, 'h' },
+        { NULL,             0,                   NULL,  0  }
+    };
+
+    while ((opt = getopt_long(argc, argv, "n:c:s:w:v:h?", options, &idx)) != -1) {
+        switch (opt) {
+        case 'n':
+            iterations = atoi(optarg);
+            break;
+
+        case 'c':
+            only = optarg;
+            break;
+
+        case 's':
+            dids = atoi(optarg);
+            break;
+
+        case 'w':
+            workers = atoi(optarg);
+            break;
+
+        case 'v':
+            credentials = atoi(optarg);
+            break;
+
+        case 'h':
+        case '?':
+        default:
+            usage();
+            exit(-1);
+        }
+    }
+
+    if (iterations <= 0 || dids < 0 || workers <= 0 || credentials < 0) {
+        usage();
+        exit(-1);
+    }
+
+    if (dids > 0) {
+        snprintf(root, sizeof(root), "%s%s", getenv("HOME"), "/.didbench.export");
+        if (bench_store(root, dids, workers) < 0) {
+            fprintf(stderr, "Bench store failed. Error: %s\n", DIDError_GetLastErrorMessage());
+            return -1;
+        }
+        return 0;
+    }
+
+    if (credentials > 0) {
+        snprintf(root, sizeof(root), "%s%s", getenv("HOME"), "/.didbench.credentials");
+        if (bench_credentials(root, credentials, iterations) < 0) {
+            fprintf(stderr, "Bench credentials failed. Error: %s\n", DIDError_GetLastErrorMessage());
+            return -1;
+        }
+        return 0;
+    }
+
+    snprintf(root, sizeof(root), "%s%s", getenv("HOME"), "/.didbench.store");
+    if (setup_context(&context, root) < 0) {
+        fprintf(stderr, "Setup bench failed. Error: %s\n", DIDError_GetLastErrorMessage());
+        goto cleanup;
+    }
+
+    for (bench = cases; bench->name; bench++) {
+        if (only && strcmp(only, bench->name))
+            continue;
+
+        start = clock();
+        for (i = 0; i < iterations; i++) {
+            if (bench->run(&context) < 0) {
+                fprintf(stderr, "Bench %s failed. Error: %s\n", bench->name,
+                        DIDError_GetLastErrorMessage());
+                goto cleanup;
+            }
+        }
+
+        elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+        printf("%-16s %8d ops %10.3f s %12.1f ops/s\n", bench->name, iterations,
+                elapsed, elapsed > 0 ? iterations / elapsed : 0);
+    }
+
+    rc = 0;
+
+cleanup:
+    cleanup_context(&context);
+    return rc;
+}
@@ -35,6 +35,66 @@
 #include <openssl/pem.h>
 #include <crystal.h>
 
+#ifdef HDKEY_P256_PRECOMPUTE
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+static EC_GROUP *p256_group;
+
+// The shared P-256 group carries the precomputed multiples of the generator,
+// which speed up the fixed-base part of signing and verification. Keys built
+// with EC_KEY_set_group() share the table through the group's reference.
+static const EC_GROUP *get_p256_group(void)
+{
+    EC_GROUP *group, *prev;
+
+    if (p256_group)
+        return p256_group;
+
+    group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+    if (!group)
+        return NULL;
+
+    if (1 != EC_GROUP_precompute_mult(group, NULL)) {
+        EC_GROUP_free(group);
+        return NULL;
+    }
+
+#if defined(_MSC_VER)
+    prev = (EC_GROUP *)InterlockedCompareExchangePointer((PVOID volatile *)&p256_group, group, NULL);
+#else
+    prev = __sync_val_compare_and_swap(&p256_group, NULL, group);
+#endif
+    if (prev) {
+        EC_GROUP_free(group);
+        return prev;
+    }
+
+    return group;
+}
+#endif
+
+static EC_KEY *new_p256_key(void)
+{
+#ifdef HDKEY_P256_PRECOMPUTE
+    const EC_GROUP *group = get_p256_group();
+    EC_KEY *key;
+
+    if (group) {
+        key = EC_KEY_new();
+        if (key && 1 != EC_KEY_set_group(key, group)) {
+            EC_KEY_free(key);
+            key = NULL;
+        }
+
+        return key;
+    }
+#endif
+
+    return EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+}
+
 #define BIP32_SEED_KEY "Bitcoin seed"
 #define BIP32_XPRV     "\x04\x88\xAD\xE4"
 #define BIP32_XPUB     "\x04\x88\xB2\x1E"
@@ -70,7 +130,7 @@ static int _TweakSecret(UInt256 *secretOut, const UInt256 *secretIn,
 void getPubKeyFromPrivKey(void *brecPoint, const UInt256 *k)
 {
     BIGNUM *privkey = BN_bin2bn((const unsigned char *) k, sizeof(*k), NULL);
-    EC_KEY *key = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+    EC_KEY *key = new_p256_key();
     if (NULL != privkey && NULL != key) {
         const EC_GROUP *curve = EC_KEY_get0_group(key);
         EC_POINT *_pubkey = EC_POINT_new(curve);
@@ -256,7 +316,7 @@ ECDSA65Sign_sha256(const void *privKey, size_t privKeyLen, const UInt256 *md,
     if (!privKey || 32 != privKeyLen || !signedData || 64 > signedDataSize)
         return -1;
 
-    EC_KEY *key = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+    EC_KEY *key = new_p256_key();
     if (key) {
         BIGNUM *privkeyIn = BN_bin2bn((const unsigned char *)privKey,
                 (int)privKeyLen, NULL);
@@ -293,48 +353,92 @@ ECDSA65Sign_sha256(const void *privKey, size_t privKeyLen, const UInt256 *md,
     return len;
 }
 
-int ECDSA65Verify_sha256(const void *pubKey, size_t pubKeyLen, const UInt256 *md,
-        const void *signedData, size_t signedDataLen)
+void *ECDSA65PublicKey_New(const void *pubKey, size_t pubKeyLen)
 {
-    const uint8_t *pSignedData = (const uint8_t *)signedData;
+    BIGNUM *_pubkey;
+    EC_KEY *key;
+    EC_POINT *ec_p;
     int rc = 0;
 
-    if (!pubKey || 33 != pubKeyLen || !signedData || 64 != signedDataLen)
-        return rc;
+    if (!pubKey || 33 != pubKeyLen)
+        return NULL;
 
-    // TODO:
-    // if (PublickeyIsValid(pubKey, nid)) {
-    BIGNUM *_pubkey = NULL;
     _pubkey = BN_bin2bn((const unsigned char *)pubKey, (int)pubKeyLen, NULL);
-    EC_KEY *key = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
-    if (NULL != _pubkey && NULL != key) {
+    if (NULL == _pubkey)
+        return NULL;
+
+    key = new_p256_key();
+    if (NULL != key) {
         const EC_GROUP *curve = EC_KEY_get0_group(key);
-        EC_POINT *ec_p = EC_POINT_bn2point(curve, _pubkey, NULL, NULL);
+        ec_p = EC_POINT_bn2point(curve, _pubkey, NULL, NULL);
         if (NULL != ec_p) {
-            if (1 == EC_KEY_set_public_key(key, ec_p)) {
-                ECDSA_SIG *sig = ECDSA_SIG_new();
-                if (NULL != sig) {
-                    BIGNUM *r = BN_bin2bn(pSignedData, 32, NULL);
-                    BIGNUM *s = BN_bin2bn(pSignedData + 32, 32, NULL);
-                    ECDSA_SIG_set0(sig, r, s);
-                    if (1 == ECDSA_do_verify((uint8_t *) md, sizeof(*md), sig, key))
-                        rc = 1;
-
-                    ECDSA_SIG_free(sig);
-                }
-            }
+            rc = EC_KEY_set_public_key(key, ec_p);
             EC_POINT_free(ec_p);
         }
-        EC_KEY_free(key);
-        BN_free(_pubkey);
-    } else {
-        if (NULL != _pubkey) {
-            BN_free(_pubkey);
-        }
-        if (NULL != key) {
+
+        if (1 != rc) {
             EC_KEY_free(key);
+            key = NULL;
         }
     }
+
+    BN_free(_pubkey);
+    return key;
+}
+
+void *ECDSA65PublicKey_Ref(void *key)
+{
+    if (!key || 1 != EC_KEY_up_ref((EC_KEY *)key))
+        return NULL;
+
+    return key;
+}
+
+void ECDSA65PublicKey_Free(void *key)
+{
+    if (key)
+        EC_KEY_free((EC_KEY *)key);
+}
+
+int ECDSA65VerifyWithKey_sha256(void *key, const UInt256 *md,
+        const void *signedData, size_t signedDataLen)
+{
+    const uint8_t *pSignedData = (const uint8_t *)signedData;
+    int rc = 0;
+
+    if (!key || !signedData || 64 != signedDataLen)
+        return rc;
+
+    ECDSA_SIG *sig = ECDSA_SIG_new();
+    if (NULL != sig) {
+        BIGNUM *r = BN_bin2bn(pSignedData, 32, NULL);
+        BIGNUM *s = BN_bin2bn(pSignedData + 32, 32, NULL);
+        ECDSA_SIG_set0(sig, r, s);
+        if (1 == ECDSA_do_verify((uint8_t *) md, sizeof(*md), sig, (EC_KEY *)key))
+            rc = 1;
+
+        ECDSA_SIG_free(sig);
+    }
+
+    return rc;
+}
+
+int ECDSA65Verify_sha256(const void *pubKey, size_t pubKeyLen, const UInt256 *md,
+        const void *signedData, size_t signedDataLen)
+{
+    void *key;
+    int rc = 0;
+
+    if (!pubKey || 33 != pubKeyLen || !signedData || 64 != signedDataLen)
+        return rc;
+
+    // TODO:
+    // if (PublickeyIsValid(pubKey, nid)) {
+    key = ECDSA65PublicKey_New(pubKey, pubKeyLen);
+    if (NULL != key) {
+        rc = ECDSA65VerifyWithKey_sha256(key, md, signedData, signedDataLen);
+        ECDSA65PublicKey_Free(key);
+    }
     // }
     return rc;
 }
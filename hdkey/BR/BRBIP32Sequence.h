@@ -123,6 +123,15 @@ ssize_t ECDSA65Sign_sha256(const void *privKey, size_t privKeyLen,
 int ECDSA65Verify_sha256(const void *pubKey, size_t pubKeyLen, const UInt256 *md,
         const void *signedData, size_t signedDataLen);
 
+void *ECDSA65PublicKey_New(const void *pubKey, size_t pubKeyLen);
+
+void *ECDSA65PublicKey_Ref(void *key);
+
+void ECDSA65PublicKey_Free(void *key);
+
+int ECDSA65VerifyWithKey_sha256(void *key, const UInt256 *md,
+        const void *signedData, size_t signedDataLen);
+
 void BRBIP32vRootFromSeed(UInt256 *secret, UInt256 *chaincode, const void *seed,
         size_t seedLen);
 
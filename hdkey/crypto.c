@@ -21,13 +21,16 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 #include <assert.h>
+#include <pthread.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 #include <openssl/opensslv.h>
-#include <openssl/bio.h>
 #include <openssl/evp.h>
-#include <openssl/buffer.h>
 #include <openssl/conf.h>
 #include <openssl/md5.h>
 #include <openssl/err.h>
@@ -35,7 +38,6 @@
 #include <crystal.h>
 
 #include "BRInt.h"
-#include "BRBase58.h"
 #include "BRCrypto.h"
 #include "BRBIP32Sequence.h"
 #include "HDkey.h"
@@ -187,125 +189,278 @@ ssize_t decrypt_from_b64(uint8_t *plain, const char *passwd, const char *base64)
 {
     size_t len = strlen(base64);
     unsigned char *cipher = (unsigned char *)alloca(len);
-    len = b64_url_decode(cipher, base64);
-    return aes256_decrypt(plain, passwd, cipher, len);
+    ssize_t size = b64_url_decode(cipher, base64);
+    if (size < 0)
+        return -1;
+
+    return aes256_decrypt(plain, passwd, cipher, size);
 }
 
+static const char b64_url_chars[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+//The decode tables take both the url safe and the standard alphabet.
+#define __ 0xFF
+static const uint8_t b64_values[256] = {
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, 62, __, 62, __, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, __, __, __, __, __, __,
+    __,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, __, __, __, __, 63,
+    __, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __
+};
+
+static const char b58_chars[] =
+        "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+static const uint8_t b58_values[256] = {
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __,  0,  1,  2,  3,  4,  5,  6,  7,  8, __, __, __, __, __, __,
+    __,  9, 10, 11, 12, 13, 14, 15, 16, __, 17, 18, 19, 20, 21, __,
+    22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, __, __, __, __, __,
+    __, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, __, 44, 45, 46,
+    47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __
+};
+#undef __
+
+//58^5, the largest power of 58 in 32 bits.
+#define B58_LIMB                656356768U
+#define B58_LIMB_DIGITS         5
+
 /* Caller should provide enough buffer for base64 */
 ssize_t b64_url_encode(char *base64, const uint8_t *input, size_t len)
 {
-    BIO *bio, *b64;
-    BUF_MEM *bufferPtr;
-    ssize_t b64_len;
-
-    // TODO: Check errors
-    b64 = BIO_new(BIO_f_base64());
-    bio = BIO_new(BIO_s_mem());
-    bio = BIO_push(b64, bio);
-
-    BIO_set_flags(bio, BIO_FLAGS_BASE64_NO_NL); //Ignore newlines - write everything in one line
-    BIO_write(bio, input, len);
-    BIO_flush(bio);
-    BIO_get_mem_ptr(bio, &bufferPtr);
-    BIO_set_close(bio, BIO_NOCLOSE);
-    BIO_free_all(bio);
-
-    b64_len = bufferPtr->length;
-    memcpy(base64, bufferPtr->data, b64_len);
-    base64[b64_len] = 0;
-    BUF_MEM_free(bufferPtr);
-
-    // To URL safe mode
-    for (char *p = base64; *p != 0; p++) {
-        if (*p == '+') {
-            *p = '-';
-        } else if (*p == '/') {
-            *p = '_';
-        } else if (*p == '=') {
-            *p = 0;
-            b64_len--;
-        }
-    }
+    const uint8_t *end = input + len - len % 3;
+    char *p = base64;
+    uint32_t v;
 
-    return b64_len; //success
-}
+    if (!base64 || (!input && len))
+        return -1;
+
+    for (; input < end; input += 3) {
+        v = ((uint32_t)input[0] << 16) | ((uint32_t)input[1] << 8) | input[2];
+        *p++ = b64_url_chars[v >> 18];
+        *p++ = b64_url_chars[(v >> 12) & 0x3F];
+        *p++ = b64_url_chars[(v >> 6) & 0x3F];
+        *p++ = b64_url_chars[v & 0x3F];
+    }
 
-static size_t base64_decode_length(const char* b64input)
-{ //Calculates the length of a decoded string
-    size_t len = strlen(b64input),
-        padding = 0;
+    //url safe mode has no padding.
+    if (len % 3) {
+        v = (uint32_t)input[0] << 16;
+        if (len % 3 == 2)
+            v |= (uint32_t)input[1] << 8;
 
-    if (b64input[len-1] == '=' && b64input[len-2] == '=') //last two chars are =
-        padding = 2;
-    else if (b64input[len-1] == '=') //last char is =
-        padding = 1;
+        *p++ = b64_url_chars[v >> 18];
+        *p++ = b64_url_chars[(v >> 12) & 0x3F];
+        if (len % 3 == 2)
+            *p++ = b64_url_chars[(v >> 6) & 0x3F];
+    }
 
-    return (len*3)/4 - padding;
+    *p = 0;
+    return p - base64;
 }
 
 /* Caller should provide enough buffer for result buffer */
 ssize_t b64_url_decode(uint8_t *buffer, const char *base64)
 {
-    BIO *bio, *b64;
-    ssize_t len = strlen(base64);
+    const uint8_t *s = (const uint8_t *)base64;
+    uint8_t *p = buffer;
+    size_t len, rest;
+    uint8_t a, b, c, d;
+    uint32_t v;
 
-    //
-    char *_base64 = malloc(len + 8);
-    if (!_base64)
+    if (!buffer || !base64)
         return -1;
 
-    strcpy(_base64, base64);
+    len = strlen(base64);
+    //the padding is optional.
+    if (len % 4 == 0 && len > 0 && s[len - 1] == '=')
+        len -= (s[len - 2] == '=') ? 2 : 1;
 
-    int l = len % 4;
-    if (l == 2) {
-        strcat(_base64, "==");
-        len += 2;
-    } else if (l == 3) {
-        strcat(_base64, "=");
-        len++;
-    }
+    rest = len % 4;
+    if (rest == 1)
+        return -1;
 
-    for (char *p = _base64; *p != 0; p++) {
-        if (*p == '-')
-            *p = '+';
-        else if (*p == '_')
-            *p = '/';
+    for (len -= rest; len > 0; len -= 4, s += 4) {
+        a = b64_values[s[0]];
+        b = b64_values[s[1]];
+        c = b64_values[s[2]];
+        d = b64_values[s[3]];
+        //the invalid chars are 0xFF, the top bits are never set by a digit.
+        if ((a | b | c | d) & 0xC0)
+            return -1;
+
+        v = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | d;
+
+        *p++ = (uint8_t)(v >> 16);
+        *p++ = (uint8_t)(v >> 8);
+        *p++ = (uint8_t)v;
     }
 
-    bio = BIO_new_mem_buf((char*)_base64, len);
-    b64 = BIO_new(BIO_f_base64());
-    bio = BIO_push(b64, bio);
+    if (rest) {
+        a = b64_values[s[0]];
+        b = b64_values[s[1]];
+        c = rest == 3 ? b64_values[s[2]] : 0;
+        if ((a | b | c) & 0xC0)
+            return -1;
 
-    BIO_set_flags(bio, BIO_FLAGS_BASE64_NO_NL); //Do not use newlines to flush buffer
-    len = BIO_read(bio, buffer, len);
-    assert(len == base64_decode_length(_base64));
-    BIO_free_all(bio);
-    free(_base64);
+        v = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6);
 
-    return len; //success
+        *p++ = (uint8_t)(v >> 16);
+        if (rest == 3)
+            *p++ = (uint8_t)(v >> 8);
+    }
+
+    return p - buffer;
 }
+
 ssize_t b58_encode(char *base58, size_t base58_len, uint8_t *input, size_t len)
 {
+    uint32_t *limbs, limb;
+    size_t zcount = 0, count = 0, size, i, j, chunk;
+    uint64_t carry;
+    char digits[B58_LIMB_DIGITS];
+    char *p;
+
     if (!base58 || base58_len <= 0 || !input || !len)
         return -1;
 
-    size_t size = BRBase58Encode(NULL, 0, input, len);
-    if (size > base58_len)
+    while (zcount < len && input[zcount] == 0)
+        zcount++;
+
+    //the limbs are little endian in base 58^5, 32 input bits are taken at once.
+    limbs = (uint32_t *)alloca(((len - zcount) * 138 / 100 / B58_LIMB_DIGITS + 2) * sizeof(uint32_t));
+    for (i = zcount; i < len; i += chunk) {
+        chunk = (len - i) % 4 ? (len - i) % 4 : 4;
+        carry = 0;
+        for (j = 0; j < chunk; j++)
+            carry = (carry << 8) | input[i + j];
+
+        for (j = 0; j < count; j++) {
+            carry += (uint64_t)limbs[j] << (chunk * 8);
+            limbs[j] = (uint32_t)(carry % B58_LIMB);
+            carry /= B58_LIMB;
+        }
+        while (carry) {
+            limbs[count++] = (uint32_t)(carry % B58_LIMB);
+            carry /= B58_LIMB;
+        }
+    }
+
+    //the leading zeros are not written, ela addresses don't start with '1'.
+    size = 0;
+    if (count > 0) {
+        for (limb = limbs[count - 1]; limb; limb /= 58)
+            size++;
+        size += (count - 1) * B58_LIMB_DIGITS;
+    }
+    //keep the length BRBase58Encode reports, it counts the zeros and the NUL.
+    if (zcount + size + 1 > base58_len) {
+        mem_clean(limbs, count * sizeof(uint32_t));
         return 0;
+    }
+
+    p = base58;
+    for (i = count; i > 0; i--) {
+        limb = limbs[i - 1];
+        for (j = B58_LIMB_DIGITS; j > 0; j--) {
+            digits[j - 1] = b58_chars[limb % 58];
+            limb /= 58;
+        }
 
-    return BRBase58Encode(base58, size, input, len);
+        //the top limb has no leading '1'.
+        j = (i == count) ? B58_LIMB_DIGITS - (size - (count - 1) * B58_LIMB_DIGITS) : 0;
+        memcpy(p, digits + j, B58_LIMB_DIGITS - j);
+        p += B58_LIMB_DIGITS - j;
+    }
+    *p = 0;
+
+    mem_clean(limbs, count * sizeof(uint32_t));
+    mem_clean(digits, sizeof(digits));
+    return zcount + size + 1;
 }
 
 ssize_t b58_decode(uint8_t *data, size_t len, const char *base58)
 {
+    const uint8_t *s = (const uint8_t *)base58;
+    uint32_t *limbs, value, scale;
+    size_t zcount = 0, count = 0, size, i, j, n;
+    uint64_t carry;
+    uint8_t digit;
+
     if (!data || len <= 0 || !base58)
         return -1;
 
-    size_t size = BRBase58Decode(NULL, 0, base58);
-    if (size > len)
+    while (*s == '1')
+        s++, zcount++;
+
+    //the limbs are little endian in base 2^32, 5 digits are taken at once.
+    n = strlen((const char *)s);
+    limbs = (uint32_t *)alloca((n * 733 / 1000 / 4 + 2) * sizeof(uint32_t));
+    while (*s) {
+        value = 0;
+        scale = 1;
+        for (i = 0; i < B58_LIMB_DIGITS && *s; i++, s++) {
+            digit = b58_values[*s];
+            //stop at an invalid digit as BRBase58Decode does.
+            if (digit == 0xFF)
+                break;
+
+            value = value * 58 + digit;
+            scale *= 58;
+        }
+
+        carry = value;
+        for (j = 0; j < count; j++) {
+            carry += (uint64_t)limbs[j] * scale;
+            limbs[j] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        if (carry)
+            limbs[count++] = (uint32_t)carry;
+
+        if (i < B58_LIMB_DIGITS && *s)
+            break;
+    }
+
+    size = 0;
+    if (count > 0) {
+        for (value = limbs[count - 1]; value; value >>= 8)
+            size++;
+        size += (count - 1) * 4;
+    }
+    if (zcount + size > len) {
+        mem_clean(limbs, count * sizeof(uint32_t));
         return 0;
+    }
 
-    return BRBase58Decode(data, size, base58);
+    memset(data, 0, zcount);
+    for (i = 0; i < size; i++)
+        data[zcount + size - 1 - i] = (uint8_t)(limbs[i / 4] >> ((i % 4) * 8));
+
+    mem_clean(limbs, count * sizeof(uint32_t));
+    return zcount + size;
 }
 
 int sha256_digest_init(Sha256_Digest *sha256_digest)
@@ -459,19 +614,275 @@ int ecdsa_verify(uint8_t *sig, uint8_t *publickey, uint8_t *digest, size_t size)
 
 int ecdsa_verify_base64(char *sig, uint8_t *publickey, uint8_t *digest, size_t size)
 {
-    uint8_t binsig[SIGNATURE_BYTES];
-    ssize_t len;
+    uint8_t binsig[SIGNATURE_BYTES * 2];
 
     if (!sig || !publickey || !digest || size != SHA256_BYTES)
         return -1;
 
-    len = b64_url_decode(binsig, sig);
-    if (len < 0 )
+    // The decoded text is shorter than the text, so a text that fits the
+    // buffer can't overflow it.
+    if (strlen(sig) >= sizeof(binsig) || b64_url_decode(binsig, sig) != SIGNATURE_BYTES)
         return -1;
 
     return ecdsa_verify(binsig, publickey, digest, size);
 }
 
+PreparedPublicKey *ecdsa_prepare_publickey(uint8_t *publickey, size_t size)
+{
+    if (!publickey || size != PUBLICKEY_BYTES)
+        return NULL;
+
+    return (PreparedPublicKey *)ECDSA65PublicKey_New(publickey, size);
+}
+
+PreparedPublicKey *ecdsa_publickey_ref(PreparedPublicKey *key)
+{
+    return (PreparedPublicKey *)ECDSA65PublicKey_Ref(key);
+}
+
+void ecdsa_publickey_free(PreparedPublicKey *key)
+{
+    ECDSA65PublicKey_Free(key);
+}
+
+int ecdsa_verify_prepared(uint8_t *sig, PreparedPublicKey *key, uint8_t *digest, size_t size)
+{
+    int rc;
+
+    if (!sig || !key || !digest || size != SHA256_BYTES)
+        return -1;
+
+    rc = ECDSA65VerifyWithKey_sha256(key, (const UInt256 *)digest, sig, SIGNATURE_BYTES);
+    return rc == 0 ? -1 : 0;
+}
+
+int ecdsa_verify_base64_prepared(char *sig, PreparedPublicKey *key, uint8_t *digest, size_t size)
+{
+    uint8_t binsig[SIGNATURE_BYTES * 2];
+
+    if (!sig || !key || !digest || size != SHA256_BYTES)
+        return -1;
+
+    // The decoded text is shorter than the text, so a text that fits the
+    // buffer can't overflow it.
+    if (strlen(sig) >= sizeof(binsig) || b64_url_decode(binsig, sig) != SIGNATURE_BYTES)
+        return -1;
+
+    return ecdsa_verify_prepared(binsig, key, digest, size);
+}
+
+#define MAX_VERIFY_WORKERS      8
+
+typedef struct VerifyJob {
+    struct VerifyJob *next;
+    EcdsaVerifyItem *items;
+    size_t count;
+    size_t claimed;
+    size_t finished;
+    pthread_cond_t done;
+} VerifyJob;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    VerifyJob *jobs;
+    int workers;
+    bool started;
+    bool stopping;
+    pthread_t threads[MAX_VERIFY_WORKERS];
+} verify_pool = {
+    PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,
+    NULL,
+    0,
+    false,
+    false
+};
+
+// Claim the next item of the first queued job, called with the pool lock.
+static EcdsaVerifyItem *verify_claim(VerifyJob **job)
+{
+    VerifyJob *head = verify_pool.jobs;
+    EcdsaVerifyItem *item;
+
+    if (!head)
+        return NULL;
+
+    item = &head->items[head->claimed++];
+    if (head->claimed == head->count)
+        verify_pool.jobs = head->next;
+
+    *job = head;
+    return item;
+}
+
+static void verify_item(EcdsaVerifyItem *item)
+{
+    int rc;
+
+    rc = ECDSA65VerifyWithKey_sha256(item->key, (const UInt256 *)item->digest,
+            item->signature, SIGNATURE_BYTES);
+    item->result = rc == 0 ? -1 : 0;
+}
+
+static void *verify_worker(void *arg)
+{
+    EcdsaVerifyItem *item;
+    VerifyJob *job;
+
+    (void)arg;
+
+    pthread_mutex_lock(&verify_pool.lock);
+    while (1) {
+        item = verify_claim(&job);
+        if (!item) {
+            // Leave once the queue is drained.
+            if (verify_pool.stopping)
+                break;
+
+            pthread_cond_wait(&verify_pool.ready, &verify_pool.lock);
+            continue;
+        }
+
+        pthread_mutex_unlock(&verify_pool.lock);
+        verify_item(item);
+        pthread_mutex_lock(&verify_pool.lock);
+
+        if (++job->finished == job->count)
+            pthread_cond_signal(&job->done);
+    }
+
+    pthread_mutex_unlock(&verify_pool.lock);
+    return NULL;
+}
+
+// Called with the pool lock, the workers start with the first batch.
+static void verify_pool_start(void)
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+    static bool registered = false;
+#endif
+    long cpus = 2;
+    int i;
+
+    if (verify_pool.started)
+        return;
+
+#if defined(_SC_NPROCESSORS_ONLN)
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (cpus > MAX_VERIFY_WORKERS)
+        cpus = MAX_VERIFY_WORKERS;
+
+    // The caller of ecdsa_verify_batch works too, so one thread less.
+    for (i = 1; i < cpus; i++) {
+        if (pthread_create(&verify_pool.threads[verify_pool.workers], NULL,
+                verify_worker, NULL) != 0)
+            break;
+        verify_pool.workers++;
+    }
+
+    verify_pool.started = true;
+
+    // Joining threads at the unload of a Windows dll deadlocks on the
+    // loader lock, there the process exit takes the workers down.
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (!registered)
+        registered = atexit(ecdsa_verify_cleanup) == 0;
+#endif
+}
+
+void ecdsa_verify_cleanup(void)
+{
+    pthread_t threads[MAX_VERIFY_WORKERS];
+    int workers, i;
+
+    pthread_mutex_lock(&verify_pool.lock);
+    if (!verify_pool.started || verify_pool.stopping) {
+        pthread_mutex_unlock(&verify_pool.lock);
+        return;
+    }
+
+    verify_pool.stopping = true;
+    workers = verify_pool.workers;
+    memcpy(threads, verify_pool.threads, sizeof(pthread_t) * workers);
+    pthread_cond_broadcast(&verify_pool.ready);
+    pthread_mutex_unlock(&verify_pool.lock);
+
+    for (i = 0; i < workers; i++)
+        pthread_join(threads[i], NULL);
+
+    // The next batch starts the workers again.
+    pthread_mutex_lock(&verify_pool.lock);
+    verify_pool.workers = 0;
+    verify_pool.started = false;
+    verify_pool.stopping = false;
+    pthread_mutex_unlock(&verify_pool.lock);
+}
+
+int ecdsa_verify_batch(EcdsaVerifyItem *items, size_t count)
+{
+    EcdsaVerifyItem *item;
+    VerifyJob job, *claimed, **pp;
+    size_t i;
+    int rc = 0;
+
+    if (count == 0)
+        return 0;
+
+    if (!items)
+        return -1;
+
+    for (i = 0; i < count; i++) {
+        if (!items[i].key)
+            return -1;
+        items[i].result = -1;
+    }
+
+    if (count == 1) {
+        verify_item(items);
+        return items->result;
+    }
+
+    memset(&job, 0, sizeof(job));
+    job.items = items;
+    job.count = count;
+    pthread_cond_init(&job.done, NULL);
+
+    pthread_mutex_lock(&verify_pool.lock);
+    verify_pool_start();
+    for (pp = &verify_pool.jobs; *pp; pp = &(*pp)->next);
+    *pp = &job;
+    pthread_cond_broadcast(&verify_pool.ready);
+
+    // Help with the queued items until our job is all claimed.
+    while (job.claimed < job.count) {
+        item = verify_claim(&claimed);
+        if (!item)
+            break;
+
+        pthread_mutex_unlock(&verify_pool.lock);
+        verify_item(item);
+        pthread_mutex_lock(&verify_pool.lock);
+
+        if (++claimed->finished == claimed->count && claimed != &job)
+            pthread_cond_signal(&claimed->done);
+    }
+
+    while (job.finished < job.count)
+        pthread_cond_wait(&job.done, &verify_pool.lock);
+    pthread_mutex_unlock(&verify_pool.lock);
+
+    pthread_cond_destroy(&job.done);
+
+    for (i = 0; i < count; i++) {
+        if (items[i].result != 0)
+            rc = -1;
+    }
+
+    return rc;
+}
+
 int md5(uint8_t *md5, size_t size, uint8_t *data, size_t datasize)
 {
     if (!md5 || size < 16 || !data || datasize == 0)
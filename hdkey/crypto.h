@@ -43,6 +43,16 @@ typedef struct Sha256_Digest {
     unsigned char __opaque[sizeof(void *) * 8];
 } Sha256_Digest;
 
+// The decoded and decompressed public key, ready to verify signatures.
+typedef struct PreparedPublicKey PreparedPublicKey;
+
+typedef struct EcdsaVerifyItem {
+    PreparedPublicKey *key;
+    uint8_t digest[SHA256_BYTES];
+    uint8_t signature[SIGNATURE_BYTES];
+    int result;
+} EcdsaVerifyItem;
+
 // TODO: not a safe design, caller should provide large enough buffer
 //        to receive the result
 ssize_t encrypt_to_b64(char *base64, const char *passwd,
@@ -84,6 +94,24 @@ int ecdsa_verify(uint8_t *sig, uint8_t *publickey, uint8_t *digest, size_t size)
 
 int ecdsa_verify_base64(char *sig, uint8_t *publickey, uint8_t *digest, size_t size);
 
+PreparedPublicKey *ecdsa_prepare_publickey(uint8_t *publickey, size_t size);
+
+PreparedPublicKey *ecdsa_publickey_ref(PreparedPublicKey *key);
+
+void ecdsa_publickey_free(PreparedPublicKey *key);
+
+int ecdsa_verify_prepared(uint8_t *sig, PreparedPublicKey *key, uint8_t *digest, size_t size);
+
+int ecdsa_verify_base64_prepared(char *sig, PreparedPublicKey *key, uint8_t *digest, size_t size);
+
+// Verify the items on the worker pool, the result of each item is set to 0
+// or -1. Returns 0 if all the items are verified, otherwise -1.
+int ecdsa_verify_batch(EcdsaVerifyItem *items, size_t count);
+
+// Stop and join the verify workers, also run at exit. A later batch starts
+// them again.
+void ecdsa_verify_cleanup(void);
+
 int md5(uint8_t *md5, size_t size, uint8_t *data, size_t datasize);
 
 #ifdef __cplusplus
@@ -300,7 +300,7 @@ static int parser_payload(DIDRequest *request, json_t *json)
     const char *payload;
     char *docJson;
     DID *subject;
-    size_t len;
+    ssize_t len;
 
     assert(request);
     assert(json);
@@ -441,11 +441,10 @@ errorExit:
     return -1;
 }
 
-bool DIDRequest_IsValid(DIDRequest *request, DIDDocument *document)
+bool DIDRequest_CollectValid(DIDRequest *request, DIDDocument *document, VerifyBatch *batch)
 {
     DIDDocument *signerdoc;
     DIDURL *signkey;
-    int rc;
 
     assert(request);
 
@@ -474,22 +473,57 @@ bool DIDRequest_IsValid(DIDRequest *request, DIDDocument *document)
         }
     }
 
-    if (!DIDDocument_IsValid(signerdoc)) {
+    //The proofs of a verified request are already checked, only the checks
+    //which depend on the current time and metadata are done again.
+    if (!batch) {
+        if (DIDDocument_IsValid_WithoutProof(signerdoc) != 1) {
+            DIDError_Set(DIDERR_INVALID_KEY, "Signer isn't valid.");
+            return false;
+        }
+
+        return true;
+    }
+
+    if (DIDDocument_CollectValid(signerdoc, batch) != 1) {
         DIDError_Set(DIDERR_INVALID_KEY, "Signer isn't valid.");
         return false;
     }
 
-    rc = DIDDocument_Verify(signerdoc, &request->proof.verificationMethod,
+    if (VerifyBatch_Add(batch, signerdoc, &request->proof.verificationMethod,
                 (char*)request->proof.signatureValue, 5,
                 request->header.spec, strlen(request->header.spec),
                 request->header.op, strlen(request->header.op),
                 request->header.prevtxid, strlen(request->header.prevtxid),
                 request->header.ticket, strlen(request->header.ticket),
-                request->payload, strlen(request->payload));
-    if (rc < 0)
+                request->payload, strlen(request->payload)) < 0) {
         DIDError_Set(DIDERR_VERIFY_ERROR, "Verify didrequest failed.");
+        return false;
+    }
+
+    return true;
+}
 
-    return rc == -1 ? false : true;
+bool DIDRequest_IsValid_Internal(DIDRequest *request, DIDDocument *document, bool verify)
+{
+    VerifyBatch batch;
+    bool valid;
+
+    assert(request);
+
+    memset(&batch, 0, sizeof(batch));
+    valid = DIDRequest_CollectValid(request, document, verify ? &batch : NULL);
+    if (valid && verify && VerifyBatch_Verify(&batch) < 0) {
+        DIDError_Set(DIDERR_VERIFY_ERROR, "Verify didrequest failed.");
+        valid = false;
+    }
+
+    VerifyBatch_Destroy(&batch);
+    return valid;
+}
+
+bool DIDRequest_IsValid(DIDRequest *request, DIDDocument *document)
+{
+    return DIDRequest_IsValid_Internal(request, document, true);
 }
 
 void DIDRequest_Destroy(DIDRequest *request)
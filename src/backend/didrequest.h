@@ -29,6 +29,7 @@
 #include "JsonGenerator.h"
 #include "did.h"
 #include "didurl.h"
+#include "diddocument.h"
 #include "common.h"
 #include "ticket.h"
 
@@ -80,6 +81,10 @@ int DIDRequest_ToJson_Internal(JsonGenerator *gen, DIDRequest *req);
 
 bool DIDRequest_IsValid(DIDRequest *request, DIDDocument *document);
 
+bool DIDRequest_CollectValid(DIDRequest *request, DIDDocument *document, VerifyBatch *batch);
+
+bool DIDRequest_IsValid_Internal(DIDRequest *request, DIDDocument *document, bool verify);
+
 #ifdef __cplusplus
 }
 #endif
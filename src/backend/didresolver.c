@@ -23,18 +23,33 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <limits.h>
 #include <curl/curl.h>
 #include <assert.h>
 #include <jansson.h>
+#include <pthread.h>
 
 #include "ela_did.h"
 #include "common.h"
 #include "diderror.h"
 #include "didresolver.h"
 
-static char gURL[URL_LEN];
 static int MAX_DIFF = 10;
 
+#define MAX_IDLE_HANDLES     8
+
+//The idle easy handles keep their own warm connections, and all handles share
+//the dns cache and tls sessions through gShare. The connection cache is not
+//shared: libcurl doesn't support using it from concurrent threads.
+static CURLSH *gShare;
+static struct curl_slist *gHeaders;
+static CURL *gIdleHandles[MAX_IDLE_HANDLES];
+static int gIdleCount;
+static pthread_mutex_t gPoolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t gShareLocks[CURL_LOCK_DATA_LAST];
+static pthread_once_t gTransportOnce = PTHREAD_ONCE_INIT;
+static bool gTransportReady;
+
 static const char *MAINNET = "mainnet";
 static const char *TESTNET = "testnet";
 static const char *MAINNET_RESOLVERS[] = {
@@ -127,67 +142,386 @@ static size_t HttpRequestBodyReadCallback(void *dest, size_t size,
     return 0;
 }
 
-static const char *perform_request(const char *url, const char *request_content)
-{
+//A request sent through a multi handle, it owns the copy of the request body.
+typedef struct ResolverTransfer {
+    struct ResolverTransfer *next;
+    CURL *curl;
     HttpRequestBody request;
     HttpResponseBody response;
-    long httpcode;
+    DefaultResolve_Callback *callback;
+    void *context;
+} ResolverTransfer;
+
+struct ResolverMulti {
+    pthread_mutex_t lock;
+    CURLM *multi;
+    ResolverTransfer *submitted;
+    ResolverTransfer *running;
+};
 
-    assert(url);
-    assert(request_content);
+static void share_lock(CURL *handle, curl_lock_data data,
+        curl_lock_access access, void *userptr)
+{
+    (void)handle;
+    (void)access;
+    (void)userptr;
 
-    request.used = 0;
-    request.sz = strlen(request_content);
-    request.data = (char*)request_content;
+    pthread_mutex_lock(&gShareLocks[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userptr)
+{
+    (void)handle;
+    (void)userptr;
+
+    pthread_mutex_unlock(&gShareLocks[data]);
+}
+
+static void transport_init(void)
+{
+    int i;
+
+    if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK)
+        return;
+
+    gTransportReady = true;
+    for (i = 0; i < CURL_LOCK_DATA_LAST; i++)
+        pthread_mutex_init(&gShareLocks[i], NULL);
+
+    gShare = curl_share_init();
+    if (gShare) {
+        curl_share_setopt(gShare, CURLSHOPT_LOCKFUNC, share_lock);
+        curl_share_setopt(gShare, CURLSHOPT_UNLOCKFUNC, share_unlock);
+        curl_share_setopt(gShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(gShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+
+    gHeaders = curl_slist_append(gHeaders, "Content-Type: application/json");
+    gHeaders = curl_slist_append(gHeaders, "Accept: application/json");
+}
+
+static CURL *acquire_handle(void)
+{
+    CURL *curl = NULL;
+
+    pthread_once(&gTransportOnce, transport_init);
+    if (!gTransportReady)
+        return NULL;
+
+    pthread_mutex_lock(&gPoolLock);
+    if (gIdleCount > 0)
+        curl = gIdleHandles[--gIdleCount];
+    pthread_mutex_unlock(&gPoolLock);
+
+    if (curl)
+        curl_easy_reset(curl);
+    else
+        curl = curl_easy_init();
+
+    return curl;
+}
+
+static void release_handle(CURL *curl)
+{
+    assert(curl);
+
+    pthread_mutex_lock(&gPoolLock);
+    if (gIdleCount < MAX_IDLE_HANDLES) {
+        gIdleHandles[gIdleCount++] = curl;
+        curl = NULL;
+    }
+    pthread_mutex_unlock(&gPoolLock);
+
+    if (curl)
+        curl_easy_cleanup(curl);
+}
+
+static void setup_request(CURL *curl, const char *url, long connecttimeout, long timeout,
+        HttpRequestBody *request, HttpResponseBody *response)
+{
+    assert(curl);
+    assert(url);
+    assert(request);
+    assert(response);
 
-    CURL *curl = curl_easy_init();
     curl_easy_setopt(curl, CURLOPT_URL, url);
+    if (gShare)
+        curl_easy_setopt(curl, CURLOPT_SHARE, gShare);
+
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    if (connecttimeout > 0)
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, connecttimeout);
+    if (timeout > 0)
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout);
 
     curl_easy_setopt(curl, CURLOPT_POST, 1L);
     curl_easy_setopt(curl, CURLOPT_READFUNCTION, HttpRequestBodyReadCallback);
-    curl_easy_setopt(curl, CURLOPT_READDATA, &request);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)request.sz);
+    curl_easy_setopt(curl, CURLOPT_READDATA, request);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)request->sz);
 
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, HttpResponseBodyWriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
 
 #if defined(_WIN32) || defined(_WIN64)
     curl_easy_setopt(curl, CURLOPT_SSL_OPTIONS, CURLSSLOPT_NATIVE_CA);
 #endif
 
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-    headers = curl_slist_append(headers, "Accept: application/json");
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, gHeaders);
+
+    memset(response, 0, sizeof(HttpResponseBody));
+}
+
+//Hand the handle back to the pool and take the response body out.
+static const char *finish_request(CURL *curl, CURLcode rc, HttpResponseBody *response)
+{
+    long httpcode;
+
+    assert(curl);
+    assert(response);
 
-    memset(&response, 0, sizeof(response));
-    CURLcode rc = curl_easy_perform(curl);
-    curl_slist_free_all(headers);
     if (rc != CURLE_OK) {
         DIDError_Set(DIDERR_NETWORK, "Resolve error, status: %d, message: %s", rc, curl_easy_strerror(rc));
-        curl_easy_cleanup(curl);
-        if (response.data)
-            free(response.data);
+        release_handle(curl);
+        if (response->data)
+            free(response->data);
 
         return NULL;
     }
 
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpcode);
-    curl_easy_cleanup(curl);
+    release_handle(curl);
     if (httpcode < 200 || httpcode > 250) {
         DIDError_Set(DIDERR_NETWORK, "Http error, code: %d", httpcode);
-        if (response.data)
-            free(response.data);
+        if (response->data)
+            free(response->data);
+        return NULL;
+    }
+
+    ((char *)response->data)[response->used] = 0;
+    return (const char *)response->data;
+}
+
+static const char *perform_request(const char *url, long connecttimeout, long timeout,
+        const char *request_content)
+{
+    HttpRequestBody request;
+    HttpResponseBody response;
+    CURL *curl;
+
+    assert(url);
+    assert(request_content);
+
+    request.used = 0;
+    request.sz = strlen(request_content);
+    request.data = (char*)request_content;
+
+    curl = acquire_handle();
+    if (!curl) {
+        DIDError_Set(DIDERR_NETWORK, "Initialize curl handle failed.");
+        return NULL;
+    }
+
+    setup_request(curl, url, connecttimeout, timeout, &request, &response);
+    return finish_request(curl, curl_easy_perform(curl), &response);
+}
+
+const char *DefaultResolve_Resolve(ResolverTransport *transport, const char *resolve_request)
+{
+    assert(transport);
+    assert(resolve_request);
+
+    return perform_request(transport->url, transport->connecttimeout, transport->timeout,
+            resolve_request);
+}
+
+ResolverMulti *ResolverMulti_Create(void)
+{
+    ResolverMulti *multi;
+
+    pthread_once(&gTransportOnce, transport_init);
+    if (!gTransportReady) {
+        DIDError_Set(DIDERR_NETWORK, "Initialize curl failed.");
         return NULL;
     }
 
-    ((char *)response.data)[response.used] = 0;
-    return (const char *)response.data;
+    multi = (ResolverMulti*)calloc(1, sizeof(ResolverMulti));
+    if (!multi) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for resolver failed.");
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&multi->lock, NULL) != 0) {
+        DIDError_Set(DIDERR_UNKNOWN, "Initialize lock for resolver failed.");
+        free(multi);
+        return NULL;
+    }
+
+    multi->multi = curl_multi_init();
+    if (!multi->multi) {
+        DIDError_Set(DIDERR_NETWORK, "Initialize curl multi handle failed.");
+        pthread_mutex_destroy(&multi->lock);
+        free(multi);
+        return NULL;
+    }
+
+    return multi;
+}
+
+int ResolverMulti_Submit(ResolverMulti *multi, ResolverTransport *transport,
+        const char *resolve_request, DefaultResolve_Callback *callback, void *context)
+{
+    ResolverTransfer *transfer;
+
+    assert(multi);
+    assert(transport);
+    assert(resolve_request);
+    assert(callback);
+
+    transfer = (ResolverTransfer*)calloc(1, sizeof(ResolverTransfer));
+    if (!transfer) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for request failed.");
+        return -1;
+    }
+
+    transfer->request.data = strdup(resolve_request);
+    if (!transfer->request.data) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for request failed.");
+        free(transfer);
+        return -1;
+    }
+    transfer->request.sz = strlen(resolve_request);
+
+    transfer->curl = acquire_handle();
+    if (!transfer->curl) {
+        DIDError_Set(DIDERR_NETWORK, "Initialize curl handle failed.");
+        free(transfer->request.data);
+        free(transfer);
+        return -1;
+    }
+
+    setup_request(transfer->curl, transport->url, transport->connecttimeout,
+            transport->timeout, &transfer->request, &transfer->response);
+    curl_easy_setopt(transfer->curl, CURLOPT_PRIVATE, transfer);
+    transfer->callback = callback;
+    transfer->context = context;
+
+    //the multi handle belongs to the polling thread, it picks the transfer up.
+    pthread_mutex_lock(&multi->lock);
+    transfer->next = multi->submitted;
+    multi->submitted = transfer;
+    pthread_mutex_unlock(&multi->lock);
+
+    curl_multi_wakeup(multi->multi);
+    return 0;
+}
+
+static void transfer_done(ResolverMulti *multi, ResolverTransfer *transfer, CURLcode rc)
+{
+    ResolverTransfer **pp;
+    const char *response;
+
+    assert(multi);
+    assert(transfer);
+
+    for (pp = &multi->running; *pp; pp = &(*pp)->next) {
+        if (*pp == transfer) {
+            *pp = transfer->next;
+            break;
+        }
+    }
+
+    curl_multi_remove_handle(multi->multi, transfer->curl);
+    response = finish_request(transfer->curl, rc, &transfer->response);
+    transfer->callback(response, transfer->context);
+
+    free(transfer->request.data);
+    free(transfer);
 }
 
-const char *DefaultResolve_Resolve(const char *resolve_request)
+static int multi_perform(ResolverMulti *multi)
 {
-    return perform_request(gURL, resolve_request);
+    ResolverTransfer *transfer;
+    CURLMsg *msg;
+    int running, left, done = 0;
+
+    assert(multi);
+
+    if (curl_multi_perform(multi->multi, &running) != CURLM_OK) {
+        DIDError_Set(DIDERR_NETWORK, "Perform the resolve requests failed.");
+        return -1;
+    }
+
+    while ((msg = curl_multi_info_read(multi->multi, &left)) != NULL) {
+        if (msg->msg != CURLMSG_DONE)
+            continue;
+
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&transfer);
+        transfer_done(multi, transfer, msg->data.result);
+        done++;
+    }
+
+    return done;
+}
+
+int ResolverMulti_Perform(ResolverMulti *multi, int timeout)
+{
+    ResolverTransfer *transfer, *next;
+    int done;
+
+    assert(multi);
+
+    pthread_mutex_lock(&multi->lock);
+    transfer = multi->submitted;
+    multi->submitted = NULL;
+    pthread_mutex_unlock(&multi->lock);
+
+    for (; transfer; transfer = next) {
+        next = transfer->next;
+        transfer->next = multi->running;
+        multi->running = transfer;
+
+        if (curl_multi_add_handle(multi->multi, transfer->curl) != CURLM_OK) {
+            DIDError_Set(DIDERR_NETWORK, "Add the resolve request failed.");
+            transfer_done(multi, transfer, CURLE_FAILED_INIT);
+        }
+    }
+
+    done = multi_perform(multi);
+    if (done != 0 || timeout == 0)
+        return done < 0 ? -1 : 0;
+
+    //sleep until a socket is ready, the timeout is reached or someone wakes us up.
+    if (curl_multi_poll(multi->multi, NULL, 0, timeout < 0 ? INT_MAX : timeout, NULL) != CURLM_OK) {
+        DIDError_Set(DIDERR_NETWORK, "Wait for the resolve requests failed.");
+        return -1;
+    }
+
+    return multi_perform(multi) < 0 ? -1 : 0;
+}
+
+void ResolverMulti_Wakeup(ResolverMulti *multi)
+{
+    assert(multi);
+
+    curl_multi_wakeup(multi->multi);
+}
+
+void ResolverMulti_Destroy(ResolverMulti *multi)
+{
+    ResolverTransfer *transfer;
+
+    if (!multi)
+        return;
+
+    //the unfinished requests are reported as failed.
+    ResolverMulti_Perform(multi, 0);
+    while ((transfer = multi->running) != NULL)
+        transfer_done(multi, transfer, CURLE_ABORTED_BY_CALLBACK);
+
+    curl_multi_cleanup(multi->multi);
+    pthread_mutex_destroy(&multi->lock);
+    free(multi);
 }
 
 static int check_url(const char *url)
@@ -208,7 +542,7 @@ static int check_url(const char *url)
     return 0;
 }
 
-static int check_endpoint(CheckResult *result, const char *network)
+static int check_endpoint(CheckResult *result, const char *network, ResolverTransport *transport)
 {
     time_t id, start;
     int latency, blockNumber;
@@ -231,7 +565,7 @@ static int check_endpoint(CheckResult *result, const char *network)
     }
 
     start = time(NULL);
-    response = perform_request(network, request);
+    response = perform_request(network, transport->connecttimeout, transport->timeout, request);
     if (!response)
         return rc;
 
@@ -312,7 +646,8 @@ static bool network_available(CheckResult *result)
     return result->latency >= 0;
 }
 
-static const char *check_network(const char **networks, size_t size)
+static const char *check_network(const char **networks, size_t size,
+        ResolverTransport *transport)
 {
     int i;
     const char *network;
@@ -329,7 +664,7 @@ static const char *check_network(const char **networks, size_t size)
 
     for (i = 0; i < size; i++) {
         network = networks[i];
-        check_endpoint(&results[i], network);
+        check_endpoint(&results[i], network, transport);
     }
 
     qsort(results, size, sizeof(CheckResult), select_endpoint);
@@ -339,12 +674,16 @@ static const char *check_network(const char **networks, size_t size)
         return NULL;
 }
 
-int DefaultResolve_Init(const char *_url)
+int DefaultResolve_Init(ResolverTransport *transport, const char *_url)
 {
     const char *url, **endpoints = NULL;
     CURLUcode rc;
 
-    if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) {
+    assert(transport);
+    assert(_url);
+
+    pthread_once(&gTransportOnce, transport_init);
+    if (!gTransportReady) {
         DIDError_Set(DIDERR_NETWORK, "Initialize curl failed.");
         return -1;
     }
@@ -363,15 +702,15 @@ int DefaultResolve_Init(const char *_url)
     if(rc < 0)
         return -1;
 
-    strcpy(gURL, url);
+    strcpy(transport->url, url);
 
     if (endpoints) {
-        url = check_network(endpoints, 2);
+        url = check_network(endpoints, 2, transport);
         if (url)
-            strcpy(gURL, url);
+            strcpy(transport->url, url);
     }
 
-    printf("url: %s\n", gURL);
+    printf("url: %s\n", transport->url);
 
     return 0;
 }
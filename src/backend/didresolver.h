@@ -31,9 +31,35 @@ extern "C" {
 
 #define URL_LEN              512
 
-int DefaultResolve_Init(const char *url);
+//The endpoint and timeouts of one backend, the connections are shared.
+typedef struct ResolverTransport {
+    char url[URL_LEN];
+    long connecttimeout;
+    long timeout;
+} ResolverTransport;
 
-const char *DefaultResolve_Resolve(const char *request);
+int DefaultResolve_Init(ResolverTransport *transport, const char *url);
+
+const char *DefaultResolve_Resolve(ResolverTransport *transport, const char *request);
+
+//The response is NULL if the request failed, the callee frees it.
+typedef void DefaultResolve_Callback(const char *response, void *context);
+
+//Requests in flight without blocking a thread each, driven by ResolverMulti_Perform.
+typedef struct ResolverMulti ResolverMulti;
+
+ResolverMulti *ResolverMulti_Create(void);
+
+//Thread safe, the callback is called by the thread which performs.
+int ResolverMulti_Submit(ResolverMulti *multi, ResolverTransport *transport,
+        const char *request, DefaultResolve_Callback *callback, void *context);
+
+//Wait up to timeout milliseconds for the network, negative to wait until woken up.
+int ResolverMulti_Perform(ResolverMulti *multi, int timeout);
+
+void ResolverMulti_Wakeup(ResolverMulti *multi);
+
+void ResolverMulti_Destroy(ResolverMulti *multi);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2019 - 2021 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "ela_did.h"
+#include "did.h"
+#include "diddocument.h"
+#include "credential.h"
+#include "documentcache.h"
+
+#define DOCUMENTCACHE_BUCKETS           256
+
+typedef struct CacheEntry {
+    struct CacheEntry *hnext;
+    struct CacheEntry *prev;
+    struct CacheEntry *next;
+    unsigned int hash;
+    char idstring[MAX_ID_SPECIFIC_STRING];
+    DIDDocument *document;
+    int status;
+    time_t stored;
+    size_t footprint;
+} CacheEntry;
+
+struct DocumentCache {
+    pthread_mutex_t lock;
+    size_t capacity;
+    size_t used;
+    CacheEntry *buckets[DOCUMENTCACHE_BUCKETS];
+    //lru list: head is the most recently used entry.
+    CacheEntry *head;
+    CacheEntry *tail;
+};
+
+static unsigned int str_hash(const char *str)
+{
+    unsigned int hash = 2166136261u;
+
+    assert(str);
+
+    while (*str) {
+        hash ^= (unsigned char)*str++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static size_t document_footprint(DIDDocument *document)
+{
+    size_t footprint, i;
+
+    assert(document);
+
+    footprint = sizeof(DIDDocument);
+    footprint += document->publickeys.size * (sizeof(PublicKey) + sizeof(PublicKey*));
+    footprint += document->services.size * (sizeof(Service) + sizeof(Service*));
+    footprint += document->credentials.size * (sizeof(Credential) + sizeof(Credential*));
+    footprint += document->proofs.size * sizeof(DocumentProof);
+
+    for (i = 0; i < document->controllers.size; i++)
+        footprint += document_footprint(document->controllers.docs[i]) + sizeof(DIDDocument*);
+
+    return footprint;
+}
+
+static void lru_unlink(DocumentCache *cache, CacheEntry *entry)
+{
+    assert(cache);
+    assert(entry);
+
+    if (entry->prev)
+        entry->prev->next = entry->next;
+    else
+        cache->head = entry->next;
+
+    if (entry->next)
+        entry->next->prev = entry->prev;
+    else
+        cache->tail = entry->prev;
+
+    entry->prev = entry->next = NULL;
+}
+
+static void lru_push_front(DocumentCache *cache, CacheEntry *entry)
+{
+    assert(cache);
+    assert(entry);
+
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head)
+        cache->head->prev = entry;
+    else
+        cache->tail = entry;
+
+    cache->head = entry;
+}
+
+static CacheEntry *find_entry(DocumentCache *cache, const char *idstring, unsigned int hash)
+{
+    CacheEntry *entry;
+
+    assert(cache);
+    assert(idstring);
+
+    for (entry = cache->buckets[hash % DOCUMENTCACHE_BUCKETS]; entry; entry = entry->hnext) {
+        if (entry->hash == hash && !strcmp(entry->idstring, idstring))
+            return entry;
+    }
+
+    return NULL;
+}
+
+static void remove_entry(DocumentCache *cache, CacheEntry *entry)
+{
+    CacheEntry **pp;
+
+    assert(cache);
+    assert(entry);
+
+    for (pp = &cache->buckets[entry->hash % DOCUMENTCACHE_BUCKETS]; *pp; pp = &(*pp)->hnext) {
+        if (*pp == entry) {
+            *pp = entry->hnext;
+            break;
+        }
+    }
+
+    lru_unlink(cache, entry);
+    cache->used -= entry->footprint;
+
+    DIDDocument_Destroy(entry->document);
+    free(entry);
+}
+
+static void evict(DocumentCache *cache, size_t capacity)
+{
+    assert(cache);
+
+    while (cache->tail && cache->used > capacity)
+        remove_entry(cache, cache->tail);
+}
+
+static DIDDocument *document_dup(DIDDocument *document)
+{
+    DIDDocument *copy;
+
+    assert(document);
+
+    copy = (DIDDocument*)calloc(1, sizeof(DIDDocument));
+    if (!copy)
+        return NULL;
+
+    if (DIDDocument_Copy(copy, document) < 0) {
+        DIDDocument_Destroy(copy);
+        return NULL;
+    }
+
+    return copy;
+}
+
+DocumentCache *DocumentCache_Create(size_t capacity)
+{
+    DocumentCache *cache;
+
+    cache = (DocumentCache*)calloc(1, sizeof(DocumentCache));
+    if (!cache)
+        return NULL;
+
+    if (pthread_mutex_init(&cache->lock, NULL) != 0) {
+        free(cache);
+        return NULL;
+    }
+
+    cache->capacity = capacity;
+    return cache;
+}
+
+void DocumentCache_Destroy(DocumentCache *cache)
+{
+    if (!cache)
+        return;
+
+    DocumentCache_Clear(cache);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+void DocumentCache_SetCapacity(DocumentCache *cache, size_t capacity)
+{
+    assert(cache);
+
+    pthread_mutex_lock(&cache->lock);
+    cache->capacity = capacity;
+    evict(cache, capacity);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+DIDDocument *DocumentCache_Load(DocumentCache *cache, DID *did, long ttl, int *status)
+{
+    CacheEntry *entry;
+    DIDDocument *document = NULL;
+    unsigned int hash;
+    time_t curtime;
+
+    assert(cache);
+    assert(did);
+    assert(ttl >= 0);
+    assert(status);
+
+    hash = str_hash(did->idstring);
+    time(&curtime);
+
+    pthread_mutex_lock(&cache->lock);
+
+    entry = find_entry(cache, did->idstring, hash);
+    if (!entry)
+        goto exit;
+
+    if (curtime - entry->stored > ttl) {
+        remove_entry(cache, entry);
+        goto exit;
+    }
+
+    //Hand out a private copy, callers own and may modify the returned document.
+    document = document_dup(entry->document);
+    if (!document)
+        goto exit;
+
+    *status = entry->status;
+    lru_unlink(cache, entry);
+    lru_push_front(cache, entry);
+
+exit:
+    pthread_mutex_unlock(&cache->lock);
+    return document;
+}
+
+int DocumentCache_Store(DocumentCache *cache, DIDDocument *document, int status,
+        time_t fetched)
+{
+    CacheEntry *entry, *old;
+    size_t footprint;
+
+    assert(cache);
+    assert(document);
+
+    footprint = document_footprint(document) + sizeof(CacheEntry);
+    if (footprint > cache->capacity)
+        return -1;
+
+    entry = (CacheEntry*)calloc(1, sizeof(CacheEntry));
+    if (!entry)
+        return -1;
+
+    entry->document = document_dup(document);
+    if (!entry->document) {
+        free(entry);
+        return -1;
+    }
+
+    strcpy(entry->idstring, document->did.idstring);
+    entry->hash = str_hash(entry->idstring);
+    entry->status = status;
+    entry->footprint = footprint;
+    entry->stored = fetched;
+
+    pthread_mutex_lock(&cache->lock);
+
+    old = find_entry(cache, entry->idstring, entry->hash);
+    if (old)
+        remove_entry(cache, old);
+
+    entry->hnext = cache->buckets[entry->hash % DOCUMENTCACHE_BUCKETS];
+    cache->buckets[entry->hash % DOCUMENTCACHE_BUCKETS] = entry;
+    lru_push_front(cache, entry);
+    cache->used += footprint;
+
+    evict(cache, cache->capacity);
+
+    pthread_mutex_unlock(&cache->lock);
+    return 0;
+}
+
+void DocumentCache_Invalidate(DocumentCache *cache, DID *did)
+{
+    CacheEntry *entry;
+
+    assert(cache);
+    assert(did);
+
+    pthread_mutex_lock(&cache->lock);
+    entry = find_entry(cache, did->idstring, str_hash(did->idstring));
+    if (entry)
+        remove_entry(cache, entry);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void DocumentCache_Clear(DocumentCache *cache)
+{
+    assert(cache);
+
+    pthread_mutex_lock(&cache->lock);
+    evict(cache, 0);
+    pthread_mutex_unlock(&cache->lock);
+}
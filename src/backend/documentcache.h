@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2019 - 2021 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DOCUMENTCACHE_H__
+#define __DOCUMENTCACHE_H__
+
+#include <stddef.h>
+#include <time.h>
+
+#include "ela_did.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEFAULT_DOCUMENTCACHE_CAPACITY          (4 * 1024 * 1024)
+
+typedef struct DocumentCache        DocumentCache;
+
+DocumentCache *DocumentCache_Create(size_t capacity);
+
+void DocumentCache_Destroy(DocumentCache *cache);
+
+void DocumentCache_SetCapacity(DocumentCache *cache, size_t capacity);
+
+DIDDocument *DocumentCache_Load(DocumentCache *cache, DID *did, long ttl, int *status);
+
+//The entry ages from fetched, when its source was fetched from the chain.
+int DocumentCache_Store(DocumentCache *cache, DIDDocument *document, int status,
+        time_t fetched);
+
+void DocumentCache_Invalidate(DocumentCache *cache, DID *did);
+
+void DocumentCache_Clear(DocumentCache *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__DOCUMENTCACHE_H__
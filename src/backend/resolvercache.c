@@ -25,6 +25,11 @@
 #include <sys/stat.h>
 #include <limits.h>
 #include <assert.h>
+#include <pthread.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
 
 #include "ela_did.h"
 #include "diderror.h"
@@ -32,55 +37,298 @@
 #include "did.h"
 #include "resolvercache.h"
 #include "credentialbiography.h"
+#include "documentcache.h"
+#include "crypto.h"
 
-static char rootpath[PATH_MAX] = {0};
+#define VERIFIED_SUFFIX         ".verified"
+#define DIGEST_BASE64_LEN       64
+#define MARKKEY_FILE            ".markkey"
 
-int ResolverCache_SetCacheDir(const char *root)
+int ResolverCache_Init(ResolverCache *cache)
+{
+    assert(cache);
+
+    memset(cache, 0, sizeof(ResolverCache));
+    if (pthread_rwlock_init(&cache->lock, NULL) != 0)
+        return -1;
+
+    //without a key nothing is trusted as verified, results are checked again.
+    //SetCacheDir replaces it with the key kept in the cache directory.
+    cache->haskey = RAND_bytes(cache->markkey, sizeof(cache->markkey)) == 1;
+
+    //without the memory tier the cache directory still works.
+    cache->memcapacity = DEFAULT_DOCUMENTCACHE_CAPACITY;
+    cache->memcache = DocumentCache_Create(cache->memcapacity);
+    return 0;
+}
+
+void ResolverCache_Free(ResolverCache *cache)
+{
+    assert(cache);
+
+    if (cache->memcache)
+        DocumentCache_Destroy(cache->memcache);
+
+    pthread_rwlock_destroy(&cache->lock);
+    OPENSSL_cleanse(cache, sizeof(ResolverCache));
+}
+
+//SetCacheDir may run on another thread, the readers work on a copy.
+static void get_root(ResolverCache *cache, char *root)
+{
+    assert(cache);
+    assert(root);
+
+    pthread_rwlock_rdlock(&cache->lock);
+    strcpy(root, cache->rootpath);
+    pthread_rwlock_unlock(&cache->lock);
+}
+
+static DocumentCache *get_memcache(ResolverCache *cache)
+{
+    DocumentCache *memcache;
+
+    assert(cache);
+
+    pthread_rwlock_rdlock(&cache->lock);
+    memcache = cache->memcapacity > 0 ? cache->memcache : NULL;
+    pthread_rwlock_unlock(&cache->lock);
+    return memcache;
+}
+
+//The marker key is kept next to the markers so they outlive the process.
+//A key file the group or others can reach isn't trusted, a new one is made.
+static bool load_markkey(const char *root, uint8_t *key, size_t size)
+{
+    char path[PATH_MAX];
+    const uint8_t *data;
+#if !defined(_WIN32) && !defined(_WIN64)
+    struct stat st;
+#endif
+    size_t len = 0;
+    bool loaded = false;
+
+    assert(root);
+    assert(key);
+
+    if (mkdirs(root, S_IRWXU) < 0 || get_file(path, 1, 2, root, MARKKEY_FILE) == -1)
+        return false;
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (stat(path, &st) == 0 && (st.st_mode & (S_IRWXG | S_IRWXO)) != 0)
+        delete_file(path);
+#endif
+
+    data = (const uint8_t*)load_data(path, &len);
+    if (data) {
+        if (len == size) {
+            memcpy(key, data, size);
+            loaded = true;
+        }
+
+        OPENSSL_cleanse((void*)data, len);
+        free((void*)data);
+        if (loaded)
+            return true;
+    }
+
+    if (RAND_bytes(key, size) != 1)
+        return false;
+
+    return store_data(path, key, size) == 0;
+}
+
+static void set_markkey(ResolverCache *cache, const char *root)
+{
+    uint8_t key[sizeof(cache->markkey)];
+    bool haskey;
+
+    haskey = load_markkey(root, key, sizeof(key));
+
+    pthread_rwlock_wrlock(&cache->lock);
+    memcpy(cache->markkey, key, sizeof(key));
+    cache->haskey = haskey;
+    pthread_rwlock_unlock(&cache->lock);
+
+    OPENSSL_cleanse(key, sizeof(key));
+}
+
+int ResolverCache_SetCacheDir(ResolverCache *cache, const char *root)
 {
     int rc;
 
+    assert(cache);
     assert(root && *root);
 
-    if (strlen(root) >= sizeof(rootpath))
+    if (strlen(root) >= sizeof(cache->rootpath))
         return -1;
 
     rc = mkdirs(root, S_IRWXU);
-    strcpy(rootpath, root);
+
+    pthread_rwlock_wrlock(&cache->lock);
+    strcpy(cache->rootpath, root);
+    pthread_rwlock_unlock(&cache->lock);
+
+    set_markkey(cache, root);
+
+    if (cache->memcache)
+        DocumentCache_Clear(cache->memcache);
+
     return rc;
 }
 
-const char *ResolverCache_GetCacheDir(void)
+void ResolverCache_SetMemoryCapacity(ResolverCache *cache, size_t capacity)
 {
-    if (!*rootpath)
-        return NULL;
+    assert(cache);
+
+    pthread_rwlock_wrlock(&cache->lock);
+    cache->memcapacity = capacity;
+    pthread_rwlock_unlock(&cache->lock);
+
+    if (cache->memcache)
+        DocumentCache_SetCapacity(cache->memcache, capacity);
+}
+
+const char *ResolverCache_GetCacheDir(ResolverCache *cache, char *root, size_t size)
+{
+    const char *rc = NULL;
+
+    assert(cache);
+    assert(root);
+
+    pthread_rwlock_rdlock(&cache->lock);
+    if (*cache->rootpath && strlen(cache->rootpath) < size) {
+        strcpy(root, cache->rootpath);
+        rc = root;
+    }
+    pthread_rwlock_unlock(&cache->lock);
 
-    return rootpath;
+    return rc;
 }
 
-int ResolverCache_Reset(void)
+int ResolverCache_Reset(ResolverCache *cache)
 {
-    if (!*rootpath)
+    char root[PATH_MAX];
+
+    assert(cache);
+
+    if (cache->memcache)
+        DocumentCache_Clear(cache->memcache);
+
+    get_root(cache, root);
+    if (!*root)
         return 0;
 
-    delete_file(rootpath);
+    //the markers are gone with the directory, a fresh key replaces the old.
+    delete_file(root);
+    set_markkey(cache, root);
     return 0;
 }
 
-int ResolverCache_LoadDID(ResolveResult *result, DID *did, long ttl)
+static int get_cache_file(ResolverCache *cache, char *path, int create, const char *name)
+{
+    char root[PATH_MAX];
+
+    assert(path);
+    assert(name);
+
+    get_root(cache, root);
+    return get_file(path, create, 2, root, name);
+}
+
+static int get_verified_file(ResolverCache *cache, char *path, int create, DID *did)
+{
+    char name[MAX_ID_SPECIFIC_STRING + sizeof(VERIFIED_SUFFIX)];
+
+    assert(path);
+    assert(did);
+
+    snprintf(name, sizeof(name), "%s%s", did->idstring, VERIFIED_SUFFIX);
+    return get_cache_file(cache, path, create, name);
+}
+
+//A keyed mac of the result, anyone can write the cache directory but only
+//this backend can make a marker it accepts.
+static int result_digest(ResolverCache *cache, char *digest, size_t size,
+        const uint8_t *data, size_t len)
+{
+    uint8_t key[sizeof(cache->markkey)], md[SHA256_BYTES];
+    unsigned int mdlen = sizeof(md);
+    bool haskey;
+    int rc;
+
+    assert(cache);
+    assert(digest);
+    assert(size >= DIGEST_BASE64_LEN);
+    assert(data);
+
+    pthread_rwlock_rdlock(&cache->lock);
+    haskey = cache->haskey;
+    memcpy(key, cache->markkey, sizeof(key));
+    pthread_rwlock_unlock(&cache->lock);
+
+    rc = haskey && HMAC(EVP_sha256(), key, sizeof(key), data, len, md, &mdlen) ? 0 : -1;
+    OPENSSL_cleanse(key, sizeof(key));
+    if (rc < 0)
+        return -1;
+
+    return b64_url_encode(digest, md, mdlen) < 0 ? -1 : 0;
+}
+
+//The marker holds the mac of the cached result whose proofs were verified.
+static bool is_verified(ResolverCache *cache, DID *did, const uint8_t *data, size_t len)
+{
+    char path[PATH_MAX], digest[DIGEST_BASE64_LEN];
+    const char *marker, *value;
+    json_t *root, *item;
+    json_error_t error;
+    bool verified = false;
+
+    assert(did);
+    assert(data);
+
+    if (get_verified_file(cache, path, 0, did) == -1)
+        return false;
+
+    marker = load_file(path);
+    if (!marker)
+        return false;
+
+    root = json_loads(marker, JSON_COMPACT, &error);
+    free((void*)marker);
+    if (!root)
+        return false;
+
+    item = json_object_get(root, "digest");
+    if (item && json_is_string(item)) {
+        value = json_string_value(item);
+        if (result_digest(cache, digest, sizeof(digest), data, len) == 0 &&
+                strlen(value) == strlen(digest) &&
+                CRYPTO_memcmp(digest, value, strlen(digest)) == 0)
+            verified = true;
+    }
+
+    json_decref(root);
+    return verified;
+}
+
+int ResolverCache_LoadDID(ResolverCache *cache, ResolveResult *result, DID *did,
+        long ttl, bool *verified, time_t *fetched)
 {
     char path[PATH_MAX];
-    const char *data;
+    const uint8_t *data;
     struct stat s;
     time_t curtime;
     json_t *root;
     json_error_t error;
+    size_t len;
     int rc;
 
     assert(result);
     assert(did);
     assert(ttl >= 0);
 
-    if (get_file(path, 0, 2, rootpath, did->idstring) == -1)
+    if (get_cache_file(cache, path, 0, did->idstring) == -1)
         return -1;
 
     //check the last modify time
@@ -91,52 +339,146 @@ int ResolverCache_LoadDID(ResolveResult *result, DID *did, long ttl)
     if (curtime - s.st_mtime > ttl)
         return -1;
 
-    data = load_file(path);
+    if (fetched)
+        *fetched = s.st_mtime;
+
+    data = (const uint8_t*)load_data(path, &len);
     if (!data)
         return -1;
 
-    root = json_loads(data, JSON_COMPACT, &error);
+    if (ResolveResult_IsBinary(data, len)) {
+        if (verified)
+            *verified = is_verified(cache, did, data, len);
+
+        rc = ResolveResult_FromBinary(result, data, len, false);
+        free((void*)data);
+        return rc;
+    }
+
+    //the entries written before the binary format are still json, the marker
+    //holds the digest of the binary encoding.
+    root = json_loads((const char*)data, JSON_COMPACT, &error);
     free((void*)data);
     if (!root)
         return -1;
 
     rc = ResolveResult_FromJson(result, root, false);
     json_decref(root);
+    if (rc == 0 && verified) {
+        data = ResolveResult_ToBinary(result, &len);
+        if (data) {
+            *verified = is_verified(cache, did, data, len);
+            free((void*)data);
+        }
+    }
+
     return rc;
 }
 
-int ResolveCache_StoreDID(ResolveResult *result, DID *did)
+int ResolveCache_MarkDIDVerified(ResolverCache *cache, ResolveResult *result, DID *did)
+{
+    char path[PATH_MAX], digest[DIGEST_BASE64_LEN], marker[128];
+    const uint8_t *data;
+    size_t len;
+    int rc;
+
+    assert(result);
+    assert(did);
+
+    data = ResolveResult_ToBinary(result, &len);
+    if (!data)
+        return -1;
+
+    rc = result_digest(cache, digest, sizeof(digest), data, len);
+    free((void*)data);
+    if (rc < 0)
+        return -1;
+
+    if (get_verified_file(cache, path, 1, did) == -1)
+        return -1;
+
+    snprintf(marker, sizeof(marker), "{\"verified\":%lld,\"digest\":\"%s\"}",
+            (long long)time(NULL), digest);
+    return store_file(path, marker);
+}
+
+DIDDocument *ResolverCache_LoadDocument(ResolverCache *cache, DID *did, long ttl, int *status)
+{
+    DocumentCache *memcache;
+
+    assert(did);
+    assert(ttl >= 0);
+    assert(status);
+
+    memcache = get_memcache(cache);
+    if (!memcache)
+        return NULL;
+
+    return DocumentCache_Load(memcache, did, ttl, status);
+}
+
+int ResolveCache_StoreDocument(ResolverCache *cache, DIDDocument *document, int status,
+        time_t fetched)
+{
+    DocumentCache *memcache;
+
+    assert(document);
+
+    memcache = get_memcache(cache);
+    if (!memcache)
+        return -1;
+
+    return DocumentCache_Store(memcache, document, status, fetched);
+}
+
+void ResolveCache_InvalidateDocument(ResolverCache *cache, DID *did)
+{
+    assert(cache);
+    assert(did);
+
+    if (cache->memcache)
+        DocumentCache_Invalidate(cache->memcache, did);
+}
+
+int ResolveCache_StoreDID(ResolverCache *cache, ResolveResult *result, DID *did)
 {
     char path[PATH_MAX];
-    const char *data;
+    const uint8_t *data;
+    size_t len;
     int rc;
 
     assert(result);
     assert(did);
 
-    if (get_file(path, 1, 2, rootpath, did->idstring) == -1)
+    if (get_cache_file(cache, path, 1, did->idstring) == -1)
         return -1;
 
-    data = ResolveResult_ToJson(result);
+    data = ResolveResult_ToBinary(result, &len);
     if (!data)
         return -1;
 
-    rc = store_file(path, data);
+    rc = store_data(path, data, len);
     free((void*)data);
     return rc;
 }
 
-void ResolveCache_InvalidateDID(DID *did)
+void ResolveCache_InvalidateDID(ResolverCache *cache, DID *did)
 {
     char path[PATH_MAX];
 
     assert(did);
 
-    if (get_file(path, 0, 2, rootpath, did->idstring) == 0)
+    ResolveCache_InvalidateDocument(cache, did);
+
+    if (get_cache_file(cache, path, 0, did->idstring) == 0)
+        delete_file(path);
+
+    if (get_verified_file(cache, path, 0, did) == 0)
         delete_file(path);
 }
 
-CredentialBiography *ResolverCache_LoadCredential(DIDURL *id, DID *issuer, long ttl)
+CredentialBiography *ResolverCache_LoadCredential(ResolverCache *cache, DIDURL *id,
+        DID *issuer, long ttl)
 {
     CredentialBiography *biography;
     CredentialTransaction *tx;
@@ -156,7 +498,7 @@ CredentialBiography *ResolverCache_LoadCredential(DIDURL *id, DID *issuer, long
     if (size < 0 || size > sizeof(buffer))
         return NULL;
 
-    if (get_file(path, 0, 2, rootpath, buffer) == -1)
+    if (get_cache_file(cache, path, 0, buffer) == -1)
         return NULL;
 
     //check the lasted modify time
@@ -197,7 +539,8 @@ errorExit:
     return biography;
 }
 
-int ResolveCache_StoreCredential(CredentialBiography *biography, DIDURL *id)
+int ResolveCache_StoreCredential(ResolverCache *cache, CredentialBiography *biography,
+        DIDURL *id)
 {
     char path[PATH_MAX], buffer[ELA_MAX_DIDURL_LEN];
     const char *data;
@@ -210,7 +553,7 @@ int ResolveCache_StoreCredential(CredentialBiography *biography, DIDURL *id)
     if (size < 0 || size > sizeof(buffer))
         return -1;
 
-    if (get_file(path, 1, 2, rootpath, buffer) == -1)
+    if (get_cache_file(cache, path, 1, buffer) == -1)
         return -1;
 
     data = Credentialbiography_ToJson(biography);
@@ -222,12 +565,13 @@ int ResolveCache_StoreCredential(CredentialBiography *biography, DIDURL *id)
     return rc;
 }
 
-void ResolveCache_InvalidateCredential(DIDURL *id)
+void ResolveCache_InvalidateCredential(ResolverCache *cache, DIDURL *id)
 {
-    char path[PATH_MAX];
+    char path[PATH_MAX], root[PATH_MAX];
 
     assert(id);
 
-    if (get_file(path, 0, 3, rootpath, id->did.idstring, id->fragment) == 0)
+    get_root(cache, root);
+    if (get_file(path, 0, 3, root, id->did.idstring, id->fragment) == 0)
         delete_file(path);
 }
@@ -23,30 +23,65 @@
 #ifndef __RESOLVERCACHE_H__
 #define __RESOLVERCACHE_H__
 
+#include <limits.h>
+#include <pthread.h>
+
 #include "ela_did.h"
 #include "resolveresult.h"
+#include "documentcache.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-int ResolverCache_SetCacheDir(const char *root);
+//The cache directory and memory tier of one backend.
+typedef struct ResolverCache {
+    pthread_rwlock_t lock;
+    char rootpath[PATH_MAX];
+    DocumentCache *memcache;
+    size_t memcapacity;
+    //Key of this backend, kept in the cache directory with owner-only
+    //access. The verified markers are signed with it.
+    uint8_t markkey[32];
+    bool haskey;
+} ResolverCache;
+
+int ResolverCache_Init(ResolverCache *cache);
+
+void ResolverCache_Free(ResolverCache *cache);
+
+int ResolverCache_SetCacheDir(ResolverCache *cache, const char *root);
+
+const char *ResolverCache_GetCacheDir(ResolverCache *cache, char *root, size_t size);
+
+int ResolverCache_Reset(ResolverCache *cache);
+
+void ResolverCache_SetMemoryCapacity(ResolverCache *cache, size_t capacity);
+
+DIDDocument *ResolverCache_LoadDocument(ResolverCache *cache, DID *did, long ttl, int *status);
+
+int ResolveCache_StoreDocument(ResolverCache *cache, DIDDocument *document, int status,
+        time_t fetched);
 
-const char *ResolverCache_GetCacheDir(void);
+void ResolveCache_InvalidateDocument(ResolverCache *cache, DID *did);
 
-int ResolverCache_Reset(void);
+//fetched gets the time the cached result was fetched from the chain.
+int ResolverCache_LoadDID(ResolverCache *cache, ResolveResult *result, DID *did,
+        long ttl, bool *verified, time_t *fetched);
 
-int ResolverCache_LoadDID(ResolveResult *result, DID *did, long ttl);
+int ResolveCache_MarkDIDVerified(ResolverCache *cache, ResolveResult *result, DID *did);
 
-int ResolveCache_StoreDID(ResolveResult *result, DID *did);
+int ResolveCache_StoreDID(ResolverCache *cache, ResolveResult *result, DID *did);
 
-void ResolveCache_InvalidateDID(DID *did);
+void ResolveCache_InvalidateDID(ResolverCache *cache, DID *did);
 
-CredentialBiography *ResolverCache_LoadCredential(DIDURL *id, DID *issuer, long ttl);
+CredentialBiography *ResolverCache_LoadCredential(ResolverCache *cache, DIDURL *id,
+        DID *issuer, long ttl);
 
-int ResolveCache_StoreCredential(CredentialBiography *biography, DIDURL *id);
+int ResolveCache_StoreCredential(ResolverCache *cache, CredentialBiography *biography,
+        DIDURL *id);
 
-void ResolveCache_InvalidateCredential(DIDURL *id);
+void ResolveCache_InvalidateCredential(ResolverCache *cache, DIDURL *id);
 
 #ifdef __cplusplus
 }
@@ -32,6 +32,29 @@
 #include "JsonGenerator.h"
 #include "resolveresult.h"
 #include "didbiography.h"
+#include "crypto.h"
+
+static const char *spec = "elastos/did/1.0";
+static const char* operation[] = {"create", "update", "transfer", "deactivate"};
+
+typedef struct BinaryCursor {
+    uint8_t *data;
+    size_t size;
+    size_t pos;
+} BinaryCursor;
+
+static void set_metadata(ResolveResult *result, DIDTransaction *txinfo)
+{
+    DIDDocument *doc = txinfo->request.doc;
+
+    if (doc) {
+        DIDMetadata_SetPublished(&doc->metadata, txinfo->timestamp);
+        DIDMetadata_SetTxid(&doc->metadata, txinfo->txid);
+        DIDMetadata_SetSignature(&doc->metadata, doc->proofs.proofs[0].signatureValue);
+        DIDMetadata_SetDeactivated(&doc->metadata, result->status);
+        doc->did.metadata = &doc->metadata;
+    }
+}
 
 int ResolveResult_FromJson(ResolveResult *result, json_t *json, bool all)
 {
@@ -110,14 +133,7 @@ int ResolveResult_FromJson(ResolveResult *result, json_t *json, bool all)
             if (DIDTransaction_FromJson(txinfo, field) == -1)
                 return -1;
 
-            DIDDocument *doc = txinfo->request.doc;
-            if (doc) {
-                DIDMetadata_SetPublished(&doc->metadata, txinfo->timestamp);
-                DIDMetadata_SetTxid(&doc->metadata, txinfo->txid);
-                DIDMetadata_SetSignature(&doc->metadata, doc->proofs.proofs[0].signatureValue);
-                DIDMetadata_SetDeactivated(&doc->metadata, result->status);
-                memcpy(&doc->did.metadata, &doc->metadata, sizeof(DIDMetadata));
-            }
+            set_metadata(result, txinfo);
             result->txs.size++;
         }
     }
@@ -197,6 +213,346 @@ const char *ResolveResult_ToJson(ResolveResult *result)
     return DIDJG_Finish(gen);
 }
 
+// The binary encoding of the resolver cache. Integers are little endian,
+// strings are a u32 length and the bytes:
+//   magic[4], u8 version, str did, u8 status, u32 count, then per transaction
+//   str txid, i64 timestamp, str op, str prevtxid, str ticket, str payload,
+//   str document, str verificationMethod, str signature.
+// The payload is kept verbatim for verification, the document is the decoded
+// payload with its NUL, so a load doesn't parse or decode it twice.
+static void put_bytes(BinaryCursor *cursor, const void *data, size_t len)
+{
+    //the first pass has no buffer and only counts.
+    if (cursor->data && len)
+        memcpy(cursor->data + cursor->pos, data, len);
+    cursor->pos += len;
+}
+
+static void put_integer(BinaryCursor *cursor, uint64_t value, size_t len)
+{
+    uint8_t bytes[8];
+    size_t i;
+
+    for (i = 0; i < len; i++)
+        bytes[i] = (uint8_t)(value >> (i * 8));
+
+    put_bytes(cursor, bytes, len);
+}
+
+static void put_string(BinaryCursor *cursor, const char *data, size_t len)
+{
+    put_integer(cursor, len, 4);
+    put_bytes(cursor, data, len);
+}
+
+static int get_integer(BinaryCursor *cursor, uint64_t *value, size_t len)
+{
+    size_t i;
+
+    if (cursor->size - cursor->pos < len)
+        return -1;
+
+    *value = 0;
+    for (i = 0; i < len; i++)
+        *value |= (uint64_t)cursor->data[cursor->pos++] << (i * 8);
+
+    return 0;
+}
+
+static const char *get_string(BinaryCursor *cursor, size_t *len)
+{
+    const char *data;
+    uint64_t value;
+
+    if (get_integer(cursor, &value, 4) < 0 || cursor->size - cursor->pos < value)
+        return NULL;
+
+    data = (const char*)cursor->data + cursor->pos;
+    cursor->pos += value;
+    *len = value;
+    return data;
+}
+
+static int copy_string(BinaryCursor *cursor, char *buffer, size_t size)
+{
+    const char *data;
+    size_t len;
+
+    data = get_string(cursor, &len);
+    if (!data || len >= size || memchr(data, 0, len))
+        return -1;
+
+    memcpy(buffer, data, len);
+    buffer[len] = 0;
+    return 0;
+}
+
+static char *dup_string(BinaryCursor *cursor)
+{
+    const char *data;
+    char *string;
+    size_t len;
+
+    data = get_string(cursor, &len);
+    if (!data || memchr(data, 0, len))
+        return NULL;
+
+    string = (char*)malloc(len + 1);
+    if (!string)
+        return NULL;
+
+    memcpy(string, data, len);
+    string[len] = 0;
+    return string;
+}
+
+static int transaction_tobinary(BinaryCursor *cursor, DIDTransaction *txinfo)
+{
+    DIDRequest *request = &txinfo->request;
+    char method[ELA_MAX_DIDURL_LEN];
+    uint8_t *document = NULL;
+    ssize_t len = 0;
+
+    if (!DIDURL_ToString_Internal(&request->proof.verificationMethod, method, sizeof(method), false))
+        return -1;
+
+    //decode the payload so that the loader won't.
+    if (request->doc) {
+        document = (uint8_t*)malloc(strlen(request->payload) + 1);
+        if (!document)
+            return -1;
+
+        len = b64_url_decode(document, request->payload);
+        if (len <= 0) {
+            free(document);
+            return -1;
+        }
+        document[len++] = 0;
+    }
+
+    put_string(cursor, txinfo->txid, strlen(txinfo->txid));
+    put_integer(cursor, (uint64_t)(int64_t)txinfo->timestamp, 8);
+    put_string(cursor, request->header.op, strlen(request->header.op));
+    put_string(cursor, request->header.prevtxid, strlen(request->header.prevtxid));
+    put_string(cursor, request->header.ticket ? request->header.ticket : "",
+            request->header.ticket ? strlen(request->header.ticket) : 0);
+    put_string(cursor, request->payload, strlen(request->payload));
+    put_string(cursor, (const char*)document, len);
+    put_string(cursor, method, strlen(method));
+    put_string(cursor, request->proof.signatureValue, strlen(request->proof.signatureValue));
+
+    if (document)
+        free(document);
+    return 0;
+}
+
+static int resolveresult_tobinary(BinaryCursor *cursor, ResolveResult *result)
+{
+    char id[ELA_MAX_DID_LEN];
+    size_t i;
+
+    if (!DID_ToString(&result->did, id, sizeof(id)))
+        return -1;
+
+    put_bytes(cursor, RESOLVE_RESULT_MAGIC, 4);
+    put_integer(cursor, RESOLVE_RESULT_VERSION, 1);
+    put_string(cursor, id, strlen(id));
+    put_integer(cursor, result->status, 1);
+    put_integer(cursor, result->status != DIDStatus_NotFound ? result->txs.size : 0, 4);
+    if (result->status != DIDStatus_NotFound) {
+        for (i = 0; i < result->txs.size; i++) {
+            if (transaction_tobinary(cursor, &result->txs.txs[i]) < 0)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+const uint8_t *ResolveResult_ToBinary(ResolveResult *result, size_t *size)
+{
+    BinaryCursor cursor;
+
+    assert(result);
+    assert(size);
+
+    memset(&cursor, 0, sizeof(cursor));
+    if (resolveresult_tobinary(&cursor, result) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESULT, "Serialize resolve result to binary failed.");
+        return NULL;
+    }
+
+    cursor.size = cursor.pos;
+    cursor.data = (uint8_t*)malloc(cursor.size);
+    if (!cursor.data) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for resolve result failed.");
+        return NULL;
+    }
+
+    cursor.pos = 0;
+    if (resolveresult_tobinary(&cursor, result) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESULT, "Serialize resolve result to binary failed.");
+        free(cursor.data);
+        return NULL;
+    }
+
+    *size = cursor.size;
+    return cursor.data;
+}
+
+bool ResolveResult_IsBinary(const uint8_t *data, size_t size)
+{
+    assert(data);
+
+    return size > 4 && !memcmp(data, RESOLVE_RESULT_MAGIC, 4);
+}
+
+static int transaction_frombinary(BinaryCursor *cursor, DIDTransaction *txinfo)
+{
+    DIDRequest *request = &txinfo->request;
+    char method[ELA_MAX_DIDURL_LEN];
+    const char *document;
+    uint8_t *decoded;
+    uint64_t timestamp;
+    size_t len;
+    ssize_t rc;
+    int i;
+
+    if (copy_string(cursor, txinfo->txid, sizeof(txinfo->txid)) < 0 ||
+            get_integer(cursor, &timestamp, 8) < 0)
+        return -1;
+    txinfo->timestamp = (time_t)(int64_t)timestamp;
+
+    strcpy(request->header.spec, spec);
+    if (copy_string(cursor, request->header.op, sizeof(request->header.op)) < 0 ||
+            copy_string(cursor, request->header.prevtxid, sizeof(request->header.prevtxid)) < 0)
+        return -1;
+
+    for (i = 0; i < 4; i++) {
+        if (!strcmp(request->header.op, operation[i]))
+            break;
+    }
+    if (i == 4)
+        return -1;
+
+    request->header.ticket = dup_string(cursor);
+    if (!request->header.ticket)
+        return -1;
+    if (!*request->header.ticket) {
+        free((void*)request->header.ticket);
+        request->header.ticket = "";
+    }
+
+    request->payload = dup_string(cursor);
+    if (!request->payload)
+        return -1;
+
+    document = get_string(cursor, &len);
+    if (!document)
+        return -1;
+
+    if ((len > 0) != (strcmp(request->header.op, operation[RequestType_Deactivate]) != 0))
+        return -1;
+
+    if (len > 0) {
+        if (document[len - 1] || strlen(document) != len - 1)
+            return -1;
+
+        //the signature covers the payload, not the decoded copy next to it:
+        //an entry whose copy differs from its payload is rejected.
+        decoded = (uint8_t*)malloc(strlen(request->payload) + 1);
+        if (!decoded)
+            return -1;
+
+        rc = b64_url_decode(decoded, request->payload);
+        if (rc != (ssize_t)(len - 1) || memcmp(decoded, document, len - 1)) {
+            free(decoded);
+            return -1;
+        }
+        free(decoded);
+
+        request->doc = DIDDocument_FromJson(document);
+        if (!request->doc)
+            return -1;
+
+        DID_Copy(&request->did, &request->doc->did);
+    } else if (DID_Parse(&request->did, request->payload) < 0) {
+        return -1;
+    }
+
+    if (copy_string(cursor, method, sizeof(method)) < 0 ||
+            DIDURL_Parse(&request->proof.verificationMethod, method, &request->did) < 0 ||
+            copy_string(cursor, request->proof.signatureValue,
+                sizeof(request->proof.signatureValue)) < 0)
+        return -1;
+
+    return 0;
+}
+
+int ResolveResult_FromBinary(ResolveResult *result, const uint8_t *data, size_t size, bool all)
+{
+    BinaryCursor cursor;
+    char id[ELA_MAX_DID_LEN];
+    uint64_t value;
+    size_t i, count;
+
+    assert(result);
+    assert(data);
+
+    cursor.data = (uint8_t*)data;
+    cursor.size = size;
+    cursor.pos = 4;
+
+    if (!ResolveResult_IsBinary(data, size) || get_integer(&cursor, &value, 1) < 0 ||
+            value != RESOLVE_RESULT_VERSION) {
+        DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESULT, "Unsupported resolve result format.");
+        return -1;
+    }
+
+    if (copy_string(&cursor, id, sizeof(id)) < 0 || DID_Parse(&result->did, id) < 0 ||
+            get_integer(&cursor, &value, 1) < 0 || value > DIDStatus_NotFound) {
+        DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESULT, "Invalid resolve result.");
+        return -1;
+    }
+    result->status = (DIDStatus)value;
+
+    if (get_integer(&cursor, &value, 4) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESULT, "Invalid resolve result.");
+        return -1;
+    }
+    if (result->status == DIDStatus_NotFound)
+        return 0;
+
+    count = (size_t)value;
+    if (count == 0) {
+        DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESULT, "Missing transaction.");
+        return -1;
+    }
+    if (!all && result->status != DIDStatus_Deactivated)
+        count = 1;
+
+    result->txs.txs = (DIDTransaction *)calloc(count, sizeof(DIDTransaction));
+    if (!result->txs.txs) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Create transaction info failed.");
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        DIDTransaction *txinfo = &result->txs.txs[i];
+        if (transaction_frombinary(&cursor, txinfo) < 0) {
+            DIDRequest_Destroy(&txinfo->request);
+            ResolveResult_Destroy(result);
+            DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESULT, "Invalid resovled transaction.");
+            return -1;
+        }
+
+        set_metadata(result, txinfo);
+        result->txs.size++;
+    }
+
+    return 0;
+}
+
 DID *ResolveResult_GetDID(ResolveResult *result)
 {
     assert(result);
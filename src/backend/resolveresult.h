@@ -33,10 +33,19 @@
 extern "C" {
 #endif
 
+#define RESOLVE_RESULT_MAGIC            "DIDR"
+#define RESOLVE_RESULT_VERSION          1
+
 typedef struct DIDBiography ResolveResult;
 
 int ResolveResult_FromJson(ResolveResult *result, json_t *json, bool all);
 
+bool ResolveResult_IsBinary(const uint8_t *data, size_t size);
+
+int ResolveResult_FromBinary(ResolveResult *result, const uint8_t *data, size_t size, bool all);
+
+const uint8_t *ResolveResult_ToBinary(ResolveResult *result, size_t *size);
+
 void ResolveResult_Destroy(ResolveResult *result);
 
 void ResolveResult_Free(ResolveResult *result);
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2019 - 2021 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "singleflight.h"
+
+struct SingleFlight {
+    SingleFlight *next;
+    char *key;
+    int refs;
+    bool done;
+    pthread_cond_t cond;
+
+    void *result;
+    int status;
+    SingleFlight_CopyCallback *copy;
+    SingleFlight_FreeCallback *freecb;
+};
+
+//All the calls in flight, they are few at a time, so a list is enough.
+static SingleFlight *gFlights;
+static pthread_mutex_t gFlightLock = PTHREAD_MUTEX_INITIALIZER;
+
+//Called with gFlightLock held, the caller frees the flight after the unlock
+//if this was the last reference.
+static bool flight_release(SingleFlight *flight)
+{
+    assert(flight);
+    assert(flight->refs > 0);
+
+    return --flight->refs == 0;
+}
+
+static void flight_free(SingleFlight *flight)
+{
+    assert(flight);
+
+    if (flight->result && flight->freecb)
+        flight->freecb(flight->result);
+
+    pthread_cond_destroy(&flight->cond);
+    free(flight->key);
+    free(flight);
+}
+
+SingleFlight *SingleFlight_Join(const char *key, bool *leader)
+{
+    SingleFlight *flight;
+
+    assert(key && *key);
+    assert(leader);
+
+    pthread_mutex_lock(&gFlightLock);
+
+    for (flight = gFlights; flight; flight = flight->next) {
+        if (!strcmp(flight->key, key)) {
+            flight->refs++;
+            *leader = false;
+            pthread_mutex_unlock(&gFlightLock);
+            return flight;
+        }
+    }
+
+    flight = (SingleFlight*)calloc(1, sizeof(SingleFlight));
+    if (!flight)
+        goto errorExit;
+
+    flight->key = strdup(key);
+    if (!flight->key) {
+        free(flight);
+        goto errorExit;
+    }
+
+    if (pthread_cond_init(&flight->cond, NULL) != 0) {
+        free(flight->key);
+        free(flight);
+        goto errorExit;
+    }
+
+    flight->refs = 1;
+    flight->next = gFlights;
+    gFlights = flight;
+
+    *leader = true;
+    pthread_mutex_unlock(&gFlightLock);
+    return flight;
+
+errorExit:
+    pthread_mutex_unlock(&gFlightLock);
+    return NULL;
+}
+
+void SingleFlight_Complete(SingleFlight *flight, void *result, int status,
+        SingleFlight_CopyCallback *copy, SingleFlight_FreeCallback *freecb)
+{
+    SingleFlight **pp;
+    void *shared = NULL;
+    bool waiters, last;
+
+    assert(flight);
+
+    pthread_mutex_lock(&gFlightLock);
+
+    for (pp = &gFlights; *pp; pp = &(*pp)->next) {
+        if (*pp == flight) {
+            *pp = flight->next;
+            break;
+        }
+    }
+
+    //Nobody joins once the flight is unlinked, and the waiters don't leave
+    //before it's done.
+    waiters = flight->refs > 1;
+    pthread_mutex_unlock(&gFlightLock);
+
+    //The leader keeps its result, the waiters share one copy of it, made
+    //without holding the lock.
+    if (waiters && result && copy)
+        shared = copy(result);
+
+    pthread_mutex_lock(&gFlightLock);
+
+    if (shared) {
+        flight->result = shared;
+        flight->copy = copy;
+        flight->freecb = freecb;
+    }
+
+    flight->status = status;
+    flight->done = true;
+    pthread_cond_broadcast(&flight->cond);
+
+    last = flight_release(flight);
+    pthread_mutex_unlock(&gFlightLock);
+
+    if (last)
+        flight_free(flight);
+}
+
+void *SingleFlight_Wait(SingleFlight *flight, int *status)
+{
+    void *result = NULL;
+    bool last;
+
+    assert(flight);
+    assert(status);
+
+    pthread_mutex_lock(&gFlightLock);
+
+    while (!flight->done)
+        pthread_cond_wait(&flight->cond, &gFlightLock);
+
+    *status = flight->status;
+    pthread_mutex_unlock(&gFlightLock);
+
+    //The shared result is read-only once the flight is done, and the
+    //reference held here keeps it alive while it's copied.
+    if (flight->result)
+        result = flight->copy(flight->result);
+
+    pthread_mutex_lock(&gFlightLock);
+    last = flight_release(flight);
+    pthread_mutex_unlock(&gFlightLock);
+
+    if (last)
+        flight_free(flight);
+
+    return result;
+}
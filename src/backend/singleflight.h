@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2019 - 2021 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __SINGLEFLIGHT_H__
+#define __SINGLEFLIGHT_H__
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SingleFlight         SingleFlight;
+
+typedef void *SingleFlight_CopyCallback(void *result);
+
+typedef void SingleFlight_FreeCallback(void *result);
+
+SingleFlight *SingleFlight_Join(const char *key, bool *leader);
+
+void SingleFlight_Complete(SingleFlight *flight, void *result, int status,
+        SingleFlight_CopyCallback *copy, SingleFlight_FreeCallback *freecb);
+
+void *SingleFlight_Wait(SingleFlight *flight, int *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__SINGLEFLIGHT_H__
@@ -164,7 +164,7 @@ int CredentialRequest_FromJson(CredentialRequest *request, json_t *json)
     char *vcJson;
     const char *op, *payload;
     DIDURL *id;
-    size_t len;
+    ssize_t len;
 
     assert(request);
     assert(json);
@@ -32,6 +32,7 @@
 #include "crypto.h"
 #include "JsonGenerator.h"
 #include "JsonHelper.h"
+#include "JsonReader.h"
 #include "did.h"
 #include "diddocument.h"
 #include "didstore.h"
@@ -39,6 +40,8 @@
 #include "didbackend.h"
 #include "credentialbiography.h"
 
+#define CREDENTIAL_ARENA_SIZE          (sizeof(Credential) + 512)
+
 static const char *PresentationsType = "VerifiablePresentation";
 extern const char *ProofType;
 
@@ -242,11 +245,19 @@ void Credential_Destroy(Credential *credential)
     if (!credential)
         return;
 
-    free_types(credential);
     if (credential->subject.properties)
         json_decref(credential->subject.properties);
 
     CredentialMetadata_Free(&credential->metadata);
+
+    //the types and the credential itself belong to the arena.
+    if (credential->arena) {
+        if (credential->arena->owner == credential)
+            Arena_Destroy(credential->arena);
+        return;
+    }
+
+    free_types(credential);
     free(credential);
 
     DIDERROR_FINALIZE();
@@ -658,6 +669,7 @@ Credential *Credential_From_Internal(json_t *json, DID *did)
     if (parse_types(credential, item) == -1)
         goto errorExit;
 
+    credential->id.metadata = &credential->metadata;
     return credential;
 
 errorExit:
@@ -692,6 +704,303 @@ ssize_t Parse_Credentials(DID *did, Credential **creds, size_t size, json_t *jso
     return index;
 }
 
+enum {
+    CRED_SUBJECT,
+    CRED_ID,
+    CRED_ISSUER,
+    CRED_ISSUANCE_DATE,
+    CRED_EXPIRATION_DATE,
+    CRED_PROOF,
+    CRED_TYPE,
+    CRED_MEMBERS
+};
+
+static int read_types(Credential *credential, JsonSpan *span)
+{
+    JsonReader r, *reader;
+    JsonToken token;
+    char **types, *typestr;
+    size_t len;
+
+    assert(credential);
+    assert(credential->arena);
+    assert(span);
+
+    reader = DIDJR_InitializeSpan(&r, span);
+    DIDJR_Next(reader);
+
+    while ((token = DIDJR_Next(reader)) != JsonToken_EndArray) {
+        if (token == JsonToken_Error) {
+            DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Invalid types.");
+            return -1;
+        }
+
+        if (token != JsonToken_String) {
+            DIDJR_Skip(reader, NULL);
+            continue;
+        }
+
+        //the decoded string is never longer than the raw one.
+        len = reader->end - reader->start;
+        typestr = (char*)Arena_Alloc(credential->arena, len);
+        if (!typestr || DIDJR_GetString(reader, typestr, len) < 0)
+            continue;
+
+        types = (char**)Arena_Grow(credential->arena, credential->type.types,
+                credential->type.size, sizeof(char*));
+        if (!types) {
+            DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for credential types failed.");
+            return -1;
+        }
+
+        types[credential->type.size++] = typestr;
+        credential->type.types = types;
+    }
+
+    if (!credential->type.size) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "No credential type.");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int read_subject(Credential *credential, JsonSpan *span, DID *did)
+{
+    JsonMember members[] = { { ID } };
+    JsonReader r, *reader;
+    char buffer[ELA_MAX_DID_LEN];
+
+    assert(credential);
+    assert(span);
+
+    // properties exclude "id".
+    reader = DIDJR_InitializeSpan(&r, span);
+    DIDJR_Next(reader);
+    if (DIDJR_ReadMembers(reader, members, 1, DIDJR_CollectMember,
+            &credential->subject.properties) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Invalid credential subject.");
+        return -1;
+    }
+
+    if (members[0].value.token == JsonToken_None) {
+        if (!did) {
+            DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Missing subject id.");
+            return -1;
+        }
+        DID_Copy(&credential->subject.id, did);
+    } else if (DIDJR_CopyString(&members[0].value, buffer, sizeof(buffer)) < 0 ||
+            DID_Parse(&credential->subject.id, buffer) == -1) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Invalid subject id.");
+        return -1;
+    }
+
+    if (!credential->subject.properties) {
+        credential->subject.properties = json_object();
+        if (!credential->subject.properties) {
+            DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for properties failed.");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int read_proof(Credential *credential, JsonSpan *span)
+{
+    JsonMember members[] = { { TYPE }, { CREATED }, { VERIFICATION_METHOD }, { SIGNATURE } };
+    JsonReader r, *reader;
+    char buffer[ELA_MAX_DIDURL_LEN];
+
+    assert(credential);
+    assert(span);
+
+    reader = DIDJR_InitializeSpan(&r, span);
+    DIDJR_Next(reader);
+    if (DIDJR_ReadMembers(reader, members, 4, NULL, NULL) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Invalid proof.");
+        return -1;
+    }
+
+    if (members[0].value.token == JsonToken_None) {
+        strcpy(credential->proof.type, ProofType);
+    } else if (DIDJR_CopyString(&members[0].value, credential->proof.type,
+            sizeof(credential->proof.type)) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Unknow proof type.");
+        return -1;
+    }
+
+    //compatible for no "created"
+    if (members[1].value.token != JsonToken_None &&
+            (DIDJR_CopyString(&members[1].value, buffer, sizeof(buffer)) < 0 ||
+            parse_time(&credential->proof.created, buffer) < 0)) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Invalid create credential time.");
+        return -1;
+    }
+
+    if (members[2].value.token == JsonToken_None) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Missing verification method.");
+        return -1;
+    }
+    if (DIDJR_CopyString(&members[2].value, buffer, sizeof(buffer)) < 0 ||
+            DIDURL_Parse(&credential->proof.verificationMethod, buffer, &credential->issuer) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Invalid verification method.");
+        return -1;
+    }
+
+    if (members[3].value.token == JsonToken_None) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Missing signature.");
+        return -1;
+    }
+    if (members[3].value.token != JsonToken_String) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Invalid signature.");
+        return -1;
+    }
+    if (DIDJR_CopyString(&members[3].value, credential->proof.signatureValue,
+            sizeof(credential->proof.signatureValue)) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Signature is too long.");
+        return -1;
+    }
+
+    return 0;
+}
+
+//With no arena the credential creates and owns one.
+Credential *Credential_FromReader(JsonReader *reader, DID *did, Arena *arena)
+{
+    JsonMember members[CRED_MEMBERS] = {
+        { CREDENTIAL_SUBJECT }, { ID }, { ISSUER }, { ISSUANCE_DATE },
+        { EXPIRATION_DATE }, { PROOF }, { TYPE }
+    };
+    Credential *credential;
+    JsonSpan *item;
+    char buffer[ELA_MAX_DIDURL_LEN];
+
+    assert(reader);
+
+    if (DIDJR_ReadMembers(reader, members, CRED_MEMBERS, NULL, NULL) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Deserialize credential failed, error: %s.",
+                reader->error ? reader->error : "invalid object");
+        return NULL;
+    }
+
+    if (!arena) {
+        arena = Arena_Create(CREDENTIAL_ARENA_SIZE);
+        if (!arena) {
+            DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for credential failed.");
+            return NULL;
+        }
+
+        //the first chunk always has room for the credential.
+        credential = (Credential*)Arena_Alloc(arena, sizeof(Credential));
+        arena->owner = credential;
+    } else {
+        credential = (Credential*)Arena_Alloc(arena, sizeof(Credential));
+        if (!credential) {
+            DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for credential failed.");
+            return NULL;
+        }
+    }
+    credential->arena = arena;
+
+    item = &members[CRED_SUBJECT].value;
+    if (item->token == JsonToken_None) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Missing credential subject.");
+        goto errorExit;
+    }
+    if (item->token != JsonToken_StartObject) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Invalid credential subject.");
+        goto errorExit;
+    }
+    if (read_subject(credential, item, did) < 0)
+        goto errorExit;
+
+    //id
+    item = &members[CRED_ID].value;
+    if (item->token == JsonToken_None) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Missing id.");
+        goto errorExit;
+    }
+    if (item->token != JsonToken_String) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Invalid id.");
+        goto errorExit;
+    }
+    if (DIDJR_CopyString(item, buffer, sizeof(buffer)) < 0 ||
+            DIDURL_Parse(&credential->id, buffer, &credential->subject.id) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Invalid credential id.");
+        goto errorExit;
+    }
+
+    if (!DID_Equals(&credential->id.did, &credential->subject.id)) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Credential owner is not match with DID.");
+        goto errorExit;
+    }
+
+    //issuer
+    item = &members[CRED_ISSUER].value;
+    if (item->token == JsonToken_None) {
+        DID_Copy(&credential->issuer, &credential->id.did);
+    } else if (DIDJR_CopyString(item, buffer, sizeof(buffer)) < 0 ||
+            DID_Parse(&credential->issuer, buffer) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Invalid issuer.");
+        goto errorExit;
+    }
+
+    //issuanceDate
+    item = &members[CRED_ISSUANCE_DATE].value;
+    if (item->token == JsonToken_None) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Missing issuance data.");
+        goto errorExit;
+    }
+    if (DIDJR_CopyString(item, buffer, sizeof(buffer)) < 0 ||
+            parse_time(&credential->issuanceDate, buffer) == -1) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Invalid issuance data.");
+        goto errorExit;
+    }
+
+    //expirationdate
+    item = &members[CRED_EXPIRATION_DATE].value;
+    if (item->token != JsonToken_None &&
+            (DIDJR_CopyString(item, buffer, sizeof(buffer)) < 0 ||
+            parse_time(&credential->expirationDate, buffer) == -1)) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Invalid expiration date.");
+        goto errorExit;
+    }
+
+    //proof
+    item = &members[CRED_PROOF].value;
+    if (item->token == JsonToken_None) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Missing proof.");
+        goto errorExit;
+    }
+    if (item->token != JsonToken_StartObject) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Invalid proof.");
+        goto errorExit;
+    }
+    if (read_proof(credential, item) < 0)
+        goto errorExit;
+
+    //type
+    item = &members[CRED_TYPE].value;
+    if (item->token == JsonToken_None) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Missing types.");
+        goto errorExit;
+    }
+    if (item->token != JsonToken_StartArray) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Invalid types.");
+        goto errorExit;
+    }
+    if (read_types(credential, item) == -1)
+        goto errorExit;
+
+    credential->id.metadata = &credential->metadata;
+    return credential;
+
+errorExit:
+    Credential_Destroy(credential);
+    return NULL;
+}
+
 static int didurl_func(const void *a, const void *b)
 {
     char _stringa[ELA_MAX_DID_LEN], _stringb[ELA_MAX_DID_LEN];
@@ -745,6 +1054,46 @@ const char* Credential_ToJson_ForSign(Credential *credential, bool compact, bool
     return DIDJG_Finish(gen);
 }
 
+ssize_t Credential_Digest_ForSign(Credential *credential, uint8_t *digest)
+{
+    JsonDigest jd;
+    JsonGenerator *gen;
+    ssize_t rc;
+
+    assert(credential);
+    assert(digest);
+
+    if (MEMO_LOAD(&credential->cache.digested) == MEMO_SET) {
+        memcpy(digest, credential->cache.digest, SHA256_BYTES);
+        return SHA256_BYTES;
+    }
+
+    gen = JsonDigest_Initialize(&jd);
+    if (!gen) {
+        DIDError_Set(DIDERR_CRYPTO_ERROR, "Json digest for credential initialize failed.");
+        return -1;
+    }
+
+    if (Credential_ToJson_Internal(gen, credential, NULL, false, true) < 0) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Serialize credential to json failed.");
+        JsonDigest_Destroy(&jd);
+        return -1;
+    }
+
+    rc = JsonDigest_Finish(&jd, digest, 0);
+    if (rc < 0) {
+        DIDError_Set(DIDERR_CRYPTO_ERROR, "Get credential digest failed.");
+        return rc;
+    }
+
+    //the first thread to finish publishes the digest, the others just use theirs.
+    if (MEMO_CLAIM(&credential->cache.digested)) {
+        memcpy(credential->cache.digest, digest, SHA256_BYTES);
+        MEMO_STORE(&credential->cache.digested, MEMO_SET);
+    }
+    return rc;
+}
+
 const char* Credential_ToJson(Credential *credential, bool normalized)
 {
     DIDERROR_INITIALIZE();
@@ -782,22 +1131,28 @@ const char *Credential_ToString(Credential *credential, bool normalized)
 
 Credential *Credential_FromJson(const char *json, DID *did)
 {
-    json_t *root;
-    json_error_t error;
+    JsonReader r, *reader;
     Credential *credential;
 
     DIDERROR_INITIALIZE();
 
     CHECK_ARG(!json, "No credential json.", NULL);
 
-    root = json_loads(json, JSON_COMPACT, &error);
-    if (!root) {
-        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Deserialize credential failed, error: %s.", error.text);
+    reader = DIDJR_Initialize(&r, json, strlen(json));
+    if (DIDJR_Next(reader) != JsonToken_StartObject) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Deserialize credential failed, error: %s.",
+                reader->error ? reader->error : "object expected");
+        return NULL;
+    }
+
+    credential = Credential_FromReader(reader, did, NULL);
+    if (credential && DIDJR_Finish(reader) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_CREDENTIAL, "Deserialize credential failed, error: %s.",
+                reader->error);
+        Credential_Destroy(credential);
         return NULL;
     }
 
-    credential = Credential_From_Internal(root, did);
-    json_decref(root);
     return credential;
 
     DIDERROR_FINALIZE();
@@ -812,7 +1167,7 @@ DIDURL *Credential_GetVerificationMethod(Credential *credential)
 int Credential_Verify(Credential *credential)
 {
     DIDDocument *doc;
-    const char *data;
+    uint8_t digest[SHA256_BYTES];
     int rc = -1, status;
 
     CHECK_ARG(!credential, "No credential to verify.", -1);
@@ -824,13 +1179,11 @@ int Credential_Verify(Credential *credential)
         return -1;
     }
 
-    data = Credential_ToJson_ForSign(credential, false, true);
-    if (!data)
+    if (Credential_Digest_ForSign(credential, digest) < 0)
         goto errorExit;
 
-    rc = DIDDocument_Verify(doc, &credential->proof.verificationMethod,
-            credential->proof.signatureValue, 1, data, strlen(data));
-    free((void *)data);
+    rc = DIDDocument_VerifyDigest(doc, &credential->proof.verificationMethod,
+            credential->proof.signatureValue, digest, sizeof(digest));
     if (rc < 0)
         DIDError_Set(DIDERR_VERIFY_ERROR, "Verify credential failed.");
 
@@ -872,13 +1225,15 @@ int Credential_IsExpired(Credential *credential)
     DIDERROR_FINALIZE();
 }
 
-int Credential_IsGenuine_Internal(Credential *credential, DIDDocument *document)
+int Credential_CollectGenuine(Credential *credential, DIDDocument *document, VerifyBatch *batch)
 {
     DIDDocument *issuerdoc = NULL;
-    const char *data;
+    PublicKey *signkey;
+    uint8_t digest[SHA256_BYTES];
     int genuine = 0, rc, status;
 
     assert(credential);
+    assert(batch);
 
     issuerdoc = document;
     if (!issuerdoc) {
@@ -902,16 +1257,30 @@ int Credential_IsGenuine_Internal(Credential *credential, DIDDocument *document)
         goto errorExit;
     }
 
-    data = Credential_ToJson_ForSign(credential, false, true);
-    if (!data) {
+    signkey = DIDDocument_GetPublicKey(issuerdoc, &credential->proof.verificationMethod);
+    if (!signkey) {
+        DIDError_Set(DIDERR_INVALID_KEY, " * VC %s : no verification key %s.",
+                DIDURLSTR(&credential->id), DIDURLSTR(&credential->proof.verificationMethod));
+        goto errorExit;
+    }
+
+    if (MEMO_LOAD(&credential->cache.genuine) == MEMO_SET &&
+            !strcmp(credential->cache.signkey, signkey->publicKeyBase58)) {
+        genuine = 1;
+        goto errorExit;
+    }
+
+    if (Credential_Digest_ForSign(credential, digest) < 0) {
         DIDError_Set(DIDERRCODE, " * VC %s : %s.", DIDURLSTR(&credential->id), DIDERRMSG);
         genuine = -1;
         goto errorExit;
     }
 
-    rc = DIDDocument_Verify(issuerdoc, &credential->proof.verificationMethod,
-            credential->proof.signatureValue, 1, data, strlen(data));
-    free((void *)data);
+    //the key is kept in the batch, the memo is set once the batch verifies.
+    rc = VerifyBatch_AddDigest(batch, issuerdoc, &credential->proof.verificationMethod,
+            credential->proof.signatureValue, digest);
+    if (rc == 0)
+        rc = VerifyBatch_AddMemo(batch, credential, signkey->publicKeyBase58);
     if (rc < 0)
         DIDError_Set(DIDERR_VERIFY_ERROR, " * VC %s : verify failed.",
                 DIDURLSTR(&credential->id));
@@ -924,6 +1293,38 @@ errorExit:
     return genuine;
 }
 
+int Credential_IsGenuine_Internal(Credential *credential, DIDDocument *document)
+{
+    VerifyBatch batch;
+    int genuine;
+
+    assert(credential);
+
+    memset(&batch, 0, sizeof(batch));
+    genuine = Credential_CollectGenuine(credential, document, &batch);
+    if (genuine == 1 && VerifyBatch_Verify(&batch) < 0) {
+        DIDError_Set(DIDERR_VERIFY_ERROR, " * VC %s : verify failed.",
+                DIDURLSTR(&credential->id));
+        genuine = 0;
+    }
+
+    VerifyBatch_Destroy(&batch);
+    return genuine;
+}
+
+void Credential_MarkGenuine(Credential *credential, const char *signkey)
+{
+    assert(credential);
+    assert(signkey);
+
+    //the memo is written once, a credential checked with another key later
+    //is just verified again.
+    if (MEMO_CLAIM(&credential->cache.genuine)) {
+        strcpy(credential->cache.signkey, signkey);
+        MEMO_STORE(&credential->cache.genuine, MEMO_SET);
+    }
+}
+
 int Credential_IsGenuine(Credential *credential)
 {
     DIDERROR_INITIALIZE();
@@ -937,13 +1338,14 @@ int Credential_IsGenuine(Credential *credential)
     DIDERROR_FINALIZE();
 }
 
-int Credential_IsValid_Internal(Credential *credential, DIDDocument *document)
+int Credential_CollectValid(Credential *credential, DIDDocument *document, VerifyBatch *batch)
 {
     DIDDocument *issuerdoc;
     int valid = 0, status;
 
     assert(credential);
     assert(document);
+    assert(batch);
 
     if (!DID_Equals(&credential->id.did, &credential->subject.id)) {
         DIDError_Set(DIDERR_MALFORMED_CREDENTIAL,
@@ -960,7 +1362,7 @@ int Credential_IsValid_Internal(Credential *credential, DIDDocument *document)
             return -1;
         }
 
-        if (DIDDocument_IsValid(issuerdoc) != 1) {
+        if (DIDDocument_CollectValid(issuerdoc, batch) != 1) {
             DIDDocument_Destroy(issuerdoc);
             DIDError_Set(DIDERR_NOT_VALID, " * VC %s : issuer %s is not valid",
                     DIDURLSTR(&credential->id), DIDSTR(&credential->issuer));
@@ -975,7 +1377,7 @@ int Credential_IsValid_Internal(Credential *credential, DIDDocument *document)
         goto errorExit;
     }
 
-    valid = Credential_IsGenuine_Internal(credential, issuerdoc);
+    valid = Credential_CollectGenuine(credential, issuerdoc, batch);
     if (valid != 1)
         DIDError_Set(DIDERR_NOT_GENUINE, " * VC %s : is not genuine.", DIDURLSTR(&credential->id));
 
@@ -985,9 +1387,29 @@ errorExit:
     return valid;
 }
 
+int Credential_IsValid_Internal(Credential *credential, DIDDocument *document)
+{
+    VerifyBatch batch;
+    int valid;
+
+    assert(credential);
+    assert(document);
+
+    memset(&batch, 0, sizeof(batch));
+    valid = Credential_CollectValid(credential, document, &batch);
+    if (valid == 1 && VerifyBatch_Verify(&batch) < 0) {
+        DIDError_Set(DIDERR_NOT_GENUINE, " * VC %s : is not genuine.", DIDURLSTR(&credential->id));
+        valid = 0;
+    }
+
+    VerifyBatch_Destroy(&batch);
+    return valid;
+}
+
 int Credential_IsValid(Credential *credential)
 {
     DIDDocument *doc;
+    VerifyBatch batch;
     int valid, status;
 
     DIDERROR_INITIALIZE();
@@ -1001,15 +1423,22 @@ int Credential_IsValid(Credential *credential)
         return -1;
     }
 
-    if (DIDDocument_IsValid(doc) != 1) {
+    //the owner, the issuer and the credential proofs are verified in one batch.
+    memset(&batch, 0, sizeof(batch));
+    if (DIDDocument_CollectValid(doc, &batch) != 1) {
+        VerifyBatch_Destroy(&batch);
         DIDDocument_Destroy(doc);
         DIDError_Set(DIDERR_NOT_VALID, " * VC %s : is invalid.",
                 DIDURLSTR(&credential->id));
         return 0;
     }
 
-    valid = Credential_IsValid_Internal(credential, doc);
+    valid = Credential_CollectValid(credential, doc, &batch);
     DIDDocument_Destroy(doc);
+    if (valid == 1 && VerifyBatch_Verify(&batch) < 0)
+        valid = 0;
+
+    VerifyBatch_Destroy(&batch);
     if (valid != 1)
         DIDError_Set(DIDERR_NOT_VALID, " * VC %s : is invalid.",
                 DIDURLSTR(&credential->id));
@@ -1060,6 +1489,15 @@ int Credential_Copy(Credential *dest, Credential *src)
 
     memcpy(&dest->proof, &src->proof, sizeof(CredentialProof));
     CredentialMetadata_Copy(&dest->metadata, &src->metadata);
+    dest->id.metadata = &dest->metadata;
+    if (MEMO_LOAD(&src->cache.digested) == MEMO_SET) {
+        memcpy(dest->cache.digest, src->cache.digest, SHA256_BYTES);
+        dest->cache.digested = MEMO_SET;
+    }
+    if (MEMO_LOAD(&src->cache.genuine) == MEMO_SET) {
+        strcpy(dest->cache.signkey, src->cache.signkey);
+        dest->cache.genuine = MEMO_SET;
+    }
 
     return 0;
 }
@@ -29,8 +29,11 @@
 #include "did.h"
 #include "didurl.h"
 #include "JsonGenerator.h"
+#include "JsonReader.h"
+#include "Arena.h"
 #include "credmeta.h"
 #include "common.h"
+#include "diddocument.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -62,6 +65,19 @@ struct Credential {
     CredentialSubject subject;
     CredentialProof proof;
     CredentialMetadata metadata;
+
+    //Set if parsed, the credential may live in the arena of its document.
+    Arena *arena;
+
+    //Memoized verification state. The proof is genuine as long as the issuer
+    //still verifies it with the same key. The flags are MEMO_* states, each
+    //memo is written once and published after its data.
+    struct {
+        int digested;
+        uint8_t digest[SHA256_BYTES];
+        char signkey[PUBLICKEY_BASE58_BYTES];
+        int genuine;
+    } cache;
 };
 
 int CredentialArray_ToJson(JsonGenerator *gen, Credential **creds, size_t size,
@@ -69,10 +85,14 @@ int CredentialArray_ToJson(JsonGenerator *gen, Credential **creds, size_t size,
 
 Credential *Credential_From_Internal(json_t *json, DID *did);
 
+Credential *Credential_FromReader(JsonReader *reader, DID *did, Arena *arena);
+
 ssize_t Parse_Credentials(DID *did, Credential **creds, size_t size, json_t *json);
 
 const char* Credential_ToJson_ForSign(Credential *cred, bool compact, bool forsign);
 
+ssize_t Credential_Digest_ForSign(Credential *cred, uint8_t *digest);
+
 int Credential_Verify(Credential *cred);
 
 int Credential_ToJson_Internal(JsonGenerator *gen, Credential *cred, DID *did,
@@ -92,6 +112,12 @@ time_t Credential_GetExpirationDate_Internal(Credential *cred, DIDDocument *docu
 
 int Credential_IsValid_Internal(Credential *cred, DIDDocument *document);
 
+int Credential_CollectGenuine(Credential *cred, DIDDocument *document, VerifyBatch *batch);
+
+int Credential_CollectValid(Credential *cred, DIDDocument *document, VerifyBatch *batch);
+
+void Credential_MarkGenuine(Credential *cred, const char *signkey);
+
 #ifdef __cplusplus
 }
 #endif
@@ -182,6 +182,24 @@ int DID_Init(DID *did, const char *idstring)
     return 0;
 }
 
+//The DIDs handed to the caller carry their own metadata, the ones embedded
+//in a document or a credential borrow the owner's.
+typedef struct StandaloneDID {
+    DID did;
+    DIDMetadata metadata;
+} StandaloneDID;
+
+static DID *did_alloc(void)
+{
+    return (DID *)calloc(1, sizeof(StandaloneDID));
+}
+
+//after the parser, which clears the DID.
+static void did_attach(DID *did)
+{
+    did->metadata = &((StandaloneDID *)did)->metadata;
+}
+
 DID *DID_FromString(const char *idstring)
 {
     DID *did;
@@ -190,7 +208,7 @@ DID *DID_FromString(const char *idstring)
 
     CHECK_ARG(!idstring || !*idstring, "No idstring argument.", NULL);
 
-    did = (DID *)calloc(1, sizeof(DID));
+    did = did_alloc();
     if (!did) {
         DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for DID failed.");
         return NULL;
@@ -201,6 +219,7 @@ DID *DID_FromString(const char *idstring)
         return NULL;
     }
 
+    did_attach(did);
     return did;
 
     DIDERROR_FINALIZE();
@@ -217,7 +236,7 @@ DID *DID_New(const char *method_specific_string)
     CHECK_ARG(strlen(method_specific_string) >= MAX_ID_SPECIFIC_STRING,
             "Method specific string is too long.", NULL);
 
-    did = (DID *)calloc(1, sizeof(DID));
+    did = did_alloc();
     if (!did) {
         DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for DID failed.");
         return NULL;
@@ -225,6 +244,7 @@ DID *DID_New(const char *method_specific_string)
 
     strcpy(did->method, did_method);
     strcpy(did->idstring, method_specific_string);
+    did_attach(did);
     return did;
 
     DIDERROR_FINALIZE();
@@ -245,7 +265,7 @@ DID *DID_NewWithMethod(const char *method, const char *method_specific_string)
     CHECK_ARG(strlen(method_specific_string) >= MAX_ID_SPECIFIC_STRING,
             "Method specific string is too long.", NULL);
 
-    did = (DID *)calloc(1, sizeof(DID));
+    did = did_alloc();
     if (!did) {
         DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for DID failed.");
         return NULL;
@@ -253,6 +273,7 @@ DID *DID_NewWithMethod(const char *method, const char *method_specific_string)
 
     strcpy(did->method, method);
     strcpy(did->idstring, method_specific_string);
+    did_attach(did);
     return did;
 
     DIDERROR_FINALIZE();
@@ -307,6 +328,8 @@ char *DID_ToString(DID *did, char *idstring, size_t len)
     DIDERROR_FINALIZE();
 }
 
+//Copies the id only, dest stays bound to its owner's metadata. The
+//destination is often a field nobody initialized yet.
 DID *DID_Copy(DID *dest, DID *src)
 {
     assert(dest);
@@ -362,7 +385,7 @@ void DID_Destroy(DID *did)
     DIDERROR_INITIALIZE();
 
     if (did) {
-        DIDMetadata_Free(&did->metadata);
+        DIDMetadata_Free(&((StandaloneDID *)did)->metadata);
         free(did);
     }
 
@@ -390,12 +413,49 @@ DIDDocument *DID_Resolve(DID *did, int *status, bool force)
     DIDERROR_FINALIZE();
 }
 
+int DID_ResolveBatch(DID **dids, size_t size, DIDDocument **docs,
+        DIDStatus *statuses, bool force)
+{
+    size_t i;
+
+    DIDERROR_INITIALIZE();
+
+    CHECK_ARG(!dids || size == 0, "No dids to resolve.", -1);
+    CHECK_ARG(!docs, "No buffer for the resolved documents.", -1);
+    CHECK_ARG(!statuses, "Please give argument to record status.", -1);
+
+    for (i = 0; i < size; i++)
+        CHECK_ARG(!dids[i], "Invalid did to resolve.", -1);
+
+    return DIDBackend_ResolveDIDs(dids, size, docs, statuses, force);
+
+    DIDERROR_FINALIZE();
+}
+
+int DID_ResolveAsync(DID *did, bool force, DIDResolve_Callback *callback, void *context)
+{
+    DIDERROR_INITIALIZE();
+
+    CHECK_ARG(!did, "No did to resolve.", -1);
+    CHECK_ARG(!callback, "No callback for the resolved document.", -1);
+
+    return DIDBackend_ResolveDIDAsync(did, force, callback, context);
+
+    DIDERROR_FINALIZE();
+}
+
 DIDMetadata *DID_GetMetadata(DID *did)
 {
     DIDERROR_INITIALIZE();
 
     CHECK_ARG(!did, "No did to get metadata.", NULL);
-    return &did->metadata;
+
+    if (!did->metadata) {
+        DIDError_Set(DIDERR_NOT_EXISTS, "No metadata attached to this did.");
+        return NULL;
+    }
+
+    return did->metadata;
 
     DIDERROR_FINALIZE();
 }
@@ -36,7 +36,9 @@ extern "C" {
 struct DID {
     char method[MAX_METHOD_STRING];
     char idstring[MAX_ID_SPECIFIC_STRING];
-    DIDMetadata metadata;
+    //borrowed from the owning document or store listing, unless the DID
+    //came from DID_New/DID_FromString and carries its own.
+    DIDMetadata *metadata;
 };
 
 int DID_Parse(DID *did, const char *idstring);
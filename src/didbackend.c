@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <jansson.h>
+#include <pthread.h>
 
 #include "ela_did.h"
 #include "common.h"
@@ -39,18 +40,57 @@
 #include "diderror.h"
 #include "didbiography.h"
 #include "credentialbiography.h"
+#include "singleflight.h"
+#include "WorkerPool.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+#define __thread        __declspec(thread)
+#endif
 
 #define DEFAULT_TTL    (24 * 60 * 60 * 1000)
+#define MAX_RESOLVE_WORKERS     8
 #define DID_RESOLVE_REQUEST "{\"method\":\"did_resolveDID\",\"params\":[{\"did\":\"%s\",\"all\":%s}], \"id\":\"%s\"}"
 #define DID_RESOLVEVC_REQUEST "{\"method\":\"did_listCredentials\",\"params\":[{\"did\":\"%s\",\"skip\":%d,\"limit\":%d}], \"id\":\"%s\"}"
 #define VC_RESOLVE_REQUEST "{\"method\":\"did_resolveCredential\",\"params\":[{\"id\":\"%s\"}], \"id\":\"%s\"}"
 #define VC_RESOLVE_WITH_ISSUER_REQUEST "{\"method\":\"did_resolveCredential\",\"params\":[{\"id\":\"%s\", \"issuer\":\"%s\"}], \"id\":\"%s\"}"
 
-static DIDLocalResovleHandle *gLocalResolveHandle;
-static CreateIdTransaction_Callback *gCreateIdTransaction;
-static Resolve_Callback *gResolve;
-
-long ttl = DEFAULT_TTL;
+//The global api configures the default backend, or the one the calling
+//thread switched to with DIDBackend_Use.
+static DIDBackend gDefaultBackend;
+static pthread_once_t gDefaultOnce = PTHREAD_ONCE_INIT;
+static __thread DIDBackend *gCurrentBackend;
+
+//A DID_ResolveAsync call, from the worker which prepares it to the
+//DIDBackend_Poll call which delivers it.
+typedef struct AsyncResolve {
+    struct AsyncResolve *next;
+    DIDBackend *backend;
+    DID did;
+    bool force;
+    SingleFlight *flight;
+    struct AsyncResolve *followers;
+    const char *data;
+    DIDDocument *doc;
+    int status;
+    int errcode;
+    char errmsg[256];
+    DIDResolve_Callback *callback;
+    void *context;
+} AsyncResolve;
+
+struct ResolveLoop {
+    pthread_mutex_t lock;
+    pthread_mutex_t polllock;
+    ResolverMulti *multi;
+    WorkerPool *pool;
+    AsyncResolve *inflight;
+    AsyncResolve *completed;
+    size_t pending;
+};
+
+static void loop_destroy(ResolveLoop *loop);
+
+static ResolveLoop *backend_loop(DIDBackend *backend);
 
 static void get_txid(char *txid)
 {
@@ -65,62 +105,279 @@ static void get_txid(char *txid)
     txid[31] = 0;
 }
 
-int DIDBackend_InitializeDefault(CreateIdTransaction_Callback *createtransaction,
-        const char *url, const char *cachedir)
+static int backend_init(DIDBackend *backend)
 {
-    DIDERROR_INITIALIZE();
+    assert(backend);
 
-    CHECK_ARG(!url || !*url, "No url string.", -1);
-    CHECK_ARG(!cachedir || !*cachedir, "No cache directory.", -1);
-    CHECK_ARG(strlen(url) >= URL_LEN, "Url is too long.", -1);
+    memset(backend, 0, sizeof(DIDBackend));
+    if (pthread_rwlock_init(&backend->lock, NULL) != 0)
+        return -1;
 
-    if (DefaultResolve_Init(url) < 0)
+    if (ResolverCache_Init(&backend->cache) < 0) {
+        pthread_rwlock_destroy(&backend->lock);
         return -1;
+    }
 
-    if (createtransaction)
-        gCreateIdTransaction = createtransaction;
+    backend->ttl = DEFAULT_TTL;
+    return 0;
+}
+
+static void default_init(void)
+{
+    backend_init(&gDefaultBackend);
+}
+
+DIDBackend *DIDBackend_GetCurrent(void)
+{
+    if (gCurrentBackend)
+        return gCurrentBackend;
+
+    pthread_once(&gDefaultOnce, default_init);
+    return &gDefaultBackend;
+}
+
+static bool backend_hasresolver(DIDBackend *backend)
+{
+    bool has;
+
+    assert(backend);
+
+    pthread_rwlock_rdlock(&backend->lock);
+    has = backend->resolve || *backend->transport.url;
+    pthread_rwlock_unlock(&backend->lock);
+    return has;
+}
+
+//The resolver may be replaced meanwhile, the request runs on a snapshot.
+static const char *backend_resolve(DIDBackend *backend, const char *request)
+{
+    Resolve_Callback *resolve;
+    ResolverTransport transport;
+
+    assert(backend);
+    assert(request);
+
+    pthread_rwlock_rdlock(&backend->lock);
+    resolve = backend->resolve;
+    memcpy(&transport, &backend->transport, sizeof(ResolverTransport));
+    pthread_rwlock_unlock(&backend->lock);
+
+    if (resolve)
+        return resolve(request);
+
+    if (!*transport.url) {
+        DIDError_Set(DIDERR_DID_RESOLVE_ERROR, "No Resolver.");
+        return NULL;
+    }
+
+    return DefaultResolve_Resolve(&transport, request);
+}
+
+static CreateIdTransaction_Callback *backend_createtransaction(DIDBackend *backend)
+{
+    CreateIdTransaction_Callback *createtransaction;
+
+    assert(backend);
+
+    pthread_rwlock_rdlock(&backend->lock);
+    createtransaction = backend->createtransaction;
+    pthread_rwlock_unlock(&backend->lock);
+    return createtransaction;
+}
+
+static DIDLocalResovleHandle *backend_localresolve(DIDBackend *backend)
+{
+    DIDLocalResovleHandle *handle;
+
+    assert(backend);
+
+    pthread_rwlock_rdlock(&backend->lock);
+    handle = backend->localresolve;
+    pthread_rwlock_unlock(&backend->lock);
+    return handle;
+}
+
+static long backend_ttl(DIDBackend *backend)
+{
+    long ttl;
+
+    assert(backend);
+
+    pthread_rwlock_rdlock(&backend->lock);
+    ttl = backend->ttl;
+    pthread_rwlock_unlock(&backend->lock);
+    return ttl;
+}
+
+static bool backend_verifyonload(DIDBackend *backend)
+{
+    bool verify;
+
+    assert(backend);
+
+    pthread_rwlock_rdlock(&backend->lock);
+    verify = backend->verifyonload;
+    pthread_rwlock_unlock(&backend->lock);
+    return verify;
+}
+
+static int backend_initialize(DIDBackend *backend, CreateIdTransaction_Callback *createtransaction,
+        Resolve_Callback *resolve, const char *url, const char *cachedir)
+{
+    ResolverTransport transport;
+
+    assert(backend);
+    assert(cachedir && *cachedir);
 
-    gResolve = DefaultResolve_Resolve;
+    memset(&transport, 0, sizeof(ResolverTransport));
+    if (url && DefaultResolve_Init(&transport, url) < 0)
+        return -1;
+
+    pthread_rwlock_wrlock(&backend->lock);
+    if (createtransaction)
+        backend->createtransaction = createtransaction;
+
+    //the timeouts stay as they were set.
+    if (url) {
+        backend->resolve = NULL;
+        strcpy(backend->transport.url, transport.url);
+    } else if (resolve) {
+        backend->resolve = resolve;
+    }
+    pthread_rwlock_unlock(&backend->lock);
 
-    if (ResolverCache_SetCacheDir(cachedir) < 0) {
+    if (ResolverCache_SetCacheDir(&backend->cache, cachedir) < 0) {
         DIDError_Set(DIDERR_INVALID_ARGS, "Invalid cache directory.");
         return -1;
     }
 
     return 0;
+}
+
+static DIDBackend *backend_create(CreateIdTransaction_Callback *createtransaction,
+        Resolve_Callback *resolve, const char *url, const char *cachedir)
+{
+    DIDBackend *backend;
+
+    backend = (DIDBackend*)calloc(1, sizeof(DIDBackend));
+    if (!backend) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for backend failed.");
+        return NULL;
+    }
+
+    if (backend_init(backend) < 0) {
+        DIDError_Set(DIDERR_UNKNOWN, "Initialize backend failed.");
+        free(backend);
+        return NULL;
+    }
+
+    if (backend_initialize(backend, createtransaction, resolve, url, cachedir) < 0) {
+        DIDBackend_Destroy(backend);
+        return NULL;
+    }
+
+    return backend;
+}
+
+DIDBackend *DIDBackend_CreateDefault(CreateIdTransaction_Callback *createtransaction,
+        const char *url, const char *cachedir)
+{
+    DIDERROR_INITIALIZE();
+
+    CHECK_ARG(!url || !*url, "No url string.", NULL);
+    CHECK_ARG(!cachedir || !*cachedir, "No cache directory.", NULL);
+    CHECK_ARG(strlen(url) >= URL_LEN, "Url is too long.", NULL);
+
+    return backend_create(createtransaction, NULL, url, cachedir);
 
     DIDERROR_FINALIZE();
 }
 
-int DIDBackend_Initialize(CreateIdTransaction_Callback *createtransaction,
+DIDBackend *DIDBackend_Create(CreateIdTransaction_Callback *createtransaction,
         Resolve_Callback *resolve, const char *cachedir)
 {
     DIDERROR_INITIALIZE();
 
+    CHECK_ARG(!resolve, "No resolve method.", NULL);
+    CHECK_ARG(!cachedir || !*cachedir, "No cache directory.", NULL);
+
+    return backend_create(createtransaction, resolve, NULL, cachedir);
+
+    DIDERROR_FINALIZE();
+}
+
+void DIDBackend_Destroy(DIDBackend *backend)
+{
+    DIDERROR_INITIALIZE();
+
+    if (!backend || backend == &gDefaultBackend)
+        return;
+
+    if (gCurrentBackend == backend)
+        gCurrentBackend = NULL;
+
+    loop_destroy(backend->loop);
+    ResolverCache_Free(&backend->cache);
+    pthread_rwlock_destroy(&backend->lock);
+    free(backend);
+
+    DIDERROR_FINALIZE();
+}
+
+DIDBackend *DIDBackend_Use(DIDBackend *backend)
+{
+    DIDBackend *previous;
+
+    DIDERROR_INITIALIZE();
+
+    previous = gCurrentBackend;
+    gCurrentBackend = backend;
+    return previous;
+
+    DIDERROR_FINALIZE();
+}
+
+void DIDBackend_InvalidateDID(DID *did)
+{
+    assert(did);
+
+    ResolveCache_InvalidateDID(&DIDBackend_GetCurrent()->cache, did);
+}
+
+int DIDBackend_InitializeDefault(CreateIdTransaction_Callback *createtransaction,
+        const char *url, const char *cachedir)
+{
+    DIDERROR_INITIALIZE();
+
+    CHECK_ARG(!url || !*url, "No url string.", -1);
     CHECK_ARG(!cachedir || !*cachedir, "No cache directory.", -1);
+    CHECK_ARG(strlen(url) >= URL_LEN, "Url is too long.", -1);
 
-    if (createtransaction)
-       gCreateIdTransaction = createtransaction;
-    if (resolve)
-       gResolve = resolve;
+    return backend_initialize(DIDBackend_GetCurrent(), createtransaction, NULL, url, cachedir);
 
-    if (ResolverCache_SetCacheDir(cachedir) < 0){
-        DIDError_Set(DIDERR_INVALID_ARGS, "Invalid cache directory.");
-        return -1;
-    }
+    DIDERROR_FINALIZE();
+}
 
-    return 0;
+int DIDBackend_Initialize(CreateIdTransaction_Callback *createtransaction,
+        Resolve_Callback *resolve, const char *cachedir)
+{
+    DIDERROR_INITIALIZE();
+
+    CHECK_ARG(!cachedir || !*cachedir, "No cache directory.", -1);
+
+    return backend_initialize(DIDBackend_GetCurrent(), createtransaction, resolve, NULL, cachedir);
 
     DIDERROR_FINALIZE();
 }
 
 bool DIDBackend_IsInitialized()
 {
-    return gResolve ? true : false;
+    return backend_hasresolver(DIDBackend_GetCurrent());
 }
 
 int DIDBackend_CreateDID(DIDDocument *document, DIDURL *signkey, const char *storepass)
 {
+    CreateIdTransaction_Callback *createtransaction;
     const char *reqstring;
     bool success;
 
@@ -128,7 +385,8 @@ int DIDBackend_CreateDID(DIDDocument *document, DIDURL *signkey, const char *sto
     assert(signkey);
     assert(storepass && *storepass);
 
-    if (!gCreateIdTransaction) {
+    createtransaction = backend_createtransaction(DIDBackend_GetCurrent());
+    if (!createtransaction) {
         DIDError_Set(DIDERR_DID_TRANSACTION_ERROR, "No method to create transaction.\
                 Please use 'DIDBackend_InitializeDefault' or 'DIDBackend_Initialize' to initialize backend.");
         return -1;
@@ -143,7 +401,7 @@ int DIDBackend_CreateDID(DIDDocument *document, DIDURL *signkey, const char *sto
     if (!reqstring)
         return -1;
 
-    success = gCreateIdTransaction(reqstring, "");
+    success = createtransaction(reqstring, "");
     free((void*)reqstring);
     if (!success)
         DIDError_Set(DIDERR_DID_TRANSACTION_ERROR, "Create Id transaction(create) failed.");
@@ -153,6 +411,7 @@ int DIDBackend_CreateDID(DIDDocument *document, DIDURL *signkey, const char *sto
 
 int DIDBackend_UpdateDID(DIDDocument *document, DIDURL *signkey, const char *storepass)
 {
+    CreateIdTransaction_Callback *createtransaction;
     const char *reqstring;
     bool success;
 
@@ -160,7 +419,8 @@ int DIDBackend_UpdateDID(DIDDocument *document, DIDURL *signkey, const char *sto
     assert(signkey);
     assert(storepass && *storepass);
 
-    if (!gCreateIdTransaction) {
+    createtransaction = backend_createtransaction(DIDBackend_GetCurrent());
+    if (!createtransaction) {
         DIDError_Set(DIDERR_DID_TRANSACTION_ERROR, "No method to create transaction.\
                 Please use 'DIDBackend_InitializeDefault' or 'DIDBackend_Initialize' to initialize backend.");
         return -1;
@@ -175,7 +435,7 @@ int DIDBackend_UpdateDID(DIDDocument *document, DIDURL *signkey, const char *sto
     if (!reqstring)
         return -1;
 
-    success = gCreateIdTransaction(reqstring, "");
+    success = createtransaction(reqstring, "");
     free((void*)reqstring);
     if (!success)
         DIDError_Set(DIDERR_DID_TRANSACTION_ERROR, "Create Id transaction(update) failed.");
@@ -186,6 +446,7 @@ int DIDBackend_UpdateDID(DIDDocument *document, DIDURL *signkey, const char *sto
 int DIDBackend_TransferDID(DIDDocument *document, TransferTicket *ticket,
         DIDURL *signkey, const char *storepass)
 {
+    CreateIdTransaction_Callback *createtransaction;
     const char *reqstring;
     bool success;
 
@@ -194,7 +455,8 @@ int DIDBackend_TransferDID(DIDDocument *document, TransferTicket *ticket,
     assert(signkey);
     assert(storepass && *storepass);
 
-    if (!gCreateIdTransaction) {
+    createtransaction = backend_createtransaction(DIDBackend_GetCurrent());
+    if (!createtransaction) {
         DIDError_Set(DIDERR_DID_TRANSACTION_ERROR, "No method to create transaction.\
                 Please use 'DIDBackend_InitializeDefault' or 'DIDBackend_Initialize' to initialize backend.");
         return -1;
@@ -209,7 +471,7 @@ int DIDBackend_TransferDID(DIDDocument *document, TransferTicket *ticket,
     if (!reqstring)
         return -1;
 
-    success = gCreateIdTransaction(reqstring, "");
+    success = createtransaction(reqstring, "");
     free((void*)reqstring);
     if (!success)
         DIDError_Set(DIDERR_DID_TRANSACTION_ERROR, "Create Id transaction(transfer) failed.");
@@ -222,6 +484,7 @@ int DIDBackend_TransferDID(DIDDocument *document, TransferTicket *ticket,
 int DIDBackend_DeactivateDID(DIDDocument *signerdoc, DIDURL *signkey,
         DIDURL *creater, const char *storepass)
 {
+    CreateIdTransaction_Callback *createtransaction;
     const char *reqstring;
     bool success;
 
@@ -229,7 +492,8 @@ int DIDBackend_DeactivateDID(DIDDocument *signerdoc, DIDURL *signkey,
     assert(signkey);
     assert(storepass && *storepass);
 
-    if (!gCreateIdTransaction) {
+    createtransaction = backend_createtransaction(DIDBackend_GetCurrent());
+    if (!createtransaction) {
         DIDError_Set(DIDERR_DID_TRANSACTION_ERROR, "No method to create transaction.\
                 Please use 'DIDBackend_InitializeDefault' or 'DIDBackend_Initialize' to initialize backend.");
         return -1;
@@ -244,7 +508,7 @@ int DIDBackend_DeactivateDID(DIDDocument *signerdoc, DIDURL *signkey,
     if (!reqstring)
         return -1;
 
-    success = gCreateIdTransaction(reqstring, "");
+    success = createtransaction(reqstring, "");
     free((void*)reqstring);
     if (!success)
         DIDError_Set(DIDERR_DID_TRANSACTION_ERROR, "Create Id transaction(deactivated) failed.");
@@ -279,29 +543,38 @@ static json_t *get_resolve_result(json_t *json)
     return item;
 }
 
-static int resolvedid_from_backend(ResolveResult *result, DID *did, bool all)
+static int resolvedid_request(char *request, DID *did, bool all)
 {
-    const char *data = NULL, *forAll;
-    json_t *root = NULL, *item;
-    json_error_t error;
-    char _idstring[ELA_MAX_DID_LEN], request[256], *didstring, txid[32];
-    int rc = -1;
+    char _idstring[ELA_MAX_DID_LEN], *didstring, txid[32];
 
-    assert(result);
+    assert(request);
     assert(did);
 
     didstring = DID_ToString(did, _idstring, sizeof(_idstring));
     if (!didstring)
-        return rc;
+        return -1;
 
-    forAll = !all ? "false" : "true";
     get_txid(txid);
-    if (sprintf(request, DID_RESOLVE_REQUEST, didstring, forAll, txid) == -1) {
+    if (sprintf(request, DID_RESOLVE_REQUEST, didstring, all ? "true" : "false", txid) == -1) {
         DIDError_Set(DIDERR_MALFORMED_RESOLVE_REQUEST, "Generate resolve request failed.");
-        return rc;
+        return -1;
     }
 
-    data = gResolve(request);
+    return 0;
+}
+
+//Parse the response of a resolve request and keep it in the cache, the data is freed.
+static int resolvedid_response(DIDBackend *backend, ResolveResult *result, DID *did,
+        bool all, const char *data)
+{
+    json_t *root = NULL, *item;
+    json_error_t error;
+    int rc = -1;
+
+    assert(backend);
+    assert(result);
+    assert(did);
+
     if (!data) {
         DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESPONSE, "No resolve data %s from chain failed.", DIDSTR(did));
         return rc;
@@ -320,7 +593,7 @@ static int resolvedid_from_backend(ResolveResult *result, DID *did, bool all)
     if (ResolveResult_FromJson(result, item, all) == -1)
         goto errorExit;
 
-    if (ResolveResult_GetStatus(result) != DIDStatus_NotFound && ResolveCache_StoreDID(result, did) == -1)
+    if (ResolveResult_GetStatus(result) != DIDStatus_NotFound && ResolveCache_StoreDID(&backend->cache, result, did) == -1)
         goto errorExit;
 
     rc = 0;
@@ -328,11 +601,24 @@ static int resolvedid_from_backend(ResolveResult *result, DID *did, bool all)
 errorExit:
     if (root)
         json_decref(root);
-    if (data)
-        free((void*)data);
+    free((void*)data);
     return rc;
 }
 
+static int resolvedid_from_backend(DIDBackend *backend, ResolveResult *result, DID *did, bool all)
+{
+    char request[256];
+
+    assert(backend);
+    assert(result);
+    assert(did);
+
+    if (resolvedid_request(request, did, all) < 0)
+        return -1;
+
+    return resolvedid_response(backend, result, did, all, backend_resolve(backend, request));
+}
+
 static ssize_t listvcs_result_fromjson(json_t *json, DIDURL **buffer, size_t size, const char *did)
 {
     json_t *item, *field;
@@ -377,7 +663,7 @@ static ssize_t listvcs_result_fromjson(json_t *json, DIDURL **buffer, size_t siz
     return len;
 }
 
-static ssize_t listvcs_from_backend(DID *did, DIDURL **buffer, size_t size, int skip, int limit)
+static ssize_t listvcs_from_backend(DIDBackend *backend, DID *did, DIDURL **buffer, size_t size, int skip, int limit)
 {
     const char *data = NULL;
     json_t *root = NULL, *item;
@@ -385,6 +671,7 @@ static ssize_t listvcs_from_backend(DID *did, DIDURL **buffer, size_t size, int
     char _idstring[ELA_MAX_DID_LEN], request[256], txid[32], *didstring;
     ssize_t rc = -1, len = 0;
 
+    assert(backend);
     assert(buffer);
     assert(did);
     assert(size > 0);
@@ -401,7 +688,7 @@ static ssize_t listvcs_from_backend(DID *did, DIDURL **buffer, size_t size, int
         return rc;
     }
 
-    data = gResolve(request);
+    data = backend_resolve(backend, request);
     if (!data) {
         DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESPONSE, "No resolve did %s failed.", did->idstring);
         return rc;
@@ -427,7 +714,7 @@ errorExit:
     return rc;
 }
 
-static CredentialBiography *resolvevc_from_backend(DIDURL *id, DID *issuer)
+static CredentialBiography *resolvevc_from_backend(DIDBackend *backend, DIDURL *id, DID *issuer)
 {
     CredentialBiography *biography = NULL;
     const char *data = NULL;
@@ -436,6 +723,7 @@ static CredentialBiography *resolvevc_from_backend(DIDURL *id, DID *issuer)
     char _idstring[ELA_MAX_DIDURL_LEN], _didstring[ELA_MAX_DID_LEN], request[256], txid[32];
     char *idstring, *didstring = NULL;
 
+    assert(backend);
     assert(id);
 
     idstring = DIDURL_ToString_Internal(id, _idstring, sizeof(_idstring), false);
@@ -456,7 +744,7 @@ static CredentialBiography *resolvevc_from_backend(DIDURL *id, DID *issuer)
         }
     }
 
-    data = gResolve(request);
+    data = backend_resolve(backend, request);
     if (!data) {
         DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESPONSE, "Resolve data %s from chain failed.", idstring);
         return NULL;
@@ -477,7 +765,7 @@ static CredentialBiography *resolvevc_from_backend(DIDURL *id, DID *issuer)
         goto errorExit;
 
     if (CredentialBiography_GetStatus(biography) != CredentialStatus_NotFound &&
-            ResolveCache_StoreCredential(biography, id) == -1) {
+            ResolveCache_StoreCredential(&backend->cache, biography, id) == -1) {
         CredentialBiography_Destroy(biography);
         biography = NULL;
     }
@@ -490,89 +778,142 @@ errorExit:
     return biography;
 }
 
-static int resolve_internal(ResolveResult *result, DID *did, bool all, bool force)
+static int resolve_internal(DIDBackend *backend, ResolveResult *result, DID *did,
+        bool all, bool force, bool *verified, time_t *fetched)
 {
+    assert(backend);
     assert(result);
     assert(did);
     assert(!all || (all && force));
 
-    if (!force && ResolverCache_LoadDID(result, did, ttl) == 0)
+    if (verified)
+        *verified = false;
+
+    if (!force && ResolverCache_LoadDID(&backend->cache, result, did, backend_ttl(backend),
+            verified, fetched) == 0)
         return 0;
 
-    if (resolvedid_from_backend(result, did, all) < 0)
+    if (verified)
+        *verified = false;
+
+    if (fetched)
+        time(fetched);
+
+    if (resolvedid_from_backend(backend, result, did, all) < 0)
         return -1;
 
     return 0;
 }
 
-static CredentialBiography *resolvevc_internal(DIDURL *id, DID *issuer, bool force)
+static void *biography_copy(void *data)
+{
+    CredentialBiography *biography = (CredentialBiography*)data;
+    const char *json;
+    json_t *root;
+    json_error_t error;
+
+    assert(biography);
+
+    json = Credentialbiography_ToJson(biography);
+    if (!json)
+        return NULL;
+
+    root = json_loads(json, JSON_COMPACT, &error);
+    free((void*)json);
+    if (!root)
+        return NULL;
+
+    biography = CredentialBiography_FromJson(root);
+    json_decref(root);
+    return biography;
+}
+
+static void biography_free(void *data)
+{
+    CredentialBiography_Destroy((CredentialBiography*)data);
+}
+
+static CredentialBiography *resolvevc_internal(DIDBackend *backend, DIDURL *id,
+        DID *issuer, bool force)
 {
     CredentialBiography *biography;
+    SingleFlight *flight;
+    char key[ELA_MAX_DIDURL_LEN * 2 + 32], idstring[ELA_MAX_DIDURL_LEN], issuerstring[ELA_MAX_DID_LEN];
+    bool leader;
+    int status;
 
+    assert(backend);
     assert(id);
 
     if (!force) {
-        biography = ResolverCache_LoadCredential(id, issuer, ttl);
+        biography = ResolverCache_LoadCredential(&backend->cache, id, issuer, backend_ttl(backend));
         if (biography)
             return biography;
     }
 
-    return resolvevc_from_backend(id, issuer);
+    //Concurrent resolves of the same credential share one request to the backend.
+    snprintf(key, sizeof(key), "%p:vc:%s:%s", (void*)backend, DIDURL_ToString(id, idstring, sizeof(idstring)),
+            issuer ? DID_ToString(issuer, issuerstring, sizeof(issuerstring)) : "");
+    flight = SingleFlight_Join(key, &leader);
+    if (!flight)
+        return resolvevc_from_backend(backend, id, issuer);
+
+    if (!leader) {
+        biography = (CredentialBiography*)SingleFlight_Wait(flight, &status);
+        if (!biography)
+            DIDError_Set(DIDERR_DID_RESOLVE_ERROR, "Resolve credential %s failed.", DIDURLSTR(id));
+        return biography;
+    }
+
+    biography = resolvevc_from_backend(backend, id, issuer);
+    SingleFlight_Complete(flight, biography, 0, biography_copy, biography_free);
+    return biography;
 }
 
-DIDDocument *DIDBackend_ResolveDID(DID *did, int *status, bool force)
+//Check the biography and take the document out of it, the result is released.
+static DIDDocument *document_from_result(DIDBackend *backend, DID *did, ResolveResult *result,
+        bool verified, time_t fetched, int *status)
 {
     DIDDocument *doc = NULL;
-    ResolveResult result;
     DIDTransaction *info = NULL;
+    VerifyBatch batch;
     const char *op;
     size_t i;
 
+    assert(backend);
     assert(did);
+    assert(result);
+    assert(status);
 
-    //If user give document to verify, sdk use it first.
-    if (gLocalResolveHandle) {
-        doc = gLocalResolveHandle(did);
-        if (doc)
-            return doc;
-    }
-
-    if (!gResolve) {
-        *status = DIDStatus_Error;
-        DIDError_Set(DIDERR_DID_RESOLVE_ERROR, "No Resolver.");
-        return NULL;
-    }
-
-    memset(&result, 0, sizeof(ResolveResult));
-    if (resolve_internal(&result, did, false, force) == -1)
-        goto errorExit;
+    memset(&batch, 0, sizeof(VerifyBatch));
 
-    switch (result.status) {
+    switch (result->status) {
         case DIDStatus_NotFound:
             *status = DIDStatus_NotFound;
-            ResolveResult_Destroy(&result);
+            ResolveCache_InvalidateDocument(&backend->cache, did);
+            ResolveResult_Destroy(result);
             return NULL;
 
         case DIDStatus_Deactivated:
-            if (result.txs.size != 2) {
+            if (result->txs.size != 2) {
                 DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESULT, "Invalid DID biography, wrong transaction count.");
                 goto errorExit;
             }
 
-            if (strcmp("deactivate", result.txs.txs[0].request.header.op) ||
-                    !strcmp("deactivate", result.txs.txs[1].request.header.op)) {
+            if (strcmp("deactivate", result->txs.txs[0].request.header.op) ||
+                    !strcmp("deactivate", result->txs.txs[1].request.header.op)) {
                 DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESULT, "Invalid DID biography, wrong status.");
                 goto errorExit;
             }
 
-            info = &result.txs.txs[1];
+            info = &result->txs.txs[1];
             doc = info->request.doc;
             if (!doc) {
                 DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESULT, "Invalid DID biography, missing document.");
                 goto errorExit;
             }
 
-            if (!DIDRequest_IsValid(&result.txs.txs[0].request, doc)) {
+            if (!DIDRequest_CollectValid(&result->txs.txs[0].request, doc, verified ? NULL : &batch)) {
                 DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESULT, "Document is not valid.");
                 goto errorExit;
             }
@@ -582,7 +923,7 @@ DIDDocument *DIDBackend_ResolveDID(DID *did, int *status, bool force)
             break;
 
         case DIDStatus_Valid:
-            info = &result.txs.txs[0];
+            info = &result->txs.txs[0];
             doc = info->request.doc;
             if (!doc) {
                 DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESULT, "Invalid DID biography, missing document.");
@@ -604,35 +945,830 @@ DIDDocument *DIDBackend_ResolveDID(DID *did, int *status, bool force)
         goto errorExit;
     }
 
-    if (!DIDRequest_IsValid(&info->request, doc)) {
+    if (!DIDRequest_CollectValid(&info->request, doc, verified ? NULL : &batch)) {
         DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESULT, "Invalid transaction.");
         goto errorExit;
     }
 
-    for (; i < result.txs.size; i++)
-        DIDDocument_Destroy(result.txs.txs[i].request.doc);
-    ResolveResult_Free(&result);
+    //all the signatures of the biography are checked together.
+    if (!verified) {
+        if (VerifyBatch_Verify(&batch) < 0) {
+            DIDError_Set(DIDERR_MALFORMED_RESOLVE_RESULT, "Invalid transaction.");
+            goto errorExit;
+        }
+
+        //the document proofs are in the batch, the copies from the memory
+        //cache don't verify them again.
+        DIDDocument_MarkGenuine(doc);
+        ResolveCache_MarkDIDVerified(&backend->cache, result, did);
+    }
+    VerifyBatch_Destroy(&batch);
+
+    //the memory copy expires with the result it was taken from.
+    ResolveCache_StoreDocument(&backend->cache, doc, *status, fetched);
+
+    for (; i < result->txs.size; i++)
+        DIDDocument_Destroy(result->txs.txs[i].request.doc);
+    ResolveResult_Free(result);
     return doc;
 
 errorExit:
     *status = DIDStatus_Error;
-    ResolveResult_Destroy(&result);
+    VerifyBatch_Destroy(&batch);
+    ResolveCache_InvalidateDocument(&backend->cache, did);
+    ResolveResult_Destroy(result);
     return NULL;
 }
 
+static DIDDocument *resolve_document(DIDBackend *backend, DID *did, int *status, bool force)
+{
+    ResolveResult result;
+    bool verified = false;
+    time_t fetched;
+
+    assert(backend);
+    assert(did);
+    assert(status);
+
+    memset(&result, 0, sizeof(ResolveResult));
+    if (resolve_internal(backend, &result, did, false, force,
+            backend_verifyonload(backend) ? NULL : &verified, &fetched) == -1) {
+        *status = DIDStatus_Error;
+        ResolveCache_InvalidateDocument(&backend->cache, did);
+        ResolveResult_Destroy(&result);
+        return NULL;
+    }
+
+    return document_from_result(backend, did, &result, verified, fetched, status);
+}
+
+static void *document_copy(void *data)
+{
+    DIDDocument *doc;
+
+    assert(data);
+
+    doc = (DIDDocument*)calloc(1, sizeof(DIDDocument));
+    if (!doc)
+        return NULL;
+
+    if (DIDDocument_Copy(doc, (DIDDocument*)data) < 0) {
+        DIDDocument_Destroy(doc);
+        return NULL;
+    }
+
+    return doc;
+}
+
+static void document_free(void *data)
+{
+    DIDDocument_Destroy((DIDDocument*)data);
+}
+
+DIDDocument *DIDBackend_ResolveDID(DID *did, int *status, bool force)
+{
+    DIDBackend *backend = DIDBackend_GetCurrent();
+    DIDLocalResovleHandle *localresolve;
+    DIDDocument *doc = NULL;
+    SingleFlight *flight;
+    char key[ELA_MAX_DID_LEN + 32];
+    bool leader;
+
+    assert(did);
+
+    //If user give document to verify, sdk use it first.
+    localresolve = backend_localresolve(backend);
+    if (localresolve) {
+        doc = localresolve(did);
+        if (doc)
+            return doc;
+    }
+
+    if (!backend_hasresolver(backend)) {
+        *status = DIDStatus_Error;
+        DIDError_Set(DIDERR_DID_RESOLVE_ERROR, "No Resolver.");
+        return NULL;
+    }
+
+    //The memory cache only holds documents which already passed validation.
+    if (!force) {
+        doc = ResolverCache_LoadDocument(&backend->cache, did, backend_ttl(backend), status);
+        if (doc)
+            return doc;
+    }
+
+    //Concurrent resolves of the same did share the one which goes first.
+    snprintf(key, sizeof(key), "%p:%s:%s", (void*)backend, force ? "force" : "did", did->idstring);
+    flight = SingleFlight_Join(key, &leader);
+    if (!flight)
+        return resolve_document(backend, did, status, force);
+
+    if (!leader) {
+        doc = (DIDDocument*)SingleFlight_Wait(flight, status);
+        if (!doc && *status != DIDStatus_NotFound) {
+            *status = DIDStatus_Error;
+            DIDError_Set(DIDERR_DID_RESOLVE_ERROR, "Resolve did %s failed.", DIDSTR(did));
+        }
+        return doc;
+    }
+
+    doc = resolve_document(backend, did, status, force);
+    SingleFlight_Complete(flight, doc, *status, document_copy, document_free);
+    return doc;
+}
+
+//The dids of one DIDBackend_ResolveDIDs call. The caller and the pool
+//workers take the dids one by one; the batch lives until the last of them
+//lets it go, so a worker that starts late finds it empty and just leaves.
+typedef struct ResolveBatch {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int refs;
+    DIDBackend *backend;
+    DID **dids;
+    DIDDocument **docs;
+    DIDStatus *statuses;
+    size_t size;
+    size_t next;
+    size_t done;
+    bool force;
+} ResolveBatch;
+
+static ResolveBatch *batch_create(DIDBackend *backend, size_t size, bool force)
+{
+    ResolveBatch *batch;
+
+    batch = (ResolveBatch*)calloc(1, sizeof(ResolveBatch));
+    if (!batch)
+        return NULL;
+
+    batch->dids = (DID**)calloc(size, sizeof(DID*));
+    batch->docs = (DIDDocument**)calloc(size, sizeof(DIDDocument*));
+    batch->statuses = (DIDStatus*)calloc(size, sizeof(DIDStatus));
+    if (!batch->dids || !batch->docs || !batch->statuses)
+        goto errorExit;
+
+    if (pthread_mutex_init(&batch->lock, NULL) != 0)
+        goto errorExit;
+
+    if (pthread_cond_init(&batch->cond, NULL) != 0) {
+        pthread_mutex_destroy(&batch->lock);
+        goto errorExit;
+    }
+
+    batch->refs = 1;
+    batch->backend = backend;
+    batch->force = force;
+    return batch;
+
+errorExit:
+    free((void*)batch->dids);
+    free((void*)batch->docs);
+    free((void*)batch->statuses);
+    free(batch);
+    return NULL;
+}
+
+static void batch_release(ResolveBatch *batch)
+{
+    bool last;
+
+    assert(batch);
+
+    pthread_mutex_lock(&batch->lock);
+    last = --batch->refs == 0;
+    pthread_mutex_unlock(&batch->lock);
+    if (!last)
+        return;
+
+    pthread_cond_destroy(&batch->cond);
+    pthread_mutex_destroy(&batch->lock);
+    free((void*)batch->dids);
+    free((void*)batch->docs);
+    free((void*)batch->statuses);
+    free(batch);
+}
+
+static void resolve_items(ResolveBatch *batch)
+{
+    DIDBackend *previous;
+    DIDDocument *doc;
+    DIDStatus status;
+    size_t i;
+
+    assert(batch);
+
+    //the workers resolve with the backend of the caller.
+    previous = gCurrentBackend;
+    gCurrentBackend = batch->backend;
+
+    while (true) {
+        pthread_mutex_lock(&batch->lock);
+        i = batch->next < batch->size ? batch->next++ : batch->size;
+        pthread_mutex_unlock(&batch->lock);
+
+        if (i >= batch->size)
+            break;
+
+        doc = DIDBackend_ResolveDID(batch->dids[i], (int*)&status, batch->force);
+
+        pthread_mutex_lock(&batch->lock);
+        batch->docs[i] = doc;
+        batch->statuses[i] = status;
+        if (++batch->done == batch->size)
+            pthread_cond_broadcast(&batch->cond);
+        pthread_mutex_unlock(&batch->lock);
+    }
+
+    gCurrentBackend = previous;
+}
+
+static void resolve_task(void *arg)
+{
+    ResolveBatch *batch = (ResolveBatch*)arg;
+
+    assert(batch);
+
+    DIDError_Initialize();
+    resolve_items(batch);
+    DIDError_Finalize();
+    batch_release(batch);
+}
+
+//Runs the batch on the workers of the backend. The caller resolves too and
+//only waits for the dids already taken, so a batch started from a worker
+//can't wait on tasks queued behind it.
+static void resolve_batch(ResolveBatch *batch)
+{
+    ResolveLoop *loop;
+    size_t count, i;
+
+    assert(batch);
+
+    if (batch->size == 0)
+        return;
+
+    loop = backend_loop(batch->backend);
+    count = MIN(batch->size, MAX_RESOLVE_WORKERS);
+    for (i = 1; loop && i < count; i++) {
+        pthread_mutex_lock(&batch->lock);
+        batch->refs++;
+        pthread_mutex_unlock(&batch->lock);
+
+        if (WorkerPool_Submit(loop->pool, resolve_task, batch) < 0) {
+            batch_release(batch);
+            break;
+        }
+    }
+
+    resolve_items(batch);
+
+    pthread_mutex_lock(&batch->lock);
+    while (batch->done < batch->size)
+        pthread_cond_wait(&batch->cond, &batch->lock);
+    pthread_mutex_unlock(&batch->lock);
+}
+
+int DIDBackend_ResolveDIDs(DID **dids, size_t size, DIDDocument **docs,
+        DIDStatus *statuses, bool force)
+{
+    DIDBackend *backend = DIDBackend_GetCurrent();
+    ResolveBatch *batch = NULL;
+    DIDDocument *doc;
+    size_t *owners = NULL, i, j;
+    int rc = -1;
+
+    assert(dids);
+    assert(size > 0);
+    assert(docs);
+    assert(statuses);
+
+    if (!backend_hasresolver(backend)) {
+        DIDError_Set(DIDERR_DID_RESOLVE_ERROR, "No Resolver.");
+        return -1;
+    }
+
+    batch = batch_create(backend, size, force);
+    //owners[i] is the index of the first occurrence of dids[i]
+    owners = (size_t*)calloc(size, sizeof(size_t));
+    if (!batch || !owners) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for resolving dids failed.");
+        goto errorExit;
+    }
+
+    for (i = 0; i < size; i++) {
+        docs[i] = NULL;
+        statuses[i] = DIDStatus_Error;
+        owners[i] = i;
+
+        for (j = 0; j < i; j++) {
+            if (owners[j] == j && DID_Equals(dids[i], dids[j])) {
+                owners[i] = j;
+                break;
+            }
+        }
+        if (owners[i] != i)
+            continue;
+
+        //return the cache hits without going to the workers.
+        if (!force && !backend_localresolve(backend)) {
+            doc = ResolverCache_LoadDocument(&backend->cache, dids[i], backend_ttl(backend),
+                    (int*)&statuses[i]);
+            if (doc) {
+                docs[i] = doc;
+                continue;
+            }
+        }
+
+        batch->dids[batch->size++] = dids[i];
+    }
+
+    resolve_batch(batch);
+
+    for (i = 0, j = 0; i < size && j < batch->size; i++) {
+        if (owners[i] == i && dids[i] == batch->dids[j]) {
+            docs[i] = batch->docs[j];
+            statuses[i] = batch->statuses[j];
+            j++;
+        }
+    }
+
+    //every duplicated did gets its own copy of the document.
+    for (i = 0; i < size; i++) {
+        if (owners[i] == i)
+            continue;
+
+        statuses[i] = statuses[owners[i]];
+        if (!docs[owners[i]])
+            continue;
+
+        doc = (DIDDocument*)calloc(1, sizeof(DIDDocument));
+        if (!doc || DIDDocument_Copy(doc, docs[owners[i]]) < 0) {
+            DIDDocument_Destroy(doc);
+            statuses[i] = DIDStatus_Error;
+            continue;
+        }
+        docs[i] = doc;
+    }
+
+    rc = 0;
+
+errorExit:
+    if (batch)
+        batch_release(batch);
+    if (owners)
+        free((void*)owners);
+    return rc;
+}
+
+static void loop_destroy(ResolveLoop *loop)
+{
+    AsyncResolve *job;
+
+    if (!loop)
+        return;
+
+    //the queued jobs run to the end, the requests in flight fail.
+    WorkerPool_Destroy(loop->pool);
+    loop->pool = NULL;
+    ResolverMulti_Destroy(loop->multi);
+
+    while ((job = loop->completed) != NULL) {
+        loop->completed = job->next;
+        DIDDocument_Destroy(job->doc);
+        free(job);
+    }
+
+    pthread_mutex_destroy(&loop->polllock);
+    pthread_mutex_destroy(&loop->lock);
+    free(loop);
+}
+
+static ResolveLoop *loop_create(void)
+{
+    ResolveLoop *loop;
+
+    loop = (ResolveLoop*)calloc(1, sizeof(ResolveLoop));
+    if (!loop) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for resolve loop failed.");
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&loop->lock, NULL) != 0) {
+        DIDError_Set(DIDERR_UNKNOWN, "Initialize lock for resolve loop failed.");
+        free(loop);
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&loop->polllock, NULL) != 0) {
+        DIDError_Set(DIDERR_UNKNOWN, "Initialize lock for resolve loop failed.");
+        pthread_mutex_destroy(&loop->lock);
+        free(loop);
+        return NULL;
+    }
+
+    loop->multi = ResolverMulti_Create();
+    if (!loop->multi)
+        goto errorExit;
+
+    loop->pool = WorkerPool_Create(MAX_RESOLVE_WORKERS);
+    if (!loop->pool) {
+        DIDError_Set(DIDERR_UNKNOWN, "Start resolve workers failed.");
+        goto errorExit;
+    }
+
+    return loop;
+
+errorExit:
+    loop_destroy(loop);
+    return NULL;
+}
+
+static ResolveLoop *backend_loop(DIDBackend *backend)
+{
+    ResolveLoop *loop;
+
+    assert(backend);
+
+    pthread_rwlock_rdlock(&backend->lock);
+    loop = backend->loop;
+    pthread_rwlock_unlock(&backend->lock);
+    if (loop)
+        return loop;
+
+    pthread_rwlock_wrlock(&backend->lock);
+    if (!backend->loop)
+        backend->loop = loop_create();
+    loop = backend->loop;
+    pthread_rwlock_unlock(&backend->lock);
+    return loop;
+}
+
+static void async_deliver(ResolveLoop *loop, AsyncResolve *job)
+{
+    assert(loop);
+    assert(job);
+
+    pthread_mutex_lock(&loop->lock);
+    job->next = loop->completed;
+    loop->completed = job;
+    pthread_mutex_unlock(&loop->lock);
+}
+
+static void async_complete(AsyncResolve *job, DIDDocument *doc, int status)
+{
+    AsyncResolve *follower, *followers = NULL, **pp;
+    ResolveLoop *loop;
+    const char *msg;
+
+    assert(job);
+
+    job->doc = doc;
+    job->status = doc ? status : (status == DIDStatus_NotFound ? status : DIDStatus_Error);
+    if (job->status == DIDStatus_Error) {
+        job->errcode = DIDError_GetLastErrorCode();
+        msg = DIDError_GetLastErrorMessage();
+        if (msg) {
+            strncpy(job->errmsg, msg, sizeof(job->errmsg));
+            job->errmsg[sizeof(job->errmsg) - 1] = 0;
+        }
+    }
+
+    loop = job->backend->loop;
+    if (job->flight) {
+        pthread_mutex_lock(&loop->lock);
+        for (pp = &loop->inflight; *pp; pp = &(*pp)->next) {
+            if (*pp == job) {
+                *pp = job->next;
+                break;
+            }
+        }
+        followers = job->followers;
+        job->followers = NULL;
+        pthread_mutex_unlock(&loop->lock);
+
+        SingleFlight_Complete(job->flight, job->doc, job->status, document_copy, document_free);
+        job->flight = NULL;
+    }
+
+    //the async followers get their own copy of the leader's document.
+    while ((follower = followers) != NULL) {
+        followers = follower->next;
+        follower->status = job->status;
+        follower->errcode = job->errcode;
+        memcpy(follower->errmsg, job->errmsg, sizeof(follower->errmsg));
+        if (job->doc) {
+            follower->doc = (DIDDocument*)document_copy(job->doc);
+            if (!follower->doc) {
+                follower->status = DIDStatus_Error;
+                follower->errcode = DIDERR_OUT_OF_MEMORY;
+                strcpy(follower->errmsg, "Copy the resolved document failed.");
+            }
+        }
+        async_deliver(loop, follower);
+    }
+
+    async_deliver(loop, job);
+    ResolverMulti_Wakeup(loop->multi);
+}
+
+//Concurrent resolves of the same did share the one which goes first, as the
+//sync ones do. Returns 1 if the job waits on an async leader, it holds no
+//worker then, 2 if it got the result of a sync leader, 0 if it goes on to
+//the network, as the leader if job->flight is set.
+static int async_join(AsyncResolve *job, DIDDocument **doc, int *status)
+{
+    ResolveLoop *loop;
+    AsyncResolve *leadjob;
+    SingleFlight *flight;
+    char key[ELA_MAX_DID_LEN + 32];
+    bool leader;
+
+    assert(job);
+    assert(doc);
+    assert(status);
+
+    loop = job->backend->loop;
+    pthread_mutex_lock(&loop->lock);
+    for (leadjob = loop->inflight; leadjob; leadjob = leadjob->next) {
+        if (leadjob->force == job->force && DID_Equals(&leadjob->did, &job->did) == 1) {
+            job->next = leadjob->followers;
+            leadjob->followers = job;
+            pthread_mutex_unlock(&loop->lock);
+            return 1;
+        }
+    }
+
+    //the async leader is listed under the same lock, so no async job blocks
+    //a worker on a flight which needs one to finish.
+    snprintf(key, sizeof(key), "%p:%s:%s", (void*)job->backend,
+            job->force ? "force" : "did", job->did.idstring);
+    flight = SingleFlight_Join(key, &leader);
+    if (flight && leader) {
+        job->flight = flight;
+        job->next = loop->inflight;
+        loop->inflight = job;
+    }
+    pthread_mutex_unlock(&loop->lock);
+
+    //the leader is a sync resolve, it runs on its own thread.
+    if (flight && !leader) {
+        *doc = (DIDDocument*)SingleFlight_Wait(flight, status);
+        if (!*doc && *status != DIDStatus_NotFound) {
+            *status = DIDStatus_Error;
+            DIDError_Set(DIDERR_DID_RESOLVE_ERROR, "Resolve did %s failed.", DIDSTR(&job->did));
+        }
+        return 2;
+    }
+
+    return 0;
+}
+
+static void async_validate(void *arg)
+{
+    AsyncResolve *job = (AsyncResolve*)arg;
+    DIDBackend *previous;
+    DIDDocument *doc = NULL;
+    ResolveResult result;
+    int status = DIDStatus_Error;
+
+    assert(job);
+
+    DIDError_Initialize();
+    previous = gCurrentBackend;
+    gCurrentBackend = job->backend;
+
+    memset(&result, 0, sizeof(ResolveResult));
+    if (resolvedid_response(job->backend, &result, &job->did, false, job->data) == 0) {
+        doc = document_from_result(job->backend, &job->did, &result, false, time(NULL), &status);
+    } else {
+        ResolveCache_InvalidateDocument(&job->backend->cache, &job->did);
+        ResolveResult_Destroy(&result);
+    }
+    job->data = NULL;
+
+    gCurrentBackend = previous;
+    async_complete(job, doc, status);
+    DIDError_Finalize();
+}
+
+//Called by the polling thread, the parsing and validation go to the workers.
+static void async_response(const char *response, void *context)
+{
+    AsyncResolve *job = (AsyncResolve*)context;
+
+    assert(job);
+
+    job->data = response;
+    if (!job->backend->loop->pool ||
+            WorkerPool_Submit(job->backend->loop->pool, async_validate, job) < 0)
+        async_validate(job);
+}
+
+static void async_prepare(void *arg)
+{
+    AsyncResolve *job = (AsyncResolve*)arg;
+    DIDBackend *backend, *previous;
+    DIDLocalResovleHandle *localresolve;
+    ResolverTransport transport;
+    DIDDocument *doc = NULL;
+    ResolveResult result;
+    char request[256];
+    int rc, status = DIDStatus_Error;
+    bool remote, verified = false;
+    time_t fetched;
+
+    assert(job);
+
+    DIDError_Initialize();
+    backend = job->backend;
+    previous = gCurrentBackend;
+    gCurrentBackend = backend;
+
+    pthread_rwlock_rdlock(&backend->lock);
+    remote = !backend->resolve;
+    memcpy(&transport, &backend->transport, sizeof(ResolverTransport));
+    pthread_rwlock_unlock(&backend->lock);
+
+    //a resolve method of the user blocks anyway, it runs here.
+    if (!remote) {
+        doc = DIDBackend_ResolveDID(&job->did, &status, job->force);
+        //the local resolve handle gives the document without a status.
+        if (doc && status == DIDStatus_Error)
+            status = DIDStatus_Valid;
+        goto completed;
+    }
+
+    localresolve = backend_localresolve(backend);
+    if (localresolve) {
+        doc = localresolve(&job->did);
+        if (doc) {
+            status = DIDStatus_Valid;
+            goto completed;
+        }
+    }
+
+    if (!job->force) {
+        doc = ResolverCache_LoadDocument(&backend->cache, &job->did, backend_ttl(backend), &status);
+        if (doc)
+            goto completed;
+
+        memset(&result, 0, sizeof(ResolveResult));
+        if (ResolverCache_LoadDID(&backend->cache, &result, &job->did, backend_ttl(backend),
+                backend_verifyonload(backend) ? NULL : &verified, &fetched) == 0) {
+            doc = document_from_result(backend, &job->did, &result, verified, fetched, &status);
+            goto completed;
+        }
+    }
+
+    rc = async_join(job, &doc, &status);
+    if (rc == 1)
+        goto queued;
+    if (rc == 2)
+        goto completed;
+
+    if (resolvedid_request(request, &job->did, false) == 0 &&
+            ResolverMulti_Submit(backend->loop->multi, &transport, request, async_response, job) == 0)
+        goto queued;
+
+completed:
+    gCurrentBackend = previous;
+    async_complete(job, doc, status);
+    DIDError_Finalize();
+    return;
+
+queued:
+    gCurrentBackend = previous;
+    DIDError_Finalize();
+}
+
+int DIDBackend_ResolveDIDAsync(DID *did, bool force, DIDResolve_Callback *callback,
+        void *context)
+{
+    DIDBackend *backend = DIDBackend_GetCurrent();
+    AsyncResolve *job;
+    ResolveLoop *loop;
+
+    assert(did);
+    assert(callback);
+
+    if (!backend_hasresolver(backend)) {
+        DIDError_Set(DIDERR_DID_RESOLVE_ERROR, "No Resolver.");
+        return -1;
+    }
+
+    loop = backend_loop(backend);
+    if (!loop)
+        return -1;
+
+    job = (AsyncResolve*)calloc(1, sizeof(AsyncResolve));
+    if (!job) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for resolving did failed.");
+        return -1;
+    }
+
+    job->backend = backend;
+    DID_Copy(&job->did, did);
+    job->force = force;
+    job->callback = callback;
+    job->context = context;
+
+    pthread_mutex_lock(&loop->lock);
+    loop->pending++;
+    pthread_mutex_unlock(&loop->lock);
+
+    if (WorkerPool_Submit(loop->pool, async_prepare, job) < 0) {
+        pthread_mutex_lock(&loop->lock);
+        loop->pending--;
+        pthread_mutex_unlock(&loop->lock);
+
+        DIDError_Set(DIDERR_UNKNOWN, "Queue the resolve of %s failed.", DIDSTR(did));
+        free(job);
+        return -1;
+    }
+
+    return 0;
+}
+
+int DIDBackend_Poll(int timeout)
+{
+    DIDBackend *backend;
+    AsyncResolve *job, *completed = NULL;
+    ResolveLoop *loop;
+    size_t delivered = 0, pending;
+    int rc;
+
+    DIDERROR_INITIALIZE();
+
+    backend = DIDBackend_GetCurrent();
+    pthread_rwlock_rdlock(&backend->lock);
+    loop = backend->loop;
+    pthread_rwlock_unlock(&backend->lock);
+    if (!loop)
+        return 0;
+
+    //the multi handle is driven by one thread at a time.
+    pthread_mutex_lock(&loop->polllock);
+
+    pthread_mutex_lock(&loop->lock);
+    pending = loop->pending;
+    if (loop->completed)
+        timeout = 0;
+    pthread_mutex_unlock(&loop->lock);
+
+    if (pending == 0) {
+        pthread_mutex_unlock(&loop->polllock);
+        return 0;
+    }
+
+    rc = ResolverMulti_Perform(loop->multi, timeout);
+
+    //the completed list is the newest first, deliver them in order.
+    pthread_mutex_lock(&loop->lock);
+    while ((job = loop->completed) != NULL) {
+        loop->completed = job->next;
+        job->next = completed;
+        completed = job;
+    }
+    pthread_mutex_unlock(&loop->lock);
+
+    pthread_mutex_unlock(&loop->polllock);
+
+    while ((job = completed) != NULL) {
+        completed = job->next;
+        if (job->status == DIDStatus_Error)
+            DIDError_Set(job->errcode ? job->errcode : DIDERR_DID_RESOLVE_ERROR,
+                    "Resolve did %s failed: %s", job->did.idstring, job->errmsg);
+
+        job->callback(&job->did, job->doc, (DIDStatus)job->status, job->context);
+        free(job);
+        delivered++;
+    }
+
+    pthread_mutex_lock(&loop->lock);
+    loop->pending -= delivered;
+    pending = loop->pending;
+    pthread_mutex_unlock(&loop->lock);
+
+    return rc < 0 ? -1 : (int)pending;
+
+    DIDERROR_FINALIZE();
+}
+
 DIDBiography *DIDBackend_ResolveDIDBiography(DID *did)
 {
+    DIDBackend *backend = DIDBackend_GetCurrent();
     ResolveResult result;
 
     assert(did);
 
-    if (!gResolve) {
+    if (!backend_hasresolver(backend)) {
         DIDError_Set(DIDERR_DID_RESOLVE_ERROR, "No Resolver.");
         return NULL;
     }
 
     memset(&result, 0, sizeof(ResolveResult));
-    if (resolve_internal(&result, did, true, true) == -1) {
+    if (resolve_internal(backend, &result, did, true, true, NULL, NULL) == -1) {
         ResolveResult_Destroy(&result);
         return NULL;
     }
@@ -649,22 +1785,25 @@ DIDBiography *DIDBackend_ResolveDIDBiography(DID *did)
 ssize_t DIDBackend_ListCredentials(DID *did, DIDURL **buffer, size_t size,
         int skip, int limit)
 {
+    DIDBackend *backend = DIDBackend_GetCurrent();
+
     assert(did);
     assert(buffer);
     assert(size > 0);
     assert(skip >= 0 && limit >= 0);
 
-    if (!gResolve) {
+    if (!backend_hasresolver(backend)) {
         DIDError_Set(DIDERR_DID_RESOLVE_ERROR, "No Resolver.");
         return -1;
     }
 
-    return listvcs_from_backend(did, buffer, size, skip, limit);
+    return listvcs_from_backend(backend, did, buffer, size, skip, limit);
 }
 
 int DIDBackend_DeclareCredential(Credential *vc, DIDURL *signkey,
         DIDDocument *document, const char *storepass)
 {
+    CreateIdTransaction_Callback *createtransaction;
     const char *reqstring;
     bool success;
 
@@ -673,7 +1812,8 @@ int DIDBackend_DeclareCredential(Credential *vc, DIDURL *signkey,
     assert(document);
     assert(storepass && *storepass);
 
-    if (!gCreateIdTransaction) {
+    createtransaction = backend_createtransaction(DIDBackend_GetCurrent());
+    if (!createtransaction) {
         DIDError_Set(DIDERR_DID_TRANSACTION_ERROR, "No method to create transaction.\
                 Please use 'DIDBackend_InitializeDefault' or 'DIDBackend_Initialize' to initialize backend.");
         return -1;
@@ -688,7 +1828,7 @@ int DIDBackend_DeclareCredential(Credential *vc, DIDURL *signkey,
     if (!reqstring)
         return -1;
 
-    success = gCreateIdTransaction(reqstring, "");
+    success = createtransaction(reqstring, "");
     free((void*)reqstring);
     if (!success)
         DIDError_Set(DIDERR_DID_TRANSACTION_ERROR, "Create Id transaction(declare) failed.");
@@ -699,6 +1839,7 @@ int DIDBackend_DeclareCredential(Credential *vc, DIDURL *signkey,
 int DIDBackend_RevokeCredential(DIDURL *credid, DIDURL *signkey, DIDDocument *document,
         const char *storepass)
 {
+    CreateIdTransaction_Callback *createtransaction;
     const char *reqstring;
     bool success;
 
@@ -707,7 +1848,8 @@ int DIDBackend_RevokeCredential(DIDURL *credid, DIDURL *signkey, DIDDocument *do
     assert(document);
     assert(storepass && *storepass);
 
-    if (!gCreateIdTransaction) {
+    createtransaction = backend_createtransaction(DIDBackend_GetCurrent());
+    if (!createtransaction) {
         DIDError_Set(DIDERR_DID_TRANSACTION_ERROR, "No method to create transaction.\
                 Please use 'DIDBackend_InitializeDefault' or 'DIDBackend_Initialize' to initialize backend.");
         return -1;
@@ -722,7 +1864,7 @@ int DIDBackend_RevokeCredential(DIDURL *credid, DIDURL *signkey, DIDDocument *do
     if (!reqstring)
         return -1;
 
-    success = gCreateIdTransaction(reqstring, "");
+    success = createtransaction(reqstring, "");
     free((void*)reqstring);
     if (!success)
         DIDError_Set(DIDERR_DID_TRANSACTION_ERROR, "create Id transaction(revoke) failed.");
@@ -732,6 +1874,7 @@ int DIDBackend_RevokeCredential(DIDURL *credid, DIDURL *signkey, DIDDocument *do
 
 Credential *DIDBackend_ResolveCredential(DIDURL *id, int *status, bool force)
 {
+    DIDBackend *backend = DIDBackend_GetCurrent();
     CredentialBiography *biography;
     CredentialTransaction *info;
     Credential *cred = NULL;
@@ -740,12 +1883,12 @@ Credential *DIDBackend_ResolveCredential(DIDURL *id, int *status, bool force)
 
     assert(id);
 
-    if (!gResolve) {
+    if (!backend_hasresolver(backend)) {
         DIDError_Set(DIDERR_DID_RESOLVE_ERROR, "No resolver.");
         return NULL;
     }
 
-    biography = resolvevc_internal(id, NULL, false);
+    biography = resolvevc_internal(backend, id, NULL, false);
     if (!biography) {
         *status = CredentialStatus_Error;
         return NULL;
@@ -829,18 +1972,19 @@ errorExit:
 
 int DIDBackend_ResolveRevocation(DIDURL *id, DID *issuer)
 {
+    DIDBackend *backend = DIDBackend_GetCurrent();
     CredentialBiography *biography;
     int exist;
 
     assert(id);
     assert(issuer);
 
-    if (!gResolve) {
+    if (!backend_hasresolver(backend)) {
         DIDError_Set(DIDERR_DID_RESOLVE_ERROR, "No Resolver.");
         return -1;
     }
 
-    biography = resolvevc_from_backend(id, issuer);
+    biography = resolvevc_from_backend(backend, id, issuer);
     if (!biography)
         return -1;
 
@@ -851,16 +1995,17 @@ int DIDBackend_ResolveRevocation(DIDURL *id, DID *issuer)
 
 CredentialBiography *DIDBackend_ResolveCredentialBiography(DIDURL *id, DID *issuer)
 {
+    DIDBackend *backend = DIDBackend_GetCurrent();
     CredentialBiography *biography;
 
     assert(id);
 
-    if (!gResolve) {
+    if (!backend_hasresolver(backend)) {
         DIDError_Set(DIDERR_DID_RESOLVE_ERROR, "No resolver.");
         return NULL;
     }
 
-    biography = resolvevc_internal(id, issuer, true);
+    biography = resolvevc_internal(backend, id, issuer, true);
     if (biography && CredentialBiography_GetStatus(biography) == CredentialStatus_NotFound) {
         CredentialBiography_Destroy(biography);
         return NULL;
@@ -869,16 +2014,63 @@ CredentialBiography *DIDBackend_ResolveCredentialBiography(DIDURL *id, DID *issu
     return biography;
 }
 
-void DIDBackend_SetTTL(long _ttl)
+void DIDBackend_SetTTL(long ttl)
+{
+    DIDBackend *backend;
+
+    DIDERROR_INITIALIZE();
+
+    backend = DIDBackend_GetCurrent();
+    pthread_rwlock_wrlock(&backend->lock);
+    backend->ttl = ttl;
+    pthread_rwlock_unlock(&backend->lock);
+
+    DIDERROR_FINALIZE();
+}
+
+void DIDBackend_SetVerifyOnLoad(bool verify)
 {
+    DIDBackend *backend;
+
     DIDERROR_INITIALIZE();
 
-    ttl = _ttl;
+    backend = DIDBackend_GetCurrent();
+    pthread_rwlock_wrlock(&backend->lock);
+    backend->verifyonload = verify;
+    pthread_rwlock_unlock(&backend->lock);
+
+    DIDERROR_FINALIZE();
+}
+
+void DIDBackend_SetResolveTimeout(long connecttimeout, long timeout)
+{
+    DIDBackend *backend;
+
+    DIDERROR_INITIALIZE();
+
+    backend = DIDBackend_GetCurrent();
+    pthread_rwlock_wrlock(&backend->lock);
+    backend->transport.connecttimeout = connecttimeout;
+    backend->transport.timeout = timeout;
+    pthread_rwlock_unlock(&backend->lock);
+
+    DIDERROR_FINALIZE();
+}
+
+void DIDBackend_SetMemoryCacheSize(size_t size)
+{
+    DIDERROR_INITIALIZE();
+
+    ResolverCache_SetMemoryCapacity(&DIDBackend_GetCurrent()->cache, size);
 
     DIDERROR_FINALIZE();
 }
 
 void DIDBackend_SetLocalResolveHandle(DIDLocalResovleHandle *handle)
 {
-    gLocalResolveHandle = handle;
+    DIDBackend *backend = DIDBackend_GetCurrent();
+
+    pthread_rwlock_wrlock(&backend->lock);
+    backend->localresolve = handle;
+    pthread_rwlock_unlock(&backend->lock);
 }
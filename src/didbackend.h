@@ -23,13 +23,35 @@
 #ifndef __DIDBACKEND_H__
 #define __DIDBACKEND_H__
 
+#include <pthread.h>
+
 #include "ela_did.h"
 #include "credentialbiography.h"
+#include "didresolver.h"
+#include "resolvercache.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef struct ResolveLoop ResolveLoop;
+
+struct DIDBackend {
+    pthread_rwlock_t lock;
+    CreateIdTransaction_Callback *createtransaction;
+    Resolve_Callback *resolve;
+    DIDLocalResovleHandle *localresolve;
+    ResolverTransport transport;
+    long ttl;
+    bool verifyonload;
+    ResolverCache cache;
+    ResolveLoop *loop;
+};
+
+DIDBackend *DIDBackend_GetCurrent(void);
+
+void DIDBackend_InvalidateDID(DID *did);
+
 int DIDBackend_CreateDID(DIDDocument *document, DIDURL *signkey, const char *storepass);
 
 int DIDBackend_UpdateDID(DIDDocument *document, DIDURL *signkey, const char *storepass);
@@ -47,6 +69,12 @@ int DIDBackend_DeclareCredential(Credential *vc, DIDURL *signkey,
 
 DIDDocument *DIDBackend_ResolveDID(DID *did, int *status, bool force);
 
+int DIDBackend_ResolveDIDAsync(DID *did, bool force, DIDResolve_Callback *callback,
+        void *context);
+
+int DIDBackend_ResolveDIDs(DID **dids, size_t size, DIDDocument **docs,
+        DIDStatus *statuses, bool force);
+
 int DIDBackend_RevokeCredential(DIDURL *credid, DIDURL *signkey,
         DIDDocument *document,  const char *storepass);
 
@@ -25,6 +25,9 @@
 #include <time.h>
 #include <stdlib.h>
 #include <assert.h>
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
 
 #include "ela_did.h"
 #include "did.h"
@@ -34,12 +37,13 @@
 #include "common.h"
 #include "JsonGenerator.h"
 #include "JsonHelper.h"
+#include "JsonReader.h"
 #include "crypto.h"
 #include "HDkey.h"
 #include "didmeta.h"
 #include "diderror.h"
 #include "ticket.h"
-#include "resolvercache.h"
+#include "didbackend.h"
 
 #ifndef DISABLE_JWT
     #include "ela_jwt.h"
@@ -48,6 +52,7 @@
 #endif
 
 #define MAX_EXPIRES              5
+#define DOCUMENT_ARENA_SIZE      (sizeof(DIDDocument) + 8192)
 
 const char *ProofType = "ECDSAsecp256r1";
 
@@ -76,8 +81,60 @@ typedef enum KeyType {
 
 static void PublicKey_Destroy(PublicKey *publickey)
 {
-    if(publickey)
-        free(publickey);
+    if (!publickey)
+        return;
+
+    if (publickey->prepared)
+        ecdsa_publickey_free(publickey->prepared);
+
+    free(publickey);
+}
+
+//Shared documents are verified from several threads, so the prepared key is
+//read with acquire semantics and published once with a compare-and-swap.
+static PreparedPublicKey *PublicKey_LoadPrepared(PublicKey *publickey)
+{
+    assert(publickey);
+
+#if defined(_MSC_VER)
+    return (PreparedPublicKey*)InterlockedCompareExchangePointer(
+            (PVOID volatile *)&publickey->prepared, NULL, NULL);
+#else
+    return __atomic_load_n(&publickey->prepared, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static PreparedPublicKey *PublicKey_GetPrepared(PublicKey *publickey)
+{
+    uint8_t binkey[PUBLICKEY_BYTES];
+    PreparedPublicKey *prepared, *prev;
+
+    assert(publickey);
+
+    prepared = PublicKey_LoadPrepared(publickey);
+    if (prepared)
+        return prepared;
+
+    if (b58_decode(binkey, sizeof(binkey), publickey->publicKeyBase58) != PUBLICKEY_BYTES)
+        return NULL;
+
+    prepared = ecdsa_prepare_publickey(binkey, sizeof(binkey));
+    if (!prepared)
+        return NULL;
+
+#if defined(_MSC_VER)
+    prev = (PreparedPublicKey*)InterlockedCompareExchangePointer(
+            (PVOID volatile *)&publickey->prepared, prepared, NULL);
+#else
+    prev = __sync_val_compare_and_swap(&publickey->prepared, NULL, prepared);
+#endif
+    //another verifier got there first.
+    if (prev) {
+        ecdsa_publickey_free(prepared);
+        return prev;
+    }
+
+    return prepared;
 }
 
 static void Service_Destroy(Service *service)
@@ -91,6 +148,202 @@ static void Service_Destroy(Service *service)
     free(service);
 }
 
+static uint32_t index_hash(IndexKind kind, const char *name)
+{
+    uint32_t hash = 2166136261u ^ (uint32_t)kind;
+
+    assert(name);
+
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static bool index_didmatches(DID *did1, DID *did2)
+{
+    return !strcmp(did1->idstring, did2->idstring) && !strcmp(did1->method, did2->method);
+}
+
+static bool index_urlmatches(DIDURL *id1, DIDURL *id2)
+{
+    return !strcmp(id1->fragment, id2->fragment) && index_didmatches(&id1->did, &id2->did) &&
+            !strcmp(id1->path, id2->path) && !strcmp(id1->queryString, id2->queryString);
+}
+
+static size_t index_size(DIDDocument *document, IndexKind kind)
+{
+    switch (kind) {
+    case IndexKind_PublicKey:
+        return document->publickeys.pks ? document->publickeys.size : 0;
+    case IndexKind_Credential:
+        return document->credentials.credentials ? document->credentials.size : 0;
+    case IndexKind_Service:
+        return document->services.services ? document->services.size : 0;
+    case IndexKind_Controller:
+        return document->controllers.docs ? document->controllers.size : 0;
+    default:
+        return 0;
+    }
+}
+
+static void *index_entry(DIDDocument *document, IndexKind kind, size_t pos)
+{
+    switch (kind) {
+    case IndexKind_PublicKey:
+        return document->publickeys.pks[pos];
+    case IndexKind_Credential:
+        return document->credentials.credentials[pos];
+    case IndexKind_Service:
+        return document->services.services[pos];
+    case IndexKind_Controller:
+        return document->controllers.docs[pos];
+    default:
+        return NULL;
+    }
+}
+
+//controllers are keyed by DID, the others by their DIDURL.
+static bool index_matches(IndexKind kind, void *entry, DID *did, DIDURL *id)
+{
+    if (!entry)
+        return false;
+
+    switch (kind) {
+    case IndexKind_PublicKey:
+        return index_urlmatches(&((PublicKey*)entry)->id, id);
+    case IndexKind_Credential:
+        return index_urlmatches(&((Credential*)entry)->id, id);
+    case IndexKind_Service:
+        return index_urlmatches(&((Service*)entry)->id, id);
+    case IndexKind_Controller:
+        return index_didmatches(&((DIDDocument*)entry)->did, did);
+    default:
+        return false;
+    }
+}
+
+static const char *index_name(IndexKind kind, void *entry)
+{
+    switch (kind) {
+    case IndexKind_PublicKey:
+        return ((PublicKey*)entry)->id.fragment;
+    case IndexKind_Credential:
+        return ((Credential*)entry)->id.fragment;
+    case IndexKind_Service:
+        return ((Service*)entry)->id.fragment;
+    case IndexKind_Controller:
+        return ((DIDDocument*)entry)->did.idstring;
+    default:
+        return "";
+    }
+}
+
+static void diddocument_dropindex(DIDDocument *document)
+{
+    assert(document);
+
+    if (document->index.slots)
+        free(document->index.slots);
+
+    memset(&document->index, 0, sizeof(document->index));
+}
+
+static bool diddocument_hasindex(DIDDocument *document)
+{
+    return document->index.slots &&
+            document->index.pksize == index_size(document, IndexKind_PublicKey) &&
+            document->index.credsize == index_size(document, IndexKind_Credential) &&
+            document->index.servicesize == index_size(document, IndexKind_Service) &&
+            document->index.controllersize == index_size(document, IndexKind_Controller);
+}
+
+//A failed build only leaves the lookups on the linear scan.
+static void diddocument_buildindex(DIDDocument *document)
+{
+    static const IndexKind kinds[] = { IndexKind_PublicKey, IndexKind_Credential,
+            IndexKind_Service, IndexKind_Controller };
+    size_t count = 0, capacity = 8, size, i, j, k;
+    IndexSlot *slots;
+    void *entry;
+    uint32_t hash;
+
+    assert(document);
+
+    diddocument_dropindex(document);
+
+    for (k = 0; k < sizeof(kinds) / sizeof(IndexKind); k++)
+        count += index_size(document, kinds[k]);
+
+    while (capacity < count * 2)
+        capacity <<= 1;
+
+    slots = (IndexSlot*)calloc(capacity, sizeof(IndexSlot));
+    if (!slots)
+        return;
+
+    for (k = 0; k < sizeof(kinds) / sizeof(IndexKind); k++) {
+        size = index_size(document, kinds[k]);
+        for (i = 0; i < size; i++) {
+            entry = index_entry(document, kinds[k], i);
+            if (!entry)
+                continue;
+
+            hash = index_hash(kinds[k], index_name(kinds[k], entry));
+            for (j = hash & (capacity - 1); slots[j].pos; j = (j + 1) & (capacity - 1));
+
+            slots[j].hash = hash;
+            slots[j].kind = (uint16_t)kinds[k];
+            slots[j].pos = (uint32_t)(i + 1);
+        }
+    }
+
+    document->index.capacity = capacity;
+    document->index.slots = slots;
+    document->index.pksize = index_size(document, IndexKind_PublicKey);
+    document->index.credsize = index_size(document, IndexKind_Credential);
+    document->index.servicesize = index_size(document, IndexKind_Service);
+    document->index.controllersize = index_size(document, IndexKind_Controller);
+}
+
+static void *diddocument_lookup(DIDDocument *document, IndexKind kind, DID *did, DIDURL *id)
+{
+    size_t i, size, mask;
+    IndexSlot *slot;
+    void *entry;
+    uint32_t hash;
+
+    assert(document);
+    assert(kind == IndexKind_Controller ? !!did : !!id);
+
+    if (diddocument_hasindex(document)) {
+        hash = index_hash(kind, kind == IndexKind_Controller ? did->idstring : id->fragment);
+        mask = document->index.capacity - 1;
+        for (i = hash & mask; document->index.slots[i].pos; i = (i + 1) & mask) {
+            slot = &document->index.slots[i];
+            if (slot->hash != hash || slot->kind != kind)
+                continue;
+
+            entry = index_entry(document, kind, slot->pos - 1);
+            if (index_matches(kind, entry, did, id))
+                return entry;
+        }
+        return NULL;
+    }
+
+    //builders edit in place, so their documents are scanned.
+    size = index_size(document, kind);
+    for (i = 0; i < size; i++) {
+        entry = index_entry(document, kind, i);
+        if (index_matches(kind, entry, did, id))
+            return entry;
+    }
+
+    return NULL;
+}
+
 static int PublicKey_ToJson(JsonGenerator *gen, PublicKey *pk, int compact)
 {
     char id[ELA_MAX_DIDURL_LEN];
@@ -333,7 +586,12 @@ static int add_to_publickeys(DIDDocument *document, PublicKey *pk)
     assert(document);
     assert(pk);
 
-    pks = realloc(document->publickeys.pks, (document->publickeys.size + 1) * sizeof(PublicKey*));
+    if (document->arena)
+        pks = (PublicKey**)Arena_Grow(document->arena, document->publickeys.pks,
+                document->publickeys.size, sizeof(PublicKey*));
+    else
+        pks = (PublicKey**)realloc(document->publickeys.pks,
+                (document->publickeys.size + 1) * sizeof(PublicKey*));
     if (!pks) {
         DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for publicKeys failed.");
         return -1;
@@ -841,7 +1099,7 @@ int DIDDocument_SetStore(DIDDocument *document, DIDStore *store)
     assert(store);
 
     document->metadata.base.store = store;
-    document->did.metadata.base.store = store;
+    document->did.metadata = &document->metadata;
     return 0;
 }
 
@@ -951,14 +1209,43 @@ static void parse_multisig(const char *buffer, int *m, int *n)
 }
 
 ////////////////////////////////Document/////////////////////////////////////
+static int set_defaultkey(DIDDocument *doc)
+{
+    uint8_t binkey[PUBLICKEY_BYTES];
+    char idstring[ELA_MAX_DID_LEN];
+    int i;
+
+    assert(doc);
+
+    if (!doc->publickeys.size || !doc->publickeys.pks) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "No publicKey.");
+        return -1;
+    }
+
+    //check: pk array has default key.
+    for (i = 0; i < doc->publickeys.size; i++) {
+        PublicKey *pk = doc->publickeys.pks[i];
+        assert(pk);
+
+        b58_decode(binkey, sizeof(binkey), pk->publicKeyBase58);
+        HDKey_PublicKey2Address(binkey, idstring, sizeof(idstring));
+
+        if (!strcmp(idstring, pk->id.did.idstring)) {
+            pk->authenticationKey = true;
+            doc->defaultkey = &pk->id;
+            return 0;
+        }
+    }
+
+    DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "No default key.");
+    return -1;
+}
+
 DIDDocument *DIDDocument_FromJson_Internal(json_t *root, bool resolve)
 {
     DIDDocument *doc;
     json_t *item;
     int m, n;
-    uint8_t binkey[PUBLICKEY_BYTES];
-    char idstring[ELA_MAX_DID_LEN];
-    bool has = false;
 
     assert(root);
 
@@ -1033,93 +1320,720 @@ DIDDocument *DIDDocument_FromJson_Internal(json_t *root, bool resolve)
         goto errorExit;
 
     //check pk size
-    if (!doc->controllers.size) {
-        if (!doc->publickeys.size || !doc->publickeys.pks) {
-            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "No publicKey.");
+    if (!doc->controllers.size && set_defaultkey(doc) < 0)
+        goto errorExit;
+
+    //parse authorization
+    item = json_object_get(root, AUTHORIZATION);
+    if (item) {
+        if (!json_is_array(item)) {
+            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid authorization key.");
             goto errorExit;
         }
+        if (Parse_Auth_PublicKeys(doc, item, KeyType_Authorization) < 0)
+            goto errorExit;
+    }
 
-        //check: pk array has default key.
-        for (int i = 0; i < doc->publickeys.size; i++) {
-            PublicKey *pk = doc->publickeys.pks[i];
-            assert(pk);
-
-            b58_decode(binkey, sizeof(binkey), pk->publicKeyBase58);
-            HDKey_PublicKey2Address(binkey, idstring, sizeof(idstring));
+    //parse expires
+    item = json_object_get(root, EXPIRES);
+    if (!item) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Missing expires time.");
+        goto errorExit;
+    }
+    if (!json_is_string(item) ||
+           parse_time(&doc->expires, json_string_value(item)) == -1) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid expires time.");
+        goto errorExit;
+    }
 
-            if (!strcmp(idstring, pk->id.did.idstring)) {
-                pk->authenticationKey = true;
-                doc->defaultkey = &pk->id;
-                break;
-            }
-        }
-        if (!doc->defaultkey) {
-            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "No default key.");
+    //parse credential
+    item = json_object_get(root, VERIFIABLE_CREDENTIAL);
+    if (item) {
+        if (!json_is_array(item)) {
+            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid credentials.");
             goto errorExit;
         }
+        if (Parse_Credentials_InDoc(doc, item) < 0)
+            goto errorExit;
     }
 
-    //parse authorization
-    item = json_object_get(root, AUTHORIZATION);
+    //parse services
+    item = json_object_get(root, SERVICE);
     if (item) {
         if (!json_is_array(item)) {
-            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid authorization key.");
+            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid services.");
             goto errorExit;
         }
-        if (Parse_Auth_PublicKeys(doc, item, KeyType_Authorization) < 0)
+        if (Parse_Services(doc, item) < 0)
             goto errorExit;
     }
 
-    //parse expires
-    item = json_object_get(root, EXPIRES);
+    item = json_object_get(root, PROOF);
     if (!item) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Missing document proof.");
+        goto errorExit;
+    }
+    if (!json_is_object(item) && !json_is_array(item)) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid document proof.");
+        goto errorExit;
+    }
+    if (Parse_Proofs(doc, item) == -1)
+        goto errorExit;
+
+    //check the document format
+    if (resolve && !controllers_check(doc))
+        goto errorExit;
+
+    doc->did.metadata = &doc->metadata;
+    diddocument_buildindex(doc);
+    return doc;
+
+errorExit:
+    DIDDocument_Destroy(doc);
+    return NULL;
+}
+
+////////////////////////////Document reader//////////////////////////////////
+// The reader decodes the json text straight into the document, only the free
+// form service properties are handed to jansson. The members are located first
+// so the order of them in the text doesn't matter.
+enum {
+    DOC_ID,
+    DOC_CONTROLLER,
+    DOC_MULTISIG,
+    DOC_PUBLICKEY,
+    DOC_AUTHENTICATION,
+    DOC_AUTHORIZATION,
+    DOC_EXPIRES,
+    DOC_CREDENTIAL,
+    DOC_SERVICE,
+    DOC_PROOF,
+    DOC_MEMBERS
+};
+
+static int read_publickey(DIDDocument *document, JsonReader *reader, PublicKey **publickey)
+{
+    JsonMember members[] = { { ID }, { PUBLICKEY_BASE58 }, { CONTROLLER } };
+    char buffer[ELA_MAX_DIDURL_LEN];
+    DID *did = &document->did;
+    PublicKey *pk;
+
+    assert(document);
+    assert(reader);
+    assert(publickey);
+
+    if (DIDJR_ReadMembers(reader, members, 3, NULL, NULL) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid public key.");
+        return -1;
+    }
+
+    if (members[0].value.token == JsonToken_None) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Missing public key id.");
+        return -1;
+    }
+
+    if (members[1].value.token == JsonToken_None) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Missing publicKey base58.");
+        return -1;
+    }
+
+    pk = (PublicKey*)Arena_Alloc(document->arena, sizeof(PublicKey));
+    if (!pk) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for public key failed.");
+        return -1;
+    }
+
+    if (DIDJR_CopyString(&members[0].value, buffer, sizeof(buffer)) < 0 ||
+            DIDURL_Parse(&pk->id, buffer, did) < 0 ||
+            strcmp(did->idstring, pk->id.did.idstring)) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid public key id.");
+        return -1;
+    }
+
+    // set default value for 'type'
+    strcpy(pk->type, ProofType);
+
+    //public key must be have 'publicKeyBase58'
+    if (DIDJR_CopyString(&members[1].value, pk->publicKeyBase58, sizeof(pk->publicKeyBase58)) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid publicKey base58.");
+        return -1;
+    }
+
+    //'controller' may be default
+    if (members[2].value.token == JsonToken_None) {
+        DID_Copy(&pk->controller, did);
+    } else if (DIDJR_CopyString(&members[2].value, buffer, sizeof(buffer)) < 0 ||
+            DID_Parse(&pk->controller, buffer) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid publicKey's controller.");
+        return -1;
+    }
+
+    *publickey = pk;
+    return 0;
+}
+
+static int read_controllers(DIDDocument *document, JsonSpan *span, bool resolve)
+{
+    DIDDocument *controllerdoc, **docs;
+    JsonReader r, *reader;
+    JsonToken token;
+    char buffer[ELA_MAX_DID_LEN];
+    DID controller;
+    int status;
+
+    assert(document);
+    assert(span);
+
+    reader = DIDJR_InitializeSpan(&r, span);
+    token = DIDJR_Next(reader);
+    if (token == JsonToken_StartArray)
+        token = DIDJR_Next(reader);
+
+    for (; token != JsonToken_EndArray && token != JsonToken_End; token = DIDJR_Next(reader)) {
+        if (token != JsonToken_String) {
+            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Wrong controller.");
+            return -1;
+        }
+        if (DIDJR_GetString(reader, buffer, sizeof(buffer)) < 0 ||
+                DID_Parse(&controller, buffer) < 0) {
+            DIDError_Set(DIDERR_OUT_OF_MEMORY, "Create controller failed.");
+            return -1;
+        }
+
+        docs = (DIDDocument**)Arena_Grow(document->arena, document->controllers.docs,
+                document->controllers.size, sizeof(DIDDocument*));
+        if (!docs) {
+            DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for controllers failed.");
+            return -1;
+        }
+        document->controllers.docs = docs;
+
+        //resolved controllers come with an arena of their own.
+        if (resolve) {
+            controllerdoc = DID_Resolve(&controller, &status, false);
+            if (!controllerdoc) {
+                DIDError_Set(DIDERR_DID_RESOLVE_ERROR, "Controller %s %s", DIDSTR(&controller), DIDSTATUS_MSG(status));
+                return -1;
+            }
+        } else {
+            controllerdoc = (DIDDocument*)Arena_Alloc(document->arena, sizeof(DIDDocument));
+            if (!controllerdoc) {
+                DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for Controller document %s failed.", DIDSTR(&controller));
+                return -1;
+            }
+
+            DID_Copy(&controllerdoc->did, &controller);
+            controllerdoc->arena = document->arena;
+        }
+
+        document->controllers.docs[document->controllers.size++] = controllerdoc;
+    }
+
+    return 0;
+}
+
+static int read_publickeys(DIDDocument *document, JsonSpan *span)
+{
+    JsonReader r, *reader;
+    JsonToken token;
+    PublicKey *pk;
+    size_t count = 0;
+
+    assert(document);
+    assert(span);
+
+    reader = DIDJR_InitializeSpan(&r, span);
+    DIDJR_Next(reader);
+
+    while ((token = DIDJR_Next(reader)) != JsonToken_EndArray) {
+        if (token == JsonToken_Error) {
+            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid publicKey.");
+            return -1;
+        }
+
+        count++;
+        if (token != JsonToken_StartObject) {
+            DIDJR_Skip(reader, NULL);
+            continue;
+        }
+
+        //(required and can't default)
+        if (read_publickey(document, reader, &pk) < 0)
+            continue;
+
+        if (add_to_publickeys(document, pk) < 0)
+            return -1;
+    }
+
+    if (!count) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "PublicKey array is empty.");
+        return -1;
+    }
+
+    if (!document->publickeys.size) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "No invalid publicKey.");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int read_auth_publickeys(DIDDocument *document, JsonSpan *span, KeyType type)
+{
+    JsonReader r, *reader;
+    JsonToken token;
+    PublicKey *pk;
+    DIDURL id;
+    char buffer[ELA_MAX_DIDURL_LEN];
+    size_t count = 0;
+
+    assert(document);
+    assert(span);
+
+    reader = DIDJR_InitializeSpan(&r, span);
+    DIDJR_Next(reader);
+
+    while ((token = DIDJR_Next(reader)) != JsonToken_EndArray) {
+        count++;
+        if (token == JsonToken_String) {
+            if (DIDJR_GetString(reader, buffer, sizeof(buffer)) < 0 ||
+                    DIDURL_Parse(&id, buffer, &document->did) < 0)
+                continue;
+
+            pk = DIDDocument_GetPublicKey(document, &id);
+            if (!pk) {
+                DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Auth key is not in pulicKeys.");
+                return -1;
+            }
+        } else if (token == JsonToken_StartObject) {
+            if (read_publickey(document, reader, &pk) < 0 ||
+                    add_to_publickeys(document, pk) < 0)
+                return -1;
+        } else {
+            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Auth key array is invalid.");
+            return -1;
+        }
+
+        if (type == KeyType_Authentication)
+            pk->authenticationKey = true;
+        if (type == KeyType_Authorization)
+            pk->authorizationKey = true;
+    }
+
+    if (!count) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Auth key array is empty.");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int read_credentials(DIDDocument *document, JsonSpan *span)
+{
+    Credential *credential, **credentials;
+    JsonReader r, *reader;
+    JsonToken token;
+    size_t count = 0;
+
+    assert(document);
+    assert(span);
+
+    reader = DIDJR_InitializeSpan(&r, span);
+    DIDJR_Next(reader);
+
+    while ((token = DIDJR_Next(reader)) != JsonToken_EndArray) {
+        if (token == JsonToken_Error) {
+            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid credentials.");
+            return -1;
+        }
+
+        count++;
+        if (token != JsonToken_StartObject) {
+            DIDJR_Skip(reader, NULL);
+            continue;
+        }
+
+        credential = Credential_FromReader(reader, &document->did, document->arena);
+        if (!credential)
+            continue;
+
+        credentials = (Credential**)Arena_Grow(document->arena, document->credentials.credentials,
+                document->credentials.size, sizeof(Credential*));
+        if (!credentials) {
+            DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for credentials failed.");
+            Credential_Destroy(credential);
+            return -1;
+        }
+
+        credentials[document->credentials.size++] = credential;
+        document->credentials.credentials = credentials;
+    }
+
+    if (!count) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Credential array is empty.");
+        return -1;
+    }
+
+    return document->credentials.size > 0 ? 0 : -1;
+}
+
+static int read_services(DIDDocument *document, JsonSpan *span)
+{
+    JsonMember members[] = { { ID }, { TYPE }, { SERVICE_ENDPOINT } };
+    Service *service, **services;
+    JsonReader r, *reader;
+    JsonToken token;
+    json_t *properties;
+    char buffer[ELA_MAX_DIDURL_LEN];
+    size_t count = 0;
+
+    assert(document);
+    assert(span);
+
+    reader = DIDJR_InitializeSpan(&r, span);
+    DIDJR_Next(reader);
+
+    while ((token = DIDJR_Next(reader)) != JsonToken_EndArray) {
+        if (token == JsonToken_Error) {
+            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid services.");
+            return -1;
+        }
+
+        count++;
+        if (token != JsonToken_StartObject) {
+            DIDJR_Skip(reader, NULL);
+            continue;
+        }
+
+        //for property
+        properties = NULL;
+        if (DIDJR_ReadMembers(reader, members, 3, DIDJR_CollectMember, &properties) < 0) {
+            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid service properties.");
+            if (properties)
+                json_decref(properties);
+            return -1;
+        }
+
+        service = (Service *)Arena_Alloc(document->arena, sizeof(Service));
+        if (!service) {
+            if (properties)
+                json_decref(properties);
+            continue;
+        }
+
+        service->properties = properties;
+
+        if (DIDJR_CopyString(&members[0].value, buffer, sizeof(buffer)) < 0 ||
+                DIDURL_Parse(&service->id, buffer, &document->did) < 0 ||
+                DIDJR_CopyString(&members[1].value, service->type, sizeof(service->type)) < 0 ||
+                DIDJR_CopyString(&members[2].value, service->endpoint, sizeof(service->endpoint)) < 0) {
+            if (properties)
+                json_decref(properties);
+            continue;
+        }
+
+        if (DID_IsEmpty(&service->id.did))
+            DID_Copy(&service->id.did, &document->did);
+
+        services = (Service**)Arena_Grow(document->arena, document->services.services,
+                document->services.size, sizeof(Service*));
+        if (!services) {
+            DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for services failed.");
+            if (properties)
+                json_decref(properties);
+            return -1;
+        }
+
+        services[document->services.size++] = service;
+        document->services.services = services;
+    }
+
+    if (!count) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Service array is empty.");
+        return -1;
+    }
+
+    if (!document->services.size) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "No invalid service.");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int read_proof(DIDDocument *document, JsonReader *reader, DocumentProof *proof)
+{
+    JsonMember members[] = { { TYPE }, { CREATED }, { CREATOR }, { SIGNATURE_VALUE } };
+    char buffer[ELA_MAX_DIDURL_LEN];
+    DIDURL *key;
+
+    assert(document);
+    assert(reader);
+    assert(proof);
+
+    if (reader->token != JsonToken_StartObject ||
+            DIDJR_ReadMembers(reader, members, 4, NULL, NULL) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid proof format.");
+        return -1;
+    }
+
+    if (members[0].value.token == JsonToken_None) {
+        strcpy(proof->type, ProofType);
+    } else if (DIDJR_CopyString(&members[0].value, proof->type, sizeof(proof->type)) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid proof type.");
+        return -1;
+    }
+
+    if (members[1].value.token == JsonToken_None) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Missing create document time.");
+        return -1;
+    }
+    if (DIDJR_CopyString(&members[1].value, buffer, sizeof(buffer)) < 0 ||
+            parse_time(&proof->created, buffer) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid create document time.");
+        return -1;
+    }
+
+    if (members[2].value.token != JsonToken_None) {
+        if (DIDJR_CopyString(&members[2].value, buffer, sizeof(buffer)) < 0 ||
+                DIDURL_Parse(&proof->creater, buffer, &document->did) == -1) {
+            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid document creater.");
+            return -1;
+        }
+    } else {
+        key = DIDDocument_GetDefaultPublicKey(document);
+        if (!key || !DIDURL_Copy(&proof->creater, key)) {
+            DIDError_Set(DIDERR_MALFORMED_DIDURL, "Set document creater failed.");
+            return -1;
+        }
+    }
+
+    if (members[3].value.token == JsonToken_None) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Missing signature.");
+        return -1;
+    }
+    if (members[3].value.token != JsonToken_String) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid signature.");
+        return -1;
+    }
+    if (DIDJR_CopyString(&members[3].value, proof->signatureValue, sizeof(proof->signatureValue)) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Document signature is too long.");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int read_proofs(DIDDocument *document, JsonSpan *span)
+{
+    DocumentProof *proofs;
+    JsonReader r, *reader;
+    JsonToken token;
+    bool array;
+
+    assert(document);
+    assert(span);
+
+    reader = DIDJR_InitializeSpan(&r, span);
+    token = DIDJR_Next(reader);
+    array = (token == JsonToken_StartArray);
+    if (array)
+        token = DIDJR_Next(reader);
+
+    for (; token != JsonToken_EndArray && token != JsonToken_End; token = DIDJR_Next(reader)) {
+        proofs = (DocumentProof*)Arena_Grow(document->arena, document->proofs.proofs,
+                document->proofs.size, sizeof(DocumentProof));
+        if (!proofs) {
+            DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for proofs failed.");
+            return -1;
+        }
+        document->proofs.proofs = proofs;
+
+        if (read_proof(document, reader, &proofs[document->proofs.size]) < 0)
+            return -1;
+
+        document->proofs.size++;
+        if (!array)
+            break;
+    }
+
+    return 0;
+}
+
+static DIDDocument *read_document(const char *json, size_t len, bool resolve)
+{
+    JsonMember members[DOC_MEMBERS] = {
+        { ID }, { CONTROLLER }, { MULTI_SIGNATURE }, { PUBLICKEY }, { AUTHENTICATION },
+        { AUTHORIZATION }, { EXPIRES }, { VERIFIABLE_CREDENTIAL }, { SERVICE }, { PROOF }
+    };
+    JsonReader r, *reader;
+    JsonSpan *item;
+    DIDDocument *doc;
+    Arena *arena;
+    char buffer[DOC_BUFFER_LEN];
+    int m, n;
+
+    assert(json);
+
+    //locate the members and check the whole text at once.
+    reader = DIDJR_Initialize(&r, json, len);
+    if (DIDJR_Next(reader) == JsonToken_StartObject)
+        DIDJR_ReadMembers(reader, members, DOC_MEMBERS, NULL, NULL);
+    else
+        DIDJR_Skip(reader, NULL);
+
+    if (reader->token == JsonToken_Error || DIDJR_Finish(reader) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Deserialize document failed, error: %s.", reader->error);
+        return NULL;
+    }
+
+    //the document, its keys, services, proofs and credentials share one arena.
+    arena = Arena_Create(DOCUMENT_ARENA_SIZE);
+    if (!arena) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for document failed.");
+        return NULL;
+    }
+
+    //the first chunk always has room for the document.
+    doc = (DIDDocument*)Arena_Alloc(arena, sizeof(DIDDocument));
+    doc->arena = arena;
+    arena->owner = doc;
+
+    item = &members[DOC_ID].value;
+    if (item->token == JsonToken_None) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Missing document subject.");
+        goto errorExit;
+    }
+    if (DIDJR_CopyString(item, buffer, sizeof(buffer)) < 0 ||
+            DID_Parse(&doc->did, buffer) == -1) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid document subject.");
+        goto errorExit;
+    }
+
+    //parse constroller
+    item = &members[DOC_CONTROLLER].value;
+    if (item->token != JsonToken_None) {
+        if (item->token != JsonToken_String && item->token != JsonToken_StartArray) {
+            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid controller.");
+            goto errorExit;
+        }
+        if (read_controllers(doc, item, resolve) == -1)
+            goto errorExit;
+    }
+
+    //parser multisig
+    item = &members[DOC_MULTISIG].value;
+    if (item->token == JsonToken_None && doc->controllers.size > 1) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Missing multisig.");
+        goto errorExit;
+    }
+    if (item->token != JsonToken_None) {
+        if (item->token != JsonToken_String) {
+            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid multisig, multisig must be string.");
+            goto errorExit;
+        }
+        if (doc->controllers.size <= 1) {
+            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid multisig.");
+            goto errorExit;
+        }
+
+        if (DIDJR_CopyString(item, buffer, sizeof(buffer)) < 0)
+            *buffer = 0;
+
+        parse_multisig(buffer, &m, &n);
+        if (n != doc->controllers.size || m > n) {
+            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Multisig doesn't match the count of controllers.");
+            goto errorExit;
+        }
+        doc->multisig = m;
+    }
+
+    //parse publickey
+    item = &members[DOC_PUBLICKEY].value;
+    if (item->token != JsonToken_None && item->token != JsonToken_StartArray) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid publicKey.");
+        goto errorExit;
+    }
+    if (item->token != JsonToken_None && read_publickeys(doc, item) < 0)
+        goto errorExit;
+
+    //parse authentication
+    item = &members[DOC_AUTHENTICATION].value;
+    if (item->token != JsonToken_None && item->token != JsonToken_StartArray) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid authentication key.");
+        goto errorExit;
+    }
+    if (item->token != JsonToken_None &&
+            read_auth_publickeys(doc, item, KeyType_Authentication) < 0)
+        goto errorExit;
+
+    //check pk size
+    if (!doc->controllers.size && set_defaultkey(doc) < 0)
+        goto errorExit;
+
+    //parse authorization
+    item = &members[DOC_AUTHORIZATION].value;
+    if (item->token != JsonToken_None) {
+        if (item->token != JsonToken_StartArray) {
+            DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid authorization key.");
+            goto errorExit;
+        }
+        if (read_auth_publickeys(doc, item, KeyType_Authorization) < 0)
+            goto errorExit;
+    }
+
+    //parse expires
+    item = &members[DOC_EXPIRES].value;
+    if (item->token == JsonToken_None) {
         DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Missing expires time.");
         goto errorExit;
     }
-    if (!json_is_string(item) ||
-           parse_time(&doc->expires, json_string_value(item)) == -1) {
+    if (DIDJR_CopyString(item, buffer, sizeof(buffer)) < 0 ||
+           parse_time(&doc->expires, buffer) == -1) {
         DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid expires time.");
         goto errorExit;
     }
 
     //parse credential
-    item = json_object_get(root, VERIFIABLE_CREDENTIAL);
-    if (item) {
-        if (!json_is_array(item)) {
+    item = &members[DOC_CREDENTIAL].value;
+    if (item->token != JsonToken_None) {
+        if (item->token != JsonToken_StartArray) {
             DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid credentials.");
             goto errorExit;
         }
-        if (Parse_Credentials_InDoc(doc, item) < 0)
+        if (read_credentials(doc, item) < 0)
             goto errorExit;
     }
 
     //parse services
-    item = json_object_get(root, SERVICE);
-    if (item) {
-        if (!json_is_array(item)) {
+    item = &members[DOC_SERVICE].value;
+    if (item->token != JsonToken_None) {
+        if (item->token != JsonToken_StartArray) {
             DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid services.");
             goto errorExit;
         }
-        if (Parse_Services(doc, item) < 0)
+        if (read_services(doc, item) < 0)
             goto errorExit;
     }
 
-    item = json_object_get(root, PROOF);
-    if (!item) {
+    item = &members[DOC_PROOF].value;
+    if (item->token == JsonToken_None) {
         DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Missing document proof.");
         goto errorExit;
     }
-    if (!json_is_object(item) && !json_is_array(item)) {
+    if (item->token != JsonToken_StartObject && item->token != JsonToken_StartArray) {
         DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Invalid document proof.");
         goto errorExit;
     }
-    if (Parse_Proofs(doc, item) == -1)
+    if (read_proofs(doc, item) == -1)
         goto errorExit;
 
     //check the document format
     if (resolve && !controllers_check(doc))
         goto errorExit;
 
+    doc->did.metadata = &doc->metadata;
+    diddocument_buildindex(doc);
     return doc;
 
 errorExit:
@@ -1129,23 +2043,11 @@ errorExit:
 
 DIDDocument *DIDDocument_FromJson(const char *json)
 {
-    DIDDocument *doc;
-    json_t *root;
-    json_error_t error;
-
     DIDERROR_INITIALIZE();
 
     CHECK_ARG(!json || !*json, "Invalid document json.", NULL);
 
-    root = json_loads(json, JSON_COMPACT, &error);
-    if (!root) {
-        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, "Deserialize document failed, error: %s.", error.text);
-        return NULL;
-    }
-
-    doc = DIDDocument_FromJson_Internal(root, true);
-    json_decref(root);
-    return doc;
+    return read_document(json, strlen(json), true);
 
     DIDERROR_FINALIZE();
 }
@@ -1233,6 +2135,45 @@ static const char *diddocument_tojson_forsign(DIDDocument *document, bool compac
     return DIDJG_Finish(gen);
 }
 
+static ssize_t diddocument_digest_forsign(DIDDocument *document, uint8_t *digest)
+{
+    JsonDigest jd;
+    JsonGenerator *gen;
+    ssize_t rc;
+
+    assert(document);
+    assert(digest);
+
+    if (MEMO_LOAD(&document->cache.digested) == MEMO_SET) {
+        memcpy(digest, document->cache.digest, SHA256_BYTES);
+        return SHA256_BYTES;
+    }
+
+    gen = JsonDigest_Initialize(&jd);
+    if (!gen) {
+        DIDError_Set(DIDERR_CRYPTO_ERROR, "Json digest for document initialize failed.");
+        return -1;
+    }
+
+    if (DIDDocument_ToJson_Internal(gen, document, false, true) < 0) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Serialize document to json failed.");
+        JsonDigest_Destroy(&jd);
+        return -1;
+    }
+
+    rc = JsonDigest_Finish(&jd, digest, 0);
+    if (rc < 0) {
+        DIDError_Set(DIDERR_CRYPTO_ERROR, "Get digest failed.");
+        return rc;
+    }
+
+    if (MEMO_CLAIM(&document->cache.digested)) {
+        memcpy(document->cache.digest, digest, SHA256_BYTES);
+        MEMO_STORE(&document->cache.digested, MEMO_SET);
+    }
+    return rc;
+}
+
 const char *DIDDocument_ToJson(DIDDocument *document, bool normalized)
 {
     DIDERROR_INITIALIZE();
@@ -1281,6 +2222,28 @@ void DIDDocument_Destroy(DIDDocument *document)
     for (i = 0; i < document->controllers.size; i++)
         DIDDocument_Destroy(document->controllers.docs[i]);
 
+    //release what the arena graph references outside, then the arena at once.
+    if (document->arena) {
+        for (i = 0; i < document->publickeys.size; i++) {
+            if (document->publickeys.pks[i]->prepared)
+                ecdsa_publickey_free(document->publickeys.pks[i]->prepared);
+        }
+
+        for (i = 0; i < document->services.size; i++) {
+            if (document->services.services[i]->properties)
+                json_decref(document->services.services[i]->properties);
+        }
+
+        for (i = 0; i < document->credentials.size; i++)
+            Credential_Destroy(document->credentials.credentials[i]);
+
+        diddocument_dropindex(document);
+        DIDMetadata_Free(&document->metadata);
+        if (document->arena->owner == document)
+            Arena_Destroy(document->arena);
+        return;
+    }
+
     for (i = 0; i < document->publickeys.size; i++)
         PublicKey_Destroy(document->publickeys.pks[i]);
 
@@ -1305,6 +2268,7 @@ void DIDDocument_Destroy(DIDDocument *document)
     if (document->proofs.proofs)
         free((void*)document->proofs.proofs);
 
+    diddocument_dropindex(document);
     DIDMetadata_Free(&document->metadata);
     free(document);
 
@@ -1385,25 +2349,29 @@ int DIDDocument_IsDeactivated(DIDDocument *document)
     DIDERROR_FINALIZE();
 }
 
-static int DIDDocument_IsGenuine_Internal(DIDDocument *document, bool qualified)
+int DIDDocument_CollectGenuine(DIDDocument *document, bool qualified, VerifyBatch *batch)
 {
     DIDDocument *proof_doc;
     DocumentProof *proof;
     DID **checksigners;
-    const char *data;
+    uint8_t digest[SHA256_BYTES];
     int genuine = 0, i, rc;
     size_t size;
 
     assert(document);
+    assert(batch);
 
     if (qualified && !DIDDocument_IsQualified(document)) {
         DIDError_Set(DIDERR_MALFORMED_DOCUMENT, " * %s : signers are less than multisig number.", DIDSTR(&document->did));
         return 0;
     }
 
+    if (MEMO_LOAD(&document->cache.genuine) == MEMO_SET)
+        return 1;
+
     if (document->controllers.size > 0) {
         for(i = 0; i < document->controllers.size; i++) {
-            rc = DIDDocument_IsGenuine(document->controllers.docs[i]);
+            rc = DIDDocument_CollectGenuine(document->controllers.docs[i], true, batch);
             if (rc != 1) {
                 DIDError_Set(DIDERR_NOT_GENUINE, " * %s : controller %s is not geninue.",
                         DIDSTR(&document->did), DIDSTR(&document->controllers.docs[i]->did));
@@ -1412,16 +2380,14 @@ static int DIDDocument_IsGenuine_Internal(DIDDocument *document, bool qualified)
         }
     }
 
-    data = diddocument_tojson_forsign(document, false, true);
-    if (!data)
+    if (diddocument_digest_forsign(document, digest) < 0)
         return -1;
 
     size = document->proofs.size;
     checksigners = (DID**)alloca(size * sizeof(DID*));
     if (!checksigners) {
         DIDError_Set(DIDERR_OUT_OF_MEMORY, " * %s : malloc buffer for signers failed.", DIDSTR(&document->did));
-        genuine = -1;
-        goto errorExit;
+        return -1;
     }
 
     for (i = 0; i < size; i++) {
@@ -1456,8 +2422,8 @@ static int DIDDocument_IsGenuine_Internal(DIDDocument *document, bool qualified)
             goto errorExit;
         }
 
-        if (DIDDocument_Verify(proof_doc, &proof->creater, proof->signatureValue, 1,
-                data, strlen(data)) < 0) {
+        if (VerifyBatch_AddDigest(batch, proof_doc, &proof->creater,
+                proof->signatureValue, digest) < 0) {
             DIDError_Set(DIDERR_MALFORMED_DOCUMENT, " * %s : verify document signature failed.",
                     DIDSTR(&document->did));
             goto errorExit;
@@ -1469,10 +2435,43 @@ static int DIDDocument_IsGenuine_Internal(DIDDocument *document, bool qualified)
     genuine = 1;
 
 errorExit:
-    free((void*)data);
     return genuine;
 }
 
+static int DIDDocument_IsGenuine_Internal(DIDDocument *document, bool qualified)
+{
+    VerifyBatch batch;
+    int genuine;
+
+    assert(document);
+
+    memset(&batch, 0, sizeof(batch));
+    genuine = DIDDocument_CollectGenuine(document, qualified, &batch);
+    if (genuine == 1 && VerifyBatch_Verify(&batch) < 0) {
+        DIDError_Set(DIDERR_MALFORMED_DOCUMENT, " * %s : verify document signature failed.",
+                DIDSTR(&document->did));
+        genuine = 0;
+    }
+
+    if (genuine == 1 && qualified)
+        DIDDocument_MarkGenuine(document);
+
+    VerifyBatch_Destroy(&batch);
+    return genuine;
+}
+
+void DIDDocument_MarkGenuine(DIDDocument *document)
+{
+    size_t i;
+
+    assert(document);
+
+    for (i = 0; i < document->controllers.size; i++)
+        DIDDocument_MarkGenuine(document->controllers.docs[i]);
+
+    MEMO_STORE(&document->cache.genuine, MEMO_SET);
+}
+
 int DIDDocument_IsGenuine(DIDDocument *document)
 {
     DIDERROR_INITIALIZE();
@@ -1514,6 +2513,49 @@ int DIDDocument_IsQualified(DIDDocument *document)
     DIDERROR_FINALIZE();
 }
 
+int DIDDocument_IsValid_WithoutProof(DIDDocument *document)
+{
+    int rc;
+    assert(document);
+
+    if (!controllers_check(document))
+        return 0;
+
+    rc = DIDDocument_IsExpired(document);
+    if (rc != 0) {
+        if (rc == 1)
+            DIDError_Set(DIDERR_EXPIRED, " * %s : is expired.", DIDSTR(&document->did));
+        return rc;
+    }
+
+    rc = DIDDocument_IsDeactivated(document);
+    if (rc != 0) {
+        if (rc == 1)
+            DIDError_Set(DIDERR_DID_DEACTIVATED, "* %s : is deactivated.", DIDSTR(&document->did));
+        return rc;
+    }
+
+    return 1;
+}
+
+int DIDDocument_CollectValid(DIDDocument *document, VerifyBatch *batch)
+{
+    int rc;
+
+    assert(document);
+    assert(batch);
+
+    rc = DIDDocument_IsValid_WithoutProof(document);
+    if (rc != 1)
+        return rc;
+
+    rc = DIDDocument_CollectGenuine(document, true, batch);
+    if (rc != 1)
+        DIDError_Set(DIDERR_NOT_GENUINE, "* %s : is not geninue.", DIDSTR(&document->did));
+
+    return rc;
+}
+
 int DIDDocument_IsValid_Internal(DIDDocument *document, bool isqualified)
 {
     int rc;
@@ -1579,6 +2621,10 @@ static int publickeys_copy(DIDDocument *doc, PublicKey **pks, size_t size)
             goto errorExit;
 
         memcpy(pk_array[i], pks[i], sizeof(PublicKey));
+        //the copies share the prepared key, which is immutable.
+        pk_array[i]->prepared = PublicKey_LoadPrepared(pks[i]);
+        if (pk_array[i]->prepared)
+            pk_array[i]->prepared = ecdsa_publickey_ref(pk_array[i]->prepared);
     }
 
     doc->publickeys.pks = pk_array;
@@ -1748,11 +2794,26 @@ int DIDDocument_Copy(DIDDocument *destdoc, DIDDocument *srcdoc)
 
     destdoc->multisig = srcdoc->multisig;
     destdoc->expires = srcdoc->expires;
+    if (MEMO_LOAD(&srcdoc->cache.digested) == MEMO_SET) {
+        memcpy(destdoc->cache.digest, srcdoc->cache.digest, SHA256_BYTES);
+        destdoc->cache.digested = MEMO_SET;
+    }
+    destdoc->cache.genuine = MEMO_LOAD(&srcdoc->cache.genuine);
     DIDMetadata_Copy(&destdoc->metadata, &srcdoc->metadata);
-    memcpy(&destdoc->did.metadata, &destdoc->metadata, sizeof(DIDMetadata));
+    destdoc->did.metadata = &destdoc->metadata;
+    if (srcdoc->index.slots)
+        diddocument_buildindex(destdoc);
     return 0;
 }
 
+static void diddocument_invalidate(DIDDocument *document)
+{
+    assert(document);
+
+    memset(&document->cache, 0, sizeof(document->cache));
+    diddocument_dropindex(document);
+}
+
 DIDDocumentBuilder* DIDDocument_Edit(DIDDocument *document, DIDDocument *controllerdoc)
 {
     DIDDocumentBuilder *builder;
@@ -1789,6 +2850,7 @@ DIDDocumentBuilder* DIDDocument_Edit(DIDDocument *document, DIDDocument *control
         DIDDocumentBuilder_Destroy(builder);
         return NULL;
     }
+    diddocument_invalidate(builder->document);
 
     if (controllerdoc) {
         builder->controllerdoc = DIDDocument_GetControllerDocument(builder->document, &controllerdoc->did);
@@ -1822,25 +2884,13 @@ void DIDDocumentBuilder_Destroy(DIDDocumentBuilder *builder)
 
 DIDDocument *DIDDocument_GetControllerDocument(DIDDocument *document, DID *controller)
 {
-    DIDDocument *doc;
-    size_t size;
-    int i;
-
     assert(document);
     assert(controller);
 
-    size = document->controllers.size;
-    if (size == 0)
+    if (document->controllers.size == 0)
         return NULL;
 
-    for(i = 0; i < size; i++) {
-        doc = document->controllers.docs[i];
-        assert(doc);
-        if (DID_Equals(&doc->did, controller))
-            return doc;
-    }
-
-    return NULL;
+    return (DIDDocument*)diddocument_lookup(document, IndexKind_Controller, controller, NULL);
 }
 
 static int diddocument_addproof(DIDDocument *document, char *signature, DIDURL *signkey, time_t created)
@@ -1862,7 +2912,11 @@ static int diddocument_addproof(DIDDocument *document, char *signature, DIDURL *
         }
     }
 
-    dps = (DocumentProof*)realloc(document->proofs.proofs, (size + 1) * sizeof(DocumentProof));
+    if (document->arena)
+        dps = (DocumentProof*)Arena_Grow(document->arena, document->proofs.proofs,
+                size, sizeof(DocumentProof));
+    else
+        dps = (DocumentProof*)realloc(document->proofs.proofs, (size + 1) * sizeof(DocumentProof));
     if (!dps) {
         DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for proofs failed.");
         return -1;
@@ -1874,6 +2928,7 @@ static int diddocument_addproof(DIDDocument *document, char *signature, DIDURL *
     dps[size].created = created;
     document->proofs.proofs = dps;
     document->proofs.size++;
+    document->cache.genuine = MEMO_NONE;
     return 0;
 }
 
@@ -1881,7 +2936,7 @@ DIDDocument *DIDDocumentBuilder_Seal(DIDDocumentBuilder *builder, const char *st
 {
     DIDDocument *doc, *controllerdoc, *signdoc = NULL;
     DIDURL *key;
-    const char *data;
+    uint8_t digest[SHA256_BYTES];
     char signature[SIGNATURE_BYTES * 2 + 16];
     Credential *cred;
     int rc, i;
@@ -1896,6 +2951,9 @@ DIDDocument *DIDDocumentBuilder_Seal(DIDDocumentBuilder *builder, const char *st
     assert((doc->controllers.size > 0 && doc->controllers.docs) ||
             (doc->controllers.size == 0 && !doc->controllers.docs));
 
+    //any builder change before sealing drops the memoized state.
+    diddocument_invalidate(doc);
+
     //check controller document and multisig
     rc = DIDDocument_IsCustomizedDID(doc);
     if (rc == -1)
@@ -1965,14 +3023,12 @@ DIDDocument *DIDDocumentBuilder_Seal(DIDDocumentBuilder *builder, const char *st
         return NULL;
     }
 
-    data = diddocument_tojson_forsign(doc, false, true);
-    if (!data) {
+    if (diddocument_digest_forsign(doc, digest) < 0) {
         DIDError_Set(DIDERRCODE, "Get doc data to signed failed.");
         return NULL;
     }
 
-    rc = DIDDocument_Sign(signdoc, key, storepass, signature, 1, (unsigned char*)data, strlen(data));
-    free((void*)data);
+    rc = DIDDocument_SignDigest(signdoc, key, storepass, signature, digest, sizeof(digest));
     if (rc) {
         DIDError_Set(DIDERRCODE, "Sign document failed, error: %s.", DIDERRMSG);
         return NULL;
@@ -1981,6 +3037,7 @@ DIDDocument *DIDDocumentBuilder_Seal(DIDDocumentBuilder *builder, const char *st
     if (diddocument_addproof(doc, signature, key, time(NULL)) < 0)
         return NULL;
 
+    diddocument_buildindex(doc);
     builder->document = NULL;
     return doc;
 
@@ -2021,6 +3078,8 @@ static void clean_proofs(DIDDocument *document)
 {
     assert(document);
 
+    diddocument_invalidate(document);
+
     if (document->proofs.proofs) {
         free((void*)document->proofs.proofs);
         document->proofs.proofs = NULL;
@@ -3056,6 +4115,7 @@ int DIDDocumentBuilder_RemoveProof(DIDDocumentBuilder *builder, DID *controller)
         document->proofs.proofs = NULL;
     }
 
+    document->cache.genuine = MEMO_NONE;
     return 0;
 
     DIDERROR_FINALIZE();
@@ -3223,7 +4283,6 @@ PublicKey *DIDDocument_GetPublicKey(DIDDocument *document, DIDURL *keyid)
 {
     PublicKey *pk;
     DIDDocument *doc;
-    size_t i;
 
     DIDERROR_INITIALIZE();
 
@@ -3245,12 +4304,9 @@ PublicKey *DIDDocument_GetPublicKey(DIDDocument *document, DIDURL *keyid)
         }
     }
 
-    for (i = 0; i < doc->publickeys.size && doc->publickeys.pks; i++) {
-        pk = doc->publickeys.pks[i];
-        assert(pk);
-        if (DIDURL_Equals(keyid, &pk->id))
-            return pk;
-    }
+    pk = (PublicKey*)diddocument_lookup(doc, IndexKind_PublicKey, NULL, keyid);
+    if (pk)
+        return pk;
 
     DIDError_Set(DIDERR_NOT_EXISTS, "No this public key in document.");
     return NULL;
@@ -3722,7 +4778,7 @@ ssize_t DIDDocument_GetCredentials(DIDDocument *document, Credential **creds,
 Credential *DIDDocument_GetCredential(DIDDocument *document, DIDURL *credid)
 {
     Credential *credential = NULL;
-    size_t size, i;
+    size_t size;
 
     DIDERROR_INITIALIZE();
 
@@ -3740,12 +4796,9 @@ Credential *DIDDocument_GetCredential(DIDDocument *document, DIDURL *credid)
         return NULL;
     }
 
-    for (i = 0; i < size; i++) {
-        credential = document->credentials.credentials[i];
-        assert(credential);
-        if (DIDURL_Equals(credid, &credential->id))
-            return credential;
-    }
+    credential = (Credential*)diddocument_lookup(document, IndexKind_Credential, NULL, credid);
+    if (credential)
+        return credential;
 
     DIDError_Set(DIDERR_NOT_EXISTS, "No this credential.");
     return NULL;
@@ -3849,7 +4902,7 @@ ssize_t DIDDocument_GetServices(DIDDocument *document, Service **services,
 Service *DIDDocument_GetService(DIDDocument *document, DIDURL *serviceid)
 {
     Service *service = NULL;
-    size_t size, i;
+    size_t size;
 
     DIDERROR_INITIALIZE();
 
@@ -3867,12 +4920,9 @@ Service *DIDDocument_GetService(DIDDocument *document, DIDURL *serviceid)
         return NULL;
     }
 
-    for (i = 0; i < size; i++) {
-        service = document->services.services[i];
-        assert(service);
-        if (DIDURL_Equals(serviceid, &service->id))
-            return service;
-    }
+    service = (Service*)diddocument_lookup(document, IndexKind_Service, NULL, serviceid);
+    if (service)
+        return service;
 
     DIDError_Set(DIDERR_NOT_EXISTS, "This service is in document.");
     return NULL;
@@ -3940,22 +4990,11 @@ time_t DIDDocument_GetExpires(DIDDocument *document)
 
 ssize_t DIDDocument_GetDigest(DIDDocument *document, uint8_t *digest, size_t size)
 {
-    const char *data;
-    ssize_t rc;
-
     assert(document);
     assert(digest);
     assert(size >= SHA256_BYTES);
 
-    data = diddocument_tojson_forsign(document, false, true);
-    if (!data)
-        return -1;
-
-    rc = sha256_digest(digest, 1, (unsigned char*)data, strlen(data));
-    if (rc < 0)
-        DIDError_Set(DIDERR_CRYPTO_ERROR, "Get digest failed.");
-
-    return rc;
+    return diddocument_digest_forsign(document, digest);
 }
 
 int DIDDocument_HasPrivateKey(DIDDocument *document, DIDURL *keyid)
@@ -4088,7 +5127,9 @@ int DIDDocument_VerifyDigest(DIDDocument *document, DIDURL *keyid,
         char *sig, uint8_t *digest, size_t size)
 {
     PublicKey *publickey;
+    PreparedPublicKey *prepared;
     uint8_t binkey[PUBLICKEY_BYTES];
+    int rc;
 
     DIDERROR_INITIALIZE();
 
@@ -4110,9 +5151,15 @@ int DIDDocument_VerifyDigest(DIDDocument *document, DIDURL *keyid,
         return -1;
     }
 
-    b58_decode(binkey, sizeof(binkey), PublicKey_GetPublicKeyBase58(publickey));
+    prepared = PublicKey_GetPrepared(publickey);
+    if (prepared) {
+        rc = ecdsa_verify_base64_prepared(sig, prepared, digest, size);
+    } else {
+        b58_decode(binkey, sizeof(binkey), PublicKey_GetPublicKeyBase58(publickey));
+        rc = ecdsa_verify_base64(sig, binkey, digest, size);
+    }
 
-    if (ecdsa_verify_base64(sig, binkey, digest, size) == -1) {
+    if (rc == -1) {
         DIDError_Set(DIDERR_CRYPTO_ERROR, "Ecdsa verify failed.");
         return -1;
     }
@@ -4122,6 +5169,161 @@ int DIDDocument_VerifyDigest(DIDDocument *document, DIDURL *keyid,
     DIDERROR_FINALIZE();
 }
 
+int VerifyBatch_AddDigest(VerifyBatch *batch, DIDDocument *document, DIDURL *keyid,
+        char *sig, uint8_t *digest)
+{
+    EcdsaVerifyItem *item, *items;
+    PublicKey *publickey;
+    PreparedPublicKey *prepared;
+    uint8_t binsig[MAX_SIGNATURE_LEN];
+    size_t i;
+
+    assert(batch);
+    assert(document);
+    assert(sig);
+    assert(digest);
+
+    if (!keyid) {
+        keyid = DIDDocument_GetDefaultPublicKey(document);
+        if (!keyid) {
+            DIDError_Set(DIDERR_INVALID_ARGS, "Document doesn't have default key, so please provide key to verify.");
+            return -1;
+        }
+    }
+
+    publickey = DIDDocument_GetPublicKey(document, keyid);
+    if (!publickey) {
+        DIDError_Set(DIDERR_INVALID_KEY, "No signkey.");
+        return -1;
+    }
+
+    prepared = PublicKey_GetPrepared(publickey);
+    if (!prepared) {
+        DIDError_Set(DIDERR_CRYPTO_ERROR, "Invalid public key.");
+        return -1;
+    }
+
+    if (strlen(sig) >= sizeof(binsig) || b64_url_decode(binsig, sig) != SIGNATURE_BYTES) {
+        DIDError_Set(DIDERR_CRYPTO_ERROR, "Invalid signature.");
+        return -1;
+    }
+
+    //the same signature is checked once, e.g. a signer for two requests.
+    for (i = 0; i < batch->size; i++) {
+        if (batch->items[i].key == prepared &&
+                !memcmp(batch->items[i].digest, digest, SHA256_BYTES) &&
+                !memcmp(batch->items[i].signature, binsig, SIGNATURE_BYTES))
+            return 0;
+    }
+
+    if (batch->size == batch->capacity) {
+        items = (EcdsaVerifyItem*)realloc(batch->items,
+                (batch->capacity + 4) * sizeof(EcdsaVerifyItem));
+        if (!items) {
+            DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for verify items failed.");
+            return -1;
+        }
+
+        batch->items = items;
+        batch->capacity += 4;
+    }
+
+    //hold the key, the document may be released before the batch is verified.
+    item = &batch->items[batch->size];
+    item->key = ecdsa_publickey_ref(prepared);
+    if (!item->key) {
+        DIDError_Set(DIDERR_CRYPTO_ERROR, "Reference public key failed.");
+        return -1;
+    }
+
+    memcpy(item->digest, digest, SHA256_BYTES);
+    memcpy(item->signature, binsig, SIGNATURE_BYTES);
+    item->result = -1;
+    batch->size++;
+    return 0;
+}
+
+int VerifyBatch_Add(VerifyBatch *batch, DIDDocument *document, DIDURL *keyid,
+        char *sig, int count, ...)
+{
+    uint8_t digest[SHA256_BYTES];
+    va_list inputs;
+    ssize_t len;
+
+    assert(batch);
+    assert(document);
+    assert(sig);
+    assert(count > 0);
+
+    va_start(inputs, count);
+    len = sha256v_digest(digest, count, inputs);
+    va_end(inputs);
+    if (len == -1) {
+        DIDError_Set(DIDERR_CRYPTO_ERROR, "Get digest failed.");
+        return -1;
+    }
+
+    return VerifyBatch_AddDigest(batch, document, keyid, sig, digest);
+}
+
+int VerifyBatch_AddMemo(VerifyBatch *batch, Credential *credential, const char *signkey)
+{
+    VerifyMemo *memos;
+
+    assert(batch);
+    assert(credential);
+    assert(signkey);
+
+    memos = (VerifyMemo*)realloc(batch->memos, (batch->nmemos + 1) * sizeof(VerifyMemo));
+    if (!memos) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for verify memo failed.");
+        return -1;
+    }
+
+    memos[batch->nmemos].credential = credential;
+    strcpy(memos[batch->nmemos].signkey, signkey);
+    batch->memos = memos;
+    batch->nmemos++;
+    return 0;
+}
+
+int VerifyBatch_Verify(VerifyBatch *batch)
+{
+    size_t i;
+
+    assert(batch);
+
+    if (ecdsa_verify_batch(batch->items, batch->size) < 0) {
+        DIDError_Set(DIDERR_VERIFY_ERROR, "Ecdsa verify failed.");
+        return -1;
+    }
+
+    //every proof in the batch holds, the credentials remember their keys.
+    for (i = 0; i < batch->nmemos; i++)
+        Credential_MarkGenuine(batch->memos[i].credential, batch->memos[i].signkey);
+
+    return 0;
+}
+
+void VerifyBatch_Destroy(VerifyBatch *batch)
+{
+    size_t i;
+
+    if (!batch)
+        return;
+
+    for (i = 0; i < batch->size; i++)
+        ecdsa_publickey_free(batch->items[i].key);
+
+    if (batch->items)
+        free((void*)batch->items);
+
+    if (batch->memos)
+        free((void*)batch->memos);
+
+    memset(batch, 0, sizeof(VerifyBatch));
+}
+
 static bool proof_isexist(DocumentProof **proofs, size_t size, DocumentProof *proof)
 {
     int i;
@@ -4619,7 +5821,7 @@ int DIDDocument_PublishDID(DIDDocument *document, DIDURL *signkey, bool force,
     if (rc != 1)
         goto errorExit;
 
-    ResolveCache_InvalidateDID(&document->did);
+    DIDBackend_InvalidateDID(&document->did);
     //Meta stores the resolved txid and local signature.
     DIDMetadata_SetSignature(&document->metadata, DIDDocument_GetProofSignature(document, 0));
     if (resolve_signature)
@@ -4706,7 +5908,7 @@ int DIDDocument_TransferDID(DIDDocument *document, TransferTicket *ticket,
     if (rc != 1)
         goto errorExit;
 
-    ResolveCache_InvalidateDID(&document->did);
+    DIDBackend_InvalidateDID(&document->did);
     //Meta stores the resolved txid and local signature.
     DIDMetadata_SetSignature(&document->metadata, DIDDocument_GetProofSignature(document, 0));
     if (*resolve_doc->proofs.proofs[0].signatureValue)
@@ -4771,7 +5973,7 @@ int DIDDocument_DeactivateDID(DIDDocument *document, DIDURL *signkey, const char
 
     rc = DIDBackend_DeactivateDID(document, signkey, NULL, storepass);
     if (rc == 1)
-        ResolveCache_InvalidateDID(&document->did);
+        DIDBackend_InvalidateDID(&document->did);
 
     return rc;
 
@@ -4851,7 +6053,7 @@ int DIDDocument_DeactivateDIDByAuthorizor(DIDDocument *document, DID *target,
 
     rc = DIDBackend_DeactivateDID(document, &candidatepk->id, &pk->id, storepass);
     if (rc == 1)
-        ResolveCache_InvalidateDID(&document->did);
+        DIDBackend_InvalidateDID(&document->did);
 
 errorExit:
     DIDDocument_Destroy(targetdoc);
@@ -4880,6 +6082,7 @@ DIDDocumentBuilder* DIDDocument_CreateBuilder(DID *did, DIDDocument *controllerd
         goto errorExit;
     }
 
+    builder->document->did.metadata = &builder->document->metadata;
     if (!DID_Copy(&builder->document->did, did))
         goto errorExit;
 
@@ -4944,7 +6147,7 @@ static DIDDocument *create_customized_document(DID *did, DID **controllers, size
         return NULL;
 
     DIDMetadata_SetDeactivated(&document->metadata, false);
-    memcpy(&document->did.metadata, &document->metadata, sizeof(DIDMetadata));
+    document->did.metadata = &document->metadata;
     return document;
 }
 
@@ -31,6 +31,8 @@
 #include "didmeta.h"
 #include "common.h"
 #include "HDkey.h"
+#include "crypto.h"
+#include "Arena.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,6 +40,31 @@ extern "C" {
 
 #define MAX_ENDPOINT                    256
 
+typedef enum IndexKind {
+    IndexKind_PublicKey = 1,
+    IndexKind_Credential,
+    IndexKind_Service,
+    IndexKind_Controller
+} IndexKind;
+
+typedef struct IndexSlot {
+    uint32_t hash;
+    uint16_t kind;
+    uint16_t reserved;
+    uint32_t pos;             //position in the owning array plus one, 0 if free.
+} IndexSlot;
+
+//Open addressing table over key, credential and service fragments and
+//controller id strings, valid only while the array sizes still match.
+typedef struct DocumentIndex {
+    size_t capacity;
+    IndexSlot *slots;
+    size_t pksize;
+    size_t credsize;
+    size_t servicesize;
+    size_t controllersize;
+} DocumentIndex;
+
 typedef struct DocumentProof {
     char type[MAX_TYPE_LEN];
     time_t created;
@@ -79,6 +106,20 @@ struct DIDDocument {
 
     time_t expires;
     DIDMetadata metadata;
+
+    //Parsed documents keep the whole graph in one arena, NULL if on the heap.
+    Arena *arena;
+
+    //Memoized verification state, reset when the document is edited. The
+    //flags are MEMO_* states, published after the data they guard.
+    struct {
+        int digested;
+        uint8_t digest[SHA256_BYTES];
+        int genuine;
+    } cache;
+
+    //Built when the document is parsed, sealed or copied, dropped on edit.
+    DocumentIndex index;
 };
 
 struct PublicKey {
@@ -88,6 +129,9 @@ struct PublicKey {
     char publicKeyBase58[PUBLICKEY_BASE58_BYTES];
     bool authenticationKey;
     bool authorizationKey;
+    //built from publicKeyBase58 on the first verification, see
+    //PublicKey_GetPrepared() for how it is published between threads.
+    PreparedPublicKey *prepared;
 };
 
 struct Service {
@@ -97,6 +141,20 @@ struct Service {
     json_t *properties;
 };
 
+//A credential proof in the batch, memoized once the batch verifies.
+typedef struct VerifyMemo {
+    Credential *credential;
+    char signkey[PUBLICKEY_BASE58_BYTES];
+} VerifyMemo;
+
+typedef struct VerifyBatch {
+    EcdsaVerifyItem *items;
+    size_t size;
+    size_t capacity;
+    VerifyMemo *memos;
+    size_t nmemos;
+} VerifyBatch;
+
 struct DIDDocumentBuilder {
     DIDDocument *document;
     DIDDocument *controllerdoc;
@@ -117,6 +175,26 @@ DIDDocumentBuilder* DIDDocument_CreateBuilder(DID *did, DIDDocument *controllerd
 
 int DIDDocument_IsValid_Internal(DIDDocument *document, bool isqualified);
 
+int DIDDocument_IsValid_WithoutProof(DIDDocument *document);
+
+int DIDDocument_CollectGenuine(DIDDocument *document, bool qualified, VerifyBatch *batch);
+
+int DIDDocument_CollectValid(DIDDocument *document, VerifyBatch *batch);
+
+void DIDDocument_MarkGenuine(DIDDocument *document);
+
+int VerifyBatch_AddDigest(VerifyBatch *batch, DIDDocument *document, DIDURL *keyid,
+        char *sig, uint8_t *digest);
+
+int VerifyBatch_Add(VerifyBatch *batch, DIDDocument *document, DIDURL *keyid,
+        char *sig, int count, ...);
+
+int VerifyBatch_AddMemo(VerifyBatch *batch, Credential *credential, const char *signkey);
+
+int VerifyBatch_Verify(VerifyBatch *batch);
+
+void VerifyBatch_Destroy(VerifyBatch *batch);
+
 int DIDDocument_Copy(DIDDocument *destdoc, DIDDocument *srcdoc);
 
 const char *DIDDocument_Merge(DIDDocument **documents, size_t size);
@@ -38,7 +38,10 @@
 #include <fcntl.h>
 #include <assert.h>
 #include <sys/stat.h>
+#include <pthread.h>
 #include <openssl/opensslv.h>
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
 #include <jansson.h>
 #include <zip.h>
 
@@ -60,6 +63,10 @@
 #include "didrequest.h"
 #include "ticket.h"
 #include "rootidentity.h"
+#include "WorkerPool.h"
+
+#define DEFAULT_STORE_WORKERS   4
+#define MAX_STORE_WORKERS       32
 
 static char MAGIC[] = { 0x00, 0x0D, 0x01, 0x0D };
 static char VERSION[] = { 0x00, 0x00, 0x00, 0x02 };
@@ -69,6 +76,7 @@ static const char *DIDSTORE_VERSION = "3";
 
 static const char *META_FILE = ".metadata";
 static const char *DATA_DIR = "data";
+static const char *STORE_INDEX_FILE = ".index";
 static const char *ROOTS_DIR = "roots";
 static const char *MNEMONIC_FILE = "mnemonic";
 static const char *PRIVATE_FILE = "private";
@@ -82,6 +90,7 @@ static const char *CREDENTIAL_FILE = "credential";
 static const char *PRIVATEKEYS_DIR = "privatekeys";
 
 static const char *DATA_JOURNAL = "data.journal";
+static const char *PASSWORD_JOURNAL = "password.journal";
 static const char *POST_PASSWORD = "postChangePassword";
 static const char *POST_UPGRADE = "postUpgrade";
 static const char *DID_EXPORT = "did.elastos.export/2.0";
@@ -120,6 +129,30 @@ typedef struct Dir_Copy_Helper {
     const char *newpassword;
 } Dir_Copy_Helper;
 
+//A file encrypted by the storepass, under the roots or ids directory.
+typedef struct Reencrypt_File {
+    const char *dir;
+    char id[MAX_ID_LEN];
+    char name[MAX_ID_LEN];
+} Reencrypt_File;
+
+typedef struct Password_Change {
+    DIDStore *store;
+    const char *newpassword;
+    const char *oldpassword;
+    Reencrypt_File *files;
+    size_t count;
+    size_t capacity;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t next;
+    int running;
+    bool failed;
+    int errcode;
+    char errmsg[256];
+} Password_Change;
+
 typedef struct Cred_Export_Helper {
     DIDStore *store;
     JsonGenerator *gen;
@@ -131,21 +164,73 @@ typedef struct Prvkey_Export {
     char key[512];
 } Prvkey_Export;
 
-typedef struct DID_Export {
+typedef struct Store_Export {
     DIDStore *store;
     const char *storepass;
     const char *password;
-    const char *tmpdir;
     zip_t *zip;
-} DID_Export;
+    struct Export_Source **sources;
+    size_t count;
+    size_t capacity;
+
+    //the pool generates the entries ahead of the zip writer, at most
+    //window of them are waiting in memory.
+    WorkerPool *pool;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t next;
+    size_t window;
+    bool failed;
+    int errcode;
+    char errmsg[256];
+
+    size_t done;
+    DIDStore_ProgressCallback *progress;
+    void *context;
+} Store_Export;
 
-typedef struct RootIdentity_Export {
+//A zip entry which is generated when the zip is written.
+typedef struct Export_Source {
+    Store_Export *export;
+    size_t index;
+    bool isdid;
+    DID did;
+    char id[MAX_ID_LEN];
+    bool queued;
+    bool ready;
+    const char *data;
+    size_t size;
+    size_t offset;
+    zip_error_t error;
+} Export_Source;
+
+typedef struct Store_Import {
     DIDStore *store;
     const char *storepass;
     const char *password;
-    const char *tmpdir;
-    zip_t *zip;
-} RootIdentity_Export;
+
+    WorkerPool *pool;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t inflight;
+    bool failed;
+    int errcode;
+    char errmsg[256];
+    char name[PATH_MAX];
+
+    size_t done;
+    size_t reported;
+    size_t total;
+    DIDStore_ProgressCallback *progress;
+    void *context;
+} Store_Import;
+
+typedef struct Import_Entry {
+    Store_Import *import;
+    char name[PATH_MAX];
+    char *data;
+    size_t size;
+} Import_Entry;
 
 typedef struct DefaultRootIdentity_Helper {
     char id[MAX_ID_LEN];
@@ -218,6 +303,7 @@ int DIDStore_StoreDIDMetadata(DIDStore *store, DIDMetadata *metadata, DID *did)
     data = DIDMetadata_ToJson(metadata);
     if (!data) {
         delete_file(path);
+        StoreIndex_SetDIDAlias(store->index, did->idstring, NULL);
         return 0;
     }
 
@@ -225,6 +311,8 @@ int DIDStore_StoreDIDMetadata(DIDStore *store, DIDMetadata *metadata, DID *did)
     free((void*)data);
     if (rc)
         DIDError_Set(DIDERR_IO_ERROR, "Store did(%s) metadata failed.", DIDSTR(did));
+    else
+        StoreIndex_SetDIDAlias(store->index, did->idstring, DIDMetadata_GetAlias(metadata));
 
     return rc;
 }
@@ -316,8 +404,11 @@ int DIDStore_StoreCredMetadata(DIDStore *store, CredentialMetadata *metadata, DI
 
     rc = store_file(path, data);
     free((void*)data);
-    if (!rc)
+    if (!rc) {
+        StoreIndex_SetCredentialAlias(store->index, id->did.idstring, id->fragment,
+                CredentialMetadata_GetAlias(metadata));
         return 0;
+    }
 
 errorExit:
     delete_file(path);
@@ -595,6 +686,52 @@ static int create_store(DIDStore *store)
 #pragma GCC diagnostic ignored "-Wformat-overflow="
 #endif
 
+static int replay_journal(const char *journal, const char *data);
+
+static int replay_journal_helper(const char *path, void *context)
+{
+    char journalpath[PATH_MAX], datapath[PATH_MAX];
+    Dir_Copy_Helper *dh = (Dir_Copy_Helper*)context;
+    int len;
+
+    if (!path)
+        return 0;
+
+    if (strcmp(path, ".") == 0 || strcmp(path, "..") == 0)
+        return 0;
+
+    len = snprintf(journalpath, PATH_MAX, "%s%s%s", dh->srcpath, PATH_SEP, path);
+    if (len < 0 || len > PATH_MAX)
+        return -1;
+
+    len = snprintf(datapath, PATH_MAX, "%s%s%s", dh->dstpath, PATH_SEP, path);
+    if (len < 0 || len > PATH_MAX)
+        return -1;
+
+    return replay_journal(journalpath, datapath);
+}
+
+//Move the journal files over the ones in data. A replay which is broken
+//off can run again, the files moved already are not in the journal.
+static int replay_journal(const char *journal, const char *data)
+{
+    Dir_Copy_Helper dh;
+
+    assert(journal && *journal);
+    assert(data && *data);
+
+    if (test_path(journal) != S_IFDIR)
+        return replace_file(journal, data);
+
+    if (test_path(data) < 0 && mkdirs(data, S_IRWXU) < 0)
+        return -1;
+
+    memset(&dh, 0, sizeof(dh));
+    dh.srcpath = journal;
+    dh.dstpath = data;
+    return list_dir(journal, "*", replay_journal_helper, (void*)&dh);
+}
+
 static int post_changepassword(DIDStore *store)
 {
     char post_file[PATH_MAX], buffer[DOC_BUFFER_LEN];
@@ -604,7 +741,15 @@ static int post_changepassword(DIDStore *store)
 
     sprintf(post_file, "%s%s%s", store->root, PATH_SEP, POST_PASSWORD);
     if (test_path(post_file) == S_IFREG) {
-        if (get_dir(data_journal_dir, 0, 2, store->root, DATA_JOURNAL) == 0) {
+        //the journal only holds the re-encrypted files.
+        if (get_dir(data_journal_dir, 0, 2, store->root, PASSWORD_JOURNAL) == 0) {
+            get_dir(data_dir, 0, 2, store->root, DATA_DIR);
+            if (replay_journal(data_journal_dir, data_dir) < 0) {
+                DIDError_Set(DIDERR_DIDSTORE_ERROR, "Move 'password.journal' to 'data' failed.");
+                return -1;
+            }
+            delete_file(data_journal_dir);
+        } else if (get_dir(data_journal_dir, 0, 2, store->root, DATA_JOURNAL) == 0) {
             if (get_dir(data_dir, 0, 2, store->root, DATA_DIR) == 0) {
                 sprintf(buffer, "%s_%ld", DATA_DIR, (long)time(NULL));
                 get_dir(data_deprecated_dir, 0, 2, store->root, buffer);
@@ -620,6 +765,8 @@ static int post_changepassword(DIDStore *store)
     } else {
         if (get_dir(data_journal_dir, 0, 2, store->root, DATA_JOURNAL) == 0)
             delete_file(data_journal_dir);
+        if (get_dir(data_journal_dir, 0, 2, store->root, PASSWORD_JOURNAL) == 0)
+            delete_file(data_journal_dir);
     }
 
     return 0;
@@ -917,6 +1064,10 @@ static int store_pubkey_file(DIDStore *store, const char *datadir, const char *i
         delete_file(path);
         return -1;
     }
+
+    if (!strcmp(datadir, DATA_DIR))
+        StoreIndex_PutRootIdentity(store->index, id);
+
     return 0;
 }
 
@@ -1217,10 +1368,53 @@ static int check_store(DIDStore *store)
     return 0;
 }
 
+//must be called with the password lock held.
+static int password_digest(DIDStore *store, const char *storepass, uint8_t *digest)
+{
+    assert(store);
+    assert(storepass);
+    assert(digest);
+
+    return sha256_digest(digest, 2, store->password.salt, sizeof(store->password.salt),
+            storepass, strlen(storepass)) < 0 ? -1 : 0;
+}
+
+static void clear_password(DIDStore *store)
+{
+    assert(store);
+
+    pthread_mutex_lock(&store->passwordlock);
+    OPENSSL_cleanse(&store->password, sizeof(store->password));
+    pthread_mutex_unlock(&store->passwordlock);
+}
+
+static bool password_verified(DIDStore *store)
+{
+    bool verified;
+
+    assert(store);
+
+    pthread_mutex_lock(&store->passwordlock);
+    verified = store->password.verified;
+    pthread_mutex_unlock(&store->passwordlock);
+    return verified;
+}
+
 static bool check_password(DIDStore *store, const char *storepass)
 {
     char fingerprint[64] = {0};
+    uint8_t digest[SHA256_BYTES];
     const char *_fingerprint;
+    bool verified;
+
+    //The fingerprint costs an AES encryption and two MD5, the storepass which
+    //is already verified only needs a hash compare.
+    pthread_mutex_lock(&store->passwordlock);
+    verified = store->password.verified && !password_digest(store, storepass, digest) &&
+            !CRYPTO_memcmp(digest, store->password.digest, sizeof(digest));
+    pthread_mutex_unlock(&store->passwordlock);
+    if (verified)
+        return true;
 
     if (calc_fingerprint(fingerprint, sizeof(fingerprint), storepass) < 0) {
         DIDError_Set(DIDERR_CRYPTO_ERROR, "Get fingerprint failed.");
@@ -1239,6 +1433,13 @@ static bool check_password(DIDStore *store, const char *storepass)
             return false;
     }
 
+    pthread_mutex_lock(&store->passwordlock);
+    OPENSSL_cleanse(&store->password, sizeof(store->password));
+    if (RAND_bytes(store->password.salt, sizeof(store->password.salt)) == 1 &&
+            !password_digest(store, storepass, store->password.digest))
+        store->password.verified = true;
+    pthread_mutex_unlock(&store->passwordlock);
+
     return true;
 }
 
@@ -1470,6 +1671,7 @@ static int list_did_helper(const char *path, void *context)
 {
     DID_List_Helper *dh = (DID_List_Helper*)context;
     char didpath[PATH_MAX];
+    DIDMetadata metadata;
     DID did;
     int rc = 0, len;
 
@@ -1492,13 +1694,15 @@ static int list_did_helper(const char *path, void *context)
     }
 
     DID_Init(&did, path);
-    DIDStore_LoadDIDMetadata(dh->store, &did.metadata, &did);
+    memset(&metadata, 0, sizeof(metadata));
+    DIDStore_LoadDIDMetadata(dh->store, &metadata, &did);
+    did.metadata = &metadata;
 
     if (dh->filter == 0 || (dh->filter == 1 && DIDSotre_ContainsPrivateKeys(dh->store, &did)) ||
             (dh->filter == 2 && !DIDSotre_ContainsPrivateKeys(dh->store, &did)))
             rc = dh->cb(&did, dh->context);
 
-    DIDMetadata_Free(&did.metadata);
+    DIDMetadata_Free(&metadata);
     return rc;
 }
 
@@ -1587,13 +1791,13 @@ static int select_credential_helper(const char *path, void *context)
 
     if (get_file(credpath, 0, 7, ch->store->root, DATA_DIR, IDS_DIR, ch->did.idstring,
             CREDENTIALS_DIR, path, CREDENTIAL_FILE) == -1) {
-        DIDError_Set(DIDERR_NOT_EXISTS, "Credential (%s) file doesn't exist.");
+        DIDError_Set(DIDERR_NOT_EXISTS, "Credential (%s) file doesn't exist.", path);
         return -1;
     }
 
-    data = load_file(path);
+    data = load_file(credpath);
     if (!data) {
-        DIDError_Set(DIDERR_IO_ERROR, "Load credential file (%s) failed.", path);
+        DIDError_Set(DIDERR_IO_ERROR, "Load credential file (%s) failed.", credpath);
         return -1;
     }
 
@@ -1621,6 +1825,7 @@ static int list_credential_helper(const char *path, void *context)
 {
     Cred_List_Helper *ch = (Cred_List_Helper*)context;
     char credpath[PATH_MAX], filename[128];
+    CredentialMetadata metadata;
     DIDURL id;
     int rc;
 
@@ -1640,12 +1845,214 @@ static int list_credential_helper(const char *path, void *context)
 
     path2id(path, strlen(path) + 1, filename, 128);
     DIDURL_InitFromString(&id, ch->did.idstring, filename);
-    DIDStore_LoadCredMetadata(ch->store, &id.metadata, &id);
+    memset(&metadata, 0, sizeof(metadata));
+    DIDStore_LoadCredMetadata(ch->store, &metadata, &id);
+    id.metadata = &metadata;
+    rc = ch->cb(&id, ch->context);
+    CredentialMetadata_Free(&metadata);
+    return rc;
+}
+
+static int list_indexed_did_helper(const char *idstring, const char *alias,
+        bool haskeys, void *context)
+{
+    DID_List_Helper *dh = (DID_List_Helper*)context;
+    DIDMetadata metadata;
+    DID did;
+    int rc;
+
+    if (!idstring)
+        return dh->cb(NULL, dh->context);
+
+    if (!(dh->filter == 0 || (dh->filter == 1 && haskeys) || (dh->filter == 2 && !haskeys)))
+        return 0;
+
+    //the metadata of a listed did carries the alias only
+    DID_Init(&did, idstring);
+    memset(&metadata, 0, sizeof(metadata));
+    if (alias)
+        DIDMetadata_SetAlias(&metadata, alias);
+    did.metadata = &metadata;
+
+    rc = dh->cb(&did, dh->context);
+    DIDMetadata_Free(&metadata);
+    return rc;
+}
+
+static int list_indexed_credential_helper(const char *fragment, const char *alias,
+        void *context)
+{
+    Cred_List_Helper *ch = (Cred_List_Helper*)context;
+    CredentialMetadata metadata;
+    DIDURL id;
+    int rc;
+
+    if (!fragment)
+        return ch->cb(NULL, ch->context);
+
+    if (DIDURL_InitFromString(&id, ch->did.idstring, fragment) < 0)
+        return 0;
+
+    memset(&metadata, 0, sizeof(metadata));
+    if (alias)
+        CredentialMetadata_SetAlias(&metadata, alias);
+    id.metadata = &metadata;
+
     rc = ch->cb(&id, ch->context);
-    CredentialMetadata_Free(&id.metadata);
+    CredentialMetadata_Free(&metadata);
+    return rc;
+}
+
+static int list_indexed_rootidentity_helper(const char *id, void *context)
+{
+    RootIdentity_List_Helper *rh = (RootIdentity_List_Helper*)context;
+    RootIdentity *rootidentity;
+    int rc;
+
+    if (!id)
+        return rh->cb(NULL, rh->context);
+
+    rootidentity = DIDStore_LoadRootIdentity(rh->store, id);
+    if (!rootidentity)
+        return 0;
+
+    rc = rh->cb(rootidentity, rh->context);
+    RootIdentity_Destroy(rootidentity);
     return rc;
 }
 
+static int index_credential_helper(const char *path, void *context)
+{
+    Cred_List_Helper *ch = (Cred_List_Helper*)context;
+    char credpath[PATH_MAX], filename[128];
+    CredentialMetadata metadata;
+    Credential *credential = NULL;
+    const char *data;
+    DIDURL id;
+
+    if (!path || strcmp(path, ".") == 0 || strcmp(path, "..") == 0)
+        return 0;
+
+    if (strlen(path) >= sizeof(id.fragment))
+        return 0;
+
+    path2id(path, strlen(path) + 1, filename, 128);
+    if (DIDURL_InitFromString(&id, ch->did.idstring, filename) < 0)
+        return 0;
+
+    if (get_file(credpath, 0, 7, ch->store->root, DATA_DIR, IDS_DIR, ch->did.idstring,
+            CREDENTIALS_DIR, path, CREDENTIAL_FILE) == 0) {
+        data = load_file(credpath);
+        if (data) {
+            credential = Credential_FromJson(data, &ch->did);
+            free((void*)data);
+        }
+    }
+
+    if (credential) {
+        StoreIndex_PutCredential(ch->store->index, ch->did.idstring, id.fragment,
+                (const char**)credential->type.types, credential->type.size);
+        Credential_Destroy(credential);
+    } else {
+        StoreIndex_PutCredential(ch->store->index, ch->did.idstring, id.fragment, NULL, 0);
+    }
+
+    memset(&metadata, 0, sizeof(metadata));
+    DIDStore_LoadCredMetadata(ch->store, &metadata, &id);
+    if (CredentialMetadata_GetAlias(&metadata))
+        StoreIndex_SetCredentialAlias(ch->store->index, ch->did.idstring, id.fragment,
+                CredentialMetadata_GetAlias(&metadata));
+    CredentialMetadata_Free(&metadata);
+    return 0;
+}
+
+static int index_did_helper(const char *path, void *context)
+{
+    DIDStore *store = (DIDStore*)context;
+    char didpath[PATH_MAX];
+    DIDMetadata metadata;
+    Cred_List_Helper ch;
+    DID did;
+
+    if (!path || strcmp(path, ".") == 0 || strcmp(path, "..") == 0)
+        return 0;
+
+    if (strlen(path) >= sizeof(did.idstring) ||
+            get_dir(didpath, 0, 4, store->root, DATA_DIR, IDS_DIR, path) == -1 ||
+            test_path(didpath) != S_IFDIR)
+        return 0;
+
+    DID_Init(&did, path);
+    memset(&metadata, 0, sizeof(metadata));
+    DIDStore_LoadDIDMetadata(store, &metadata, &did);
+    StoreIndex_SetDIDAlias(store->index, path, DIDMetadata_GetAlias(&metadata));
+    DIDMetadata_Free(&metadata);
+
+    StoreIndex_SetDIDKeys(store->index, path, DIDSotre_ContainsPrivateKeys(store, &did) == 1);
+
+    if (get_dir(didpath, 0, 5, store->root, DATA_DIR, IDS_DIR, path, CREDENTIALS_DIR) == -1 ||
+            test_path(didpath) != S_IFDIR)
+        return 0;
+
+    memset(&ch, 0, sizeof(ch));
+    ch.store = store;
+    DID_Copy(&ch.did, &did);
+    return list_dir(didpath, "*", index_credential_helper, (void*)&ch);
+}
+
+static int index_rootidentity_helper(const char *path, void *context)
+{
+    DIDStore *store = (DIDStore*)context;
+    char identitypath[PATH_MAX];
+
+    if (!path || strcmp(path, ".") == 0 || strcmp(path, "..") == 0)
+        return 0;
+
+    if (strlen(path) >= MAX_ID_LEN ||
+            get_dir(identitypath, 0, 4, store->root, DATA_DIR, ROOTS_DIR, path) == -1 ||
+            test_path(identitypath) != S_IFDIR)
+        return 0;
+
+    StoreIndex_PutRootIdentity(store->index, path);
+    return 0;
+}
+
+//Called with the index locked for the rebuild, see StoreIndex_BeginRebuild().
+static int rebuild_index(DIDStore *store)
+{
+    char path[PATH_MAX];
+
+    if (get_dir(path, 0, 3, store->root, DATA_DIR, ROOTS_DIR) == 0 &&
+            test_path(path) == S_IFDIR &&
+            list_dir(path, "*", index_rootidentity_helper, (void*)store) < 0)
+        return -1;
+
+    if (get_dir(path, 0, 3, store->root, DATA_DIR, IDS_DIR) == 0 &&
+            test_path(path) == S_IFDIR &&
+            list_dir(path, "*", index_did_helper, (void*)store) < 0)
+        return -1;
+
+    return 0;
+}
+
+//The listings read the index, which is rebuilt from the directories when
+//it's missing, damaged or stale for did (any did if NULL). NULL means the
+//directories have to be scanned.
+static StoreIndex *load_index(DIDStore *store, DID *did)
+{
+    int rc;
+
+    rc = StoreIndex_BeginRebuild(store->index, did ? did->idstring : NULL);
+    if (rc <= 0)
+        return rc == 0 ? store->index : NULL;
+
+    rc = rebuild_index(store);
+    if (StoreIndex_EndRebuild(store->index, rc == 0) < 0 || rc < 0)
+        return NULL;
+
+    return store->index;
+}
+
 static int store_credential(DIDStore *store, Credential *credential)
 {
     const char *data;
@@ -1674,8 +2081,11 @@ static int store_credential(DIDStore *store, Credential *credential)
 
     rc = store_file(path, data);
     free((void*)data);
-    if (!rc)
+    if (!rc) {
+        StoreIndex_PutCredential(store->index, id->did.idstring, id->fragment,
+                (const char**)credential->type.types, credential->type.size);
         return 0;
+    }
 
     delete_file(path);
 
@@ -1694,11 +2104,56 @@ static int store_credential(DIDStore *store, Credential *credential)
     return -1;
 }
 
+//Returns a reference to the current session, or NULL if the store is locked.
+static KeySession *get_session(DIDStore *store)
+{
+    KeySession *session = NULL;
+
+    assert(store);
+
+    pthread_mutex_lock(&store->sessionlock);
+    if (store->session)
+        session = KeySession_Ref(store->session);
+    pthread_mutex_unlock(&store->sessionlock);
+
+    return session;
+}
+
+//The old session is wiped at once, the signers still holding it just stop
+//finding keys in it.
+static void set_session(DIDStore *store, KeySession *session)
+{
+    KeySession *old;
+
+    assert(store);
+
+    pthread_mutex_lock(&store->sessionlock);
+    old = store->session;
+    store->session = session;
+    pthread_mutex_unlock(&store->sessionlock);
+
+    if (old) {
+        KeySession_Expire(old);
+        KeySession_Destroy(old);
+    }
+}
+
+static void remove_session_keys(DIDStore *store, DID *did, DIDURL *id)
+{
+    KeySession *session;
+
+    session = get_session(store);
+    if (session) {
+        KeySession_Remove(session, did, id);
+        KeySession_Destroy(session);
+    }
+}
+
 /////////////////////////////////////////////////////////////////////////
 
 DIDStore* DIDStore_Open(const char *root)
 {
-    char path[PATH_MAX];
+    char path[PATH_MAX], idsdir[PATH_MAX], rootsdir[PATH_MAX];
     DIDStore *store;
 
     DIDERROR_INITIALIZE();
@@ -1712,8 +2167,35 @@ DIDStore* DIDStore_Open(const char *root)
         return NULL;
     }
 
+    if (pthread_mutex_init(&store->sessionlock, NULL) != 0) {
+        DIDError_Set(DIDERR_UNKNOWN, "Initialize didstore lock failed.");
+        free(store);
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&store->passwordlock, NULL) != 0) {
+        DIDError_Set(DIDERR_UNKNOWN, "Initialize didstore lock failed.");
+        pthread_mutex_destroy(&store->sessionlock);
+        free(store);
+        return NULL;
+    }
+
     strcpy(store->root, root);
 
+    if (snprintf(path, sizeof(path), "%s%s%s%s%s", root, PATH_SEP, DATA_DIR,
+            PATH_SEP, STORE_INDEX_FILE) >= sizeof(path) ||
+            snprintf(idsdir, sizeof(idsdir), "%s%s%s%s%s", root, PATH_SEP, DATA_DIR,
+            PATH_SEP, IDS_DIR) >= sizeof(idsdir) ||
+            snprintf(rootsdir, sizeof(rootsdir), "%s%s%s%s%s", root, PATH_SEP, DATA_DIR,
+            PATH_SEP, ROOTS_DIR) >= sizeof(rootsdir)) {
+        DIDError_Set(DIDERR_INVALID_ARGS, "DIDStore root is too long.");
+        goto errorExit;
+    }
+
+    store->index = StoreIndex_Open(path, idsdir, rootsdir);
+    if (!store->index)
+        goto errorExit;
+
     if (get_dir(path, 0, 1, root) == 0) {
         if ((!is_empty(path) && !check_store(store)) ||
                (is_empty(path) && !create_store(store)))
@@ -1738,6 +2220,11 @@ void DIDStore_Close(DIDStore *store)
     DIDERROR_INITIALIZE();
 
     if (store) {
+        clear_password(store);
+        set_session(store, NULL);
+        pthread_mutex_destroy(&store->sessionlock);
+        pthread_mutex_destroy(&store->passwordlock);
+        StoreIndex_Close(store->index);
         StoreMetadata_Free(&store->metadata);
         free(store);
     }
@@ -1745,34 +2232,69 @@ void DIDStore_Close(DIDStore *store)
     DIDERROR_FINALIZE();
 }
 
-int DIDStore_StoreDID(DIDStore *store, DIDDocument *document)
+int DIDStore_Unlock(DIDStore *store, const char *storepass, long ttl)
 {
-    char path[PATH_MAX];
-    const char *data;
-    DIDMetadata metadata;
-    ssize_t count;
-    int rc;
+    KeySession *session;
 
     DIDERROR_INITIALIZE();
 
-    CHECK_ARG(!store, "No didstore to store document.", -1);
-    CHECK_ARG(!document, "No document argument to be stored.", -1);
+    CHECK_ARG(!store, "No didstore to unlock.", -1);
+    CHECK_PASSWORD(storepass, -1);
+    CHECK_ARG(ttl <= 0, "Invalid ttl to unlock didstore.", -1);
 
-    if (DIDStore_LoadDIDMetadata(store, &metadata, &document->did) == -1)
+    if (!check_password(store, storepass)) {
+        DIDError_Set(DIDERR_WRONG_PASSWORD, "Wrong storepass.");
         return -1;
+    }
 
-    rc = DIDMetadata_Merge(&document->metadata, &metadata);
-    DIDMetadata_Free(&metadata);
-    if (rc < 0) {
-        DIDError_Set(DIDERR_DIDSTORE_ERROR, "Merge did metadata failed.");
+    session = KeySession_Create(storepass, ttl);
+    if (!session)
         return -1;
-    }
 
-    DIDMetadata_SetStore(&document->metadata, store);
-    DID_ToString(&document->did, document->metadata.did, sizeof(document->metadata.did));
-    memcpy(&document->did.metadata, &document->metadata, sizeof(DIDMetadata));
-	data = DIDDocument_ToJson(document, true);
-	if (!data)
+    set_session(store, session);
+    return 0;
+
+    DIDERROR_FINALIZE();
+}
+
+void DIDStore_Lock(DIDStore *store)
+{
+    DIDERROR_INITIALIZE();
+
+    if (store)
+        set_session(store, NULL);
+
+    DIDERROR_FINALIZE();
+}
+
+int DIDStore_StoreDID(DIDStore *store, DIDDocument *document)
+{
+    char path[PATH_MAX];
+    const char *data;
+    DIDMetadata metadata;
+    ssize_t count;
+    int rc;
+
+    DIDERROR_INITIALIZE();
+
+    CHECK_ARG(!store, "No didstore to store document.", -1);
+    CHECK_ARG(!document, "No document argument to be stored.", -1);
+
+    if (DIDStore_LoadDIDMetadata(store, &metadata, &document->did) == -1)
+        return -1;
+
+    rc = DIDMetadata_Merge(&document->metadata, &metadata);
+    DIDMetadata_Free(&metadata);
+    if (rc < 0) {
+        DIDError_Set(DIDERR_DIDSTORE_ERROR, "Merge did metadata failed.");
+        return -1;
+    }
+
+    DIDMetadata_SetStore(&document->metadata, store);
+    DID_ToString(&document->did, document->metadata.did, sizeof(document->metadata.did));
+    document->did.metadata = &document->metadata;
+	data = DIDDocument_ToJson(document, true);
+	if (!data)
 		return -1;
 
     rc = get_file(path, 1, 5, store->root, DATA_DIR, IDS_DIR, document->did.idstring, DOCUMENT_FILE);
@@ -1875,7 +2397,7 @@ DIDDocument *DIDStore_LoadDID(DIDStore *store, DID *did)
     }
 
     DIDMetadata_SetStore(&document->metadata, store);
-    memcpy(&document->did.metadata, &document->metadata, sizeof(DIDMetadata));
+    document->did.metadata = &document->metadata;
 
     return document;
 
@@ -1926,8 +2448,11 @@ bool DIDStore_DeleteDID(DIDStore *store, DID *did)
         return false;
     }
 
+    remove_session_keys(store, did, NULL);
+
     if (test_path(path) > 0) {
         delete_file(path);
+        StoreIndex_RemoveDID(store->index, did->idstring);
         return true;
     } else {
         DIDError_Set(DIDERR_IO_ERROR, "Did(%s) file error.", DIDSTR(did));
@@ -1968,7 +2493,12 @@ int DIDStore_ListDIDs(DIDStore *store, ELA_DID_FILTER filter,
     dh.context = context;
     dh.filter = filter;
 
-    if (list_dir(path, "*", list_did_helper, (void*)&dh) == -1) {
+    if (load_index(store, NULL))
+        rc = StoreIndex_ListDIDs(store->index, list_indexed_did_helper, (void*)&dh);
+    else
+        rc = list_dir(path, "*", list_did_helper, (void*)&dh);
+
+    if (rc == -1) {
         DIDError_Set(DIDERR_DIDSTORE_ERROR, "List dids failed.");
         return -1;
     }
@@ -2000,7 +2530,7 @@ int DIDStore_StoreCredential(DIDStore *store, Credential *credential)
 
     CredentialMetadata_SetStore(&credential->metadata, store);
     DIDURL_ToString_Internal(&credential->id, credential->metadata.id, sizeof(credential->metadata.id), false);
-    memcpy(&credential->id.metadata, &credential->metadata, sizeof(CredentialMetadata));
+    credential->id.metadata = &credential->metadata;
     CredentialMetadata_Free(&metadata);
 
     if (store_credential(store, credential) == -1 ||
@@ -2060,7 +2590,7 @@ Credential *DIDStore_LoadCredential(DIDStore *store, DID *did, DIDURL *id)
         return NULL;
     }
 
-    memcpy(&credential->id.metadata, &credential->metadata, sizeof(CredentialMetadata));
+    credential->id.metadata = &credential->metadata;
     return credential;
 
     DIDERROR_FINALIZE();
@@ -2148,6 +2678,8 @@ bool DIDStore_DeleteCredential(DIDStore *store, DID *did, DIDURL *id)
     }
 
     delete_file(path);
+    StoreIndex_RemoveCredential(store->index, did->idstring, id->fragment);
+
     if (get_dir(path, 0, 5, store->root, DATA_DIR, IDS_DIR, did->idstring, CREDENTIALS_DIR) == 0) {
         if (is_empty(path))
             delete_file(path);
@@ -2192,7 +2724,13 @@ int DIDStore_ListCredentials(DIDStore *store, DID *did,
     DID_Copy(&ch.did, did);
     ch.type = NULL;
 
-    if (list_dir(path, "*", list_credential_helper, (void*)&ch) == -1) {
+    if (load_index(store, did))
+        rc = StoreIndex_ListCredentials(store->index, did->idstring,
+                list_indexed_credential_helper, (void*)&ch);
+    else
+        rc = list_dir(path, "*", list_credential_helper, (void*)&ch);
+
+    if (rc == -1) {
         DIDError_Set(DIDERR_DIDSTORE_ERROR, "List credentials failed.");
         return -1;
     }
@@ -2225,7 +2763,12 @@ int DIDStore_SelectCredentials(DIDStore *store, DID *did, DIDURL *id,
         }
 
         if (test_path(path) > 0) {
-            if ((type && has_type(did, path, type) == true) || !type) {
+            if (type && load_index(store, did))
+                rc = StoreIndex_HasCredentialType(store->index, did->idstring, id->fragment, type);
+            else
+                rc = !type || has_type(did, path, type);
+
+            if (rc == 1) {
                 if (callback(id, context) < 0) {
                     DIDError_Set(DIDERR_DIDSTORE_ERROR, "Select credentials' callback error.");
                 }
@@ -2264,7 +2807,13 @@ int DIDStore_SelectCredentials(DIDStore *store, DID *did, DIDURL *id,
     DID_Copy(&ch.did, did);
     ch.type = type;
 
-    if (list_dir(path, "*.*", select_credential_helper, (void*)&ch) == -1) {
+    if (load_index(store, did))
+        rc = StoreIndex_SelectCredentials(store->index, did->idstring, type,
+                list_indexed_credential_helper, (void*)&ch);
+    else
+        rc = list_dir(path, "*", select_credential_helper, (void*)&ch);
+
+    if (rc == -1) {
         DIDError_Set(DIDERR_DIDSTORE_ERROR, "Select credentials failed.");
         return -1;
     }
@@ -2336,6 +2885,8 @@ int DIDStore_StorePrivateKey_Internal(DIDStore *store, DIDURL *id, const char *p
     assert(id);
     assert(prvkey && *prvkey);
 
+    remove_session_keys(store, NULL, id);
+
     id2path(id->fragment, strlen(id->fragment) + 1, filename, 128);
     if (get_file(path, 1, 6, store->root, DATA_DIR, IDS_DIR, id->did.idstring,
             PRIVATEKEYS_DIR, filename) == -1) {
@@ -2343,8 +2894,10 @@ int DIDStore_StorePrivateKey_Internal(DIDStore *store, DIDURL *id, const char *p
         return -1;
     }
 
-    if (!store_file(path, prvkey))
+    if (!store_file(path, prvkey)) {
+        StoreIndex_SetDIDKeys(store->index, id->did.idstring, true);
         return 0;
+    }
 
     DIDError_Set(DIDERR_IO_ERROR, "Store privatekey(%s) failed.", DIDURLSTR(id));
     delete_file(path);
@@ -2382,13 +2935,18 @@ void DIDStore_DeletePrivateKey(DIDStore *store, DIDURL *id)
     if (!store || !id)
         return;
 
+    remove_session_keys(store, NULL, id);
+
     id2path(id->fragment, strlen(id->fragment) + 1, filename, 128);
     if (get_file(path, 0, 6, store->root, DATA_DIR, IDS_DIR, &id->did,
             PRIVATEKEYS_DIR, filename) == -1)
         return;
 
-    if (test_path(path) > 0)
+    if (test_path(path) > 0) {
         delete_file(path);
+        StoreIndex_SetDIDKeys(store->index, id->did.idstring,
+                DIDSotre_ContainsPrivateKeys(store, &id->did) == 1);
+    }
 
     DIDERROR_FINALIZE();
 }
@@ -2548,6 +3106,7 @@ bool DIDStore_DeleteRootIdentity(DIDStore *store, const char *id)
     }
 
     delete_file(path);
+    StoreIndex_RemoveRootIdentity(store->index, id);
 
     defaultid = DIDStore_GetDefaultRootIdentity(store);
     if (defaultid) {
@@ -2593,7 +3152,12 @@ ssize_t DIDStore_ListRootIdentities(DIDStore *store,
     rh.cb = callback;
     rh.context = context;
 
-    if (list_dir(path, "*", list_rootidentity_helper, (void*)&rh) == -1) {
+    if (load_index(store, NULL))
+        rc = StoreIndex_ListRootIdentities(store->index, list_indexed_rootidentity_helper, (void*)&rh);
+    else
+        rc = list_dir(path, "*", list_rootidentity_helper, (void*)&rh);
+
+    if (rc == -1) {
         DIDError_Set(DIDERR_DIDSTORE_ERROR, "List rootidentities failed.");
         return -1;
     }
@@ -2836,6 +3400,8 @@ int DIDStore_Sign(DIDStore *store, const char *storepass, DID *did,
         DIDURL *key, char *sig, uint8_t *digest, size_t size)
 {
     uint8_t binkey[PRIVATEKEY_BYTES];
+    KeySession *session;
+    ssize_t rc;
 
     assert(store);
     assert(storepass && *storepass);
@@ -2844,168 +3410,317 @@ int DIDStore_Sign(DIDStore *store, const char *storepass, DID *did,
     assert(sig);
     assert(digest && size == SHA256_BYTES);
 
+    //An unlocked store signs with the key kept in the session, no file I/O
+    //and no decryption.
+    session = get_session(store);
+    if (session) {
+        rc = KeySession_Sign(session, storepass, key, sig, digest, size);
+        if (rc <= 0) {
+            KeySession_Destroy(session);
+            return (int)rc;
+        }
+    }
+
     if (DIDStore_LoadPrivateKey(store, storepass, did, key, binkey, sizeof(binkey)) == -1) {
+        KeySession_Destroy(session);
         DIDError_Set(DIDERR_NOT_EXISTS, "No private key to sign in the store.");
         return -1;
     }
 
-    if (ecdsa_sign_base64(sig, binkey, digest, size) == -1) {
+    if (session) {
+        KeySession_Put(session, storepass, key, binkey);
+        KeySession_Destroy(session);
+    }
+
+    rc = ecdsa_sign_base64(sig, binkey, digest, size);
+    memset(binkey, 0, sizeof(binkey));
+    if (rc == -1) {
         DIDError_Set(DIDERR_CRYPTO_ERROR, "ECDSA sign failed.");
         return -1;
     }
 
-    memset(binkey, 0, sizeof(binkey));
     return 0;
 }
 
-static bool need_reencrypt(const char *path)
+static int store_workers(int workers, size_t count)
 {
-    char file[PATH_MAX];
-    char *token, *pos;
-    bool isPrivates = false;
-    int i = -1;
+    if (workers <= 0)
+        workers = DEFAULT_STORE_WORKERS;
 
-    assert(path && *path);
+    workers = MIN(workers, MAX_STORE_WORKERS);
+    return (size_t)workers > count ? (int)count : workers;
+}
 
-    pos = strstr(path, DATA_DIR);
-    if (!pos)
-        return false;
+static int add_reencrypt_file(Password_Change *change, const char *dir,
+        const char *id, const char *name)
+{
+    Reencrypt_File *files;
+    size_t capacity;
 
-    strcpy(file, pos);
+    assert(change);
+    assert(dir && id && name);
 
-    token = strtok((char*)file, PATH_SEP);
-    while(token) {
-        if (i <= 2)
-            i++;
-        if (i == 3) {
-            if (!strcmp(token, PRIVATE_FILE) || !strcmp(token, MNEMONIC_FILE))
-                return true;
-            i++;
-        }
-        if (i == 4 && !strcmp(token, PRIVATEKEYS_DIR)) {
-            isPrivates = true;
-            i++;
-        }
-        if (i == 5 && isPrivates)
-            return true;
+    if (strlen(id) >= MAX_ID_LEN || strlen(name) >= MAX_ID_LEN) {
+        DIDError_Set(DIDERR_DIDSTORE_ERROR, "Invalid key file %s in %s.", name, id);
+        return -1;
+    }
 
-        token = strtok(NULL, PATH_SEP);
+    if (change->count == change->capacity) {
+        capacity = change->capacity ? change->capacity * 2 : 64;
+        files = (Reencrypt_File*)realloc(change->files, capacity * sizeof(Reencrypt_File));
+        if (!files) {
+            DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for key files failed.");
+            return -1;
+        }
+        change->files = files;
+        change->capacity = capacity;
     }
 
-    return false;
+    files = &change->files[change->count++];
+    files->dir = dir;
+    strcpy(files->id, id);
+    strcpy(files->name, name);
+    return 0;
 }
 
-static int dir_copy(const char *dst, const char *src, const char *newpw, const char *oldpw);
+typedef struct Reencrypt_Helper {
+    Password_Change *change;
+    const char *id;
+} Reencrypt_Helper;
 
-static int dir_copy_helper(const char *path, void *context)
+static int list_privatekeys_helper(const char *path, void *context)
 {
-    char srcpath[PATH_MAX], dstpath[PATH_MAX];
-    int len;
+    Reencrypt_Helper *helper = (Reencrypt_Helper*)context;
 
-    Dir_Copy_Helper *dh = (Dir_Copy_Helper*)context;
+    if (!path || *path == '.')
+        return 0;
 
-    if (!path)
+    return add_reencrypt_file(helper->change, IDS_DIR, helper->id, path);
+}
+
+static int list_ids_helper(const char *path, void *context)
+{
+    Password_Change *change = (Password_Change*)context;
+    Reencrypt_Helper helper;
+    char dir[PATH_MAX];
+
+    if (!path || *path == '.')
         return 0;
 
-    if (strcmp(path, ".") == 0 || strcmp(path, "..") == 0)
+    if (get_dir(dir, 0, 5, change->store->root, DATA_DIR, IDS_DIR, path, PRIVATEKEYS_DIR) < 0)
         return 0;
 
-    len = snprintf(srcpath, PATH_MAX, "%s%s%s", dh->srcpath, PATH_SEP, path);
-    if (len < 0 || len > PATH_MAX)
+    helper.change = change;
+    helper.id = path;
+    return list_dir(dir, "*", list_privatekeys_helper, (void*)&helper) < 0 ? -1 : 0;
+}
+
+static int list_roots_helper(const char *path, void *context)
+{
+    Password_Change *change = (Password_Change*)context;
+    char file[PATH_MAX];
+
+    if (!path || *path == '.')
+        return 0;
+
+    if (get_file(file, 0, 5, change->store->root, DATA_DIR, ROOTS_DIR, path, PRIVATE_FILE) == 0 &&
+            test_path(file) == S_IFREG &&
+            add_reencrypt_file(change, ROOTS_DIR, path, PRIVATE_FILE) < 0)
         return -1;
 
-    len = snprintf(dstpath, PATH_MAX, "%s%s%s", dh->dstpath, PATH_SEP, path);
-    if (len < 0 || len > PATH_MAX)
+    if (get_file(file, 0, 5, change->store->root, DATA_DIR, ROOTS_DIR, path, MNEMONIC_FILE) == 0 &&
+            test_path(file) == S_IFREG &&
+            add_reencrypt_file(change, ROOTS_DIR, path, MNEMONIC_FILE) < 0)
         return -1;
 
-    return dir_copy(dstpath, srcpath, dh->newpassword, dh->oldpassword);
+    return 0;
 }
 
-static int dir_copy(const char *dst, const char *src, const char *newpw, const char *oldpw)
+//The files encrypted by the storepass: roots/*/private, roots/*/mnemonic
+//and ids/*/privatekeys/*. Nothing else is read.
+static int list_reencrypt_files(Password_Change *change)
 {
-    int rc;
-    Dir_Copy_Helper dh;
-    const char *string;
-    ssize_t size;
-    uint8_t plain[256];
-    unsigned char data[512];
+    char dir[PATH_MAX];
 
-    assert(dst && *dst);
-    assert(src && *src);
+    assert(change);
 
-    if (test_path(src) < 0)
+    if (get_dir(dir, 0, 3, change->store->root, DATA_DIR, ROOTS_DIR) == 0 &&
+            list_dir(dir, "*", list_roots_helper, (void*)change) < 0) {
+        DIDError_Set(DIDERR_DIDSTORE_ERROR, "List root identities failed.");
         return -1;
+    }
 
-    //src is directory.
-    if (test_path(src) == S_IFDIR) {
-        if (test_path(dst) < 0) {
-            rc = mkdirs(dst, S_IRWXU);
-            if (rc < 0) {
-                DIDError_Set(DIDERR_IO_ERROR, "Create cache directory (%s) failed", dst);
-                return -1;
-            }
-        }
+    if (get_dir(dir, 0, 3, change->store->root, DATA_DIR, IDS_DIR) == 0 &&
+            list_dir(dir, "*", list_ids_helper, (void*)change) < 0) {
+        DIDError_Set(DIDERR_DIDSTORE_ERROR, "List private keys failed.");
+        return -1;
+    }
 
-        dh.srcpath = src;
-        dh.dstpath = dst;
-        dh.oldpassword = oldpw;
-        dh.newpassword = newpw;
+    return 0;
+}
 
-        if (list_dir(src, "*", dir_copy_helper, (void*)&dh) == -1) {
-            DIDError_Set(DIDERR_DIDSTORE_ERROR, "Copy directory failed.");
-            return -1;
-        }
+//Decrypt the file with the old password, the one encrypted with the new
+//password goes to the same place in the journal.
+static int reencrypt_file(Password_Change *change, Reencrypt_File *file)
+{
+    char src[PATH_MAX], dst[PATH_MAX];
+    uint8_t plain[256];
+    char data[512];
+    const char *string;
+    ssize_t size;
+    int rc, count;
 
-        return 0;
+    assert(change);
+    assert(file);
+
+    count = file->dir == IDS_DIR ? 6 : 5;
+    if (get_file(src, 0, count, change->store->root, DATA_DIR, file->dir, file->id,
+            file->dir == IDS_DIR ? PRIVATEKEYS_DIR : file->name, file->name) < 0) {
+        DIDError_Set(DIDERR_NOT_EXISTS, "Key file %s of %s doesn't exist.", file->name, file->id);
+        return -1;
     }
 
-    //src is file
     string = load_file(src);
     if (!string || !*string) {
+        if (string)
+            free((void*)string);
         DIDError_Set(DIDERR_IO_ERROR, "Load %s failed.", src);
         return -1;
     }
 
-    //src is not encrypted file.
-    if (!need_reencrypt(src)) {
-        rc = store_file(dst, string);
+    //a lazy private key isn't encrypted.
+    if (!strcmp(LAZY_PRIVATEKEY, string)) {
         free((void*)string);
-        if (rc < 0)
-            DIDError_Set(DIDERR_IO_ERROR, "Store %s failed.", dst);
-
-        return rc;
+        return 0;
     }
 
-    //src is encrypted file.
-    size = decrypt_from_b64(plain, oldpw, string);
+    size = decrypt_from_b64(plain, change->oldpassword, string);
     free((void*)string);
     if (size < 0) {
         DIDError_Set(DIDERR_CRYPTO_ERROR, "Decrypt %s failed.", src);
         return -1;
     }
 
-    size = encrypt_to_b64((char*)data, newpw, plain, size);
+    size = encrypt_to_b64(data, change->newpassword, plain, size);
     memset(plain, 0, sizeof(plain));
     if (size < 0) {
         DIDError_Set(DIDERR_CRYPTO_ERROR, "Encrypt %s with new password failed.", src);
         return -1;
     }
 
-    rc = store_file(dst, (char*)data);
+    if (get_file(dst, 1, count, change->store->root, PASSWORD_JOURNAL, file->dir, file->id,
+            file->dir == IDS_DIR ? PRIVATEKEYS_DIR : file->name, file->name) < 0) {
+        DIDError_Set(DIDERR_DIDSTORE_ERROR, "Create journal file for %s failed.", src);
+        return -1;
+    }
+
+    rc = store_file(dst, data);
+    memset(data, 0, sizeof(data));
     if (rc < 0)
         DIDError_Set(DIDERR_IO_ERROR, "Store %s failed.", dst);
 
     return rc;
 }
 
-static int change_password(DIDStore *store, const char *newpw, const char *oldpw)
+//Runs on a worker, takes the files one by one until all are done.
+static void reencrypt_files(void *arg)
+{
+    Password_Change *change = (Password_Change*)arg;
+    Reencrypt_File *file;
+    const char *msg;
+
+    assert(change);
+
+    DIDError_Initialize();
+
+    pthread_mutex_lock(&change->lock);
+    while (!change->failed && change->next < change->count) {
+        file = &change->files[change->next++];
+        pthread_mutex_unlock(&change->lock);
+
+        if (reencrypt_file(change, file) < 0) {
+            pthread_mutex_lock(&change->lock);
+            if (!change->failed) {
+                change->failed = true;
+                change->errcode = DIDError_GetLastErrorCode();
+                msg = DIDError_GetLastErrorMessage();
+                if (msg) {
+                    strncpy(change->errmsg, msg, sizeof(change->errmsg));
+                    change->errmsg[sizeof(change->errmsg) - 1] = 0;
+                }
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&change->lock);
+    }
+    change->running--;
+    pthread_cond_broadcast(&change->cond);
+    pthread_mutex_unlock(&change->lock);
+
+    DIDError_Finalize();
+}
+
+static int reencrypt_all(Password_Change *change)
+{
+    WorkerPool *pool = NULL;
+    int workers, i;
+
+    assert(change);
+
+    workers = store_workers(0, change->count);
+    if (workers > 1)
+        pool = WorkerPool_Create(workers);
+
+    if (!pool) {
+        change->running = 1;
+        reencrypt_files(change);
+    } else {
+        change->running = workers;
+        for (i = 0; i < workers; i++) {
+            if (WorkerPool_Submit(pool, reencrypt_files, change) < 0) {
+                pthread_mutex_lock(&change->lock);
+                change->running--;
+                pthread_mutex_unlock(&change->lock);
+            }
+        }
+
+        //the calling thread works as well, so no file is left behind.
+        pthread_mutex_lock(&change->lock);
+        change->running++;
+        pthread_mutex_unlock(&change->lock);
+        reencrypt_files(change);
+
+        pthread_mutex_lock(&change->lock);
+        while (change->running > 0)
+            pthread_cond_wait(&change->cond, &change->lock);
+        pthread_mutex_unlock(&change->lock);
+
+        WorkerPool_Destroy(pool);
+    }
+
+    if (change->failed) {
+        DIDError_Set(change->errcode ? change->errcode : DIDERR_DIDSTORE_ERROR,
+                "%s", change->errmsg);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int change_password(DIDStore *store, const char *newpw, const char *oldpw,
+        const char *fingerprint)
 {
-    char data_dir[PATH_MAX] = {0}, data_journal_dir[PATH_MAX] = {0};
-    char path[PATH_MAX] = {0};
+    char data_dir[PATH_MAX] = {0}, journal_dir[PATH_MAX] = {0};
+    char path[PATH_MAX] = {0}, tmp[PATH_MAX] = {0};
+    Password_Change change;
+    StoreMetadata metadata;
+    int rc = -1;
 
     assert(store);
     assert(newpw && *newpw);
     assert(oldpw && *oldpw);
+    assert(fingerprint && *fingerprint);
 
     if (get_dir(data_dir, 0, 2, store->root, DATA_DIR) == -1) {
         DIDError_Set(DIDERR_NOT_EXISTS, "Data directory doesn't exist.");
@@ -3016,28 +3731,58 @@ static int change_password(DIDStore *store, const char *newpw, const char *oldpw
         return -1;
     }
 
-    if (get_dir(data_journal_dir, 1, 2, store->root, DATA_JOURNAL) == -1) {
-        DIDError_Set(DIDERR_DIDSTORE_ERROR, "Create data journal directory failed.");
-        return -1;
-    }
-    if (test_path(data_journal_dir) != S_IFDIR) {
-        DIDError_Set(DIDERR_IO_ERROR, "Data journal is not a directory.");
+    //a journal without the post file is from a broken change.
+    if (get_dir(journal_dir, 0, 2, store->root, PASSWORD_JOURNAL) == 0)
+        delete_file(journal_dir);
+
+    if (get_dir(journal_dir, 1, 2, store->root, PASSWORD_JOURNAL) == -1) {
+        DIDError_Set(DIDERR_DIDSTORE_ERROR, "Create password journal directory failed.");
         return -1;
     }
 
-    if (dir_copy(data_journal_dir, data_dir, newpw, oldpw) == -1) {
-        delete_file(data_journal_dir);
-        return -1;
+    memset(&change, 0, sizeof(Password_Change));
+    change.store = store;
+    change.newpassword = newpw;
+    change.oldpassword = oldpw;
+    pthread_mutex_init(&change.lock, NULL);
+    pthread_cond_init(&change.cond, NULL);
+
+    if (list_reencrypt_files(&change) < 0 || reencrypt_all(&change) < 0)
+        goto errorExit;
+
+    //the new fingerprint is committed together with the keys.
+    memset(&metadata, 0, sizeof(StoreMetadata));
+    if (StoreMetadata_Copy(&metadata, &store->metadata) < 0 ||
+            StoreMetadata_SetFingerPrint(&metadata, fingerprint) < 0 ||
+            store_storemetadata(store, PASSWORD_JOURNAL, &metadata) < 0) {
+        StoreMetadata_Free(&metadata);
+        goto errorExit;
     }
+    StoreMetadata_Free(&metadata);
 
-    //create tag file to indicate copying dir successfully.
+    //The rename of the post file is the commit point, the journal is moved
+    //into data after it, even if the process is stopped in the middle.
     if (get_file(path, 1, 2, store->root, POST_PASSWORD) == -1) {
         DIDError_Set(DIDERR_DIDSTORE_ERROR, "Create 'post_password' file failed.");
-        delete_file(data_journal_dir);
-        return -1;
+        goto errorExit;
+    }
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if (store_file(tmp, "") < 0 || replace_file(tmp, path) < 0) {
+        DIDError_Set(DIDERR_IO_ERROR, "Store 'post_password' file failed.");
+        delete_file(tmp);
+        goto errorExit;
     }
+    rc = 0;
+
+errorExit:
+    if (rc < 0)
+        delete_file(journal_dir);
 
-    return store_file(path, "");
+    pthread_cond_destroy(&change.cond);
+    pthread_mutex_destroy(&change.lock);
+    free(change.files);
+    return rc;
 }
 
 int DIDStore_ChangePassword(DIDStore *store, const char *newpw, const char *oldpw)
@@ -3055,22 +3800,24 @@ int DIDStore_ChangePassword(DIDStore *store, const char *newpw, const char *oldp
         return -1;
     }
 
-    if (change_password(store, newpw, oldpw) == -1)
-        return -1;
+    //the session and the verified password are bound to the old password.
+    set_session(store, NULL);
+    clear_password(store);
 
     if (calc_fingerprint(fingerprint, sizeof(fingerprint), newpw) < 0) {
         DIDError_Set(DIDERR_CRYPTO_ERROR, "Calculate new fingerprint failed.");
         return -1;
     }
 
-    if (post_changepassword(store) < 0)
+    if (change_password(store, newpw, oldpw, fingerprint) == -1)
         return -1;
 
-    if (StoreMetadata_SetFingerPrint(&store->metadata, fingerprint) < 0 ||
-            store_storemetadata(store, NULL, &store->metadata) < 0)
+    //the new password is committed, the files are moved by the next open
+    //if it fails here.
+    if (StoreMetadata_SetFingerPrint(&store->metadata, fingerprint) < 0)
         return -1;
 
-    return 0;
+    return post_changepassword(store);
 
     DIDERROR_FINALIZE();
 }
@@ -3425,10 +4172,32 @@ static int check_file(const char *file)
     return 0;
 }
 
+static const char *exportdid_data(DIDStore *store, const char *storepass, DID *did,
+        const char *password)
+{
+    JsonGenerator g, *gen;
+
+    assert(store);
+    assert(did);
+
+    gen = DIDJG_Initialize(&g);
+    if (!gen) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Json generator for exporting did initialize failed.");
+        return NULL;
+    }
+
+    if (exportdid_internal(gen, store, storepass, did, password) < 0) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Serialize exporting did to json failed.");
+        DIDJG_Destroy(gen);
+        return NULL;
+    }
+
+    return DIDJG_Finish(gen);
+}
+
 int DIDStore_ExportDID(DIDStore *store, const char *storepass, DID *did,
         const char *file, const char *password)
 {
-    JsonGenerator g, *gen;
     const char *data;
     int rc;
 
@@ -3447,19 +4216,10 @@ int DIDStore_ExportDID(DIDStore *store, const char *storepass, DID *did,
     }
 
     //generate did export string
-    gen = DIDJG_Initialize(&g);
-    if (!gen) {
-        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Json generator for exporting did initialize failed.");
-        return -1;;
-    }
-
-    if (exportdid_internal(gen, store, storepass, did, password) < 0) {
-        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Serialize exporting did to json failed.");
-        DIDJG_Destroy(gen);
+    data = exportdid_data(store, storepass, did, password);
+    if (!data)
         return -1;
-    }
 
-    data = DIDJG_Finish(gen);
     rc = store_file(file, data);
     free((void*)data);
     if (rc < 0) {
@@ -3607,7 +4367,7 @@ static DIDDocument *import_document(json_t *json, DID *did, Sha256_Digest *diges
     if (DIDMetadata_FromJson_Internal(&doc->metadata, field) < 0)
         goto errorExit;
 
-    memcpy(&doc->did.metadata, &doc->metadata, sizeof(DIDMetadata));
+    doc->did.metadata = &doc->metadata;
     metastring = DIDMetadata_ToJson(&doc->metadata);
     if (!metastring)
         goto errorExit;
@@ -3899,12 +4659,9 @@ static int import_init(const char *password, Sha256_Digest *digest)
     return 0;
 }
 
-int DIDStore_ImportDID(DIDStore *store, const char *storepass,
-        const char *file, const char *password)
+static int importdid_internal(DIDStore *store, const char *storepass, json_t *root,
+        const char *password)
 {
-    const char *string = NULL;
-    json_t *root = NULL;
-    json_error_t error;
     Sha256_Digest digest;
     DID *did = NULL;
     DIDDocument *doc = NULL;
@@ -3913,37 +4670,15 @@ int DIDStore_ImportDID(DIDStore *store, const char *storepass,
     int rc = -1;
     size_t i;
 
-    DIDERROR_INITIALIZE();
-
-    CHECK_ARG(!store, "No store to import did.", -1);
-    CHECK_PASSWORD(storepass, -1);
-    CHECK_ARG(!file || !*file, "Please provide file to import did.", -1);
-    CHECK_ARG(!password || !*password, "Please specify password to import.", -1);
+    assert(store);
+    assert(root);
 
-    if (test_path(file) != S_IFREG) {
-        DIDError_Set(DIDERR_INVALID_ARGS, "Invalid file to import did error.");
-        return -1;
-    }
+    if (import_init(password, &digest) < 0)
+        goto errorExit;
 
-    string = load_file(file);
-    if (!string) {
-        DIDError_Set(DIDERR_IO_ERROR, "Load file [%s] failed.", file);
-        return -1;
-    }
-
-    root = json_loads(string, JSON_COMPACT, &error);
-    free((void*)string);
-    if (!root) {
-        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Deserialize export file failed, error: %s.", error.text);
-        return -1;
-    }
-
-    if (import_init(password, &digest) < 0)
-        goto errorExit;
-
-    //type
-    if (import_type(root, &digest) < 0)
-        goto errorExit;
+    //type
+    if (import_type(root, &digest) < 0)
+        goto errorExit;
 
     //id
     did = import_id(root, &digest);
@@ -4009,8 +4744,6 @@ int DIDStore_ImportDID(DIDStore *store, const char *storepass,
 errorExit:
     if (rc == -1)
         sha256_digest_cleanup(&digest);
-    if (root)
-        json_decref(root);
     if (did)
         DID_Destroy(did);
     if (doc)
@@ -4021,6 +4754,44 @@ errorExit:
     }
 
     return rc;
+}
+
+int DIDStore_ImportDID(DIDStore *store, const char *storepass,
+        const char *file, const char *password)
+{
+    const char *string = NULL;
+    json_t *root = NULL;
+    json_error_t error;
+    int rc;
+
+    DIDERROR_INITIALIZE();
+
+    CHECK_ARG(!store, "No store to import did.", -1);
+    CHECK_PASSWORD(storepass, -1);
+    CHECK_ARG(!file || !*file, "Please provide file to import did.", -1);
+    CHECK_ARG(!password || !*password, "Please specify password to import.", -1);
+
+    if (test_path(file) != S_IFREG) {
+        DIDError_Set(DIDERR_INVALID_ARGS, "Invalid file to import did error.");
+        return -1;
+    }
+
+    string = load_file(file);
+    if (!string) {
+        DIDError_Set(DIDERR_IO_ERROR, "Load file [%s] failed.", file);
+        return -1;
+    }
+
+    root = json_loads(string, JSON_COMPACT, &error);
+    free((void*)string);
+    if (!root) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Deserialize export file failed, error: %s.", error.text);
+        return -1;
+    }
+
+    rc = importdid_internal(store, storepass, root, password);
+    json_decref(root);
+    return rc;
 
     DIDERROR_FINALIZE();
 }
@@ -4167,31 +4938,19 @@ static int export_defaultId(JsonGenerator *gen, DIDStore *store, const char *id,
     return 0;
 }
 
-int DIDStore_ExportRootIdentity(DIDStore *store, const char *storepass,
-        const char *id, const char *file, const char *password)
+static const char *exportidentity_data(DIDStore *store, const char *storepass,
+        const char *id, const char *password)
 {
     Sha256_Digest digest;
-    const char *pubKey = NULL, *data;
-    int rc = -1;
     JsonGenerator g, *gen;
 
-    DIDERROR_INITIALIZE();
-
-    CHECK_ARG(!store, "No store to export rootidentity.", -1);
-    CHECK_PASSWORD(storepass, -1);
-    CHECK_ARG(!id, "No rootidentity id argument.", -1);
-    CHECK_ARG(!file || !*file, "Please provide file to export rootidentity.", -1);
-    CHECK_ARG(!password || !*password, "Invalid password.", -1);
-
-    if (check_file(file) < 0) {
-        DIDError_Set(DIDERR_INVALID_ARGS, "Invalid file to export rootidentity.");
-        return -1;
-    }
+    assert(store);
+    assert(id);
 
     gen = DIDJG_Initialize(&g);
     if (!gen) {
         DIDError_Set(DIDERR_OUT_OF_MEMORY, "Json generator for exporting rootidentity initialize failed.");
-        goto errorExit;
+        return NULL;
     }
 
     if (export_init(gen, password, &digest) < 0 || export_type(gen, &digest) < 0)
@@ -4203,27 +4962,49 @@ int DIDStore_ExportRootIdentity(DIDStore *store, const char *storepass,
             export_pubkey(gen, store, id, &digest) < 0 ||
             export_index(gen, store, id, &digest) < 0 ||
             export_defaultId(gen, store, id, &digest) < 0 ||
-            export_created(gen, &digest) < 0)
+            export_created(gen, &digest) < 0 ||
+            export_final(gen, &digest) < 0)
+        goto errorExit;
+
+    return DIDJG_Finish(gen);
+
+errorExit:
+    sha256_digest_cleanup(&digest);
+    DIDJG_Destroy(gen);
+    return NULL;
+}
+
+int DIDStore_ExportRootIdentity(DIDStore *store, const char *storepass,
+        const char *id, const char *file, const char *password)
+{
+    const char *data;
+    int rc;
+
+    DIDERROR_INITIALIZE();
+
+    CHECK_ARG(!store, "No store to export rootidentity.", -1);
+    CHECK_PASSWORD(storepass, -1);
+    CHECK_ARG(!id, "No rootidentity id argument.", -1);
+    CHECK_ARG(!file || !*file, "Please provide file to export rootidentity.", -1);
+    CHECK_ARG(!password || !*password, "Invalid password.", -1);
+
+    if (check_file(file) < 0) {
+        DIDError_Set(DIDERR_INVALID_ARGS, "Invalid file to export rootidentity.");
         return -1;
+    }
 
-    if (export_final(gen, &digest) < 0)
-        goto errorExit;
+    data = exportidentity_data(store, storepass, id, password);
+    if (!data)
+        return -1;
 
-    data = DIDJG_Finish(gen);
     rc = store_file(file, data);
     free((void*)data);
     if (rc < 0) {
         DIDError_Set(DIDERR_IO_ERROR, "Write exporting did string into file failed.");
-        goto errorExit;
+        return -1;
     }
 
-    rc = 0;
-
-errorExit:
-    if (pubKey)
-       free((void*)pubKey);
-
-    return rc;
+    return 0;
 
     DIDERROR_FINALIZE();
 }
@@ -4410,42 +5191,17 @@ static int import_defaultId(json_t *json, DIDStore *store, const char *id,
     return 0;
 }
 
-int DIDStore_ImportRootIdentity(DIDStore *store, const char *storepass,
-        const char *file, const char *password)
+static int importidentity_internal(DIDStore *store, const char *storepass, json_t *root,
+        const char *password)
 {
-    json_t *root = NULL;
-    json_error_t error;
-    const char *string = NULL;
     char fingerprint[64] = {0};
     char id[MAX_ID_LEN] = {0}, path[PATH_MAX];
     Sha256_Digest digest;
     bool isDefault, toDelete = true;
     int rc = -1;
 
-    DIDERROR_INITIALIZE();
-
-    CHECK_ARG(!store, "No store to import rootidentity.", -1);
-    CHECK_PASSWORD(storepass, -1);
-    CHECK_ARG(!file || !*file, "Please provide file to import rootidentity.", -1);
-    CHECK_ARG(!password || !*password, "Invalid password.", -1);
-
-    if (test_path(file) != S_IFREG) {
-        DIDError_Set(DIDERR_INVALID_ARGS, "Invalid file to import rootidentity.");
-        return -1;
-    }
-
-    string = load_file(file);
-    if (!string) {
-        DIDError_Set(DIDERR_IO_ERROR, "Load file[%s] failed.", file);
-        return -1;
-    }
-
-    root = json_loads(string, JSON_COMPACT, &error);
-    free((void*)string);
-    if (!root) {
-        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Deserialize rootidentity failed, error: %s.", error.text);
-        return -1;
-    }
+    assert(store);
+    assert(root);
 
     if (import_init(password, &digest) < 0 || import_type(root, &digest) < 0)
         goto errorExit;
@@ -4472,6 +5228,8 @@ int DIDStore_ImportRootIdentity(DIDStore *store, const char *storepass,
     if (StoreMetadata_SetFingerPrint(&store->metadata, fingerprint) < 0)
         goto errorExit;
 
+    clear_password(store);
+
     if (isDefault && StoreMetadata_SetDefaultRootIdentity(&store->metadata, id) < 0)
         goto errorExit;
 
@@ -4482,13 +5240,49 @@ int DIDStore_ImportRootIdentity(DIDStore *store, const char *storepass,
     rc = 0;
 
 errorExit:
-    if (root)
-       json_decref(root);
     if (*id && toDelete) {
         get_dir(path, 0, 4, store->root, DATA_DIR, ROOTS_DIR, id);
         delete_file(path);
     }
     return rc;
+}
+
+int DIDStore_ImportRootIdentity(DIDStore *store, const char *storepass,
+        const char *file, const char *password)
+{
+    json_t *root = NULL;
+    json_error_t error;
+    const char *string = NULL;
+    int rc;
+
+    DIDERROR_INITIALIZE();
+
+    CHECK_ARG(!store, "No store to import rootidentity.", -1);
+    CHECK_PASSWORD(storepass, -1);
+    CHECK_ARG(!file || !*file, "Please provide file to import rootidentity.", -1);
+    CHECK_ARG(!password || !*password, "Invalid password.", -1);
+
+    if (test_path(file) != S_IFREG) {
+        DIDError_Set(DIDERR_INVALID_ARGS, "Invalid file to import rootidentity.");
+        return -1;
+    }
+
+    string = load_file(file);
+    if (!string) {
+        DIDError_Set(DIDERR_IO_ERROR, "Load file[%s] failed.", file);
+        return -1;
+    }
+
+    root = json_loads(string, JSON_COMPACT, &error);
+    free((void*)string);
+    if (!root) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Deserialize rootidentity failed, error: %s.", error.text);
+        return -1;
+    }
+
+    rc = importidentity_internal(store, storepass, root, password);
+    json_decref(root);
+    return rc;
 
     DIDERROR_FINALIZE();
 }
@@ -4510,79 +5304,242 @@ static zip_t *create_zip(const char *file)
     return zip;
 }
 
-static int did_to_zip(DID *did, void *context)
+static const char *export_data(Export_Source *source)
 {
-    DID_Export *export = (DID_Export*)context;
-    char tmpfile[PATH_MAX];
-
-    if (!did)
-        return 0;
+    Store_Export *export;
 
-    sprintf(tmpfile, "%s%s%s.json", export->tmpdir, PATH_SEP, did->idstring);
-    delete_file(tmpfile);
-    if (DIDStore_ExportDID(export->store, export->storepass, did, tmpfile, export->password) < 0)
-       return -1;
+    assert(source);
 
-    zip_source_t *did_source = zip_source_file(export->zip, tmpfile, 0, 0);
+    export = source->export;
+    if (source->isdid)
+        return exportdid_data(export->store, export->storepass, &source->did,
+                export->password);
+    else
+        return exportidentity_data(export->store, export->storepass, source->id,
+                export->password);
+}
 
-    if (!did_source) {
-        DIDError_Set(DIDERR_MALFORMED_EXPORTDID, "Get source file failed.");
-        return -1;
+static void wipe_data(const char *data, size_t size)
+{
+    if (data) {
+        memset((char*)data, 0, size);
+        free((void*)data);
     }
+}
 
-    sprintf(tmpfile, "did-%s", did->idstring);
-    if (zip_file_add(export->zip, tmpfile, did_source, 0) < 0) {
-        zip_source_free(did_source);
-        DIDError_Set(DIDERR_MALFORMED_EXPORTDID, "Add source file failed.");
-        return -1;
+//Runs on a worker, the entry stays in memory until libzip opens it.
+static void export_entry(void *arg)
+{
+    Export_Source *source = (Export_Source*)arg;
+    Store_Export *export;
+    const char *data = NULL, *msg;
+    bool failed;
+
+    assert(source);
+
+    export = source->export;
+    DIDError_Initialize();
+
+    pthread_mutex_lock(&export->lock);
+    failed = export->failed;
+    pthread_mutex_unlock(&export->lock);
+
+    if (!failed)
+        data = export_data(source);
+
+    pthread_mutex_lock(&export->lock);
+    if (!data && !export->failed) {
+        export->failed = true;
+        export->errcode = DIDError_GetLastErrorCode();
+        msg = DIDError_GetLastErrorMessage();
+        if (msg) {
+            strncpy(export->errmsg, msg, sizeof(export->errmsg));
+            export->errmsg[sizeof(export->errmsg) - 1] = 0;
+        }
     }
+    source->data = data;
+    source->size = data ? strlen(data) : 0;
+    source->ready = true;
+    pthread_cond_broadcast(&export->cond);
+    pthread_mutex_unlock(&export->lock);
 
-    return 0;
+    DIDError_Finalize();
 }
 
-static int exportdid_to_zip(DIDStore *store, const char *storepass, zip_t *zip,
-        const char *password, const char *tmpdir)
+//Queue the entries up to index + window, called with the lock held.
+static void export_schedule(Store_Export *export, size_t index)
 {
-    DID_Export export;
+    Export_Source *source;
 
-    assert(store);
-    assert(storepass && *storepass);
-    assert(zip);
-    assert(password && *password);
+    assert(export);
 
-    export.store = store;
-    export.storepass = storepass;
-    export.password = password;
-    export.zip = zip;
-    export.tmpdir = tmpdir;
+    while (export->next < export->count && export->next <= index + export->window) {
+        source = export->sources[export->next++];
+        source->queued = true;
+        if (WorkerPool_Submit(export->pool, export_entry, source) < 0)
+            source->queued = false;
+    }
+}
+
+static int export_open(Export_Source *source)
+{
+    Store_Export *export;
+    bool queued = false;
+
+    assert(source);
+
+    export = source->export;
+    source->data = NULL;
+    if (export->pool) {
+        pthread_mutex_lock(&export->lock);
+        export_schedule(export, source->index);
+        queued = source->queued;
+        while (queued && !source->ready)
+            pthread_cond_wait(&export->cond, &export->lock);
+
+        source->queued = false;
+        source->ready = false;
+        if (queued && !source->data)
+            DIDError_Set(export->errcode ? export->errcode : DIDERR_DIDSTORE_ERROR,
+                    "Export entry %zu failed: %s", source->index, export->errmsg);
+        pthread_mutex_unlock(&export->lock);
+    }
+
+    //no worker, or libzip opens the entry again.
+    if (!queued) {
+        source->data = export_data(source);
+        source->size = source->data ? strlen(source->data) : 0;
+    }
 
-    return DIDStore_ListDIDs(store, 0, did_to_zip, (void*)&export);
+    source->offset = 0;
+    return source->data ? 0 : -1;
 }
 
-static int rootidentity_to_zip(RootIdentity *rootidentity, void *context)
+static zip_int64_t export_source(void *userdata, void *data, zip_uint64_t len,
+        zip_source_cmd_t cmd)
 {
-    RootIdentity_Export *export = (RootIdentity_Export*)context;
+    Export_Source *source = (Export_Source*)userdata;
+    Store_Export *export;
 
-    char tmpfile[PATH_MAX], path[PATH_MAX];
-    zip_source_t *prv_source;
+    assert(source);
 
-    if (!rootidentity)
+    export = source->export;
+    switch (cmd) {
+    case ZIP_SOURCE_OPEN:
+        if (export_open(source) < 0) {
+            zip_error_set(&source->error, ZIP_ER_INTERNAL, 0);
+            return -1;
+        }
+        return 0;
+
+    case ZIP_SOURCE_READ:
+        if (len > source->size - source->offset)
+            len = source->size - source->offset;
+
+        memcpy(data, source->data + source->offset, len);
+        source->offset += len;
+        return (zip_int64_t)len;
+
+    case ZIP_SOURCE_CLOSE:
+        wipe_data(source->data, source->size);
+        source->data = NULL;
+
+        if (export->done < export->count)
+            export->done++;
+        if (export->progress)
+            export->progress(export->done, export->count, export->context);
+        return 0;
+
+    case ZIP_SOURCE_STAT:
+        zip_stat_init((zip_stat_t*)data);
+        return sizeof(zip_stat_t);
+
+    case ZIP_SOURCE_ERROR:
+        return zip_error_to_data(&source->error, data, len);
+
+    case ZIP_SOURCE_FREE:
+        //the sources belong to the export, the workers may still hold them.
         return 0;
 
-    sprintf(tmpfile, "%s%s%s.json", export->tmpdir, PATH_SEP, rootidentity->id);
-    delete_file(tmpfile);
-    if (DIDStore_ExportRootIdentity(export->store, export->storepass, rootidentity->id, tmpfile, export->password) < 0)
+    case ZIP_SOURCE_SUPPORTS:
+        return zip_source_make_command_bitmap(ZIP_SOURCE_OPEN, ZIP_SOURCE_READ,
+                ZIP_SOURCE_CLOSE, ZIP_SOURCE_STAT, ZIP_SOURCE_ERROR, ZIP_SOURCE_FREE, -1);
+
+    default:
+        zip_error_set(&source->error, ZIP_ER_OPNOTSUPP, 0);
+        return -1;
+    }
+}
+
+static int append_export_entry(Store_Export *export, DID *did, const char *id)
+{
+    Export_Source *source, **sources;
+    size_t capacity;
+
+    assert(export);
+    assert(did || id);
+
+    if (export->count == export->capacity) {
+        capacity = export->capacity ? export->capacity * 2 : 64;
+        sources = (Export_Source**)realloc(export->sources, capacity * sizeof(Export_Source*));
+        if (!sources) {
+            DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for export entries failed.");
+            return -1;
+        }
+        export->sources = sources;
+        export->capacity = capacity;
+    }
+
+    source = (Export_Source*)calloc(1, sizeof(Export_Source));
+    if (!source) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for export entry failed.");
         return -1;
+    }
+
+    source->export = export;
+    source->isdid = did != NULL;
+    if (did)
+        DID_Copy(&source->did, did);
+    else
+        strncpy(source->id, id, sizeof(source->id) - 1);
+    zip_error_init(&source->error);
+
+    export->sources[export->count++] = source;
+    return 0;
+}
+
+//root identities first, then the dids, both by id.
+static int export_compare(const void *a, const void *b)
+{
+    const Export_Source *sa = *(const Export_Source**)a;
+    const Export_Source *sb = *(const Export_Source**)b;
+
+    if (sa->isdid != sb->isdid)
+        return sa->isdid ? 1 : -1;
 
-    prv_source = zip_source_file(export->zip, tmpfile, 0, 0);
-    if (!prv_source) {
-        DIDError_Set(DIDERR_MALFORMED_EXPORTDID, "Get source file failed.");
+    return strcmp(sa->isdid ? sa->did.idstring : sa->id,
+            sb->isdid ? sb->did.idstring : sb->id);
+}
+
+static int add_export_entry(Store_Export *export, Export_Source *source)
+{
+    zip_source_t *zipsource;
+    char name[PATH_MAX];
+    const char *id;
+
+    assert(export);
+    assert(source);
+
+    id = source->isdid ? source->did.idstring : source->id;
+    zipsource = zip_source_function(export->zip, export_source, source);
+    if (!zipsource) {
+        DIDError_Set(DIDERR_MALFORMED_EXPORTDID, "Create source for '%s' failed.", id);
         return -1;
     }
 
-    sprintf(path, "rootIdentity-%s", rootidentity->id);
-    if (zip_file_add(export->zip, path, prv_source, 0) < 0) {
-        zip_source_free(prv_source);
+    snprintf(name, sizeof(name), "%s-%s", source->isdid ? "did" : "rootIdentity", id);
+    if (zip_file_add(export->zip, name, zipsource, 0) < 0) {
+        zip_source_free(zipsource);
         DIDError_Set(DIDERR_MALFORMED_EXPORTDID, "Add source file failed.");
         return -1;
     }
@@ -4590,30 +5547,55 @@ static int rootidentity_to_zip(RootIdentity *rootidentity, void *context)
     return 0;
 }
 
-static int exportidentity_to_zip(DIDStore *store, const char *storepass, zip_t *zip,
-        const char *password, const char *tmpdir)
+static int did_to_zip(DID *did, void *context)
+{
+    if (!did)
+        return 0;
+
+    return append_export_entry((Store_Export*)context, did, NULL);
+}
+
+static int rootidentity_to_zip(RootIdentity *rootidentity, void *context)
 {
-    RootIdentity_Export export;
+    if (!rootidentity)
+        return 0;
 
-    assert(store);
-    assert(storepass && *storepass);
-    assert(zip);
-    assert(password && *password);
+    return append_export_entry((Store_Export*)context, NULL, rootidentity->id);
+}
 
-    export.store = store;
-    export.storepass = storepass;
-    export.password = password;
-    export.zip = zip;
-    export.tmpdir = tmpdir;
+static void export_cleanup(Store_Export *export)
+{
+    Export_Source *source;
+    size_t i;
+
+    assert(export);
+
+    //the queued entries are skipped, then the pool stops.
+    if (export->pool) {
+        pthread_mutex_lock(&export->lock);
+        export->failed = true;
+        pthread_mutex_unlock(&export->lock);
+        WorkerPool_Destroy(export->pool);
+    }
 
-    return DIDStore_ListRootIdentities(store, rootidentity_to_zip, (void*)&export);
+    for (i = 0; i < export->count; i++) {
+        source = export->sources[i];
+        wipe_data(source->data, source->size);
+        zip_error_fini(&source->error);
+        free(source);
+    }
+    free(export->sources);
+
+    pthread_cond_destroy(&export->cond);
+    pthread_mutex_destroy(&export->lock);
 }
 
-int DIDStore_ExportStore(DIDStore *store, const char *storepass,
-        const char *zipfile, const char *password)
+int DIDStore_ExportStoreEx(DIDStore *store, const char *storepass,
+        const char *zipfile, const char *password, int workers,
+        DIDStore_ProgressCallback *progress, void *context)
 {
-    zip_t *zip = NULL;
-    char tmpdir[PATH_MAX];
+    Store_Export export;
+    size_t i;
     int rc = -1;
 
     DIDERROR_INITIALIZE();
@@ -4623,50 +5605,70 @@ int DIDStore_ExportStore(DIDStore *store, const char *storepass,
     CHECK_ARG(!zipfile || !*zipfile, "Please provide zipfile to export.", -1);
     CHECK_ARG(!password || !*password, "Invalid password.", -1);
 
-    zip = create_zip(zipfile);
-    if (!zip) {
-        DIDError_Set(DIDERR_IO_ERROR, "Create zip file failed.");
+    //the workers only compare with the verified storepass, it never changes
+    //under them.
+    if (!check_password(store, storepass))
         return -1;
-    }
 
-    //create temp dir
-#if defined(_WIN32) || defined(_WIN64)
-    const char *tmp = getenv("TEMP");
-    if (!tmp) {
-        DIDError_Set(DIDERR_NOT_EXISTS, "Temp file doesn't exist.");
-        return -1;
+    memset(&export, 0, sizeof(Store_Export));
+    export.store = store;
+    export.storepass = storepass;
+    export.password = password;
+    export.progress = progress;
+    export.context = context;
+    pthread_mutex_init(&export.lock, NULL);
+    pthread_cond_init(&export.cond, NULL);
+
+    if (DIDStore_ListRootIdentities(store, rootidentity_to_zip, (void*)&export) < 0 ||
+            DIDStore_ListDIDs(store, 0, did_to_zip, (void*)&export) < 0)
+        goto errorExit;
+
+    if (export.count > 1)
+        qsort(export.sources, export.count, sizeof(Export_Source*), export_compare);
+
+    export.zip = create_zip(zipfile);
+    if (!export.zip) {
+        DIDError_Set(DIDERR_IO_ERROR, "Create zip file failed.");
+        goto errorExit;
     }
-#else
-    const char *tmp = getenv("TMPDIR");
-    if (!tmp) {
-        if (access("/tmp", 0) == 0) {
-            tmp = "/tmp";
-        } else {
-            DIDError_Set(DIDERR_NOT_EXISTS, "Temp file doesn't exist.");
-            return -1;
-        }
+
+    for (i = 0; i < export.count; i++) {
+        export.sources[i]->index = i;
+        if (add_export_entry(&export, export.sources[i]) < 0)
+            goto errorExit;
     }
-#endif
 
-    snprintf(tmpdir, sizeof(tmpdir), "%s%sdidexport", tmp, PATH_SEP);
-    mkdirs(tmpdir, S_IRWXU);
+    workers = store_workers(workers, export.count);
+    if (workers > 1 && password_verified(store)) {
+        export.pool = WorkerPool_Create(workers);
+        export.window = (size_t)workers * 2;
+    }
 
-    if (exportidentity_to_zip(store, storepass, zip, password, tmpdir) < 0 ||
-            exportdid_to_zip(store, storepass, zip, password, tmpdir) < 0 )
+    //the entries are generated and written here.
+    if (zip_close(export.zip) < 0) {
+        DIDError_Set(DIDERR_IO_ERROR, "Write zip file failed: %s.", zip_strerror(export.zip));
         goto errorExit;
-
+    }
+    export.zip = NULL;
     rc = 0;
 
 errorExit:
-    if (zip)
-        zip_close(zip);
-
-    delete_file(tmpdir);
+    if (export.zip) {
+        zip_discard(export.zip);
+        delete_file(zipfile);
+    }
+    export_cleanup(&export);
     return rc;
 
     DIDERROR_FINALIZE();
 }
 
+int DIDStore_ExportStore(DIDStore *store, const char *storepass,
+        const char *zipfile, const char *password)
+{
+    return DIDStore_ExportStoreEx(store, storepass, zipfile, password, 0, NULL, NULL);
+}
+
 static zip_t *open_zip(const char *file)
 {
     int err;
@@ -4684,103 +5686,341 @@ static zip_t *open_zip(const char *file)
     return zip;
 }
 
-int DIDStore_ImportStore(DIDStore *store, const char *storepass, const char *zipfile,
-        const char *password)
+static size_t read_entry(void *buffer, size_t buflen, void *data)
+{
+    zip_int64_t size;
+
+    size = zip_fread((zip_file_t*)data, buffer, buflen);
+    return size < 0 ? (size_t)-1 : (size_t)size;
+}
+
+//The entry is parsed while it is decompressed, without a copy of it.
+static json_t *load_entry(zip_t *zip, zip_int64_t index)
+{
+    zip_file_t *file;
+    json_error_t error;
+    json_t *root;
+
+    assert(zip);
+
+    file = zip_fopen_index(zip, index, ZIP_FL_UNCHANGED);
+    if (!file) {
+        DIDError_Set(DIDERR_IO_ERROR, "Open index %d file.", index);
+        return NULL;
+    }
+
+    root = json_load_callback(read_entry, file, JSON_DISABLE_EOF_CHECK, &error);
+    zip_fclose(file);
+    if (!root)
+        DIDError_Set(DIDERR_MALFORMED_EXPORTDID, "Deserialize index %d file failed, error: %s.",
+                index, error.text);
+
+    return root;
+}
+
+static bool is_rootidentity_entry(const char *name)
+{
+    return !strncmp(name, "rootIdentity-", strlen("rootIdentity-"));
+}
+
+static bool is_did_entry(const char *name)
+{
+    return !strncmp(name, "did-", strlen("did-"));
+}
+
+//Only read here, the entry is parsed and imported by a worker.
+static Import_Entry *read_import_entry(Store_Import *import, zip_t *zip,
+        zip_int64_t index, const char *name)
+{
+    Import_Entry *entry;
+    zip_file_t *file;
+    zip_stat_t st;
+    zip_int64_t size;
+
+    assert(import);
+    assert(zip);
+    assert(name);
+
+    if (zip_stat_index(zip, index, ZIP_FL_UNCHANGED, &st) < 0 || !(st.valid & ZIP_STAT_SIZE)) {
+        DIDError_Set(DIDERR_IO_ERROR, "Obtain information about index %d file.", index);
+        return NULL;
+    }
+
+    entry = (Import_Entry*)calloc(1, sizeof(Import_Entry));
+    if (!entry) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for import entry failed.");
+        return NULL;
+    }
+
+    entry->data = (char*)malloc(st.size + 1);
+    if (!entry->data) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for index %d file failed.", index);
+        free(entry);
+        return NULL;
+    }
+
+    file = zip_fopen_index(zip, index, ZIP_FL_UNCHANGED);
+    if (!file) {
+        DIDError_Set(DIDERR_IO_ERROR, "Open index %d file.", index);
+        goto errorExit;
+    }
+
+    size = zip_fread(file, entry->data, st.size);
+    zip_fclose(file);
+    if (size < 0 || (zip_uint64_t)size != st.size) {
+        DIDError_Set(DIDERR_IO_ERROR, "Read index %d file failed.", index);
+        goto errorExit;
+    }
+
+    entry->import = import;
+    entry->size = (size_t)size;
+    entry->data[entry->size] = 0;
+    strncpy(entry->name, name, sizeof(entry->name) - 1);
+    return entry;
+
+errorExit:
+    free(entry->data);
+    free(entry);
+    return NULL;
+}
+
+static void import_entry(void *arg)
+{
+    Import_Entry *entry = (Import_Entry*)arg;
+    Store_Import *import;
+    json_error_t error;
+    json_t *root;
+    const char *msg;
+    bool failed;
+    int rc = -1;
+
+    assert(entry);
+
+    import = entry->import;
+    DIDError_Initialize();
+
+    pthread_mutex_lock(&import->lock);
+    failed = import->failed;
+    pthread_mutex_unlock(&import->lock);
+
+    if (!failed) {
+        root = json_loadb(entry->data, entry->size, 0, &error);
+        if (root) {
+            rc = importdid_internal(import->store, import->storepass, root, import->password);
+            json_decref(root);
+        } else {
+            DIDError_Set(DIDERR_MALFORMED_EXPORTDID, "Deserialize %s failed, error: %s.",
+                    entry->name, error.text);
+        }
+    }
+
+    pthread_mutex_lock(&import->lock);
+    import->inflight--;
+    if (rc == 0) {
+        import->done++;
+    } else if (!import->failed) {
+        import->failed = true;
+        import->errcode = DIDError_GetLastErrorCode();
+        msg = DIDError_GetLastErrorMessage();
+        if (msg) {
+            strncpy(import->errmsg, msg, sizeof(import->errmsg));
+            import->errmsg[sizeof(import->errmsg) - 1] = 0;
+        }
+        strcpy(import->name, entry->name);
+    }
+    pthread_cond_broadcast(&import->cond);
+    pthread_mutex_unlock(&import->lock);
+
+    DIDError_Finalize();
+
+    wipe_data(entry->data, entry->size);
+    free(entry);
+}
+
+static void import_progress(Store_Import *import, size_t done)
+{
+    assert(import);
+
+    if (import->progress && done != import->reported) {
+        import->reported = done;
+        import->progress(done, import->total, import->context);
+    }
+}
+
+//Wait until no more than limit entries are in flight, the progress is
+//reported on the importing thread.
+static bool import_wait(Store_Import *import, size_t limit)
+{
+    size_t done;
+    bool failed;
+
+    assert(import);
+
+    pthread_mutex_lock(&import->lock);
+    while (import->inflight > limit && !import->failed)
+        pthread_cond_wait(&import->cond, &import->lock);
+    done = import->done;
+    failed = import->failed;
+    pthread_mutex_unlock(&import->lock);
+
+    import_progress(import, done);
+    return !failed;
+}
+
+static int import_did(Store_Import *import, zip_t *zip, zip_int64_t index, const char *name)
+{
+    Import_Entry *entry;
+    json_t *root;
+    int rc;
+
+    assert(import);
+    assert(zip);
+    assert(name);
+
+    if (!import->pool) {
+        root = load_entry(zip, index);
+        if (!root)
+            return -1;
+
+        rc = importdid_internal(import->store, import->storepass, root, import->password);
+        json_decref(root);
+        if (rc < 0) {
+            DIDError_Set(DIDERR_MALFORMED_EXPORTDID, "Import did(%s) failed.", name);
+            return -1;
+        }
+
+        import_progress(import, ++import->done);
+        return 0;
+    }
+
+    entry = read_import_entry(import, zip, index, name);
+    if (!entry)
+        return -1;
+
+    pthread_mutex_lock(&import->lock);
+    import->inflight++;
+    pthread_mutex_unlock(&import->lock);
+
+    if (WorkerPool_Submit(import->pool, import_entry, entry) < 0)
+        import_entry(entry);
+
+    return 0;
+}
+
+int DIDStore_ImportStoreEx(DIDStore *store, const char *storepass,
+        const char *zipfile, const char *password, int workers,
+        DIDStore_ProgressCallback *progress, void *context)
 {
+    Store_Import import;
     zip_t *zip = NULL;
     zip_int64_t count, i;
-    zip_stat_t stat;
-    int rc = -1;
+    const char *name;
+    json_t *root;
+    size_t dids = 0, window = 0;
+    int rc = -1, code;
 
     DIDERROR_INITIALIZE();
 
-#if defined(_WIN32) || defined(_WIN64)
-    char filename[] = "\\tmp\\storeexport.json";
-#else
-    char filename[] = "/tmp/storeexport.json";
-#endif
-
     CHECK_ARG(!store, "No store to import store.", -1);
     CHECK_PASSWORD(storepass, -1);
     CHECK_ARG(!zipfile || !*zipfile, "Please provide zipfile to import.", -1);
     CHECK_ARG(!password || !*password, "Invalid password.", -1);
 
+    memset(&import, 0, sizeof(Store_Import));
+    import.store = store;
+    import.storepass = storepass;
+    import.password = password;
+    import.progress = progress;
+    import.context = context;
+    pthread_mutex_init(&import.lock, NULL);
+    pthread_cond_init(&import.cond, NULL);
+
     zip = open_zip(zipfile);
     if (!zip)
-        return -1;
+        goto errorExit;
 
     count = zip_get_num_entries(zip, ZIP_FL_UNCHANGED);
     if (count == 0)
         goto errorExit;
 
     for (i = 0; i < count; i++) {
-        zip_int64_t readed;
-        int code;
-        zip_stat_init(&stat);
-        if (zip_stat_index(zip, i, ZIP_FL_UNCHANGED, &stat) < 0) {
+        name = zip_get_name(zip, i, ZIP_FL_UNCHANGED);
+        if (!name) {
             DIDError_Set(DIDERR_IO_ERROR, "Obtain information about index %d file.", i);
             goto errorExit;
         }
 
-        zip_file_t *zip_file = zip_fopen_index(zip, i, ZIP_FL_UNCHANGED);
-        if (!zip_file) {
-            DIDError_Set(DIDERR_IO_ERROR, "Open index %d file.", i);
-            goto errorExit;
-        }
+        if (is_rootidentity_entry(name))
+            import.total++;
+        else if (is_did_entry(name))
+            dids++;
+    }
+    import.total += dids;
 
-        char *buffer = (char*)malloc(stat.size + 1);
-        if (!buffer) {
-            DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for index %d file failed.", i);
-            zip_fclose(zip_file);
-            goto errorExit;
-        }
+    //The root identities update the store metadata, they go first and one
+    //by one.
+    for (i = 0; i < count; i++) {
+        name = zip_get_name(zip, i, ZIP_FL_UNCHANGED);
+        if (!name || !is_rootidentity_entry(name))
+            continue;
 
-        readed = zip_fread(zip_file, buffer, stat.size);
-        zip_fclose(zip_file);
-        if (readed < 0) {
-            DIDError_Set(DIDERR_IO_ERROR, "Read index %d file failed.", i);
+        root = load_entry(zip, i);
+        if (!root)
             goto errorExit;
-        }
-        buffer[stat.size] = 0;
 
-        delete_file(filename);
-        if (check_file(filename) < 0) {
-            DIDError_Set(DIDERR_IO_ERROR, "Invalid file[%s].", filename);
+        code = importidentity_internal(store, storepass, root, password);
+        json_decref(root);
+        if (code < 0) {
+            DIDError_Set(DIDERR_MALFORMED_EXPORTDID, "Import rootidentity(%s) failed.", name);
             goto errorExit;
         }
 
-        code = store_file(filename, buffer);
-        free(buffer);
-        if (code < 0) {
-            DIDError_Set(DIDERR_IO_ERROR, "Store '%s' file failed.", filename);
-            delete_file(filename);
+        import_progress(&import, ++import.done);
+    }
+
+    //the workers only compare with the verified storepass, it never changes
+    //under them.
+    workers = store_workers(workers, dids);
+    if (workers > 1) {
+        if (!check_password(store, storepass))
             goto errorExit;
+
+        if (password_verified(store)) {
+            import.pool = WorkerPool_Create(workers);
+            window = (size_t)workers * 2;
         }
+    }
 
-        if (!strncmp(stat.name, "rootIdentity-", strlen("rootIdentity-"))) {
-            code = DIDStore_ImportRootIdentity(store, storepass, filename, password);
-            delete_file(filename);
-            if (code < 0) {
-                DIDError_Set(DIDERR_MALFORMED_EXPORTDID, "Import rootidentity(%s) failed.", filename);
-                goto errorExit;
-            }
-        } else if(!strncmp(stat.name, "did-", strlen("did-"))) {
-            DID * did = DID_New(stat.name + 4);
-            if (!did)
-                goto errorExit;
+    for (i = 0; i < count; i++) {
+        name = zip_get_name(zip, i, ZIP_FL_UNCHANGED);
+        if (!name || !is_did_entry(name))
+            continue;
 
-            code = DIDStore_ImportDID(store, storepass, filename, password);
-            delete_file(filename);
-            DID_Destroy(did);
-            if (code < 0) {
-                DIDError_Set(DIDERR_MALFORMED_EXPORTDID, "Import did(%s) failed.", filename);
-                goto errorExit;
-            }
-        }
+        if (import.pool && !import_wait(&import, window))
+            break;
+
+        if (import_did(&import, zip, i, name) < 0)
+            goto errorExit;
+    }
+
+    if (import.pool && !import_wait(&import, 0)) {
+        DIDError_Set(import.errcode ? import.errcode : DIDERR_MALFORMED_EXPORTDID,
+                "%s", import.errmsg);
+        DIDError_Set(DIDERR_MALFORMED_EXPORTDID, "Import did(%s) failed.", import.name);
+        goto errorExit;
     }
     rc = 0;
 
 errorExit:
+    if (import.pool) {
+        pthread_mutex_lock(&import.lock);
+        import.failed = true;
+        pthread_mutex_unlock(&import.lock);
+        WorkerPool_Destroy(import.pool);
+    }
+    pthread_cond_destroy(&import.cond);
+    pthread_mutex_destroy(&import.lock);
+
     if (zip)
         zip_close(zip);
 
@@ -4788,3 +6028,9 @@ errorExit:
 
     DIDERROR_FINALIZE();
 }
+
+int DIDStore_ImportStore(DIDStore *store, const char *storepass, const char *zipfile,
+        const char *password)
+{
+    return DIDStore_ImportStoreEx(store, storepass, zipfile, password, 0, NULL, NULL);
+}
@@ -23,11 +23,15 @@
 #ifndef __DIDSTORE_H__
 #define __DIDSTORE_H__
 
+#include <pthread.h>
+
 #include "ela_did.h"
 #include "didbackend.h"
 #include "didmeta.h"
 #include "credmeta.h"
 #include "storemeta.h"
+#include "keysession.h"
+#include "storeindex.h"
 
 #if defined(_WIN32) || defined(_WIN64)
     #include <crystal.h>
@@ -41,9 +45,24 @@ extern "C" {
 
 #define MAX_PRIVATEKEY_BASE64           160
 
+#define PASSWORD_SALT_BYTES             16
+
 struct DIDStore {
     char root[PATH_MAX];
     StoreMetadata metadata;
+    //Swapped by Unlock and Lock, the signers take a reference under the lock.
+    pthread_mutex_t sessionlock;
+    KeySession *session;
+    StoreIndex *index;
+
+    //The salted digest of the last verified storepass, the signers, Unlock
+    //and the export/import workers check it under the lock.
+    pthread_mutex_t passwordlock;
+    struct {
+        bool verified;
+        uint8_t salt[PASSWORD_SALT_BYTES];
+        uint8_t digest[SHA256_BYTES];
+    } password;
 };
 
 int DIDStore_StoreDIDMetadata(DIDStore *store, DIDMetadata *metadata, DID *did);
@@ -248,6 +248,24 @@ int DIDURL_InitFromString(DIDURL *id, const char *idstring, const char *fragment
     return 0;
 }
 
+//The ids handed to the caller carry their own metadata, the ones embedded
+//in a credential or a document borrow the owner's.
+typedef struct StandaloneDIDURL {
+    DIDURL id;
+    CredentialMetadata metadata;
+} StandaloneDIDURL;
+
+static DIDURL *id_alloc(void)
+{
+    return (DIDURL *)calloc(1, sizeof(StandaloneDIDURL));
+}
+
+//after the parser, which clears the id.
+static void id_attach(DIDURL *id)
+{
+    id->metadata = &((StandaloneDIDURL *)id)->metadata;
+}
+
 DIDURL *DIDURL_FromString(const char *idstring, DID *context)
 {
     DIDURL *id;
@@ -256,7 +274,7 @@ DIDURL *DIDURL_FromString(const char *idstring, DID *context)
 
     CHECK_ARG(!idstring || !*idstring, "Invalid idstring.", NULL);
 
-    id = (DIDURL*)calloc(1, sizeof(DIDURL));
+    id = id_alloc();
     if (!id) {
         DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for DIDURL failed.");
         return NULL;
@@ -267,6 +285,7 @@ DIDURL *DIDURL_FromString(const char *idstring, DID *context)
         return NULL;
     }
 
+    id_attach(id);
     return id;
 
     DIDERROR_FINALIZE();
@@ -285,7 +304,7 @@ DIDURL *DIDURL_New(const char *method_specific_string, const char *fragment)
             "method specific string is too long.", NULL);
     CHECK_ARG(strlen(fragment) >= MAX_FRAGMENT_LEN, "The fragment is too long.", NULL);
 
-    id = (DIDURL *)calloc(1, sizeof(DIDURL));
+    id = id_alloc();
     if (!id) {
         DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for DIDURL failed.");
         return NULL;
@@ -294,7 +313,7 @@ DIDURL *DIDURL_New(const char *method_specific_string, const char *fragment)
     strcpy(id->did.method, did_method);
     strcpy(id->did.idstring, method_specific_string);
     strcpy(id->fragment, fragment);
-
+    id_attach(id);
     return id;
 
     DIDERROR_FINALIZE();
@@ -310,7 +329,7 @@ DIDURL *DIDURL_NewFromDid(DID *did, const char *fragment)
     CHECK_ARG(!fragment || !*fragment, "Invalid fragment string.", NULL);
     CHECK_ARG(strlen(fragment) >= MAX_FRAGMENT_LEN, "The fragment is too long.", NULL);
 
-    id = (DIDURL*)calloc(1, sizeof(DIDURL));
+    id = id_alloc();
     if (!id) {
         DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for DIDURL failed.");
         return NULL;
@@ -322,6 +341,7 @@ DIDURL *DIDURL_NewFromDid(DID *did, const char *fragment)
     }
 
     strcpy(id->fragment, fragment);
+    id_attach(id);
     return id;
 
     DIDERROR_FINALIZE();
@@ -562,7 +582,7 @@ void DIDURL_Destroy(DIDURL *id)
     if (!id)
         return;
 
-    CredentialMetadata_Free(&id->metadata);
+    CredentialMetadata_Free(&((StandaloneDIDURL *)id)->metadata);
     free(id);
 
     DIDERROR_FINALIZE();
@@ -573,7 +593,13 @@ CredentialMetadata *DIDURL_GetMetadata(DIDURL *id)
     DIDERROR_INITIALIZE();
 
     CHECK_ARG(!id, "No destination id argument.", NULL);
-    return &id->metadata;
+
+    if (!id->metadata) {
+        DIDError_Set(DIDERR_NOT_EXISTS, "No metadata attached to this id.");
+        return NULL;
+    }
+
+    return id->metadata;
 
     DIDERROR_FINALIZE();
 }
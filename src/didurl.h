@@ -40,7 +40,9 @@ struct  DIDURL {
     char path[MAX_PATH_LEN];
     char queryString[MAX_QUERY_LEN];
     char fragment[MAX_FRAGMENT_LEN];
-    CredentialMetadata metadata;
+    //borrowed from the owning credential or store listing, unless the id
+    //came from DIDURL_New/DIDURL_FromString and carries its own.
+    CredentialMetadata *metadata;
 };
 
 int DIDURL_Parse(DIDURL *id, const char *idstring, DID *context);
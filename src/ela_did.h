@@ -310,6 +310,13 @@ typedef struct Issuer                   Issuer;
  * DIDStore is local store for specified DID.
  */
 typedef struct DIDStore                 DIDStore;
+/**
+ * \~English
+ * DIDBackend holds the resolver, the transaction method, the resolve cache and
+ * the ttl used to resolve, verify and publish. A backend is safe to be used by
+ * several threads at the same time.
+ */
+typedef struct DIDBackend               DIDBackend;
 
 #ifndef DISABLE_JWT
     /**
@@ -357,6 +364,18 @@ typedef int DIDStore_CredentialsCallback(DIDURL *id, void *context);
  *      If no error occurs, return 0. Otherwise, return -1.
  */
 typedef int DIDStore_RootIdentitiesCallback(RootIdentity *rootidentity, void *context);
+/**
+ * \~English
+ * Progress callback of exporting or importing the whole store. It is called
+ * on the thread which exports or imports the store.
+ * @param
+ *      done              [in] The count of the entries finished.
+ * @param
+ *      total             [in] The count of all the entries.
+ * @param
+ *      context           [in] The application defined context data.
+ */
+typedef void DIDStore_ProgressCallback(size_t done, size_t total, void *context);
 /**
  * \~English
  * The function indicate how to resolve the confict, if the local document is different
@@ -401,6 +420,24 @@ typedef bool CreateIdTransaction_Callback(const char *payload, const char *memo)
  */
 typedef const char* Resolve_Callback(const char *request);
 
+/**
+ * \~English
+ * The function called when a resolve started by DID_ResolveAsync is done.
+ * @param
+ *      did                  [in] The DID which is resolved, it is valid only
+ *                                during the call.
+ * @param
+ *      document             [in] The DID Document, NULL if the DID can't be
+ *                                resolved. User need to release it.
+ * @param
+ *      status               [in] The status of the DID. If it is DIDStatus_Error,
+ *                                the error code and message tell the reason.
+ * @param
+ *      context              [in] The context given to DID_ResolveAsync.
+ */
+typedef void DIDResolve_Callback(DID *did, DIDDocument *document, DIDStatus status,
+        void *context);
+
 /******************************************************************************
  * DID
  *****************************************************************************/
@@ -550,6 +587,61 @@ DID_API void DID_Destroy(DID *did);
  */
 DID_API DIDDocument *DID_Resolve(DID *did, DIDStatus *status, bool force);
 
+/**
+ * \~English
+ * Get the newest DID Documents of a group of DIDs from chain.
+ * The cached documents are returned directly, the repeated DIDs are resolved
+ * only once, and the others are resolved concurrently.
+ *
+ * @param
+ *      dids                     [in] The array of DIDs to resolve.
+ * @param
+ *      size                     [in] The count of DIDs.
+ * @param
+ *      docs                     [out] The buffer to receive the DID Documents,
+ *                               which has at least 'size' elements. The element
+ *                               is NULL if the DID Document can't be resolved.
+ * @param
+ *      statuses                 [out] The buffer to receive the status of each DID,
+ *                               which has at least 'size' elements.
+ * @param
+ *      force                    [in] Indicate if load document from cache or not.
+ *                               force = true, document gets only from chain.
+ *                               force = false, document can get from cache,
+ *                               if no document is in the cache, resolve it from chain.
+ * @return
+ *      0 if the DIDs are resolved, check the status of each DID for the result;
+ *      -1 if an error occurred.
+ *      Notice that user need to release the handles of returned documents to destroy their memory.
+ */
+DID_API int DID_ResolveBatch(DID **dids, size_t size, DIDDocument **docs,
+        DIDStatus *statuses, bool force);
+
+/**
+ * \~English
+ * Start to get the newest DID Document from chain without blocking.
+ * The request is sent without holding a thread, the response is parsed and
+ * validated by the resolve workers, then the callback is called by the thread
+ * which calls DIDBackend_Poll on the same backend.
+ *
+ * @param
+ *      did                      [in] The handle of DID.
+ * @param
+ *      force                    [in] Indicate if load document from cache or not.
+ *                               force = true, document gets only from chain.
+ *                               force = false, document can get from cache,
+ *                               if no document is in the cache, resolve it from chain.
+ * @param
+ *      callback                 [in] The function called with the result.
+ * @param
+ *      context                  [in] The context passed to the callback.
+ * @return
+ *      0 if the resolve is started, the callback is called exactly once;
+ *      -1 if an error occurred, the callback is not called.
+ */
+DID_API int DID_ResolveAsync(DID *did, bool force, DIDResolve_Callback *callback,
+        void *context);
+
 /**
  * \~English
  * Get all DID Documents from chain.
@@ -571,7 +663,10 @@ DID_API DIDBiography *DID_ResolveBiography(DID *did);
  *      did                      [in] The handle of DID.
  * @return
  *      If no error occurs, return the handle to DIDMetadata.
- *      Otherwise, return -1.
+ *      Otherwise, return NULL. A DID created by DID_New or DID_FromString
+ *      always has its own metadata. A DID embedded in a document or a
+ *      credential shares its owner's metadata, and returns NULL with
+ *      DIDERR_NOT_EXISTS when the owner has none, e.g. a controller.
  */
 DID_API DIDMetadata *DID_GetMetadata(DID *did);
 
@@ -950,6 +1045,10 @@ DID_API void DIDURL_Destroy(DIDURL *id);
  *      id                       [in] The handle of DIDURL.
  * @return
  *      If no error occurs, return the handle to CredentialMetadata. Otherwise, return NULL.
+ *      A DIDURL created by DIDURL_New or DIDURL_FromString always has its
+ *      own metadata. An id embedded in a credential or a document shares
+ *      its owner's metadata, and returns NULL with DIDERR_NOT_EXISTS when
+ *      the owner has none, e.g. a public key id.
  */
 DID_API CredentialMetadata *DIDURL_GetMetadata(DIDURL *id);
 
@@ -3735,6 +3834,33 @@ DID_API DIDStore* DIDStore_Open(const char *root);
  */
 DID_API void DIDStore_Close(DIDStore *store);
 
+/**
+ * \~English
+ * Unlock DIDStore for signing. The private keys used to sign in the unlock
+ * period are decrypted once and kept in memory, so the later signatures with
+ * the same storepass don't read or decrypt the key files again. The keys are
+ * wiped when the period expires or DIDStore is locked or closed.
+ *
+ * @param
+ *      store                 [in] The handle to DIDStore.
+ * @param
+ *      storepass             [in] Password for DIDStore.
+ * @param
+ *      ttl                   [in] The unlock period, in seconds.
+ * @return
+ *      0 on success, -1 if an error occurred.
+ */
+DID_API int DIDStore_Unlock(DIDStore *store, const char *storepass, long ttl);
+
+/**
+ * \~English
+ * Lock DIDStore and wipe all the private keys kept by DIDStore_Unlock().
+ *
+ * @param
+ *      store                 [in] The handle to DIDStore.
+ */
+DID_API void DIDStore_Lock(DIDStore *store);
+
 /**
  * \~English
  * Check if it has the specified root identity or not.
@@ -4221,6 +4347,34 @@ DID_API int DIDStore_ImportRootIdentity(DIDStore *store, const char *storepass,
 DID_API int DIDStore_ExportStore(DIDStore *store, const char *storepass,
         const char *zipfile, const char *password);
 
+/**
+ * \~English
+ * Export whole store information into zip file, the entries are generated by
+ * a pool of worker threads. The zip entries are in the same order whatever
+ * the count of workers: root identities first, then the DIDs, each sorted
+ * by id.
+ *
+ * @param
+ *      store                   [in] The handle to DIDStore.
+ * @param
+ *      storepass               [in] Password for DIDStore.
+ * @param
+ *      zipfile                 [in] Zip file to export.
+ * @param
+ *      password                [in] Password to encrypt.
+ * @param
+ *      workers                 [in] The count of worker threads, 0 for the default.
+ * @param
+ *      progress                [in] The progress callback, or NULL.
+ * @param
+ *      context                 [in] The application defined context data.
+ * @return
+ *      0 on success, -1 if an error occurred.
+ */
+DID_API int DIDStore_ExportStoreEx(DIDStore *store, const char *storepass,
+        const char *zipfile, const char *password, int workers,
+        DIDStore_ProgressCallback *progress, void *context);
+
 /**
  * \~English
  * Import zip file into new DIDStore.
@@ -4239,6 +4393,32 @@ DID_API int DIDStore_ExportStore(DIDStore *store, const char *storepass,
 DID_API int DIDStore_ImportStore(DIDStore *store, const char *storepass,
         const char *zipfile, const char *password);
 
+/**
+ * \~English
+ * Import zip file into new DIDStore. The root identities are imported first,
+ * then the DIDs are imported by a pool of worker threads.
+ *
+ * @param
+ *      store                   [in] The handle to DIDStore.
+ * @param
+ *      storepass               [in] Password for DIDStore.
+ * @param
+ *      zipfile                 [in] zip file to import.
+ * @param
+ *      password                [in] Password to encrypt.
+ * @param
+ *      workers                 [in] The count of worker threads, 0 for the default.
+ * @param
+ *      progress                [in] The progress callback, or NULL.
+ * @param
+ *      context                 [in] The application defined context data.
+ * @return
+ *      0 on success, -1 if an error occurred.
+ */
+DID_API int DIDStore_ImportStoreEx(DIDStore *store, const char *storepass,
+        const char *zipfile, const char *password, int workers,
+        DIDStore_ProgressCallback *progress, void *context);
+
 /******************************************************************************
  * Mnemonic
  *****************************************************************************/
@@ -4755,6 +4935,85 @@ DID_API const char *TransferTicket_GetProofSignature(TransferTicket *ticket, int
 /******************************************************************************
  * DIDBackend
  *****************************************************************************/
+/**
+ * \~English
+ * Create a backend which resolves with the default resolver.
+ *
+ * @param
+ *      createtransaction  [in] The method to create id transaction.
+ * @param
+ *      url                [in] The URL string.
+ *                         eg: support url string or "mainnet" or "testnet".
+ * @param
+ *      cachedir           [in] The directory for cache, which should not be
+ *                              shared with other backends.
+ * @return
+ *      If no error occurs, return the handle to DIDBackend. Otherwise, return NULL.
+ *      Free the handle by DIDBackend_Destroy.
+ */
+DID_API DIDBackend *DIDBackend_CreateDefault(CreateIdTransaction_Callback *createtransaction,
+        const char *url, const char *cachedir);
+
+/**
+ * \~English
+ * Create a backend which resolves with the given method.
+ *
+ * @param
+ *      createtransaction  [in] The method to create id transaction.
+ * @param
+ *      resolve           [in] The method to resolve.
+ * @param
+ *      cachedir          [in] The directory for cache, which should not be
+ *                             shared with other backends.
+ * @return
+ *      If no error occurs, return the handle to DIDBackend. Otherwise, return NULL.
+ *      Free the handle by DIDBackend_Destroy.
+ */
+DID_API DIDBackend *DIDBackend_Create(CreateIdTransaction_Callback *createtransaction,
+        Resolve_Callback *resolve, const char *cachedir);
+
+/**
+ * \~English
+ * Destroy a backend created by DIDBackend_Create or DIDBackend_CreateDefault.
+ * The backend must not be in use by any thread.
+ *
+ * @param
+ *      backend            [in] The handle to DIDBackend.
+ */
+DID_API void DIDBackend_Destroy(DIDBackend *backend);
+
+/**
+ * \~English
+ * Make the calling thread resolve, verify and publish with the given backend.
+ * All the other DIDBackend functions, and every api which resolves or publishes,
+ * work on the backend of the calling thread, which is the default backend
+ * until one is set.
+ *
+ * @param
+ *      backend            [in] The handle to DIDBackend, NULL to go back to
+ *                              the default backend.
+ * @return
+ *      The backend used by the thread before, NULL if it was the default one.
+ */
+DID_API DIDBackend *DIDBackend_Use(DIDBackend *backend);
+
+/**
+ * \~English
+ * Drive the resolves started by DID_ResolveAsync on the backend of the calling
+ * thread: send the queued requests, read the responses, and call the callbacks
+ * of the finished ones. Call it from the event loop, or from one thread with a
+ * negative timeout; the calls of different threads run one after another.
+ *
+ * @param
+ *      timeout            [in] The time in milliseconds to wait for the network
+ *                              when nothing is finished, 0 to return at once,
+ *                              negative to wait until something is finished.
+ * @return
+ *      The count of resolves still in progress, 0 when all are done;
+ *      -1 if an error occurred.
+ */
+DID_API int DIDBackend_Poll(int timeout);
+
 /**
  * \~English
  * Initialize DIDBackend by url.
@@ -4806,6 +5065,46 @@ DID_API bool DIDBackend_IsInitialized(void);
  */
 DID_API void DIDBackend_SetTTL(long ttl);
 
+/**
+ * \~English
+ * Set the size of the in-memory document cache which sits in front of the
+ * resolve cache directory. Resolved documents are kept there after validation,
+ * the least recently used ones are dropped once the size is exceeded, and the
+ * entries expire with the same ttl as the resolve cache.
+ *
+ * @param
+ *      size           [in] The maximum size of the memory cache in bytes,
+ *                          0 to disable the memory cache.
+ */
+DID_API void DIDBackend_SetMemoryCacheSize(size_t size);
+
+/**
+ * \~English
+ * Set whether the resolve results loaded from the cache directory are verified
+ * again. By default the signatures of a cached result which already passed the
+ * verification are not checked again, as long as the cached content is not
+ * changed; the expiration and deactivation are always checked.
+ *
+ * @param
+ *      verify         [in] true to verify the signatures of every cached result,
+ *                          false to skip the verified ones.
+ */
+DID_API void DIDBackend_SetVerifyOnLoad(bool verify);
+
+/**
+ * \~English
+ * Set the timeouts of the requests sent by the default resolver, which is
+ * initialized by DIDBackend_InitializeDefault.
+ *
+ * @param
+ *      connecttimeout [in] The timeout in milliseconds to connect to the
+ *                          resolver, 0 to use the default.
+ * @param
+ *      timeout        [in] The timeout in milliseconds of the whole request,
+ *                          0 means no timeout.
+ */
+DID_API void DIDBackend_SetResolveTimeout(long connecttimeout, long timeout);
+
 /**
  * \~English
  * User set DID Local Resolve handle in order to give which did document to verify.
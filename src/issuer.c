@@ -127,7 +127,7 @@ Credential *Issuer_Generate_Credential(Issuer *issuer, DID *owner,
         time_t expires, const char *storepass)
 {
     Credential *cred = NULL;
-    const char *data;
+    uint8_t digest[SHA256_BYTES];
     char signature[SIGNATURE_BYTES * 2];
     DIDDocument *doc = NULL;
     size_t i;
@@ -175,13 +175,11 @@ Credential *Issuer_Generate_Credential(Issuer *issuer, DID *owner,
     time(&cred->issuanceDate);
 
     //proof
-    data = Credential_ToJson_ForSign(cred, false, true);
-    if (!data)
+    if (Credential_Digest_ForSign(cred, digest) < 0)
         goto errorExit;
 
-    rc = DIDDocument_Sign(issuer->signer, &issuer->signkey, storepass, signature,
-            1, (unsigned char*)data, strlen(data));
-    free((void*)data);
+    rc = DIDDocument_SignDigest(issuer->signer, &issuer->signkey, storepass, signature,
+            digest, sizeof(digest));
     if (rc) {
         DIDError_Set(DIDERR_SIGN_ERROR, "Sign credential failed.");
         goto errorExit;
@@ -119,7 +119,7 @@ static JWT *parse_jwt(const char *token)
     JWT *jwt = NULL;
     char *claims, *header, *_token;
     const char *pos;
-    size_t len;
+    ssize_t len;
     int dot;
 
     assert(token && *token);
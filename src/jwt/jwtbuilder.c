@@ -72,7 +72,7 @@ JWTBuilder *JWTBuilder_Create(DID *issuer)
 {
     CHECK_ARG(!issuer, "No issuer to create jwtbuilder.", NULL);
 
-    if (!DIDMetadata_AttachedStore(&issuer->metadata)) {
+    if (!issuer->metadata || !DIDMetadata_AttachedStore(issuer->metadata)) {
         DIDError_Set(DIDERR_NO_ATTACHEDSTORE, "No attached store with issuer.");
         return NULL;
     }
@@ -84,7 +84,7 @@ JWTBuilder *JWTBuilder_Create(DID *issuer)
     }
 
     DID_Copy(&builder->issuer, issuer);
-    builder->doc = DIDStore_LoadDID(issuer->metadata.base.store, issuer);
+    builder->doc = DIDStore_LoadDID(issuer->metadata->base.store, issuer);
     if (!builder->doc) {
         DIDError_Set(DIDERR_NOT_EXISTS, "No issuer document in the store.");
         JWTBuilder_Destroy(builder);
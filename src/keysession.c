@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2019 - 2021 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+
+#include "ela_did.h"
+#include "diderror.h"
+#include "crypto.h"
+#include "HDkey.h"
+#include "did.h"
+#include "didurl.h"
+#include "keysession.h"
+
+#define SESSION_SALT_BYTES          16
+
+typedef struct UnlockedKey {
+    struct UnlockedKey *next;
+    char idstring[MAX_ID_SPECIFIC_STRING];
+    char fragment[MAX_FRAGMENT_LEN];
+    uint8_t privatekey[PRIVATEKEY_BYTES];
+} UnlockedKey;
+
+//The store and each signer in flight hold a reference, the keys are wiped
+//as soon as the store expires the session, or by the sweeper at the ttl.
+struct KeySession {
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    pthread_t sweeper;
+    bool sweeping;
+    int refs;
+    time_t expires;
+    uint8_t salt[SESSION_SALT_BYTES];
+    uint8_t password[SHA256_BYTES];
+    UnlockedKey *keys;
+};
+
+//Keep the decrypted keys out of the swap, it's the best effort.
+static void lock_memory(void *addr, size_t size)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    VirtualLock(addr, size);
+#else
+    mlock(addr, size);
+#endif
+}
+
+static void unlock_memory(void *addr, size_t size)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    VirtualUnlock(addr, size);
+#else
+    munlock(addr, size);
+#endif
+}
+
+static void unlockedkey_free(UnlockedKey *key)
+{
+    OPENSSL_cleanse(key, sizeof(UnlockedKey));
+    unlock_memory(key, sizeof(UnlockedKey));
+    free(key);
+}
+
+static int password_digest(uint8_t *digest, KeySession *session, const char *storepass)
+{
+    return sha256_digest(digest, 2, session->salt, sizeof(session->salt),
+            storepass, strlen(storepass)) < 0 ? -1 : 0;
+}
+
+static void wipe_keys(KeySession *session)
+{
+    UnlockedKey *key;
+
+    while (session->keys) {
+        key = session->keys;
+        session->keys = key->next;
+        unlockedkey_free(key);
+    }
+}
+
+//must be called with the session lock held.
+static void session_expire(KeySession *session)
+{
+    wipe_keys(session);
+    OPENSSL_cleanse(session->password, sizeof(session->password));
+    session->expires = 0;
+}
+
+//must be called with the session lock held.
+static bool session_isactive(KeySession *session, const char *storepass)
+{
+    uint8_t digest[SHA256_BYTES];
+
+    if (session->expires == 0)
+        return false;
+
+    if (time(NULL) >= session->expires) {
+        session_expire(session);
+        return false;
+    }
+
+    if (password_digest(digest, session, storepass) < 0)
+        return false;
+
+    return CRYPTO_memcmp(digest, session->password, sizeof(digest)) == 0;
+}
+
+//Wipes the keys when the ttl is up even if nobody touches the store.
+static void *sweeper_main(void *arg)
+{
+    KeySession *session = (KeySession*)arg;
+    struct timespec deadline;
+    int rc = 0;
+
+    pthread_mutex_lock(&session->lock);
+    deadline.tv_sec = session->expires;
+    deadline.tv_nsec = 0;
+    while (session->expires != 0 && rc != ETIMEDOUT)
+        rc = pthread_cond_timedwait(&session->wakeup, &session->lock, &deadline);
+
+    session_expire(session);
+    pthread_mutex_unlock(&session->lock);
+    return NULL;
+}
+
+static void stop_sweeper(KeySession *session)
+{
+    bool sweeping;
+
+    pthread_mutex_lock(&session->lock);
+    sweeping = session->sweeping;
+    session->sweeping = false;
+    session_expire(session);
+    pthread_cond_signal(&session->wakeup);
+    pthread_mutex_unlock(&session->lock);
+
+    if (sweeping)
+        pthread_join(session->sweeper, NULL);
+}
+
+static UnlockedKey *find_key(KeySession *session, DIDURL *id)
+{
+    UnlockedKey *key;
+
+    for (key = session->keys; key; key = key->next) {
+        if (!strcmp(key->idstring, id->did.idstring) && !strcmp(key->fragment, id->fragment))
+            return key;
+    }
+
+    return NULL;
+}
+
+KeySession *KeySession_Create(const char *storepass, long ttl)
+{
+    KeySession *session;
+
+    assert(storepass && *storepass);
+    assert(ttl > 0);
+
+    session = (KeySession*)calloc(1, sizeof(KeySession));
+    if (!session) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for key session failed.");
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&session->lock, NULL) != 0) {
+        DIDError_Set(DIDERR_UNKNOWN, "Initialize key session lock failed.");
+        free(session);
+        return NULL;
+    }
+
+    if (pthread_cond_init(&session->wakeup, NULL) != 0) {
+        DIDError_Set(DIDERR_UNKNOWN, "Initialize key session lock failed.");
+        pthread_mutex_destroy(&session->lock);
+        free(session);
+        return NULL;
+    }
+
+    if (RAND_bytes(session->salt, sizeof(session->salt)) != 1 ||
+            password_digest(session->password, session, storepass) < 0) {
+        DIDError_Set(DIDERR_CRYPTO_ERROR, "Initialize key session failed.");
+        KeySession_Destroy(session);
+        return NULL;
+    }
+
+    session->refs = 1;
+    session->expires = time(NULL) + ttl;
+
+    if (pthread_create(&session->sweeper, NULL, sweeper_main, session) != 0) {
+        DIDError_Set(DIDERR_UNKNOWN, "Start key session sweeper failed.");
+        KeySession_Destroy(session);
+        return NULL;
+    }
+
+    session->sweeping = true;
+    return session;
+}
+
+KeySession *KeySession_Ref(KeySession *session)
+{
+    assert(session);
+
+    pthread_mutex_lock(&session->lock);
+    session->refs++;
+    pthread_mutex_unlock(&session->lock);
+    return session;
+}
+
+void KeySession_Expire(KeySession *session)
+{
+    assert(session);
+
+    stop_sweeper(session);
+}
+
+void KeySession_Destroy(KeySession *session)
+{
+    bool last;
+
+    if (!session)
+        return;
+
+    //a session that failed to initialize has no reference yet.
+    pthread_mutex_lock(&session->lock);
+    last = --session->refs <= 0;
+    pthread_mutex_unlock(&session->lock);
+    if (!last)
+        return;
+
+    stop_sweeper(session);
+    pthread_cond_destroy(&session->wakeup);
+    pthread_mutex_destroy(&session->lock);
+    OPENSSL_cleanse(session, sizeof(KeySession));
+    free(session);
+}
+
+int KeySession_CountKeys(KeySession *session)
+{
+    UnlockedKey *key;
+    int count = 0;
+
+    assert(session);
+
+    pthread_mutex_lock(&session->lock);
+    for (key = session->keys; key; key = key->next)
+        count++;
+    pthread_mutex_unlock(&session->lock);
+
+    return count;
+}
+
+bool KeySession_IsActive(KeySession *session, const char *storepass)
+{
+    bool active;
+
+    assert(session);
+    assert(storepass);
+
+    pthread_mutex_lock(&session->lock);
+    active = session_isactive(session, storepass);
+    pthread_mutex_unlock(&session->lock);
+
+    return active;
+}
+
+int KeySession_Sign(KeySession *session, const char *storepass, DIDURL *id,
+        char *sig, uint8_t *digest, size_t size)
+{
+    uint8_t privatekey[PRIVATEKEY_BYTES];
+    UnlockedKey *key;
+    ssize_t rc;
+
+    assert(session);
+    assert(storepass);
+    assert(id);
+    assert(sig);
+    assert(digest);
+
+    pthread_mutex_lock(&session->lock);
+    if (!session_isactive(session, storepass)) {
+        pthread_mutex_unlock(&session->lock);
+        return 1;
+    }
+
+    key = find_key(session, id);
+    if (!key) {
+        pthread_mutex_unlock(&session->lock);
+        return 1;
+    }
+
+    memcpy(privatekey, key->privatekey, sizeof(privatekey));
+    pthread_mutex_unlock(&session->lock);
+
+    rc = ecdsa_sign_base64(sig, privatekey, digest, size);
+    OPENSSL_cleanse(privatekey, sizeof(privatekey));
+    if (rc == -1) {
+        DIDError_Set(DIDERR_CRYPTO_ERROR, "ECDSA sign failed.");
+        return -1;
+    }
+
+    return 0;
+}
+
+int KeySession_Put(KeySession *session, const char *storepass, DIDURL *id,
+        const uint8_t *privatekey)
+{
+    UnlockedKey *key;
+
+    assert(session);
+    assert(storepass);
+    assert(id);
+    assert(privatekey);
+
+    pthread_mutex_lock(&session->lock);
+    if (!session_isactive(session, storepass)) {
+        pthread_mutex_unlock(&session->lock);
+        return -1;
+    }
+
+    key = find_key(session, id);
+    if (!key) {
+        key = (UnlockedKey*)calloc(1, sizeof(UnlockedKey));
+        if (!key) {
+            pthread_mutex_unlock(&session->lock);
+            return -1;
+        }
+
+        lock_memory(key, sizeof(UnlockedKey));
+        strcpy(key->idstring, id->did.idstring);
+        strcpy(key->fragment, id->fragment);
+        key->next = session->keys;
+        session->keys = key;
+    }
+
+    memcpy(key->privatekey, privatekey, PRIVATEKEY_BYTES);
+    pthread_mutex_unlock(&session->lock);
+    return 0;
+}
+
+void KeySession_Remove(KeySession *session, DID *did, DIDURL *id)
+{
+    UnlockedKey **pp, *key;
+
+    assert(session);
+    assert(did || id);
+
+    if (id)
+        did = &id->did;
+
+    pthread_mutex_lock(&session->lock);
+    pp = &session->keys;
+    while (*pp) {
+        key = *pp;
+        if (!strcmp(key->idstring, did->idstring) &&
+                (!id || !strcmp(key->fragment, id->fragment))) {
+            *pp = key->next;
+            unlockedkey_free(key);
+        } else {
+            pp = &key->next;
+        }
+    }
+    pthread_mutex_unlock(&session->lock);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2019 - 2021 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef __KEYSESSION_H__
+#define __KEYSESSION_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ela_did.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct KeySession KeySession;
+
+KeySession *KeySession_Create(const char *storepass, long ttl);
+
+//Drops a reference, the last one frees the session.
+void KeySession_Destroy(KeySession *session);
+
+KeySession *KeySession_Ref(KeySession *session);
+
+//Wipes the keys at once, the references still held see an inactive session.
+void KeySession_Expire(KeySession *session);
+
+//Counts the keys held without expiring the session.
+int KeySession_CountKeys(KeySession *session);
+
+bool KeySession_IsActive(KeySession *session, const char *storepass);
+
+int KeySession_Sign(KeySession *session, const char *storepass, DIDURL *id,
+        char *sig, uint8_t *digest, size_t size);
+
+int KeySession_Put(KeySession *session, const char *storepass, DIDURL *id,
+        const uint8_t *privatekey);
+
+void KeySession_Remove(KeySession *session, DID *did, DIDURL *id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__KEYSESSION_H__
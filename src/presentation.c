@@ -472,6 +472,37 @@ static const char* presentation_tojson_forsign(Presentation *presentation, bool
     return DIDJG_Finish(gen);
 }
 
+static ssize_t presentation_digest_forsign(Presentation *presentation, const char *realm,
+        const char *nonce, uint8_t *digest)
+{
+    JsonDigest jd;
+    JsonGenerator *gen;
+    ssize_t rc;
+
+    assert(presentation);
+    assert(realm);
+    assert(nonce);
+    assert(digest);
+
+    gen = JsonDigest_Initialize(&jd);
+    if (!gen) {
+        DIDError_Set(DIDERR_CRYPTO_ERROR, "Json digest for presentation initialize failed.");
+        return -1;
+    }
+
+    if (presentation_tojson_internal(gen, presentation, false, true) < 0) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Serialize presentation to json failed.");
+        JsonDigest_Destroy(&jd);
+        return -1;
+    }
+
+    rc = JsonDigest_Finish(&jd, digest, 2, realm, strlen(realm), nonce, strlen(nonce));
+    if (rc < 0)
+        DIDError_Set(DIDERR_CRYPTO_ERROR, "Get presentation digest failed.");
+
+    return rc;
+}
+
 static int add_credentialarray_to_presentation(Presentation *presentation, int count, Credential **creds)
 {
     Credential **credentials = NULL, *cred;
@@ -521,7 +552,7 @@ static int seal_presentation(Presentation *presentation, DIDDocument *doc, DIDUR
         const char *storepass, const char *nonce, const char *realm)
 {
     DIDDocument *signerdoc;
-    const char *data;
+    uint8_t digest[SHA256_BYTES];
     char signature[SIGNATURE_BYTES * 2 + 16];
     int rc;
 
@@ -534,12 +565,10 @@ static int seal_presentation(Presentation *presentation, DIDDocument *doc, DIDUR
 
     time(&presentation->created);
 
-    data = presentation_tojson_forsign(presentation, false, true);
-    if (!data)
+    if (presentation_digest_forsign(presentation, realm, nonce, digest) < 0)
         return -1;
 
     if (!DIDDocument_IsAuthenticationKey(doc, signkey)) {
-        free((void*)data);
         DIDError_Set(DIDERR_INVALID_KEY, "Signkey isn't an authentication key.");
         return -1;
     }
@@ -554,11 +583,8 @@ static int seal_presentation(Presentation *presentation, DIDDocument *doc, DIDUR
         DIDMetadata_SetStore(&signerdoc->metadata, DIDMetadata_GetStore(&doc->metadata));
     }
 
-    rc = DIDDocument_Sign(signerdoc, signkey, storepass, signature, 3,
-            (unsigned char*)data, strlen(data),
-            (unsigned char*)realm, strlen(realm),
-            (unsigned char*)nonce, strlen(nonce));
-    free((void*)data);
+    rc = DIDDocument_SignDigest(signerdoc, signkey, storepass, signature,
+            digest, sizeof(digest));
     if (rc < 0) {
         DIDError_Set(DIDERR_SIGN_ERROR, "Sign presentation failed.");
         return -1;
@@ -944,11 +970,14 @@ const char *Presentation_GetRealm(Presentation *presentation)
 static int check_presentation(Presentation *presentation, bool validtype)
 {
     DIDDocument *doc = NULL;
+    VerifyBatch batch;
     int rc = 0, status, i, check;
-    const char *data;
+    uint8_t digest[SHA256_BYTES];
 
     assert(presentation);
 
+    memset(&batch, 0, sizeof(batch));
+
     doc = DID_Resolve(Presentation_GetHolder(presentation), &status, false);
     if (!doc) {
         DIDError_Set(DIDERR_DID_RESOLVE_ERROR, " * VP %s : holder %s %s.",
@@ -958,14 +987,14 @@ static int check_presentation(Presentation *presentation, bool validtype)
     }
 
     if (validtype) {
-        rc = DIDDocument_IsValid(doc);
+        rc = DIDDocument_CollectValid(doc, &batch);
         if (rc != 1) {
             DIDError_Set(DIDERR_NOT_VALID, " * VP %s : holder's document is invalid.",
                     DIDURLSTR(Presentation_GetId(presentation)));
             goto errorExit;
         }
     } else {
-        rc = DIDDocument_IsGenuine(doc);
+        rc = DIDDocument_CollectGenuine(doc, true, &batch);
         if (rc != 1) {
             DIDError_Set(DIDERR_NOT_GENUINE, " * VP %s : signer's document is not genuine.",
                     DIDURLSTR(Presentation_GetId(presentation)));
@@ -999,7 +1028,7 @@ static int check_presentation(Presentation *presentation, bool validtype)
             goto errorExit;
         }
         if (validtype) {
-            rc = Credential_IsValid(cred);
+            rc = Credential_CollectValid(cred, doc, &batch);
             if (rc != 1) {
                 DIDError_Set(DIDERR_NOT_VALID,
                         " * VP %s : credential %s doesn't match with signer.",
@@ -1007,7 +1036,7 @@ static int check_presentation(Presentation *presentation, bool validtype)
                 goto errorExit;
             }
         } else {
-            rc = Credential_IsGenuine(cred);
+            rc = Credential_CollectGenuine(cred, NULL, &batch);
             if (rc != 1) {
                 DIDError_Set(DIDERR_NOT_GENUINE, " * VP %s : credential %s isn't genuine.",
                         DIDURLSTR(Presentation_GetId(presentation)), DIDURLSTR(&cred->id));
@@ -1016,27 +1045,27 @@ static int check_presentation(Presentation *presentation, bool validtype)
         }
     }
 
-    data = presentation_tojson_forsign(presentation, false, true);
-    if (!data) {
+    if (presentation_digest_forsign(presentation, presentation->proof.realm,
+            presentation->proof.nonce, digest) < 0) {
         DIDError_Set(DIDERRCODE, " * VP %s : %s.",
                 DIDURLSTR(Presentation_GetId(presentation)), DIDERRMSG);
         goto errorExit;
     }
 
-    check = DIDDocument_Verify(doc, &presentation->proof.verificationMethod,
-            presentation->proof.signatureValue, 3, (unsigned char*)data, strlen(data),
-            presentation->proof.realm, strlen(presentation->proof.realm),
-            presentation->proof.nonce, strlen(presentation->proof.nonce));
-    free((void*)data);
-    if (check < 0) {
+    check = VerifyBatch_AddDigest(&batch, doc, &presentation->proof.verificationMethod,
+            presentation->proof.signatureValue, digest);
+    //the holder, the credentials and the presentation are verified in one batch.
+    if (check < 0 || VerifyBatch_Verify(&batch) < 0) {
         DIDError_Set(DIDERR_VERIFY_ERROR, " * VP %s : verify persentation failed.",
                 DIDURLSTR(Presentation_GetId(presentation)));
+        rc = 0;
         goto errorExit;
     }
 
     rc = 1;
 
 errorExit:
+    VerifyBatch_Destroy(&batch);
     DIDDocument_Destroy(doc);
     return rc;
 }
@@ -502,7 +502,7 @@ static DIDDocument *rootidentity_createdid(RootIdentity *rootidentity, int index
     DIDMetadata_SetIndex(&document->metadata, index);
     DIDMetadata_SetAlias(&document->metadata, alias);
     DIDMetadata_SetDeactivated(&document->metadata, false);
-    memcpy(&document->did.metadata, &document->metadata, sizeof(DIDMetadata));
+    document->did.metadata = &document->metadata;
 
     if (DIDStore_StoreDID(store, document) == -1) {
         DIDError_Set(DIDERR_DIDSTORE_ERROR, "Store document(%s) failed.", DIDSTR(&document->did));
@@ -613,10 +613,6 @@ DID *RootIdentity_GetDIDByIndex(RootIdentity *rootidentity, int index)
     HDKey_Wipe(derivedkey);
     return did;
 
-    DIDMetadata_SetRootIdentity(&did->metadata, rootidentity->id);
-    DIDMetadata_SetIndex(&did->metadata, index);
-    did->metadata.base.store = store;
-
     DIDERROR_FINALIZE();
 }
 
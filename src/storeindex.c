@@ -0,0 +1,1055 @@
+/*
+ * Copyright (c) 2019 - 2021 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_IO_H
+#include <io.h>
+#endif
+#include <jansson.h>
+
+#include "ela_did.h"
+#include "diderror.h"
+#include "common.h"
+#include "storeindex.h"
+
+#ifndef O_BINARY
+#define O_BINARY                    0
+#endif
+
+//Superseded records tolerated before the log is rewritten.
+#define INDEX_COMPACT_RECORDS       1024
+
+#define INDEX_STAMP_LEN             128
+
+//The per-did directories the entries mirror, named as in didstore.c.
+static const char *CREDENTIALS_DIR = "credentials";
+static const char *PRIVATEKEYS_DIR = "privatekeys";
+
+static const char *INDEX_TYPE = "did:elastos:store-index";
+static const int INDEX_VERSION = 1;
+
+//The index is an append-only log of JSON lines. Memory always holds the
+//replay of the file up to 'offset'; readers pick up new lines before use.
+//Each did entry keeps its credentials by fragment, and the fragments by
+//credential type for the selections. The header and every record carry
+//the stamp of the ids and roots directories after the write, a different
+//stamp means the store was changed behind the index. The did records also
+//carry the stamp of the did's credentials and privatekeys directories,
+//which the ids directory doesn't see change.
+struct StoreIndex {
+    pthread_mutex_t lock;
+    char path[PATH_MAX];
+    char tmppath[PATH_MAX];
+    char idsdir[PATH_MAX];
+    char rootsdir[PATH_MAX];
+
+    bool loaded;
+    char stamp[INDEX_STAMP_LEN];
+    size_t offset;
+    long long inode;
+    size_t records;
+    json_t *dids;
+    json_t *roots;
+
+    bool rebuilding;
+    bool failed;
+    int fd;
+    char stampeddid[INDEX_STAMP_LEN];
+};
+
+typedef struct Index_DID {
+    char *id;
+    char *alias;
+    bool haskeys;
+} Index_DID;
+
+static void index_reset(StoreIndex *index)
+{
+    json_object_clear(index->dids);
+    json_object_clear(index->roots);
+    index->loaded = false;
+    index->stamp[0] = 0;
+    index->offset = 0;
+    index->inode = 0;
+    index->records = 0;
+}
+
+static void dir_stamp(const char *path, char *stamp, size_t size)
+{
+    struct stat st;
+    long nsec = 0;
+
+    if (stat(path, &st) < 0) {
+        snprintf(stamp, size, "-");
+        return;
+    }
+
+#if defined(__linux__)
+    nsec = st.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    nsec = st.st_mtimespec.tv_nsec;
+#endif
+    //the link count moves with the sub-directories on most file systems.
+    snprintf(stamp, size, "%lld.%09ld:%ld", (long long)st.st_mtime, nsec,
+            (long)st.st_nlink);
+}
+
+static void index_stamp(StoreIndex *index, char *stamp, size_t size)
+{
+    char ids[INDEX_STAMP_LEN / 2], roots[INDEX_STAMP_LEN / 2];
+
+    dir_stamp(index->idsdir, ids, sizeof(ids));
+    dir_stamp(index->rootsdir, roots, sizeof(roots));
+    snprintf(stamp, size, "%s,%s", ids, roots);
+}
+
+static void did_stamp(StoreIndex *index, const char *did, char *stamp, size_t size)
+{
+    char path[PATH_MAX], credentials[INDEX_STAMP_LEN / 2], privatekeys[INDEX_STAMP_LEN / 2];
+
+    snprintf(path, sizeof(path), "%s%s%s%s%s", index->idsdir, PATH_SEP, did,
+            PATH_SEP, CREDENTIALS_DIR);
+    dir_stamp(path, credentials, sizeof(credentials));
+    snprintf(path, sizeof(path), "%s%s%s%s%s", index->idsdir, PATH_SEP, did,
+            PATH_SEP, PRIVATEKEYS_DIR);
+    dir_stamp(path, privatekeys, sizeof(privatekeys));
+    snprintf(stamp, size, "%s,%s", credentials, privatekeys);
+}
+
+//A did missing from the index is covered by the stamp of the ids directory.
+static bool did_fresh(StoreIndex *index, const char *did, json_t *entry)
+{
+    char stamp[INDEX_STAMP_LEN];
+    const char *recorded;
+
+    if (!entry)
+        return true;
+
+    recorded = json_string_value(json_object_get(entry, "subdirs"));
+    if (!recorded)
+        return false;
+
+    did_stamp(index, did, stamp, sizeof(stamp));
+    return strcmp(stamp, recorded) == 0;
+}
+
+static void index_setstamp(StoreIndex *index, json_t *record)
+{
+    const char *stamp;
+
+    stamp = json_string_value(json_object_get(record, "dirs"));
+    if (stamp && strlen(stamp) < sizeof(index->stamp))
+        strcpy(index->stamp, stamp);
+}
+
+static void index_invalidate(StoreIndex *index)
+{
+    if (index->rebuilding)
+        index->failed = true;
+    else
+        delete_file(index->path);
+
+    index_reset(index);
+}
+
+static int write_record(int fd, json_t *record)
+{
+    char *line;
+    size_t len, written = 0;
+    ssize_t rc;
+
+    len = json_dumpb(record, NULL, 0, JSON_COMPACT);
+    if (!len)
+        return -1;
+
+    line = (char*)malloc(len + 1);
+    if (!line)
+        return -1;
+
+    json_dumpb(record, line, len, JSON_COMPACT);
+    line[len++] = '\n';
+
+    while (written < len) {
+        rc = write(fd, line + written, len - written);
+        if (rc <= 0)
+            break;
+        written += rc;
+    }
+
+    free(line);
+    return written == len ? 0 : -1;
+}
+
+static json_t *index_did(StoreIndex *index, const char *id)
+{
+    json_t *entry;
+
+    entry = json_object_get(index->dids, id);
+    if (entry)
+        return entry;
+
+    entry = json_pack("{s:{},s:{}}", "credentials", "types");
+    if (!entry || json_object_set_new(index->dids, id, entry) < 0)
+        return NULL;
+
+    return entry;
+}
+
+static int index_update(json_t *entry, json_t *record, const char *key)
+{
+    json_t *value;
+
+    value = json_object_get(record, key);
+    if (!value)
+        return 0;
+
+    if (!json_is_null(value))
+        return json_object_set(entry, key, value);
+
+    json_object_del(entry, key);
+    return 0;
+}
+
+//Add (or remove) the credential fragment under each of its types.
+static int index_types(json_t *entry, const char *fragment, json_t *credential,
+        bool add)
+{
+    json_t *types, *fragments, *value;
+    const char *type;
+    size_t i;
+
+    types = json_object_get(entry, "types");
+    json_array_foreach(json_object_get(credential, "types"), i, value) {
+        type = json_string_value(value);
+        if (!type)
+            continue;
+
+        fragments = json_object_get(types, type);
+        if (!add) {
+            json_object_del(fragments, fragment);
+            if (json_object_size(fragments) == 0)
+                json_object_del(types, type);
+            continue;
+        }
+
+        if (!fragments) {
+            fragments = json_object();
+            if (!fragments || json_object_set_new(types, type, fragments) < 0)
+                return -1;
+        }
+
+        if (json_object_set_new(fragments, fragment, json_true()) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int index_apply(StoreIndex *index, json_t *record)
+{
+    json_t *entry, *credentials, *credential;
+    const char *id, *fragment;
+    bool removed;
+
+    index_setstamp(index, record);
+    removed = json_is_true(json_object_get(record, "removed"));
+
+    id = json_string_value(json_object_get(record, "rootidentity"));
+    if (id) {
+        if (!removed)
+            return json_object_set_new(index->roots, id, json_true());
+
+        json_object_del(index->roots, id);
+        return 0;
+    }
+
+    id = json_string_value(json_object_get(record, "did"));
+    if (!id)
+        return -1;
+
+    fragment = json_string_value(json_object_get(record, "credential"));
+    if (removed) {
+        entry = json_object_get(index->dids, id);
+        if (!fragment) {
+            json_object_del(index->dids, id);
+        } else if (entry) {
+            credentials = json_object_get(entry, "credentials");
+            credential = json_object_get(credentials, fragment);
+            if (credential) {
+                index_types(entry, fragment, credential, false);
+                json_object_del(credentials, fragment);
+            }
+        }
+        return 0;
+    }
+
+    entry = index_did(index, id);
+    if (!entry || index_update(entry, record, "subdirs") < 0)
+        return -1;
+
+    if (!fragment)
+        return index_update(entry, record, "alias") < 0 ||
+                index_update(entry, record, "keys") < 0 ? -1 : 0;
+
+    credentials = json_object_get(entry, "credentials");
+    credential = json_object_get(credentials, fragment);
+    if (!credential) {
+        credential = json_object();
+        if (!credential || json_object_set_new(credentials, fragment, credential) < 0)
+            return -1;
+    }
+
+    if (index_update(credential, record, "alias") < 0)
+        return -1;
+
+    if (!json_object_get(record, "types"))
+        return 0;
+
+    index_types(entry, fragment, credential, false);
+    if (index_update(credential, record, "types") < 0)
+        return -1;
+
+    return index_types(entry, fragment, credential, true);
+}
+
+static int index_header(StoreIndex *index, json_t *record)
+{
+    const char *type;
+
+    type = json_string_value(json_object_get(record, "type"));
+    if (!type || strcmp(type, INDEX_TYPE))
+        return -1;
+
+    if (json_integer_value(json_object_get(record, "version")) != INDEX_VERSION)
+        return -1;
+
+    index_setstamp(index, record);
+    return 0;
+}
+
+static json_t *header_record(const char *stamp)
+{
+    return json_pack("{s:s,s:i,s:s}", "type", INDEX_TYPE, "version", INDEX_VERSION,
+            "dirs", stamp);
+}
+
+static int index_dump(StoreIndex *index, int fd)
+{
+    json_t *record, *entry, *credentials, *credential, *value;
+    const char *id, *fragment;
+
+    record = header_record(index->stamp);
+    if (!record || write_record(fd, record) < 0)
+        goto errorExit;
+    json_decref(record);
+
+    json_object_foreach(index->roots, id, value) {
+        record = json_pack("{s:s}", "rootidentity", id);
+        if (!record || write_record(fd, record) < 0)
+            goto errorExit;
+        json_decref(record);
+    }
+
+    json_object_foreach(index->dids, id, entry) {
+        record = json_copy(entry);
+        if (!record || json_object_del(record, "credentials") < 0 ||
+                json_object_del(record, "types") < 0 ||
+                json_object_set_new(record, "did", json_string(id)) < 0 ||
+                write_record(fd, record) < 0)
+            goto errorExit;
+        json_decref(record);
+
+        credentials = json_object_get(entry, "credentials");
+        json_object_foreach(credentials, fragment, credential) {
+            record = json_copy(credential);
+            if (!record || json_object_set_new(record, "did", json_string(id)) < 0 ||
+                    json_object_set_new(record, "credential", json_string(fragment)) < 0 ||
+                    write_record(fd, record) < 0)
+                goto errorExit;
+            json_decref(record);
+        }
+    }
+
+    return 0;
+
+errorExit:
+    json_decref(record);
+    return -1;
+}
+
+static size_t index_live(StoreIndex *index)
+{
+    json_t *entry;
+    const char *id;
+    size_t live;
+
+    live = json_object_size(index->roots);
+    json_object_foreach(index->dids, id, entry)
+        live += 1 + json_object_size(json_object_get(entry, "credentials"));
+
+    return live;
+}
+
+//Rewrite the log with one record per live entry.
+static void index_compact(StoreIndex *index)
+{
+    struct stat st;
+    int fd, rc;
+
+    fd = open(index->tmppath, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+        return;
+
+    rc = index_dump(index, fd);
+    close(fd);
+
+    if (rc < 0 || replace_file(index->tmppath, index->path) < 0) {
+        delete_file(index->tmppath);
+        return;
+    }
+
+    if (stat(index->path, &st) < 0) {
+        index_reset(index);
+        return;
+    }
+
+    index->offset = st.st_size;
+    index->inode = st.st_ino;
+    index->records = index_live(index);
+}
+
+//Replay the lines appended since the last refresh. Returns -1 if the index
+//file is missing, damaged or older than the store directories. Only the
+//entry of did is checked against its own directories, all of them if NULL.
+static int index_refresh(StoreIndex *index, const char *did)
+{
+    struct stat st;
+    json_t *record, *entry;
+    const char *id;
+    char *data = NULL, *line, *end, stamp[INDEX_STAMP_LEN];
+    size_t size, len = 0;
+    ssize_t rc;
+    int fd;
+
+    fd = open(index->path, O_RDONLY | O_BINARY);
+    if (fd < 0)
+        goto errorExit;
+
+    if (fstat(fd, &st) < 0)
+        goto errorExit;
+
+    if (index->loaded && ((size_t)st.st_size < index->offset || (long long)st.st_ino != index->inode))
+        index_reset(index);
+
+    if (index->loaded && (size_t)st.st_size == index->offset) {
+        close(fd);
+        fd = -1;
+        goto checkStamp;
+    }
+
+    size = st.st_size - index->offset;
+    data = (char*)malloc(size + 1);
+    if (!data || lseek(fd, index->offset, SEEK_SET) < 0)
+        goto errorExit;
+
+    while (len < size) {
+        rc = read(fd, data + len, size - len);
+        if (rc <= 0)
+            break;
+        len += rc;
+    }
+    close(fd);
+    fd = -1;
+    data[len] = 0;
+
+    //a trailing partial line is left for the next refresh
+    line = data;
+    while ((end = memchr(line, '\n', data + len - line)) != NULL) {
+        *end = 0;
+        if (*line) {
+            record = json_loads(line, 0, NULL);
+            if (!record)
+                goto errorExit;
+
+            rc = index->loaded ? index_apply(index, record) : index_header(index, record);
+            json_decref(record);
+            if (rc < 0)
+                goto errorExit;
+
+            if (index->loaded)
+                index->records++;
+            index->loaded = true;
+        }
+        line = end + 1;
+    }
+
+    index->offset += line - data;
+    index->inode = st.st_ino;
+    free(data);
+
+    if (!index->loaded)
+        goto errorExit;
+
+checkStamp:
+    index_stamp(index, stamp, sizeof(stamp));
+    if (strcmp(stamp, index->stamp))
+        goto errorExit;
+
+    if (did) {
+        if (!did_fresh(index, did, json_object_get(index->dids, did)))
+            goto errorExit;
+    } else {
+        json_object_foreach(index->dids, id, entry) {
+            if (!did_fresh(index, id, entry))
+                goto errorExit;
+        }
+    }
+
+    if (index->records > 2 * (json_object_size(index->dids) + json_object_size(index->roots)) + INDEX_COMPACT_RECORDS &&
+            index->records > 2 * index_live(index) + INDEX_COMPACT_RECORDS)
+        index_compact(index);
+
+    return 0;
+
+errorExit:
+    if (fd >= 0)
+        close(fd);
+    free(data);
+    index_reset(index);
+    return -1;
+}
+
+//Append one record, or hand it to the rebuild in progress. A missing index
+//is left alone: the next reader rebuilds it from the store.
+static void index_put(StoreIndex *index, json_t *record)
+{
+    char stamp[INDEX_STAMP_LEN];
+    const char *did = NULL;
+    int fd, rc;
+
+    pthread_mutex_lock(&index->lock);
+
+    //a removed did has no directories left to stamp.
+    if (record && (json_object_get(record, "credential") ||
+            !json_is_true(json_object_get(record, "removed"))))
+        did = json_string_value(json_object_get(record, "did"));
+
+    if (!record) {
+        index_invalidate(index);
+    } else if (index->rebuilding) {
+        //the rebuild keeps the stamps taken before the directories were read:
+        //the first record of a did comes before its directories are listed.
+        if (did && strcmp(did, index->stampeddid)) {
+            did_stamp(index, did, stamp, sizeof(stamp));
+            if (strlen(did) < sizeof(index->stampeddid))
+                strcpy(index->stampeddid, did);
+            if (json_object_set_new(record, "subdirs", json_string(stamp)) < 0)
+                index->failed = true;
+        }
+
+        if (write_record(index->fd, record) < 0)
+            index->failed = true;
+    } else {
+        //the store changed the directories before the write is recorded.
+        index_stamp(index, stamp, sizeof(stamp));
+        if (json_object_set_new(record, "dirs", json_string(stamp)) < 0) {
+            index_invalidate(index);
+            goto exit;
+        }
+
+        if (did) {
+            did_stamp(index, did, stamp, sizeof(stamp));
+            if (json_object_set_new(record, "subdirs", json_string(stamp)) < 0) {
+                index_invalidate(index);
+                goto exit;
+            }
+        }
+
+        fd = open(index->path, O_WRONLY | O_APPEND | O_BINARY);
+        if (fd >= 0) {
+            rc = write_record(fd, record);
+            close(fd);
+            if (rc < 0)
+                index_invalidate(index);
+        } else if (errno != ENOENT) {
+            index_invalidate(index);
+        }
+    }
+
+exit:
+    pthread_mutex_unlock(&index->lock);
+    json_decref(record);
+}
+
+StoreIndex *StoreIndex_Open(const char *path, const char *idsdir, const char *rootsdir)
+{
+    pthread_mutexattr_t attr;
+    StoreIndex *index;
+    int rc;
+
+    assert(path && *path);
+    assert(idsdir && *idsdir);
+    assert(rootsdir && *rootsdir);
+
+    if (strlen(path) + 4 >= PATH_MAX || strlen(idsdir) >= PATH_MAX ||
+            strlen(rootsdir) >= PATH_MAX) {
+        DIDError_Set(DIDERR_INVALID_ARGS, "The store index path is too long.");
+        return NULL;
+    }
+
+    index = (StoreIndex*)calloc(1, sizeof(StoreIndex));
+    if (!index) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for store index failed.");
+        return NULL;
+    }
+
+    strcpy(index->path, path);
+    sprintf(index->tmppath, "%s.tmp", path);
+    strcpy(index->idsdir, idsdir);
+    strcpy(index->rootsdir, rootsdir);
+    index->fd = -1;
+
+    index->dids = json_object();
+    index->roots = json_object();
+    if (!index->dids || !index->roots) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Create store index failed.");
+        goto errorExit;
+    }
+
+    //the rebuilding thread keeps the lock while it puts entries
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    rc = pthread_mutex_init(&index->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (rc != 0) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Initialize store index lock failed.");
+        goto errorExit;
+    }
+
+    return index;
+
+errorExit:
+    json_decref(index->dids);
+    json_decref(index->roots);
+    free(index);
+    return NULL;
+}
+
+void StoreIndex_Close(StoreIndex *index)
+{
+    if (!index)
+        return;
+
+    if (index->rebuilding)
+        StoreIndex_EndRebuild(index, false);
+
+    pthread_mutex_destroy(&index->lock);
+    json_decref(index->dids);
+    json_decref(index->roots);
+    free(index);
+}
+
+int StoreIndex_BeginRebuild(StoreIndex *index, const char *did)
+{
+    char stamp[INDEX_STAMP_LEN];
+    json_t *header;
+    int rc;
+
+    assert(index);
+
+    pthread_mutex_lock(&index->lock);
+
+    if (index_refresh(index, did) == 0) {
+        pthread_mutex_unlock(&index->lock);
+        return 0;
+    }
+
+    index->fd = open(index->tmppath, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, S_IRUSR | S_IWUSR);
+    if (index->fd < 0) {
+        DIDError_Set(DIDERR_IO_ERROR, "Create store index failed.");
+        pthread_mutex_unlock(&index->lock);
+        return -1;
+    }
+
+    //a change while the directories are read shows up in the next refresh.
+    index_stamp(index, stamp, sizeof(stamp));
+    header = header_record(stamp);
+    rc = header ? write_record(index->fd, header) : -1;
+    json_decref(header);
+    if (rc < 0) {
+        DIDError_Set(DIDERR_IO_ERROR, "Write store index failed.");
+        close(index->fd);
+        index->fd = -1;
+        delete_file(index->tmppath);
+        pthread_mutex_unlock(&index->lock);
+        return -1;
+    }
+
+    index->rebuilding = true;
+    index->failed = false;
+    index->stampeddid[0] = 0;
+    return 1;
+}
+
+int StoreIndex_EndRebuild(StoreIndex *index, bool commit)
+{
+    int rc = 0;
+
+    assert(index);
+    assert(index->rebuilding);
+
+    close(index->fd);
+    index->fd = -1;
+    index->rebuilding = false;
+
+    if (!commit || index->failed || replace_file(index->tmppath, index->path) < 0) {
+        delete_file(index->tmppath);
+        if (commit) {
+            DIDError_Set(DIDERR_IO_ERROR, "Write store index failed.");
+            rc = -1;
+        }
+    }
+
+    index_reset(index);
+    pthread_mutex_unlock(&index->lock);
+    return rc;
+}
+
+void StoreIndex_SetDIDAlias(StoreIndex *index, const char *did, const char *alias)
+{
+    assert(did);
+
+    index_put(index, json_pack("{s:s,s:s?}", "did", did, "alias", alias));
+}
+
+void StoreIndex_SetDIDKeys(StoreIndex *index, const char *did, bool haskeys)
+{
+    assert(did);
+
+    index_put(index, json_pack("{s:s,s:b}", "did", did, "keys", haskeys));
+}
+
+void StoreIndex_RemoveDID(StoreIndex *index, const char *did)
+{
+    assert(did);
+
+    index_put(index, json_pack("{s:s,s:b}", "did", did, "removed", true));
+}
+
+void StoreIndex_PutCredential(StoreIndex *index, const char *did,
+        const char *fragment, const char **types, size_t size)
+{
+    json_t *record, *array;
+    size_t i;
+
+    assert(did);
+    assert(fragment);
+
+    array = json_array();
+    for (i = 0; array && i < size; i++) {
+        if (types[i] && json_array_append_new(array, json_string(types[i])) < 0) {
+            json_decref(array);
+            array = NULL;
+        }
+    }
+
+    record = array ? json_pack("{s:s,s:s,s:o}", "did", did, "credential", fragment,
+            "types", array) : NULL;
+    index_put(index, record);
+}
+
+void StoreIndex_SetCredentialAlias(StoreIndex *index, const char *did,
+        const char *fragment, const char *alias)
+{
+    assert(did);
+    assert(fragment);
+
+    index_put(index, json_pack("{s:s,s:s,s:s?}", "did", did, "credential", fragment,
+            "alias", alias));
+}
+
+void StoreIndex_RemoveCredential(StoreIndex *index, const char *did,
+        const char *fragment)
+{
+    assert(did);
+    assert(fragment);
+
+    index_put(index, json_pack("{s:s,s:s,s:b}", "did", did, "credential", fragment,
+            "removed", true));
+}
+
+void StoreIndex_PutRootIdentity(StoreIndex *index, const char *id)
+{
+    assert(id);
+
+    index_put(index, json_pack("{s:s}", "rootidentity", id));
+}
+
+void StoreIndex_RemoveRootIdentity(StoreIndex *index, const char *id)
+{
+    assert(id);
+
+    index_put(index, json_pack("{s:s,s:b}", "rootidentity", id, "removed", true));
+}
+
+static void free_strings(char **strings, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        free(strings[i]);
+
+    free(strings);
+}
+
+//The listings copy the entries under the lock and run the callbacks without
+//it, so a callback may write to the store. As with list_dir(), a negative
+//callback result stops the listing, and the callback is called with NULL at
+//the end of a complete listing.
+int StoreIndex_ListDIDs(StoreIndex *index, StoreIndex_DIDsCallback *callback,
+        void *context)
+{
+    Index_DID *dids;
+    json_t *entry, *value;
+    const char *id;
+    size_t size, i = 0, j;
+    int rc = 0;
+
+    assert(index);
+    assert(callback);
+
+    pthread_mutex_lock(&index->lock);
+
+    if (index_refresh(index, NULL) < 0) {
+        pthread_mutex_unlock(&index->lock);
+        DIDError_Set(DIDERR_DIDSTORE_ERROR, "The store index is unavailable.");
+        return -1;
+    }
+
+    size = json_object_size(index->dids);
+    dids = (Index_DID*)calloc(size + 1, sizeof(Index_DID));
+    if (!dids) {
+        pthread_mutex_unlock(&index->lock);
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for dids failed.");
+        return -1;
+    }
+
+    json_object_foreach(index->dids, id, entry) {
+        value = json_object_get(entry, "alias");
+        dids[i].id = strdup(id);
+        dids[i].alias = json_is_string(value) ? strdup(json_string_value(value)) : NULL;
+        dids[i].haskeys = json_is_true(json_object_get(entry, "keys"));
+        if (!dids[i].id || (json_is_string(value) && !dids[i].alias)) {
+            rc = -1;
+            break;
+        }
+        i++;
+    }
+
+    pthread_mutex_unlock(&index->lock);
+
+    if (rc < 0) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Copy dids from store index failed.");
+    } else {
+        for (j = 0; j < i && rc >= 0; j++)
+            rc = callback(dids[j].id, dids[j].alias, dids[j].haskeys, context);
+
+        if (!rc)
+            callback(NULL, NULL, false, context);
+    }
+
+    for (j = 0; j < size; j++) {
+        free(dids[j].id);
+        free(dids[j].alias);
+    }
+    free(dids);
+    return rc;
+}
+
+static int list_credentials(StoreIndex *index, const char *did, const char *type,
+        StoreIndex_CredentialsCallback *callback, void *context)
+{
+    json_t *entry, *credentials, *fragments, *value, *alias;
+    const char *fragment;
+    char **strings;
+    size_t size, i = 0, j;
+    int rc = 0;
+
+    pthread_mutex_lock(&index->lock);
+
+    if (index_refresh(index, did) < 0) {
+        pthread_mutex_unlock(&index->lock);
+        DIDError_Set(DIDERR_DIDSTORE_ERROR, "The store index is unavailable.");
+        return -1;
+    }
+
+    entry = json_object_get(index->dids, did);
+    credentials = json_object_get(entry, "credentials");
+    fragments = type ? json_object_get(json_object_get(entry, "types"), type) : credentials;
+
+    //fragment and alias pairs
+    size = json_object_size(fragments);
+    strings = (char**)calloc(2 * size + 1, sizeof(char*));
+    if (!strings) {
+        pthread_mutex_unlock(&index->lock);
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for credentials failed.");
+        return -1;
+    }
+
+    json_object_foreach(fragments, fragment, value) {
+        alias = json_object_get(json_object_get(credentials, fragment), "alias");
+        strings[i] = strdup(fragment);
+        strings[i + 1] = json_is_string(alias) ? strdup(json_string_value(alias)) : NULL;
+        if (!strings[i] || (json_is_string(alias) && !strings[i + 1])) {
+            rc = -1;
+            break;
+        }
+        i += 2;
+    }
+
+    pthread_mutex_unlock(&index->lock);
+
+    if (rc < 0) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Copy credentials from store index failed.");
+    } else {
+        for (j = 0; j < i && rc >= 0; j += 2)
+            rc = callback(strings[j], strings[j + 1], context);
+
+        if (!rc)
+            callback(NULL, NULL, context);
+    }
+
+    free_strings(strings, 2 * size);
+    return rc;
+}
+
+int StoreIndex_ListCredentials(StoreIndex *index, const char *did,
+        StoreIndex_CredentialsCallback *callback, void *context)
+{
+    assert(index);
+    assert(did);
+    assert(callback);
+
+    return list_credentials(index, did, NULL, callback, context);
+}
+
+int StoreIndex_HasCredentialType(StoreIndex *index, const char *did,
+        const char *fragment, const char *type)
+{
+    json_t *fragments;
+    int rc;
+
+    assert(index);
+    assert(did);
+    assert(fragment);
+    assert(type);
+
+    pthread_mutex_lock(&index->lock);
+
+    if (index_refresh(index, did) < 0) {
+        pthread_mutex_unlock(&index->lock);
+        DIDError_Set(DIDERR_DIDSTORE_ERROR, "The store index is unavailable.");
+        return -1;
+    }
+
+    fragments = json_object_get(json_object_get(json_object_get(index->dids, did), "types"), type);
+    rc = json_object_get(fragments, fragment) ? 1 : 0;
+
+    pthread_mutex_unlock(&index->lock);
+    return rc;
+}
+
+int StoreIndex_SelectCredentials(StoreIndex *index, const char *did, const char *type,
+        StoreIndex_CredentialsCallback *callback, void *context)
+{
+    assert(index);
+    assert(did);
+    assert(type);
+    assert(callback);
+
+    return list_credentials(index, did, type, callback, context);
+}
+
+int StoreIndex_ListRootIdentities(StoreIndex *index,
+        StoreIndex_RootIdentitiesCallback *callback, void *context)
+{
+    json_t *value;
+    const char *id;
+    char **ids;
+    size_t size, i = 0, j;
+    int rc = 0;
+
+    assert(index);
+    assert(callback);
+
+    pthread_mutex_lock(&index->lock);
+
+    if (index_refresh(index, NULL) < 0) {
+        pthread_mutex_unlock(&index->lock);
+        DIDError_Set(DIDERR_DIDSTORE_ERROR, "The store index is unavailable.");
+        return -1;
+    }
+
+    size = json_object_size(index->roots);
+    ids = (char**)calloc(size + 1, sizeof(char*));
+    if (!ids) {
+        pthread_mutex_unlock(&index->lock);
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Malloc buffer for rootidentities failed.");
+        return -1;
+    }
+
+    json_object_foreach(index->roots, id, value) {
+        ids[i] = strdup(id);
+        if (!ids[i]) {
+            rc = -1;
+            break;
+        }
+        i++;
+    }
+
+    pthread_mutex_unlock(&index->lock);
+
+    if (rc < 0) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Copy rootidentities from store index failed.");
+    } else {
+        for (j = 0; j < i && rc >= 0; j++)
+            rc = callback(ids[j], context);
+
+        if (!rc)
+            callback(NULL, context);
+    }
+
+    free_strings(ids, size);
+    return rc;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2019 - 2021 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef __STOREINDEX_H__
+#define __STOREINDEX_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct StoreIndex StoreIndex;
+
+typedef int StoreIndex_DIDsCallback(const char *did, const char *alias,
+        bool haskeys, void *context);
+
+typedef int StoreIndex_CredentialsCallback(const char *fragment,
+        const char *alias, void *context);
+
+typedef int StoreIndex_RootIdentitiesCallback(const char *id, void *context);
+
+//The index file lives at path, idsdir and rootsdir are the directories it
+//mirrors.
+StoreIndex *StoreIndex_Open(const char *path, const char *idsdir, const char *rootsdir);
+
+void StoreIndex_Close(StoreIndex *index);
+
+//Returns 1 with the index locked when the index file is missing, damaged or
+//older than the directories: the caller puts every entry then calls
+//StoreIndex_EndRebuild. Returns 0 when the index is usable, -1 on error.
+//The credentials and privatekeys directories are checked for did only, or
+//for every did when it's NULL.
+int StoreIndex_BeginRebuild(StoreIndex *index, const char *did);
+
+int StoreIndex_EndRebuild(StoreIndex *index, bool commit);
+
+//The index is a cache of the store layout: a write that can't be recorded
+//drops the index file, and the next listing rebuilds it.
+
+void StoreIndex_SetDIDAlias(StoreIndex *index, const char *did, const char *alias);
+
+void StoreIndex_SetDIDKeys(StoreIndex *index, const char *did, bool haskeys);
+
+void StoreIndex_RemoveDID(StoreIndex *index, const char *did);
+
+void StoreIndex_PutCredential(StoreIndex *index, const char *did,
+        const char *fragment, const char **types, size_t size);
+
+void StoreIndex_SetCredentialAlias(StoreIndex *index, const char *did,
+        const char *fragment, const char *alias);
+
+void StoreIndex_RemoveCredential(StoreIndex *index, const char *did,
+        const char *fragment);
+
+void StoreIndex_PutRootIdentity(StoreIndex *index, const char *id);
+
+void StoreIndex_RemoveRootIdentity(StoreIndex *index, const char *id);
+
+int StoreIndex_ListDIDs(StoreIndex *index, StoreIndex_DIDsCallback *callback,
+        void *context);
+
+int StoreIndex_ListCredentials(StoreIndex *index, const char *did,
+        StoreIndex_CredentialsCallback *callback, void *context);
+
+//Returns 1 if the credential has the type, 0 if not, -1 on error.
+int StoreIndex_HasCredentialType(StoreIndex *index, const char *did,
+        const char *fragment, const char *type);
+
+int StoreIndex_SelectCredentials(StoreIndex *index, const char *did, const char *type,
+        StoreIndex_CredentialsCallback *callback, void *context);
+
+int StoreIndex_ListRootIdentities(StoreIndex *index,
+        StoreIndex_RootIdentitiesCallback *callback, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__STOREINDEX_H__
@@ -141,6 +141,34 @@ static const char *ticket_tojson_forsign(TransferTicket *ticket, bool forsign)
     return DIDJG_Finish(gen);
 }
 
+static ssize_t ticket_digest_forsign(TransferTicket *ticket, uint8_t *digest)
+{
+    JsonDigest jd;
+    JsonGenerator *gen;
+    ssize_t rc;
+
+    assert(ticket);
+    assert(digest);
+
+    gen = JsonDigest_Initialize(&jd);
+    if (!gen) {
+        DIDError_Set(DIDERR_CRYPTO_ERROR, "Json digest for ticket initialize failed.");
+        return -1;
+    }
+
+    if (ticket_tojson_internal(gen, ticket, true) < 0) {
+        DIDError_Set(DIDERR_OUT_OF_MEMORY, "Serialize ticket to json failed.");
+        JsonDigest_Destroy(&jd);
+        return -1;
+    }
+
+    rc = JsonDigest_Finish(&jd, digest, 0);
+    if (rc < 0)
+        DIDError_Set(DIDERR_CRYPTO_ERROR, "Get ticket digest failed.");
+
+    return rc;
+}
+
 TransferTicket *TransferTicket_Construct(DID *owner, DID *to)
 {
     TransferTicket *ticket = NULL;
@@ -232,7 +260,7 @@ static int ticket_addproof(TransferTicket *ticket, char *signature, DIDURL *sign
 int TransferTicket_Seal(TransferTicket *ticket, DIDDocument *controllerdoc,
         const char *storepass)
 {
-    const char *data = NULL;
+    uint8_t digest[SHA256_BYTES];
     char signature[SIGNATURE_BYTES * 2 + 16];
     DIDURL *signkey;
     int rc;
@@ -269,13 +297,11 @@ int TransferTicket_Seal(TransferTicket *ticket, DIDDocument *controllerdoc,
         return -1;
     }
 
-    data = ticket_tojson_forsign(ticket, true);
-    if (!data)
+    if (ticket_digest_forsign(ticket, digest) < 0)
         return -1;
 
-    rc = DIDDocument_Sign(controllerdoc, NULL, storepass, signature,
-            1, (unsigned char*)data, strlen(data));
-    free((void*)data);
+    rc = DIDDocument_SignDigest(controllerdoc, NULL, storepass, signature,
+            digest, sizeof(digest));
     if (rc < 0) {
         DIDError_Set(DIDERR_SIGN_ERROR, "Sign ticket failed.");
         return -1;
@@ -569,7 +595,7 @@ int TransferTicket_IsGenuine(TransferTicket *ticket)
     TicketProof *proof;
     DIDDocument *doc;
     DID **checksigners;
-    const char *data = NULL;
+    uint8_t digest[SHA256_BYTES];
     size_t size;
     int i, rc = 0, check;
 
@@ -591,8 +617,7 @@ int TransferTicket_IsGenuine(TransferTicket *ticket)
         return check;
     }
 
-    data = ticket_tojson_forsign(ticket, true);
-    if (!data) {
+    if (ticket_digest_forsign(ticket, digest) < 0) {
         DIDError_Set(DIDERR_NOT_GENUINE, " * TICKET %s : is not genuine,\
                 error: %s.", DIDSTR(&ticket->did), DIDERRMSG);
         return -1;
@@ -634,12 +659,14 @@ int TransferTicket_IsGenuine(TransferTicket *ticket)
             goto errorExit;
         }
 
-        rc = DIDDocument_IsValid(doc);
-        if (rc != 1)
+        check = DIDDocument_IsValid(doc);
+        if (check != 1) {
+            rc = check;
             goto errorExit;
+        }
 
-        if (DIDDocument_Verify(doc, &proof->verificationMethod, proof->signatureValue,
-                1, data, strlen(data)) < 0) {
+        if (DIDDocument_VerifyDigest(doc, &proof->verificationMethod, proof->signatureValue,
+                digest, sizeof(digest)) < 0) {
             DIDError_Set(DIDERR_NOT_GENUINE, " * TICKET %s : is not genuine,\
                     error: verify ticket failed.", DIDSTR(&ticket->did));
             goto errorExit;
@@ -651,9 +678,6 @@ int TransferTicket_IsGenuine(TransferTicket *ticket)
     rc = 1;
 
 errorExit:
-    if (data)
-       free((void*)data);
-
     return rc;
 
     DIDERROR_FINALIZE();
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2019 - 2021 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "Arena.h"
+
+#define ALIGN(n)                (((n) + 15) & ~((size_t)15))
+
+struct ArenaChunk {
+    ArenaChunk *next;
+    size_t capacity;
+    size_t used;
+};
+
+static ArenaChunk *chunk_create(size_t capacity)
+{
+    ArenaChunk *chunk;
+
+    //calloc gives the zeroed memory, the allocations are never reused.
+    chunk = (ArenaChunk*)calloc(1, ALIGN(sizeof(ArenaChunk)) + capacity);
+    if (!chunk)
+        return NULL;
+
+    chunk->capacity = capacity;
+    return chunk;
+}
+
+static char *chunk_data(ArenaChunk *chunk)
+{
+    return (char*)chunk + ALIGN(sizeof(ArenaChunk));
+}
+
+Arena *Arena_Create(size_t chunksize)
+{
+    ArenaChunk *chunk;
+    Arena *arena;
+
+    if (!chunksize)
+        chunksize = ARENA_CHUNK_SIZE;
+
+    //the arena itself lives at the head of the first chunk.
+    chunk = chunk_create(ALIGN(sizeof(Arena)) + ALIGN(chunksize));
+    if (!chunk)
+        return NULL;
+
+    arena = (Arena*)chunk_data(chunk);
+    chunk->used = ALIGN(sizeof(Arena));
+    arena->chunks = chunk;
+    arena->chunksize = ALIGN(chunksize);
+    return arena;
+}
+
+void *Arena_Alloc(Arena *arena, size_t size)
+{
+    ArenaChunk *chunk;
+    void *ptr;
+
+    assert(arena);
+    assert(arena->chunks);
+
+    size = ALIGN(size ? size : 1);
+    chunk = arena->chunks;
+    if (chunk->used + size > chunk->capacity) {
+        chunk = chunk_create(size > arena->chunksize ? size : arena->chunksize);
+        if (!chunk)
+            return NULL;
+
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    ptr = chunk_data(chunk) + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+void *Arena_Grow(Arena *arena, void *array, size_t size, size_t itemsize)
+{
+    void *items;
+
+    assert(arena);
+    assert(itemsize > 0);
+
+    //the capacity is the next power of two, so it is only full at one.
+    if (array && (size & (size - 1)))
+        return array;
+
+    items = Arena_Alloc(arena, (size ? size * 2 : 1) * itemsize);
+    if (items && size)
+        memcpy(items, array, size * itemsize);
+
+    return items;
+}
+
+void Arena_Destroy(Arena *arena)
+{
+    ArenaChunk *chunk, *next;
+
+    if (!arena)
+        return;
+
+    //the first chunk holds the arena, it is the last one in the list.
+    for (chunk = arena->chunks; chunk; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+}
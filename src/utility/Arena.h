@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2019 - 2021 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ARENA_CHUNK_SIZE                8192
+
+typedef struct ArenaChunk ArenaChunk;
+
+// A bump allocator, the memory is zeroed and only released all at once.
+typedef struct Arena {
+    void *owner;
+    ArenaChunk *chunks;
+    size_t chunksize;
+} Arena;
+
+Arena *Arena_Create(size_t chunksize);
+
+void *Arena_Alloc(Arena *arena, size_t size);
+
+// Make room for one more item, arrays double when the size is a power of two.
+void *Arena_Grow(Arena *arena, void *array, size_t size, size_t itemsize);
+
+void Arena_Destroy(Arena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__ARENA_H__
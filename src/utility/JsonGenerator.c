@@ -30,6 +30,10 @@
 
 #include "JsonGenerator.h"
 
+#ifndef MIN
+#define MIN(a,b) (((a)<(b))?(a):(b))
+#endif
+
 #define INITIAL_SIZE        4096
 #define EXPAND_SIZE         2048
 
@@ -75,6 +79,58 @@ static int ensure_capacity(JsonGenerator *generator, size_t len)
     return 0;
 }
 
+static int flush_staging(JsonGenerator *generator)
+{
+    assert(generator);
+    assert(generator->sink);
+
+    if (generator->pos == 0)
+        return 0;
+
+    if (generator->sink(generator->context, generator->buffer, generator->pos) < 0)
+        return -1;
+
+    generator->pos = 0;
+    return 0;
+}
+
+static int write_bytes(JsonGenerator *generator, const char *data, size_t len)
+{
+    size_t n;
+
+    assert(generator);
+    assert(generator->buffer);
+    assert(data);
+
+    if (!generator->sink) {
+        if (ensure_capacity(generator, len) == -1)
+            return -1;
+
+        memcpy(generator->buffer + generator->pos, data, len);
+        generator->pos += len;
+        return 0;
+    }
+
+    // The sink mode streams through the fixed staging buffer.
+    while (len > 0) {
+        if (generator->pos == generator->capacity && flush_staging(generator) == -1)
+            return -1;
+
+        n = MIN(len, generator->capacity - generator->pos);
+        memcpy(generator->buffer + generator->pos, data, n);
+        generator->pos += n;
+        data += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static inline int write_char(JsonGenerator *generator, char c)
+{
+    return write_bytes(generator, &c, 1);
+}
+
 static inline void push_state(JsonGenerator *generator, state_t state)
 {
     assert(generator);
@@ -148,30 +204,47 @@ JsonGenerator *DIDJG_Initialize(JsonGenerator *generator)
     generator->pos = 0;
     generator->deep = 0;
     generator->buffer[0] = 0;
+    generator->sink = NULL;
+    generator->context = NULL;
 
     push_state(generator, State_Root);
     return generator;
 }
 
-int DIDJG_WriteStartObject(JsonGenerator *generator)
+JsonGenerator *DIDJG_InitializeSink(JsonGenerator *generator, JsonSink sink, void *context)
 {
-    int is_sticky;
+    assert(generator);
+    assert(sink);
+
+#ifndef NDEBUG
+    memset(generator->state, 0, sizeof(generator->state));
+#endif
+
+    generator->buffer = generator->staging;
+    generator->capacity = sizeof(generator->staging);
+    generator->pos = 0;
+    generator->deep = 0;
+    generator->sink = sink;
+    generator->context = context;
 
+    push_state(generator, State_Root);
+    return generator;
+}
+
+int DIDJG_WriteStartObject(JsonGenerator *generator)
+{
     assert(generator);
     assert(generator->buffer);
     assert(get_state(generator) == State_Root
            || get_state(generator) == State_Array
            || get_state(generator) == State_Field);
 
-    is_sticky = is_state_sticky(generator);
-
-    if (ensure_capacity(generator, 1 + is_sticky) == -1)
+    if (is_state_sticky(generator) && write_char(generator, comma_symbol) == -1)
         return -1;
 
-    if (is_sticky)
-        generator->buffer[generator->pos++] = comma_symbol;
+    if (write_char(generator, start_object_symbol) == -1)
+        return -1;
 
-    generator->buffer[generator->pos++] = start_object_symbol;
     set_state_sticky(generator);
     push_state(generator, State_Object);
 
@@ -184,10 +257,9 @@ int DIDJG_WriteEndObject(JsonGenerator *generator)
     assert(generator->buffer);
     assert(get_state(generator) == State_Object);
 
-    if (ensure_capacity(generator, 1) == -1)
+    if (write_char(generator, end_object_symbol) == -1)
         return -1;
 
-    generator->buffer[generator->pos++] = end_object_symbol;
     pop_state(generator);
     if (get_state(generator) == State_Field)
         pop_state(generator); /* pop field state */
@@ -202,10 +274,9 @@ int DIDJG_WriteStartArray(JsonGenerator *generator)
     assert(get_state(generator) == State_Field ||
             get_state(generator) == State_Root);
 
-    if (ensure_capacity(generator, 1) == -1)
+    if (write_char(generator, start_array_symbol) == -1)
         return -1;
 
-    generator->buffer[generator->pos++] = start_array_symbol;
     push_state(generator, State_Array);
 
     return 0;
@@ -217,10 +288,9 @@ int DIDJG_WriteEndArray(JsonGenerator *generator)
     assert(generator->buffer);
     assert(get_state(generator) == State_Array);
 
-    if (ensure_capacity(generator, 1) == -1)
+    if (write_char(generator, end_array_symbol) == -1)
         return -1;
 
-    generator->buffer[generator->pos++] = end_array_symbol;
     pop_state(generator);
     if (get_state(generator) == State_Field)
         pop_state(generator); /* pop field state */
@@ -230,28 +300,19 @@ int DIDJG_WriteEndArray(JsonGenerator *generator)
 
 int DIDJG_WriteFieldName(JsonGenerator *generator, const char *name)
 {
-    size_t len;
-    int is_sticky;
-
     assert(generator);
     assert(generator->buffer);
     assert(name && *name);
     assert(get_state(generator) == State_Object);
 
-    is_sticky = is_state_sticky(generator);
-
-    len = strlen(name);
-    if (ensure_capacity(generator, len + 3 + is_sticky) == -1)
+    if (is_state_sticky(generator) && write_char(generator, comma_symbol) == -1)
         return -1;
 
-    if (is_sticky)
-        generator->buffer[generator->pos++] = comma_symbol;
-
-    generator->buffer[generator->pos++] = start_string_quote;
-    strcpy(generator->buffer + generator->pos, name);
-    generator->pos += len;
-    generator->buffer[generator->pos++] = end_string_quote;
-    generator->buffer[generator->pos++] = colon_symbol;
+    if (write_char(generator, start_string_quote) == -1 ||
+            write_bytes(generator, name, strlen(name)) == -1 ||
+            write_char(generator, end_string_quote) == -1 ||
+            write_char(generator, colon_symbol) == -1)
+        return -1;
 
     set_state_sticky(generator);
     push_state(generator, State_Field);
@@ -259,183 +320,117 @@ int DIDJG_WriteFieldName(JsonGenerator *generator, const char *name)
     return 0;
 }
 
-int DIDJG_WriteString(JsonGenerator *generator, const char *value)
+static const char *escape_char(char c)
+{
+    switch (c) {
+    case '\b':
+        return "\\b";
+    case '\f':
+        return "\\f";
+    case '\n':
+        return "\\n";
+    case '\r':
+        return "\\r";
+    case '\t':
+        return "\\t";
+    case '"':
+        return "\\\"";
+    case '\\':
+        return "\\\\";
+    default:
+        return NULL;
+    }
+}
+
+static int write_escaped(JsonGenerator *generator, const char *value)
 {
-    size_t len;
-    int is_sticky;
+    const char *p, *run, *escaped;
 
     assert(generator);
-    assert(generator->buffer);
-    assert(get_state(generator) == State_Field || get_state(generator) == State_Array);
+    assert(value);
 
-    is_sticky = is_state_sticky(generator);
+    for (p = run = value; *p != 0; p++) {
+        escaped = escape_char(*p);
+        if (!escaped)
+            continue;
 
-    len = value ? strlen(value) : 4; // null value
-    if (ensure_capacity(generator, len + 2 + is_sticky) == -1)
-        return -1;
-
-    if (is_sticky)
-        generator->buffer[generator->pos++] = comma_symbol;
+        if (write_bytes(generator, run, p - run) == -1 ||
+                write_bytes(generator, escaped, 2) == -1)
+            return -1;
 
-    if (value) {
-        generator->buffer[generator->pos++] = start_string_quote;
-        for (const char *p = value; *p != 0; p++) {
-            switch (*p) {
-                case '\b':
-                    if (ensure_capacity(generator, len + 1) == -1)
-                        return -1;
-                    generator->buffer[generator->pos++] = '\\';
-                    generator->buffer[generator->pos++] = 'b';
-                    break;
-                case '\f':
-                    if (ensure_capacity(generator, len + 1) == -1)
-                        return -1;
-                    generator->buffer[generator->pos++] = '\\';
-                    generator->buffer[generator->pos++] = 'f';
-                    break;
-                case '\n':
-                    if (ensure_capacity(generator, len + 1) == -1)
-                        return -1;
-                    generator->buffer[generator->pos++] = '\\';
-                    generator->buffer[generator->pos++] = 'n';
-                    break;
-                case '\r':
-                    if (ensure_capacity(generator, len + 1) == -1)
-                        return -1;
-                    generator->buffer[generator->pos++] = '\\';
-                    generator->buffer[generator->pos++] = 'r';
-                    break;
-                 case '\t':
-                    if (ensure_capacity(generator, len + 1) == -1)
-                        return -1;
-                    generator->buffer[generator->pos++] = '\\';
-                    generator->buffer[generator->pos++] = 't';
-                    break;
-                case '"':
-                    if (ensure_capacity(generator, len + 1) == -1)
-                        return -1;
-                    generator->buffer[generator->pos++] = '\\';
-                    generator->buffer[generator->pos++] = '"';
-                    break;
-                case '\\':
-                    if (ensure_capacity(generator, len + 1) == -1)
-                        return -1;
-                    generator->buffer[generator->pos++] = '\\';
-                    generator->buffer[generator->pos++] = '\\';
-                    break;
-                default:
-                    generator->buffer[generator->pos++] = *p;
-                    break;
-           }
-
-           len--;
-        }
-        generator->buffer[generator->pos++] = end_string_quote;
-    } else {
-        strcpy(generator->buffer + generator->pos, "null");
-        generator->pos += 4;
+        run = p + 1;
     }
 
+    return write_bytes(generator, run, p - run);
+}
+
+static void end_value(JsonGenerator *generator)
+{
     if (get_state(generator) == State_Field)
         pop_state(generator);
     else
         set_state_sticky(generator);
-
-    return 0;
 }
 
-int DIDJG_WriteNumber(JsonGenerator *generator, int value)
+int DIDJG_WriteString(JsonGenerator *generator, const char *value)
 {
-    size_t len;
-    int is_sticky;
-    char valuestring[32];
-
     assert(generator);
     assert(generator->buffer);
-    assert(get_state(generator) == State_Field
-           || get_state(generator) == State_Array);
-
-    is_sticky = is_state_sticky(generator);
+    assert(get_state(generator) == State_Field || get_state(generator) == State_Array);
 
-    len = snprintf(valuestring, sizeof(valuestring), "%d", value);
-    if (ensure_capacity(generator, len + is_sticky) == -1)
+    if (is_state_sticky(generator) && write_char(generator, comma_symbol) == -1)
         return -1;
 
-    if (is_sticky)
-        generator->buffer[generator->pos++] = comma_symbol;
-
-    strcpy(generator->buffer + generator->pos, valuestring);
-    generator->pos += len;
-
-    if (get_state(generator) == State_Field)
-        pop_state(generator);
-    else
-        set_state_sticky(generator);
+    if (value) {
+        if (write_char(generator, start_string_quote) == -1 ||
+                write_escaped(generator, value) == -1 ||
+                write_char(generator, end_string_quote) == -1)
+            return -1;
+    } else {
+        if (write_bytes(generator, "null", 4) == -1)
+            return -1;
+    }
 
+    end_value(generator);
     return 0;
 }
 
-int DIDJG_WriteDouble(JsonGenerator *generator, double value)
+static int write_literal(JsonGenerator *generator, const char *literal)
 {
-    size_t len;
-    int is_sticky;
-    char valuestring[64];
-
     assert(generator);
     assert(generator->buffer);
     assert(get_state(generator) == State_Field
            || get_state(generator) == State_Array);
 
-    is_sticky = is_state_sticky(generator);
-
-    len = snprintf(valuestring, sizeof(valuestring), "%g", value);
-    if (ensure_capacity(generator, len + is_sticky) == -1)
+    if (is_state_sticky(generator) && write_char(generator, comma_symbol) == -1)
         return -1;
 
-    if (is_sticky)
-        generator->buffer[generator->pos++] = comma_symbol;
-
-    strcpy(generator->buffer + generator->pos, valuestring);
-    generator->pos += len;
-
-    if (get_state(generator) == State_Field)
-        pop_state(generator);
-    else
-        set_state_sticky(generator);
+    if (write_bytes(generator, literal, strlen(literal)) == -1)
+        return -1;
 
+    end_value(generator);
     return 0;
 }
 
-int DIDJG_WriteBoolean(JsonGenerator *generator, bool value)
+int DIDJG_WriteNumber(JsonGenerator *generator, int value)
 {
-    size_t len;
-    int is_sticky;
-    char *valuestring;
-
-    assert(generator);
-    assert(generator->buffer);
-    assert(get_state(generator) == State_Field
-           || get_state(generator) == State_Array);
-
-    is_sticky = is_state_sticky(generator);
-
-    valuestring = value ? "true" : "false";
-    len = strlen(valuestring);
-    if (ensure_capacity(generator, len + is_sticky) == -1)
-        return -1;
+    char valuestring[32];
 
-    if (is_sticky)
-        generator->buffer[generator->pos++] = comma_symbol;
+    snprintf(valuestring, sizeof(valuestring), "%d", value);
+    return write_literal(generator, valuestring);
+}
 
-    strcpy(generator->buffer + generator->pos, valuestring);
-    generator->pos += len;
+int DIDJG_WriteDouble(JsonGenerator *generator, double value)
+{
+    char valuestring[64];
 
-    if (get_state(generator) == State_Field)
-        pop_state(generator);
-    else
-        set_state_sticky(generator);
+    snprintf(valuestring, sizeof(valuestring), "%g", value);
+    return write_literal(generator, valuestring);
+}
 
-    return 0;
+int DIDJG_WriteBoolean(JsonGenerator *generator, bool value)
+{
+    return write_literal(generator, value ? "true" : "false");
 }
 
 int DIDJG_WriteStringField(JsonGenerator *generator,
@@ -456,6 +451,7 @@ const char *DIDJG_Finish(JsonGenerator *generator)
 
     assert(generator);
     assert(generator->buffer);
+    assert(!generator->sink);
     assert(get_state(generator) == State_Root);
 
     if (generator->buffer[generator->pos] != 0)
@@ -467,10 +463,19 @@ const char *DIDJG_Finish(JsonGenerator *generator)
     return buffer;
 }
 
+int DIDJG_Flush(JsonGenerator *generator)
+{
+    assert(generator);
+    assert(generator->sink);
+    assert(get_state(generator) == State_Root);
+
+    return flush_staging(generator);
+}
+
 void DIDJG_Destroy(JsonGenerator *generator)
 {
-    if (!generator || !generator->buffer)
+    if (!generator || !generator->buffer || generator->sink)
         return;
 
     free(generator->buffer);
-}
\ No newline at end of file
+}
@@ -33,6 +33,9 @@ extern "C" {
 #endif
 
 #define JSON_GENERATOR_MAX_DEEPS        32
+#define JSON_GENERATOR_STAGING_SIZE     256
+
+typedef int (*JsonSink)(void *context, const char *data, size_t len);
 
 typedef struct JsonGenerator {
     size_t capacity;
@@ -40,10 +43,16 @@ typedef struct JsonGenerator {
     short deep;
     uint8_t state[JSON_GENERATOR_MAX_DEEPS];
     char *buffer;
+    JsonSink sink;
+    void *context;
+    char staging[JSON_GENERATOR_STAGING_SIZE];
 } JsonGenerator;
 
 JsonGenerator *DIDJG_Initialize(JsonGenerator *generator);
 
+// The output is written to the sink through the staging buffer, no heap buffer.
+JsonGenerator *DIDJG_InitializeSink(JsonGenerator *generator, JsonSink sink, void *context);
+
 int DIDJG_WriteStartObject(JsonGenerator *generator);
 
 int DIDJG_WriteEndObject(JsonGenerator *generator);
@@ -67,6 +76,8 @@ int DIDJG_WriteStringField(JsonGenerator *generator,
 
 const char *DIDJG_Finish(JsonGenerator *generator);
 
+int DIDJG_Flush(JsonGenerator *generator);
+
 void DIDJG_Destroy(JsonGenerator *generator);
 
 #ifdef __cplusplus
@@ -0,0 +1,698 @@
+/*
+ * Copyright (c) 2019 - 2021 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "JsonReader.h"
+
+typedef enum {
+    Expect_Value            = 0,
+    Expect_ValueOrEnd       = 1,
+    Expect_Key              = 2,
+    Expect_KeyOrEnd         = 3,
+    Expect_Colon            = 4,
+    Expect_CommaOrEnd       = 5,
+    Expect_Eof              = 6,
+} expect_t;
+
+static JsonToken fail(JsonReader *reader, const char *error)
+{
+    assert(reader);
+
+    reader->error = error;
+    reader->token = JsonToken_Error;
+    return JsonToken_Error;
+}
+
+static bool in_object(JsonReader *reader)
+{
+    int deep = reader->deep - 1;
+
+    return (reader->objects[deep >> 3] >> (deep & 7)) & 1;
+}
+
+static void after_value(JsonReader *reader)
+{
+    reader->state = reader->deep == 0 ? Expect_Eof : Expect_CommaOrEnd;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static int read_hex4(const char *data, size_t len, size_t pos)
+{
+    int i, v, value = 0;
+
+    if (pos + 4 > len)
+        return -1;
+
+    for (i = 0; i < 4; i++) {
+        v = hex_value(data[pos + i]);
+        if (v < 0)
+            return -1;
+        value = (value << 4) | v;
+    }
+
+    return value;
+}
+
+static size_t utf8_length(const uint8_t *p, size_t avail)
+{
+    size_t need, i;
+
+    if (p[0] >= 0xC2 && p[0] <= 0xDF)
+        need = 2;
+    else if (p[0] >= 0xE0 && p[0] <= 0xEF)
+        need = 3;
+    else if (p[0] >= 0xF0 && p[0] <= 0xF4)
+        need = 4;
+    else
+        return 0;
+
+    if (avail < need)
+        return 0;
+
+    for (i = 1; i < need; i++) {
+        if ((p[i] & 0xC0) != 0x80)
+            return 0;
+    }
+
+    //overlong forms, surrogates and code points above U+10FFFF.
+    if ((p[0] == 0xE0 && p[1] < 0xA0) || (p[0] == 0xED && p[1] >= 0xA0) ||
+            (p[0] == 0xF0 && p[1] < 0x90) || (p[0] == 0xF4 && p[1] >= 0x90))
+        return 0;
+
+    return need;
+}
+
+static JsonToken scan_string(JsonReader *reader, JsonToken token)
+{
+    const char *data = reader->json;
+    size_t pos = reader->pos + 1, n;
+    int code, low;
+    uint8_t c;
+
+    while (pos < reader->len) {
+        c = (uint8_t)data[pos];
+        if (c == '"') {
+            reader->start = reader->pos;
+            reader->end = pos + 1;
+            reader->pos = pos + 1;
+            reader->token = token;
+            return token;
+        }
+
+        if (c < 0x20)
+            return fail(reader, "control character in string");
+
+        if (c == '\\') {
+            if (++pos >= reader->len)
+                break;
+
+            switch (data[pos]) {
+            case '"': case '\\': case '/':
+            case 'b': case 'f': case 'n': case 'r': case 't':
+                pos++;
+                break;
+
+            case 'u':
+                code = read_hex4(data, reader->len, pos + 1);
+                if (code < 0)
+                    return fail(reader, "invalid \\u escape");
+                pos += 5;
+
+                if (code == 0)
+                    return fail(reader, "\\u0000 is not allowed");
+                if (code >= 0xDC00 && code <= 0xDFFF)
+                    return fail(reader, "invalid Unicode surrogate");
+                if (code >= 0xD800 && code <= 0xDBFF) {
+                    if (pos + 1 >= reader->len || data[pos] != '\\' || data[pos + 1] != 'u')
+                        return fail(reader, "invalid Unicode surrogate");
+                    low = read_hex4(data, reader->len, pos + 2);
+                    if (low < 0xDC00 || low > 0xDFFF)
+                        return fail(reader, "invalid Unicode surrogate");
+                    pos += 6;
+                }
+                break;
+
+            default:
+                return fail(reader, "invalid escape");
+            }
+            continue;
+        }
+
+        if (c < 0x80) {
+            pos++;
+            continue;
+        }
+
+        n = utf8_length((const uint8_t*)data + pos, reader->len - pos);
+        if (!n)
+            return fail(reader, "invalid UTF-8 in string");
+        pos += n;
+    }
+
+    return fail(reader, "unterminated string");
+}
+
+static bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static JsonToken scan_number(JsonReader *reader)
+{
+    const char *data = reader->json;
+    size_t pos = reader->pos, len = reader->len;
+
+    if (data[pos] == '-')
+        pos++;
+
+    if (pos >= len || !is_digit(data[pos]))
+        return fail(reader, "invalid number");
+
+    if (data[pos] == '0') {
+        pos++;
+    } else {
+        while (pos < len && is_digit(data[pos]))
+            pos++;
+    }
+
+    if (pos < len && data[pos] == '.') {
+        pos++;
+        if (pos >= len || !is_digit(data[pos]))
+            return fail(reader, "invalid number");
+        while (pos < len && is_digit(data[pos]))
+            pos++;
+    }
+
+    if (pos < len && (data[pos] == 'e' || data[pos] == 'E')) {
+        pos++;
+        if (pos < len && (data[pos] == '+' || data[pos] == '-'))
+            pos++;
+        if (pos >= len || !is_digit(data[pos]))
+            return fail(reader, "invalid number");
+        while (pos < len && is_digit(data[pos]))
+            pos++;
+    }
+
+    reader->start = reader->pos;
+    reader->end = pos;
+    reader->pos = pos;
+    reader->token = JsonToken_Number;
+    return JsonToken_Number;
+}
+
+static JsonToken scan_literal(JsonReader *reader, const char *literal, JsonToken token)
+{
+    size_t len = strlen(literal);
+
+    if (reader->len - reader->pos < len || memcmp(reader->json + reader->pos, literal, len))
+        return fail(reader, "invalid token");
+
+    reader->start = reader->pos;
+    reader->end = reader->pos + len;
+    reader->pos += len;
+    reader->token = token;
+    return token;
+}
+
+static JsonToken start_container(JsonReader *reader, bool object)
+{
+    int deep = reader->deep;
+
+    if (deep >= JSON_READER_MAX_DEEPS)
+        return fail(reader, "maximum parsing depth reached");
+
+    if (object)
+        reader->objects[deep >> 3] |= (uint8_t)(1 << (deep & 7));
+    else
+        reader->objects[deep >> 3] &= (uint8_t)~(1 << (deep & 7));
+
+    reader->deep++;
+    reader->start = reader->pos;
+    reader->end = ++reader->pos;
+    reader->state = object ? Expect_KeyOrEnd : Expect_ValueOrEnd;
+    reader->token = object ? JsonToken_StartObject : JsonToken_StartArray;
+    return reader->token;
+}
+
+static JsonToken end_container(JsonReader *reader, bool object)
+{
+    if (reader->deep == 0 || in_object(reader) != object)
+        return fail(reader, "unexpected end of container");
+
+    reader->deep--;
+    reader->start = reader->pos;
+    reader->end = ++reader->pos;
+    after_value(reader);
+    reader->token = object ? JsonToken_EndObject : JsonToken_EndArray;
+    return reader->token;
+}
+
+static JsonToken scan_value(JsonReader *reader)
+{
+    JsonToken token;
+    char c = reader->json[reader->pos];
+
+    switch (c) {
+    case '{':
+        return start_container(reader, true);
+    case '[':
+        return start_container(reader, false);
+    case '"':
+        token = scan_string(reader, JsonToken_String);
+        break;
+    case 't':
+        token = scan_literal(reader, "true", JsonToken_True);
+        break;
+    case 'f':
+        token = scan_literal(reader, "false", JsonToken_False);
+        break;
+    case 'n':
+        token = scan_literal(reader, "null", JsonToken_Null);
+        break;
+    default:
+        if (c == '-' || is_digit(c))
+            token = scan_number(reader);
+        else
+            token = fail(reader, "invalid token");
+        break;
+    }
+
+    if (token != JsonToken_Error)
+        after_value(reader);
+
+    return token;
+}
+
+JsonReader *DIDJR_Initialize(JsonReader *reader, const char *json, size_t len)
+{
+    assert(reader);
+    assert(json);
+
+    memset(reader, 0, sizeof(JsonReader));
+    reader->json = json;
+    reader->len = len;
+    reader->state = Expect_Value;
+    reader->token = JsonToken_None;
+    return reader;
+}
+
+JsonReader *DIDJR_InitializeSpan(JsonReader *reader, JsonSpan *span)
+{
+    assert(span);
+
+    return DIDJR_Initialize(reader, span->data, span->len);
+}
+
+JsonToken DIDJR_Next(JsonReader *reader)
+{
+    char c;
+
+    assert(reader);
+
+    if (reader->token == JsonToken_Error)
+        return JsonToken_Error;
+
+    for (;;) {
+        while (reader->pos < reader->len) {
+            c = reader->json[reader->pos];
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+                break;
+            reader->pos++;
+        }
+
+        if (reader->pos >= reader->len) {
+            if (reader->state != Expect_Eof)
+                return fail(reader, "premature end of input");
+
+            reader->start = reader->end = reader->pos;
+            reader->token = JsonToken_End;
+            return JsonToken_End;
+        }
+
+        c = reader->json[reader->pos];
+        switch (reader->state) {
+        case Expect_Value:
+            return scan_value(reader);
+
+        case Expect_ValueOrEnd:
+            if (c == ']')
+                return end_container(reader, false);
+            return scan_value(reader);
+
+        case Expect_KeyOrEnd:
+            if (c == '}')
+                return end_container(reader, true);
+            //fall through
+        case Expect_Key:
+            if (c != '"')
+                return fail(reader, "string or '}' expected");
+            if (scan_string(reader, JsonToken_Key) == JsonToken_Error)
+                return JsonToken_Error;
+            reader->state = Expect_Colon;
+            return JsonToken_Key;
+
+        case Expect_Colon:
+            if (c != ':')
+                return fail(reader, "':' expected");
+            reader->pos++;
+            reader->state = Expect_Value;
+            break;
+
+        case Expect_CommaOrEnd:
+            if (c == ',') {
+                reader->pos++;
+                reader->state = in_object(reader) ? Expect_Key : Expect_Value;
+                break;
+            }
+            if (c == '}' || c == ']')
+                return end_container(reader, c == '}');
+            return fail(reader, "',' or end of container expected");
+
+        case Expect_Eof:
+        default:
+            return fail(reader, "end of file expected");
+        }
+    }
+}
+
+int DIDJR_Skip(JsonReader *reader, JsonSpan *span)
+{
+    JsonToken token;
+    size_t start;
+    int deep;
+
+    assert(reader);
+
+    token = reader->token;
+    start = reader->start;
+
+    if (token == JsonToken_StartObject || token == JsonToken_StartArray) {
+        deep = reader->deep - 1;
+        do {
+            if (DIDJR_Next(reader) == JsonToken_Error)
+                return -1;
+        } while (reader->deep > deep);
+    } else if (token < JsonToken_String || token > JsonToken_Null) {
+        fail(reader, "value expected");
+        return -1;
+    }
+
+    if (span) {
+        span->token = token;
+        span->data = reader->json + start;
+        span->len = reader->end - start;
+    }
+
+    return 0;
+}
+
+int DIDJR_ReadMembers(JsonReader *reader, JsonMember *members, size_t count,
+        JsonMemberHandler others, void *context)
+{
+    JsonMember *member;
+    JsonToken token;
+    size_t i;
+
+    assert(reader);
+    assert(!count || members);
+
+    if (reader->token != JsonToken_StartObject) {
+        fail(reader, "object expected");
+        return -1;
+    }
+
+    for (i = 0; i < count; i++)
+        memset(&members[i].value, 0, sizeof(JsonSpan));
+
+    while ((token = DIDJR_Next(reader)) == JsonToken_Key) {
+        for (i = 0, member = NULL; i < count; i++) {
+            if (DIDJR_KeyEquals(reader, members[i].name)) {
+                member = &members[i];
+                break;
+            }
+        }
+
+        if (!member && others) {
+            if (others(context, reader) < 0)
+                return -1;
+            continue;
+        }
+
+        //the last one wins for duplicated keys, the same as jansson.
+        if (DIDJR_Next(reader) == JsonToken_Error ||
+                DIDJR_Skip(reader, member ? &member->value : NULL) < 0)
+            return -1;
+    }
+
+    return token == JsonToken_EndObject ? 0 : -1;
+}
+
+int DIDJR_Finish(JsonReader *reader)
+{
+    assert(reader);
+
+    return DIDJR_Next(reader) == JsonToken_End ? 0 : -1;
+}
+
+static ssize_t decode_string(const char *data, size_t len, char *buffer, size_t size)
+{
+    size_t pos, out = 0;
+    int code, low;
+    char c;
+
+    assert(len >= 2 && data[0] == '"' && data[len - 1] == '"');
+
+    //skip the quotes, the content was validated by the scanner.
+    data++;
+    len -= 2;
+
+    if (!memchr(data, '\\', len)) {
+        if (len + 1 > size)
+            return -1;
+        memcpy(buffer, data, len);
+        buffer[len] = 0;
+        return len;
+    }
+
+    for (pos = 0; pos < len; ) {
+        if (out + 1 >= size)
+            return -1;
+
+        c = data[pos++];
+        if (c != '\\') {
+            buffer[out++] = c;
+            continue;
+        }
+
+        c = data[pos++];
+        switch (c) {
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'n': c = '\n'; break;
+        case 'r': c = '\r'; break;
+        case 't': c = '\t'; break;
+        case 'u':
+            code = read_hex4(data, len, pos);
+            pos += 4;
+            if (code >= 0xD800 && code <= 0xDBFF) {
+                low = read_hex4(data, len, pos + 2);
+                pos += 6;
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            }
+
+            if (code < 0x80) {
+                c = (char)code;
+                break;
+            }
+
+            if (out + (code < 0x800 ? 2 : code < 0x10000 ? 3 : 4) + 1 > size)
+                return -1;
+
+            if (code < 0x800) {
+                buffer[out++] = (char)(0xC0 | (code >> 6));
+            } else if (code < 0x10000) {
+                buffer[out++] = (char)(0xE0 | (code >> 12));
+                buffer[out++] = (char)(0x80 | ((code >> 6) & 0x3F));
+            } else {
+                buffer[out++] = (char)(0xF0 | (code >> 18));
+                buffer[out++] = (char)(0x80 | ((code >> 12) & 0x3F));
+                buffer[out++] = (char)(0x80 | ((code >> 6) & 0x3F));
+            }
+            buffer[out++] = (char)(0x80 | (code & 0x3F));
+            continue;
+        default:
+            break;
+        }
+
+        buffer[out++] = c;
+    }
+
+    if (out + 1 > size)
+        return -1;
+
+    buffer[out] = 0;
+    return out;
+}
+
+bool DIDJR_KeyEquals(JsonReader *reader, const char *name)
+{
+    char buffer[64];
+    size_t len;
+
+    assert(reader);
+    assert(name);
+
+    if (reader->token != JsonToken_Key)
+        return false;
+
+    len = strlen(name);
+    if (reader->end - reader->start == len + 2 &&
+            !memcmp(reader->json + reader->start + 1, name, len))
+        return true;
+
+    //escaped keys are rare, decode them before comparing.
+    if (!memchr(reader->json + reader->start + 1, '\\', reader->end - reader->start - 2))
+        return false;
+
+    if (decode_string(reader->json + reader->start, reader->end - reader->start,
+            buffer, sizeof(buffer)) < 0)
+        return false;
+
+    return strcmp(buffer, name) == 0;
+}
+
+ssize_t DIDJR_GetString(JsonReader *reader, char *buffer, size_t size)
+{
+    assert(reader);
+    assert(buffer);
+
+    if (reader->token != JsonToken_Key && reader->token != JsonToken_String)
+        return -1;
+
+    return decode_string(reader->json + reader->start, reader->end - reader->start,
+            buffer, size);
+}
+
+ssize_t DIDJR_CopyString(JsonSpan *span, char *buffer, size_t size)
+{
+    assert(span);
+    assert(buffer);
+
+    if (span->token != JsonToken_String)
+        return -1;
+
+    return decode_string(span->data, span->len, buffer, size);
+}
+
+char *DIDJR_StrDup(JsonReader *reader)
+{
+    size_t len;
+    char *string;
+
+    assert(reader);
+
+    if (reader->token != JsonToken_Key && reader->token != JsonToken_String)
+        return NULL;
+
+    //the decoded string is never longer than the raw one.
+    len = reader->end - reader->start;
+    string = (char*)malloc(len);
+    if (!string)
+        return NULL;
+
+    if (decode_string(reader->json + reader->start, len, string, len) < 0) {
+        free(string);
+        return NULL;
+    }
+
+    return string;
+}
+
+json_t *DIDJR_LoadSpan(JsonSpan *span)
+{
+    json_error_t error;
+
+    assert(span);
+
+    return json_loadb(span->data, span->len, JSON_DECODE_ANY, &error);
+}
+
+json_t *DIDJR_Load(JsonReader *reader)
+{
+    JsonSpan span;
+
+    if (DIDJR_Skip(reader, &span) < 0)
+        return NULL;
+
+    return DIDJR_LoadSpan(&span);
+}
+
+int DIDJR_CollectMember(void *context, JsonReader *reader)
+{
+    json_t **object = (json_t**)context;
+    json_t *value;
+    char *key;
+    int rc;
+
+    assert(object);
+    assert(reader);
+
+    key = DIDJR_StrDup(reader);
+    if (!key)
+        return -1;
+
+    if (DIDJR_Next(reader) == JsonToken_Error) {
+        free(key);
+        return -1;
+    }
+
+    value = DIDJR_Load(reader);
+    if (!value) {
+        free(key);
+        return -1;
+    }
+
+    if (!*object)
+        *object = json_object();
+
+    //json_object_set_new steals the value even if it fails.
+    rc = *object ? json_object_set_new(*object, key, value) : -1;
+    if (!*object)
+        json_decref(value);
+
+    free(key);
+    return rc;
+}
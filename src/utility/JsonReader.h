@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2019 - 2021 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __JSON_READER_H__
+#define __JSON_READER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <jansson.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JSON_READER_MAX_DEEPS           2048
+
+typedef enum {
+    JsonToken_Error         = -1,
+    JsonToken_None          = 0,
+    JsonToken_StartObject   = 1,
+    JsonToken_EndObject     = 2,
+    JsonToken_StartArray    = 3,
+    JsonToken_EndArray      = 4,
+    JsonToken_Key           = 5,
+    JsonToken_String        = 6,
+    JsonToken_Number        = 7,
+    JsonToken_True          = 8,
+    JsonToken_False         = 9,
+    JsonToken_Null          = 10,
+    JsonToken_End           = 11
+} JsonToken;
+
+// The raw text of one value, strings include the quotes.
+typedef struct JsonSpan {
+    JsonToken token;
+    const char *data;
+    size_t len;
+} JsonSpan;
+
+// One entry of an object schema, value.token is JsonToken_None if absent.
+typedef struct JsonMember {
+    const char *name;
+    JsonSpan value;
+} JsonMember;
+
+typedef struct JsonReader JsonReader;
+
+// Called with the reader on an unknown key, must consume the member value.
+typedef int (*JsonMemberHandler)(void *context, JsonReader *reader);
+
+struct JsonReader {
+    const char *json;
+    size_t len;
+    size_t pos;
+    int deep;
+    uint8_t state;
+    uint8_t objects[JSON_READER_MAX_DEEPS / 8];
+    JsonToken token;
+    size_t start;
+    size_t end;
+    const char *error;
+};
+
+JsonReader *DIDJR_Initialize(JsonReader *reader, const char *json, size_t len);
+
+JsonReader *DIDJR_InitializeSpan(JsonReader *reader, JsonSpan *span);
+
+JsonToken DIDJR_Next(JsonReader *reader);
+
+int DIDJR_Skip(JsonReader *reader, JsonSpan *span);
+
+int DIDJR_ReadMembers(JsonReader *reader, JsonMember *members, size_t count,
+        JsonMemberHandler others, void *context);
+
+int DIDJR_Finish(JsonReader *reader);
+
+bool DIDJR_KeyEquals(JsonReader *reader, const char *name);
+
+ssize_t DIDJR_GetString(JsonReader *reader, char *buffer, size_t size);
+
+ssize_t DIDJR_CopyString(JsonSpan *span, char *buffer, size_t size);
+
+char *DIDJR_StrDup(JsonReader *reader);
+
+json_t *DIDJR_Load(JsonReader *reader);
+
+json_t *DIDJR_LoadSpan(JsonSpan *span);
+
+// JsonMemberHandler that adds the member to the json object at *(json_t**)context.
+int DIDJR_CollectMember(void *context, JsonReader *reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__JSON_READER_H__
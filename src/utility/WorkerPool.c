@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2019 - 2021 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "WorkerPool.h"
+
+typedef struct WorkerTask {
+    struct WorkerTask *next;
+    WorkerPool_Task *task;
+    void *arg;
+} WorkerTask;
+
+struct WorkerPool {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    WorkerTask *head;
+    WorkerTask *tail;
+    bool stopping;
+    int workers;
+    pthread_t threads[1];
+};
+
+static void *worker_main(void *arg)
+{
+    WorkerPool *pool = (WorkerPool*)arg;
+    WorkerTask *task;
+
+    assert(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    while (true) {
+        while (!pool->head && !pool->stopping)
+            pthread_cond_wait(&pool->cond, &pool->lock);
+
+        task = pool->head;
+        if (!task)
+            break;
+
+        pool->head = task->next;
+        if (!pool->head)
+            pool->tail = NULL;
+        pthread_mutex_unlock(&pool->lock);
+
+        task->task(task->arg);
+        free(task);
+
+        pthread_mutex_lock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+WorkerPool *WorkerPool_Create(int workers)
+{
+    WorkerPool *pool;
+
+    assert(workers > 0);
+
+    pool = (WorkerPool*)calloc(1, sizeof(WorkerPool) + (workers - 1) * sizeof(pthread_t));
+    if (!pool)
+        return NULL;
+
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        free(pool);
+        return NULL;
+    }
+
+    if (pthread_cond_init(&pool->cond, NULL) != 0) {
+        pthread_mutex_destroy(&pool->lock);
+        free(pool);
+        return NULL;
+    }
+
+    for (; pool->workers < workers; pool->workers++) {
+        if (pthread_create(&pool->threads[pool->workers], NULL, worker_main, pool) != 0)
+            break;
+    }
+
+    if (pool->workers == 0) {
+        WorkerPool_Destroy(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+int WorkerPool_Submit(WorkerPool *pool, WorkerPool_Task *task, void *arg)
+{
+    WorkerTask *item;
+
+    assert(pool);
+    assert(task);
+
+    item = (WorkerTask*)calloc(1, sizeof(WorkerTask));
+    if (!item)
+        return -1;
+
+    item->task = task;
+    item->arg = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->stopping) {
+        pthread_mutex_unlock(&pool->lock);
+        free(item);
+        return -1;
+    }
+
+    if (pool->tail)
+        pool->tail->next = item;
+    else
+        pool->head = item;
+    pool->tail = item;
+
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+}
+
+void WorkerPool_Destroy(WorkerPool *pool)
+{
+    int i;
+
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->workers; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
@@ -62,6 +62,10 @@
 
 #define DID_MAX_LEN      512
 
+#ifndef O_BINARY
+#define O_BINARY         0
+#endif
+
 const char *get_time_string(char *timestring, size_t len, time_t *p_time)
 {
     time_t t;
@@ -245,7 +249,8 @@ static int get_dirv(char *path, bool create, int count, va_list components)
 
         if (create) {
             if (rc < 0) {
-                if (errno != ENOENT || (errno == ENOENT && mkdir(path, S_IRWXU) < 0))
+                //EEXIST when another thread creates it at the same time.
+                if (errno != ENOENT || (mkdir(path, S_IRWXU) < 0 && errno != EEXIST))
                     return -1;
             } else {
                 if (!S_ISDIR(st.st_mode)) {
@@ -307,20 +312,19 @@ int get_file(char *path, bool create, int count, ...)
     return 0;
 }
 
-int store_file(const char *path, const char *string)
+int store_data(const char *path, const void *data, size_t len)
 {
     int fd;
-    size_t len, size;
+    size_t size;
 
-    if (!path || !*path || !string)
+    if (!path || !*path || !data)
         return -1;
 
-    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, S_IRUSR | S_IWUSR);
     if (fd == -1)
         return -1;
 
-    len = strlen(string);
-    size = write(fd, string, len);
+    size = write(fd, data, len);
     if (size < len) {
         close(fd);
         return -1;
@@ -330,7 +334,29 @@ int store_file(const char *path, const char *string)
     return 0;
 }
 
-const char *load_file(const char *path)
+//Move from over to, an existing file is replaced in one step.
+int replace_file(const char *from, const char *to)
+{
+    if (!from || !*from || !to || !*to)
+        return -1;
+
+#if defined(_WIN32) || defined(_WIN64)
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ? 0 : -1;
+#else
+    return rename(from, to);
+#endif
+}
+
+int store_file(const char *path, const char *string)
+{
+    if (!string)
+        return -1;
+
+    return store_data(path, string, strlen(string));
+}
+
+//The data is always followed by a NUL, so text files can be used as strings.
+const void *load_data(const char *path, size_t *len)
 {
     int fd;
     size_t size;
@@ -340,7 +366,7 @@ const char *load_file(const char *path)
     if (!path)
         return NULL;
 
-    fd = open(path, O_RDONLY);
+    fd = open(path, O_RDONLY | O_BINARY);
     if (fd == -1)
         return NULL;
 
@@ -363,9 +389,16 @@ const char *load_file(const char *path)
     }
 
     close(fd);
+    if (len)
+        *len = size;
     return data;
 }
 
+const char *load_file(const char *path)
+{
+    return (const char*)load_data(path, NULL);
+}
+
 static int is_empty_helper(const char *path, void *context)
 {
     if (!path || !strcmp(path, ".") || !strcmp(path, "..")) {
@@ -528,3 +561,50 @@ const char *json_astext(json_t *item)
     return strdup(value);
 }
 
+
+static int json_digest_sink(void *context, const char *data, size_t len)
+{
+    return sha256_digest_update((Sha256_Digest*)context, 1, data, len);
+}
+
+JsonGenerator *JsonDigest_Initialize(JsonDigest *jd)
+{
+    assert(jd);
+
+    if (sha256_digest_init(&jd->sha256) < 0)
+        return NULL;
+
+    return DIDJG_InitializeSink(&jd->generator, json_digest_sink, &jd->sha256);
+}
+
+ssize_t JsonDigest_Finish(JsonDigest *jd, uint8_t *digest, int count, ...)
+{
+    va_list inputs;
+    int rc = 0;
+
+    assert(jd);
+    assert(digest);
+
+    if (DIDJG_Flush(&jd->generator) < 0) {
+        sha256_digest_cleanup(&jd->sha256);
+        return -1;
+    }
+
+    if (count > 0) {
+        va_start(inputs, count);
+        rc = sha256v_digest_update(&jd->sha256, count, inputs);
+        va_end(inputs);
+        if (rc < 0) {
+            sha256_digest_cleanup(&jd->sha256);
+            return -1;
+        }
+    }
+
+    return sha256_digest_final(&jd->sha256, digest);
+}
+
+void JsonDigest_Destroy(JsonDigest *jd)
+{
+    if (jd)
+        sha256_digest_cleanup(&jd->sha256);
+}
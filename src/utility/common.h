@@ -31,11 +31,16 @@
 #include <jansson.h>
 
 #include "diderror.h"
+#include "crypto.h"
+#include "JsonGenerator.h"
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <crystal.h>
 #include <string.h>
 #endif
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -60,6 +65,29 @@ extern "C" {
     }                                                     \
 } while(0)
 
+// Serializes json straight into a sha256 context.
+typedef struct JsonDigest {
+    JsonGenerator generator;
+    Sha256_Digest sha256;
+} JsonDigest;
+
+// Memoized state shared between threads: the data is written first and the
+// flag is published with a release store, readers load it with acquire.
+#define MEMO_NONE                          0
+#define MEMO_BUSY                          1
+#define MEMO_SET                           2
+
+#if defined(_MSC_VER)
+#define MEMO_LOAD(flag)              InterlockedCompareExchange((LONG volatile*)(flag), 0, 0)
+#define MEMO_STORE(flag, v)          InterlockedExchange((LONG volatile*)(flag), (v))
+#define MEMO_CLAIM(flag)             (InterlockedCompareExchange((LONG volatile*)(flag), \
+                                             MEMO_BUSY, MEMO_NONE) == MEMO_NONE)
+#else
+#define MEMO_LOAD(flag)              __atomic_load_n((flag), __ATOMIC_ACQUIRE)
+#define MEMO_STORE(flag, v)          __atomic_store_n((flag), (v), __ATOMIC_RELEASE)
+#define MEMO_CLAIM(flag)             __sync_bool_compare_and_swap((flag), MEMO_NONE, MEMO_BUSY)
+#endif
+
 #define MAX(a,b) (((a)>(b))?(a):(b))
 #define MIN(a,b) (((a)<(b))?(a):(b))
 
@@ -85,8 +113,14 @@ int get_dir(char* path, bool create, int count, ...);
 
 int get_file(char *path, bool create, int count, ...);
 
+int store_data(const char *path, const void *data, size_t len);
+
 int store_file(const char *path, const char *string);
 
+int replace_file(const char *from, const char *to);
+
+const void *load_data(const char *path, size_t *len);
+
 const char *load_file(const char *path);
 
 bool is_empty(const char *path);
@@ -101,6 +135,12 @@ char *last_strstr(const char *haystack, const char *needle);
 
 const char *json_astext(json_t *item);
 
+JsonGenerator *JsonDigest_Initialize(JsonDigest *jd);
+
+ssize_t JsonDigest_Finish(JsonDigest *jd, uint8_t *digest, int count, ...);
+
+void JsonDigest_Destroy(JsonDigest *jd);
+
 #ifdef __cplusplus
 }
 #endif
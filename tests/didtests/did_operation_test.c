@@ -65,6 +65,24 @@ static void test_did_equals(void)
     DID_Destroy(equaldid);
 }
 
+static void test_did_own_metadata(void)
+{
+    DIDMetadata *metadata;
+    DID *copy;
+
+    //a standalone DID carries its own metadata, copies don't share it.
+    metadata = DID_GetMetadata(did);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(metadata);
+    CU_ASSERT_NOT_EQUAL(-1, DIDMetadata_SetExtra(metadata, "k", "v"));
+
+    copy = DID_New(method_specific_string);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(copy);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(DID_GetMetadata(copy));
+    CU_ASSERT_PTR_NOT_EQUAL(metadata, DID_GetMetadata(copy));
+    CU_ASSERT_PTR_NULL(DIDMetadata_GetExtra(DID_GetMetadata(copy), "k"));
+    DID_Destroy(copy);
+}
+
 static int did_test_operation_suite_init(void)
 {
     did = DID_FromString(testdid_string);
@@ -87,6 +105,7 @@ static CU_TestInfo cases[] = {
     {   "test_did_tostring_error",             test_did_tostring_error  },
     {   "test_did_compare",                    test_did_compare         },
     {   "test_did_equals",                     test_did_equals          },
+    {   "test_did_own_metadata",               test_did_own_metadata    },
     {   NULL,                                  NULL                     }
 };
 
@@ -1281,6 +1281,80 @@ static void test_diddoc_remove_proof(void)
     }
 }
 
+static void test_diddoc_lookup_many_keys(void)
+{
+    DIDDocument *doc, *sealeddoc, *editeddoc;
+    DIDDocumentBuilder *builder;
+    char publickeybase58[PUBLICKEY_BASE58_BYTES];
+    char fragment[32];
+    const char *keybase;
+    DIDURL *keyid;
+    PublicKey *pk;
+    DID *did;
+    int i;
+
+    doc = TestData_GetDocument("user1", NULL, 2);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+    did = DIDDocument_GetSubject(doc);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(did);
+
+    builder = DIDDocument_Edit(doc, NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(builder);
+
+    for (i = 0; i < 64; i++) {
+        sprintf(fragment, "many-%d", i);
+        keyid = DIDURL_NewFromDid(did, fragment);
+        CU_ASSERT_PTR_NOT_NULL(keyid);
+        keybase = Generater_Publickey(publickeybase58, sizeof(publickeybase58));
+        CU_ASSERT_PTR_NOT_NULL(keybase);
+        CU_ASSERT_NOT_EQUAL(-1, DIDDocumentBuilder_AddAuthenticationKey(builder, keyid, keybase));
+        //the builder sees its own additions before sealing.
+        CU_ASSERT_PTR_NOT_NULL(DIDDocument_GetPublicKey(builder->document, keyid));
+        DIDURL_Destroy(keyid);
+    }
+
+    sealeddoc = DIDDocumentBuilder_Seal(builder, storepass);
+    DIDDocumentBuilder_Destroy(builder);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(sealeddoc);
+    CU_ASSERT_EQUAL(68, DIDDocument_GetPublicKeyCount(sealeddoc));
+
+    for (i = 0; i < 64; i++) {
+        sprintf(fragment, "many-%d", i);
+        keyid = DIDURL_NewFromDid(did, fragment);
+        CU_ASSERT_PTR_NOT_NULL(keyid);
+        pk = DIDDocument_GetPublicKey(sealeddoc, keyid);
+        CU_ASSERT_PTR_NOT_NULL(pk);
+        CU_ASSERT_TRUE(DIDURL_Equals(keyid, PublicKey_GetId(pk)));
+        CU_ASSERT_EQUAL(1, DIDDocument_IsAuthenticationKey(sealeddoc, keyid));
+        DIDURL_Destroy(keyid);
+    }
+
+    //remove one key, the sealed copy must not find it anymore.
+    builder = DIDDocument_Edit(sealeddoc, NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(builder);
+    keyid = DIDURL_NewFromDid(did, "many-10");
+    CU_ASSERT_PTR_NOT_NULL(keyid);
+    CU_ASSERT_NOT_EQUAL(-1, DIDDocumentBuilder_RemovePublicKey(builder, keyid, true));
+    CU_ASSERT_PTR_NULL(DIDDocument_GetPublicKey(builder->document, keyid));
+
+    editeddoc = DIDDocumentBuilder_Seal(builder, storepass);
+    DIDDocumentBuilder_Destroy(builder);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(editeddoc);
+
+    CU_ASSERT_PTR_NULL(DIDDocument_GetPublicKey(editeddoc, keyid));
+    CU_ASSERT_PTR_NOT_NULL(DIDDocument_GetPublicKey(sealeddoc, keyid));
+    CU_ASSERT_EQUAL(0, DIDDocument_IsAuthenticationKey(editeddoc, keyid));
+    DIDURL_Destroy(keyid);
+
+    keyid = DIDURL_NewFromDid(did, "many-11");
+    CU_ASSERT_PTR_NOT_NULL(keyid);
+    CU_ASSERT_PTR_NOT_NULL(DIDDocument_GetPublicKey(editeddoc, keyid));
+    DIDURL_Destroy(keyid);
+
+    DIDDocument_Destroy(editeddoc);
+    DIDDocument_Destroy(sealeddoc);
+}
+
 static int diddoc_elem_test_suite_init(void)
 {
     DIDStore *store = TestData_SetupStore(true);
@@ -1321,6 +1395,7 @@ static CU_TestInfo cases[] = {
     { "test_diddoc_remove_service",                test_diddoc_remove_service            },
     { "test_diddoc_add_controller",                test_diddoc_add_controller            },
     { "test_diddoc_remove_proof",                  test_diddoc_remove_proof              },
+    { "test_diddoc_lookup_many_keys",              test_diddoc_lookup_many_keys          },
     { NULL,                                        NULL                                  }
 };
 
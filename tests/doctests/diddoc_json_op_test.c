@@ -5,12 +5,15 @@
 #endif
 #include <limits.h>
 #include <crystal.h>
+#include <jansson.h>
 
 #include <CUnit/Basic.h>
 #include "constant.h"
 #include "loader.h"
 #include "ela_did.h"
 #include "did.h"
+#include "diddocument.h"
+#include "credential.h"
 
 static DataParam params[] = {
     { 1, "issuer", NULL, NULL },      { 1, "user1", NULL, NULL },
@@ -76,6 +79,95 @@ static void test_diddoc_json_operateion(void)
     }
 }
 
+static void test_diddoc_json_reader(void)
+{
+    DIDDocument *doc, *domdoc;
+    const char *compactJson, *normalizedJson, *data;
+    char *sorted, *tail;
+    json_t *root;
+    json_error_t error;
+    size_t len;
+    int i;
+
+    for (i = 0; i < 10; i++) {
+        compactJson = TestData_GetDocumentJson(params[i].did, "compact", params[i].version);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(compactJson);
+        normalizedJson = TestData_GetDocumentJson(params[i].did, "normalized", params[i].version);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(normalizedJson);
+
+        root = json_loads(compactJson, 0, &error);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(root);
+        domdoc = DIDDocument_FromJson_Internal(root, true);
+        CU_ASSERT_PTR_NOT_NULL(domdoc);
+
+        // the members in any order.
+        sorted = json_dumps(root, JSON_SORT_KEYS | JSON_INDENT(2));
+        json_decref(root);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(sorted);
+
+        doc = DIDDocument_FromJson(sorted);
+        CU_ASSERT_PTR_NOT_NULL(doc);
+        CU_ASSERT_TRUE(DIDDocument_IsValid(doc));
+
+        data = DIDDocument_ToJson(doc, true);
+        CU_ASSERT_PTR_NOT_NULL(data);
+        CU_ASSERT_STRING_EQUAL(normalizedJson, data);
+        free((void*)data);
+
+        data = DIDDocument_ToJson(domdoc, true);
+        CU_ASSERT_PTR_NOT_NULL(data);
+        CU_ASSERT_STRING_EQUAL(normalizedJson, data);
+        free((void*)data);
+
+        DIDDocument_Destroy(doc);
+        DIDDocument_Destroy(domdoc);
+
+        // trailing data and truncated text are rejected.
+        len = strlen(sorted);
+        tail = (char*)malloc(len + 3);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(tail);
+        strcpy(tail, sorted);
+        strcat(tail, " x");
+        CU_ASSERT_PTR_NULL(DIDDocument_FromJson(tail));
+        tail[len - 1] = 0;
+        CU_ASSERT_PTR_NULL(DIDDocument_FromJson(tail));
+        free(tail);
+        free(sorted);
+    }
+}
+
+static void test_diddoc_json_arena(void)
+{
+    DIDDocument *doc, *copy;
+    const char *normalizedJson, *data;
+    size_t i, j;
+
+    for (i = 0; i < 10; i++) {
+        normalizedJson = TestData_GetDocumentJson(params[i].did, "normalized", params[i].version);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(normalizedJson);
+
+        doc = DIDDocument_FromJson(normalizedJson);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(doc->arena);
+        CU_ASSERT_PTR_EQUAL(doc->arena->owner, doc);
+        for (j = 0; j < doc->credentials.size; j++)
+            CU_ASSERT_PTR_EQUAL(doc->credentials.credentials[j]->arena, doc->arena);
+
+        // the copy is on the heap and outlives the parsed document.
+        copy = (DIDDocument*)calloc(1, sizeof(DIDDocument));
+        CU_ASSERT_PTR_NOT_NULL_FATAL(copy);
+        CU_ASSERT_NOT_EQUAL(DIDDocument_Copy(copy, doc), -1);
+        CU_ASSERT_PTR_NULL(copy->arena);
+        DIDDocument_Destroy(doc);
+
+        data = DIDDocument_ToJson(copy, true);
+        CU_ASSERT_PTR_NOT_NULL(data);
+        CU_ASSERT_STRING_EQUAL(normalizedJson, data);
+        free((void*)data);
+        DIDDocument_Destroy(copy);
+    }
+}
+
 static int diddoc_json_op_test_suite_init(void)
 {
     DIDStore *store = TestData_SetupStore(true);
@@ -93,6 +185,8 @@ static int diddoc_json_op_test_suite_cleanup(void)
 
 static CU_TestInfo cases[] = {
     { "test_diddoc_json_operateion",   test_diddoc_json_operateion   },
+    { "test_diddoc_json_reader",       test_diddoc_json_reader       },
+    { "test_diddoc_json_arena",        test_diddoc_json_arena        },
     { NULL,                            NULL                          }
 };
 
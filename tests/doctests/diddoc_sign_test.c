@@ -92,6 +92,48 @@ static void test_ctmdoc_sign_verify(void)
     }
 }
 
+static void test_diddoc_verify_oversized_signature(void)
+{
+    DIDDocument *document;
+    DIDURL *keyid;
+    PublicKey *pk;
+    PreparedPublicKey *prepared;
+    uint8_t digest[32], binkey[PUBLICKEY_BYTES];
+    char signature[MAX_SIGNATURE_LEN * 4];
+    size_t len;
+
+    document = TestData_GetDocument("user1", NULL, 2);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(document);
+
+    keyid = DIDDocument_GetDefaultPublicKey(document);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(keyid);
+
+    memset(digest, 1, sizeof(digest));
+    CU_ASSERT_NOT_EQUAL(-1, DIDDocument_SignDigest(document, keyid, storepass, signature, digest, sizeof(digest)));
+
+    // A valid signature padded with base64 text decodes far past 64 bytes.
+    len = strlen(signature);
+    memset(signature + len, 'A', sizeof(signature) - len - 1);
+    signature[sizeof(signature) - 1] = 0;
+
+    CU_ASSERT_EQUAL(-1, DIDDocument_VerifyDigest(document, keyid, signature, digest, sizeof(digest)));
+
+    pk = DIDDocument_GetPublicKey(document, keyid);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(pk);
+    CU_ASSERT_EQUAL(PUBLICKEY_BYTES, b58_decode(binkey, sizeof(binkey), PublicKey_GetPublicKeyBase58(pk)));
+
+    CU_ASSERT_EQUAL(-1, ecdsa_verify_base64(signature, binkey, digest, sizeof(digest)));
+
+    prepared = ecdsa_prepare_publickey(binkey, sizeof(binkey));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(prepared);
+    CU_ASSERT_EQUAL(-1, ecdsa_verify_base64_prepared(signature, prepared, digest, sizeof(digest)));
+
+    // A signature that fits the buffer but decodes short is rejected too.
+    signature[len - 8] = 0;
+    CU_ASSERT_EQUAL(-1, ecdsa_verify_base64_prepared(signature, prepared, digest, sizeof(digest)));
+    ecdsa_publickey_free(prepared);
+}
+
 static void test_diddoc_derive_fromidentifier(void)
 {
     DIDDocument *doc;
@@ -200,6 +242,43 @@ static void test_diddoc_derive_compatible_withjava(void)
     free((void*)key);
 }
 
+static void test_diddoc_genuine_memo(void)
+{
+    DIDDocument *document, *sealeddoc;
+    DIDDocumentBuilder *builder;
+    DIDURL *keyid;
+    char publickeybase58[PUBLICKEY_BASE58_BYTES];
+    const char *keybase;
+
+    document = TestData_GetDocument("user1", NULL, 2);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(document);
+
+    CU_ASSERT_EQUAL(1, DIDDocument_IsGenuine(document));
+    CU_ASSERT_TRUE(document->cache.genuine);
+    CU_ASSERT_EQUAL(1, DIDDocument_IsGenuine(document));
+
+    builder = DIDDocument_Edit(document, NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(builder);
+
+    keyid = DIDURL_NewFromDid(&document->did, "memo");
+    CU_ASSERT_PTR_NOT_NULL(keyid);
+    keybase = Generater_Publickey(publickeybase58, sizeof(publickeybase58));
+    CU_ASSERT_PTR_NOT_NULL(keybase);
+    CU_ASSERT_NOT_EQUAL(-1, DIDDocumentBuilder_AddPublicKey(builder, keyid, &document->did, keybase));
+    DIDURL_Destroy(keyid);
+
+    sealeddoc = DIDDocumentBuilder_Seal(builder, storepass);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(sealeddoc);
+    DIDDocumentBuilder_Destroy(builder);
+
+    CU_ASSERT_FALSE(sealeddoc->cache.genuine);
+    CU_ASSERT_EQUAL(1, DIDDocument_IsGenuine(sealeddoc));
+    CU_ASSERT_TRUE(sealeddoc->cache.genuine);
+    CU_ASSERT_EQUAL(1, DIDDocument_IsGenuine(document));
+
+    DIDDocument_Destroy(sealeddoc);
+}
+
 static int diddoc_sign_test_suite_init(void)
 {
     DIDStore *store = TestData_SetupStore(true);
@@ -218,8 +297,10 @@ static int diddoc_sign_test_suite_cleanup(void)
 static CU_TestInfo cases[] = {
     {   "test_diddoc_sign_verify",                test_diddoc_sign_verify                },
     {   "test_ctmdoc_sign_verify",                test_ctmdoc_sign_verify                },
+    {   "test_diddoc_verify_oversized_signature", test_diddoc_verify_oversized_signature },
     {   "test_diddoc_derive_fromidentifier",      test_diddoc_derive_fromidentifier      },
     {   "test_diddoc_derive_compatible_withjava", test_diddoc_derive_compatible_withjava },
+    {   "test_diddoc_genuine_memo",               test_diddoc_genuine_memo               },
     {   NULL,                                     NULL                                   }
 };
 
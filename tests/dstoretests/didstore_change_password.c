@@ -101,6 +101,12 @@ static void test_didstore_change_password(void)
     //change password
     CU_ASSERT_NOT_EQUAL(-1, DIDStore_ChangePassword(store, "newpasswd", storepass));
 
+    //the journal is moved into data and removed with the post file.
+    CU_ASSERT_FALSE(dir_exist(get_file_path(_path, PATH_MAX, 3, store->root,
+            PATH_STEP, "password.journal")));
+    CU_ASSERT_FALSE(file_exist(get_file_path(_path, PATH_MAX, 3, store->root,
+            PATH_STEP, "postChangePassword")));
+
     count = 0;
     CU_ASSERT_NOT_EQUAL(-1, DIDStore_ListDIDs(store, 0, get_did, (void*)&count));
     CU_ASSERT_EQUAL(count, 10);
@@ -117,6 +123,11 @@ static void test_didstore_change_password(void)
     CU_ASSERT_PTR_NOT_NULL(newdoc);
     DIDDocument_Destroy(newdoc);
 
+    //the old password verified before isn't accepted any more.
+    newdoc = RootIdentity_NewDID(rootidentity, storepass, "old", false);
+    CU_ASSERT_PTR_NULL(newdoc);
+    DIDDocument_Destroy(newdoc);
+
     TestData_Free();
 }
 
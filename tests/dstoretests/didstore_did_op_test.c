@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -25,6 +26,27 @@ static int get_did(DID *did, void *context)
     return 0;
 }
 
+typedef struct Alias_Helper {
+    int count;
+    int aliased;
+} Alias_Helper;
+
+static int get_did_alias(DID *did, void *context)
+{
+    Alias_Helper *helper = (Alias_Helper*)context;
+    const char *alias;
+
+    if (!did)
+        return 0;
+
+    helper->count++;
+    alias = DIDMetadata_GetAlias(DID_GetMetadata(did));
+    if (alias && !strncmp(alias, "my did ", 7))
+        helper->aliased++;
+
+    return 0;
+}
+
 static void test_didstore_bulk_newdid(void)
 {
     RootIdentity *rootidentity;
@@ -194,6 +216,92 @@ static void test_didstore_op_store_load_did(void)
     TestData_Free();
 }
 
+static void test_didstore_op_list_index(void)
+{
+    RootIdentity *rootidentity;
+    char alias[ELA_MAX_ALIAS_LEN], _path[PATH_MAX];
+    Alias_Helper helper;
+    DID dids[10];
+    DIDStore *store;
+    char *path;
+    FILE *fp;
+    int i;
+
+    store = TestData_SetupStore(true);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(store);
+
+    rootidentity = TestData_InitIdentity(store);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(rootidentity);
+
+    for (i = 0; i < 10; i++) {
+        snprintf(alias, sizeof(alias), "my did %d", i);
+        DIDDocument *doc = RootIdentity_NewDID(rootidentity, storepass, alias, false);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+        DID_Copy(&dids[i], DIDDocument_GetSubject(doc));
+        DIDDocument_Destroy(doc);
+    }
+
+    CU_ASSERT_TRUE(DIDStore_DeleteDID(store, &dids[0]));
+    CU_ASSERT_TRUE(DIDStore_DeleteDID(store, &dids[1]));
+
+    memset(&helper, 0, sizeof(helper));
+    CU_ASSERT_NOT_EQUAL(-1, DIDStore_ListDIDs(store, 0, get_did_alias, (void*)&helper));
+    CU_ASSERT_EQUAL(8, helper.count);
+    CU_ASSERT_EQUAL(8, helper.aliased);
+
+    path = get_file_path(_path, PATH_MAX, 5, store->root, PATH_STEP, DATA_DIR,
+            PATH_STEP, STORE_INDEX_FILE);
+    CU_ASSERT_TRUE_FATAL(file_exist(path));
+
+    //a missing index is rebuilt from the store directories
+    delete_file(path);
+    memset(&helper, 0, sizeof(helper));
+    CU_ASSERT_NOT_EQUAL(-1, DIDStore_ListDIDs(store, 1, get_did_alias, (void*)&helper));
+    CU_ASSERT_EQUAL(8, helper.count);
+    CU_ASSERT_EQUAL(8, helper.aliased);
+    CU_ASSERT_TRUE(file_exist(path));
+
+    //so is a damaged one
+    fp = fopen(path, "a");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+    fputs("{\"did\":\n", fp);
+    fclose(fp);
+
+    CU_ASSERT_TRUE(DIDStore_DeleteDID(store, &dids[2]));
+    memset(&helper, 0, sizeof(helper));
+    CU_ASSERT_NOT_EQUAL(-1, DIDStore_ListDIDs(store, 0, get_did_alias, (void*)&helper));
+    CU_ASSERT_EQUAL(7, helper.count);
+    CU_ASSERT_EQUAL(7, helper.aliased);
+
+    //and one older than the directories changed behind the store
+    path = get_file_path(_path, PATH_MAX, 7, store->root, PATH_STEP, DATA_DIR,
+            PATH_STEP, IDS_DIR, PATH_STEP, dids[3].idstring);
+    CU_ASSERT_TRUE_FATAL(dir_exist(path));
+    delete_file(path);
+
+    memset(&helper, 0, sizeof(helper));
+    CU_ASSERT_NOT_EQUAL(-1, DIDStore_ListDIDs(store, 0, get_did_alias, (void*)&helper));
+    CU_ASSERT_EQUAL(6, helper.count);
+    CU_ASSERT_EQUAL(6, helper.aliased);
+
+    //a change inside a did directory doesn't touch the ids directory, the
+    //did entry carries its own stamp.
+    path = get_file_path(_path, PATH_MAX, 9, store->root, PATH_STEP, DATA_DIR,
+            PATH_STEP, IDS_DIR, PATH_STEP, dids[4].idstring, PATH_STEP, PRIVATEKEYS_DIR);
+    CU_ASSERT_TRUE_FATAL(dir_exist(path));
+    delete_file(path);
+
+    memset(&helper, 0, sizeof(helper));
+    CU_ASSERT_NOT_EQUAL(-1, DIDStore_ListDIDs(store, 1, get_did_alias, (void*)&helper));
+    CU_ASSERT_EQUAL(5, helper.count);
+
+    memset(&helper, 0, sizeof(helper));
+    CU_ASSERT_NOT_EQUAL(-1, DIDStore_ListDIDs(store, 2, get_did_alias, (void*)&helper));
+    CU_ASSERT_EQUAL(1, helper.count);
+
+    TestData_Free();
+}
+
 static int didstore_did_op_test_suite_init(void)
 {
     return 0;
@@ -208,6 +316,7 @@ static CU_TestInfo cases[] = {
     {  "test_didstore_bulk_newdid",       test_didstore_bulk_newdid          },
     {  "test_didstore_op_deletedid",      test_didstore_op_deletedid         },
     {  "test_didstore_op_store_load_did", test_didstore_op_store_load_did    },
+    {  "test_didstore_op_list_index",     test_didstore_op_list_index        },
     {  NULL,                              NULL                               }
 };
 
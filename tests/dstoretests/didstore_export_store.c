@@ -341,6 +341,83 @@ static void test_didstore_export_import_store(void)
     TestData_Free();
 }
 
+typedef struct Progress_Helper {
+    size_t done;
+    size_t total;
+    int calls;
+} Progress_Helper;
+
+static void store_progress(size_t done, size_t total, void *context)
+{
+    Progress_Helper *helper = (Progress_Helper*)context;
+
+    CU_ASSERT_TRUE(done > helper->done);
+    CU_ASSERT_TRUE(done <= total);
+
+    helper->done = done;
+    helper->total = total;
+    helper->calls++;
+}
+
+static void test_didstore_export_import_store_workers(void)
+{
+    DIDStore *store, *store2;
+    char _path[PATH_MAX], _path2[PATH_MAX], command[512];
+    char current[PATH_MAX], *_current;
+    char *path, *path2, *file;
+    Progress_Helper helper;
+
+    _current = get_current_path(current);
+
+    store = TestData_SetupTestStore(true, 2);
+    CU_ASSERT_PTR_NOT_NULL(store);
+
+    CU_ASSERT_PTR_NOT_NULL(TestData_GetDocument("user1", NULL, 2));
+    CU_ASSERT_PTR_NOT_NULL(TestData_GetDocument("user2", NULL, 2));
+    CU_ASSERT_PTR_NOT_NULL(TestData_GetDocument("user3", NULL, 2));
+    CU_ASSERT_PTR_NOT_NULL(TestData_GetDocument("issuer", NULL, 2));
+
+    file = get_tmp_file(_path, "storeexport.zip");
+    CU_ASSERT_PTR_NOT_NULL(file);
+
+    memset(&helper, 0, sizeof(helper));
+    CU_ASSERT_NOT_EQUAL(-1, DIDStore_ExportStoreEx(store, password, file, "1234",
+            4, store_progress, &helper));
+    CU_ASSERT_NOT_EQUAL(0, helper.calls);
+    CU_ASSERT_EQUAL(helper.total, helper.done);
+
+    //create new store
+    path = get_store_path(_path2, "restore");
+    CU_ASSERT_PTR_NOT_NULL(path);
+    delete_file(path);
+
+    store2 = DIDStore_Open(path);
+    CU_ASSERT_PTR_NOT_NULL(store2);
+
+    memset(&helper, 0, sizeof(helper));
+    CU_ASSERT_NOT_EQUAL(-1, DIDStore_ImportStoreEx(store2, password, file, "1234",
+            4, store_progress, &helper));
+    CU_ASSERT_NOT_EQUAL(0, helper.calls);
+    CU_ASSERT_EQUAL(helper.total, helper.done);
+
+    path = get_file_path(_path, PATH_MAX, 3, store->root, PATH_STEP, DATA_DIR);
+    CU_ASSERT_TRUE_FATAL(dir_exist(path));
+
+    path2 = get_file_path(_path2, PATH_MAX, 3, store2->root, PATH_STEP, DATA_DIR);
+    CU_ASSERT_TRUE_FATAL(dir_exist(path));
+
+    // to diff directory
+#if defined(_WIN32) || defined(_WIN64)
+    sprintf(command, "set PATH=%s/../../host/usr/bin;%%windir%%;%%windir%%/SYSTEM32 && diff -r %s %s", _current, path, path2);
+#else
+    sprintf(command, "diff -r %s %s", path, path2);
+#endif
+    CU_ASSERT_EQUAL(system(command), 0);
+
+    DIDStore_Close(store2);
+    TestData_Free();
+}
+
 static void testImportCompatible(void)
 {
     char path[PATH_MAX], _storepath[PATH_MAX];
@@ -579,6 +656,7 @@ static CU_TestInfo cases[] = {
     {  "test_didstore_export_import_did",              test_didstore_export_import_did              },
     {  "test_didstore_export_import_rootidentity",     test_didstore_export_import_rootidentity     },
     {  "test_didstore_export_import_store",            test_didstore_export_import_store            },
+    {  "test_didstore_export_import_store_workers",    test_didstore_export_import_store_workers    },
     {  "testImportCompatible",                         testImportCompatible            },
     {  NULL,                                           NULL                                         }
 };
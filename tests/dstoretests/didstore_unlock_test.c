@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <CUnit/Basic.h>
+#include <limits.h>
+
+#include "constant.h"
+#include "loader.h"
+#include "ela_did.h"
+#include "diddocument.h"
+#include "didstore.h"
+
+static const char *data = "unlocked didstore";
+
+static void test_didstore_unlock_sign(void)
+{
+    char _path[PATH_MAX], backup[PATH_MAX], signature[MAX_SIGNATURE_LEN];
+    DIDStore *store;
+    RootIdentity *rootidentity;
+    DIDDocument *doc;
+    DIDURL *signkey;
+    DID *did;
+    char *path;
+    int i;
+
+    store = TestData_SetupStore(true);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(store);
+
+    rootidentity = TestData_InitIdentity(store);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(rootidentity);
+
+    doc = RootIdentity_NewDID(rootidentity, storepass, NULL, false);
+    RootIdentity_Destroy(rootidentity);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+
+    did = DIDDocument_GetSubject(doc);
+    signkey = DIDDocument_GetDefaultPublicKey(doc);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(signkey);
+
+    CU_ASSERT_EQUAL(-1, DIDStore_Unlock(store, "wrongpasswd", 60));
+    CU_ASSERT_EQUAL(0, DIDStore_Unlock(store, storepass, 60));
+
+    CU_ASSERT_NOT_EQUAL(-1, DIDDocument_Sign(doc, signkey, storepass, signature,
+            1, (unsigned char*)data, strlen(data)));
+    CU_ASSERT_NOT_EQUAL(-1, DIDDocument_Verify(doc, signkey, signature,
+            1, (unsigned char*)data, strlen(data)));
+
+    //the unlocked key signs without the key file.
+    path = get_file_path(_path, PATH_MAX, 11, store->root, PATH_STEP, DATA_DIR,
+            PATH_STEP, IDS_DIR, PATH_STEP, did->idstring, PATH_STEP, PRIVATEKEYS_DIR,
+            PATH_STEP, signkey->fragment);
+    CU_ASSERT_TRUE_FATAL(file_exist(path));
+    snprintf(backup, sizeof(backup), "%s.bak", path);
+    CU_ASSERT_EQUAL_FATAL(0, rename(path, backup));
+
+    for (i = 0; i < 10; i++) {
+        CU_ASSERT_NOT_EQUAL(-1, DIDDocument_Sign(doc, signkey, storepass, signature,
+                1, (unsigned char*)data, strlen(data)));
+        CU_ASSERT_NOT_EQUAL(-1, DIDDocument_Verify(doc, signkey, signature,
+                1, (unsigned char*)data, strlen(data)));
+    }
+
+    //a wrong storepass never uses the session.
+    CU_ASSERT_EQUAL(-1, DIDDocument_Sign(doc, signkey, "wrongpasswd", signature,
+            1, (unsigned char*)data, strlen(data)));
+
+    DIDStore_Lock(store);
+    CU_ASSERT_EQUAL(-1, DIDDocument_Sign(doc, signkey, storepass, signature,
+            1, (unsigned char*)data, strlen(data)));
+
+    DIDDocument_Destroy(doc);
+    TestData_Free();
+}
+
+static void test_didstore_unlock_expired(void)
+{
+    char signature[MAX_SIGNATURE_LEN];
+    DIDStore *store;
+    RootIdentity *rootidentity;
+    DIDDocument *doc;
+    DIDURL *signkey;
+
+    store = TestData_SetupStore(true);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(store);
+
+    rootidentity = TestData_InitIdentity(store);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(rootidentity);
+
+    doc = RootIdentity_NewDID(rootidentity, storepass, NULL, false);
+    RootIdentity_Destroy(rootidentity);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+
+    signkey = DIDDocument_GetDefaultPublicKey(doc);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(signkey);
+
+    CU_ASSERT_EQUAL(0, DIDStore_Unlock(store, storepass, 1));
+    CU_ASSERT_NOT_EQUAL(-1, DIDDocument_Sign(doc, signkey, storepass, signature,
+            1, (unsigned char*)data, strlen(data)));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(store->session);
+    CU_ASSERT_EQUAL(1, KeySession_CountKeys(store->session));
+
+    sleep(2);
+
+    //the sweeper wipes the keys at the ttl, no sign call needed.
+    CU_ASSERT_EQUAL(0, KeySession_CountKeys(store->session));
+
+    //the expired session falls back to the key file.
+    CU_ASSERT_NOT_EQUAL(-1, DIDDocument_Sign(doc, signkey, storepass, signature,
+            1, (unsigned char*)data, strlen(data)));
+    CU_ASSERT_NOT_EQUAL(-1, DIDDocument_Verify(doc, signkey, signature,
+            1, (unsigned char*)data, strlen(data)));
+
+    DIDDocument_Destroy(doc);
+    TestData_Free();
+}
+
+static int didstore_unlock_test_suite_init(void)
+{
+    return 0;
+}
+
+static int didstore_unlock_test_suite_cleanup(void)
+{
+    return 0;
+}
+
+static CU_TestInfo cases[] = {
+    {  "test_didstore_unlock_sign",          test_didstore_unlock_sign          },
+    {  "test_didstore_unlock_expired",       test_didstore_unlock_expired       },
+    {  NULL,                                 NULL                               }
+};
+
+static CU_SuiteInfo suite[] = {
+    {  "didstore unlock test",  didstore_unlock_test_suite_init,  didstore_unlock_test_suite_cleanup,   NULL, NULL, cases },
+    {  NULL,                    NULL,                             NULL,                                 NULL, NULL, NULL  }
+};
+
+CU_SuiteInfo* didstore_unlock_test_suite_info(void)
+{
+    return suite;
+}
@@ -268,6 +268,73 @@ static void test_didstore_delete_vc(void)
     TestData_Free();
 }
 
+static int count_vc(DIDURL *id, void *context)
+{
+    int *count = (int*)context;
+
+    if (id)
+        (*count)++;
+
+    return 0;
+}
+
+static void test_didstore_select_vcs(void)
+{
+    DIDDocument *doc;
+    DIDStore *store;
+    DIDURL *id;
+    DID *did;
+    int count;
+
+    store = TestData_SetupStore(true);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(store);
+
+    CU_ASSERT_PTR_NOT_NULL(TestData_GetDocument("issuer", NULL, 0));
+    doc = TestData_GetDocument("document", NULL, 0);
+    did = DIDDocument_GetSubject(doc);
+
+    CU_ASSERT_PTR_NOT_NULL(TestData_GetCredential(NULL, "vc-profile", NULL, 0));
+    CU_ASSERT_PTR_NOT_NULL(TestData_GetCredential(NULL, "vc-email", NULL, 0));
+    CU_ASSERT_PTR_NOT_NULL(TestData_GetCredential(NULL, "vc-twitter", NULL, 0));
+    CU_ASSERT_PTR_NOT_NULL(TestData_GetCredential(NULL, "vc-passport", NULL, 0));
+
+    count = 0;
+    CU_ASSERT_NOT_EQUAL(-1, DIDStore_SelectCredentials(store, did, NULL,
+            "BasicProfileCredential", count_vc, (void*)&count));
+    CU_ASSERT_EQUAL(3, count);
+
+    count = 0;
+    CU_ASSERT_NOT_EQUAL(-1, DIDStore_SelectCredentials(store, did, NULL,
+            "TwitterCredential", count_vc, (void*)&count));
+    CU_ASSERT_EQUAL(1, count);
+
+    id = DIDURL_NewFromDid(did, "email");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(id);
+    count = 0;
+    CU_ASSERT_NOT_EQUAL(-1, DIDStore_SelectCredentials(store, did, id,
+            "EmailCredential", count_vc, (void*)&count));
+    CU_ASSERT_EQUAL(1, count);
+    DIDURL_Destroy(id);
+
+    id = DIDURL_NewFromDid(did, "twitter");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(id);
+    CU_ASSERT_EQUAL(-1, DIDStore_SelectCredentials(store, did, id,
+            "EmailCredential", count_vc, (void*)&count));
+    DIDURL_Destroy(id);
+
+    id = DIDURL_NewFromDid(did, "passport");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(id);
+    CU_ASSERT_TRUE(DIDStore_DeleteCredential(store, did, id));
+    DIDURL_Destroy(id);
+
+    count = 0;
+    CU_ASSERT_NOT_EQUAL(-1, DIDStore_SelectCredentials(store, did, NULL,
+            "BasicProfileCredential", count_vc, (void*)&count));
+    CU_ASSERT_EQUAL(2, count);
+
+    TestData_Free();
+}
+
 static int didstore_vc_op_test_suite_init(void)
 {
     return 0;
@@ -282,6 +349,7 @@ static CU_TestInfo cases[] = {
     {  "test_didstore_load_vcs",       test_didstore_load_vcs     },
     {  "test_didstore_list_vcs",       test_didstore_list_vcs     },
     {  "test_didstore_delete_vc",      test_didstore_delete_vc    },
+    {  "test_didstore_select_vcs",     test_didstore_select_vcs   },
     {  NULL,                           NULL                       }
 };
 
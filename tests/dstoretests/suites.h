@@ -29,6 +29,7 @@ DECL_TESTSUITE(didstore_did_op_test);
 DECL_TESTSUITE(didstore_vc_op_test);
 DECL_TESTSUITE(didstore_change_password_test);
 DECL_TESTSUITE(didstore_export_store_test);
+DECL_TESTSUITE(didstore_unlock_test);
 
 #define DEFINE_DSTORE_TESTSUITES \
     DEFINE_TESTSUITE(didstore_change_password_test), \
@@ -36,7 +37,8 @@ DECL_TESTSUITE(didstore_export_store_test);
     DEFINE_TESTSUITE(didstore_initial_test), \
     DEFINE_TESTSUITE(didstore_openstore_test), \
     DEFINE_TESTSUITE(didstore_vc_op_test), \
-    DEFINE_TESTSUITE(didstore_export_store_test)
+    DEFINE_TESTSUITE(didstore_export_store_test), \
+    DEFINE_TESTSUITE(didstore_unlock_test)
 
 #endif /* __DSTORE_TEST_SUITES_H__ */
 
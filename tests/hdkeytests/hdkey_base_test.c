@@ -280,6 +280,46 @@ static void test_base64_compatible(void)
     }
 }
 
+static void test_base64_decode(void)
+{
+    uint8_t data[256];
+    ssize_t len;
+    int i, j;
+
+    for (i = 0; i < 256; i++) {
+        len = b64_url_decode(data, base64output[i]);
+        CU_ASSERT_EQUAL_FATAL(len, i + 1);
+        for (j = 0; j < len; j++)
+            CU_ASSERT_EQUAL(data[j], j);
+    }
+
+    //padding and the standard alphabet are accepted, other chars are not.
+    CU_ASSERT_EQUAL(b64_url_decode(data, "AP8="), 2);
+    CU_ASSERT_EQUAL(b64_url_decode(data, "-_+/"), 3);
+    CU_ASSERT_EQUAL(b64_url_decode(data, "AP8$"), -1);
+    CU_ASSERT_EQUAL(b64_url_decode(data, "AP8=A"), -1);
+}
+
+static void test_base58_roundtrip(void)
+{
+    uint8_t input[PUBLICKEY_BYTES], output[PUBLICKEY_BYTES];
+    char base58[PUBLICKEY_BASE58_BYTES];
+    int i, j;
+
+    for (i = 0; i < 64; i++) {
+        for (j = 0; j < sizeof(input); j++)
+            input[j] = (uint8_t)(i * 31 + j * 7);
+        input[0] = 0x02 + i % 2;
+
+        CU_ASSERT_TRUE(b58_encode(base58, sizeof(base58), input, sizeof(input)) > 0);
+        CU_ASSERT_EQUAL(b58_decode(output, sizeof(output), base58), sizeof(output));
+        CU_ASSERT_EQUAL(memcmp(input, output, sizeof(input)), 0);
+
+        //the output buffer is too small.
+        CU_ASSERT_EQUAL(b58_decode(output, sizeof(output) - 1, base58), 0);
+    }
+}
+
 static void test_encrypt_compatible(void)
 {
     char base64[512];
@@ -335,6 +375,8 @@ static int hdkey_base_test_suite_cleanup(void)
 
 static CU_TestInfo cases[] = {
     {   "test_base64_compatible",           test_base64_compatible         },
+    {   "test_base64_decode",               test_base64_decode             },
+    {   "test_base58_roundtrip",            test_base58_roundtrip          },
     {   "test_encrypt_compatible",          test_encrypt_compatible        },
     {   "test_encrypt_decrypt",             test_encrypt_decrypt           },
     {   "test_base64_decode_forpayload",    test_base64_decode_forpayload  },
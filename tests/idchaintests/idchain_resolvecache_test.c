@@ -0,0 +1,605 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <CUnit/Basic.h>
+#include <limits.h>
+#include <sys/stat.h>
+#if defined(_WIN32) || defined(_WIN64)
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+#include <crystal.h>
+
+#include "constant.h"
+#include "loader.h"
+#include "ela_did.h"
+#include "did.h"
+#include "didmeta.h"
+#include "diddocument.h"
+#include "common.h"
+#include "resolvercache.h"
+#include "didbackend.h"
+#include "resolveresult.h"
+
+#define MEMORY_CACHE_SIZE         (4 * 1024 * 1024)
+
+static DIDStore *store;
+
+static DIDDocument *publish_newdid(DID *did)
+{
+    RootIdentity *rootidentity;
+    DIDDocument *doc;
+    const char *mnemonic;
+    bool success;
+
+    mnemonic = Mnemonic_Generate(language);
+    rootidentity = RootIdentity_Create(mnemonic, "", true, store, storepass);
+    Mnemonic_Free((void*)mnemonic);
+    if (!rootidentity)
+        return NULL;
+
+    doc = RootIdentity_NewDID(rootidentity, storepass, NULL, false);
+    RootIdentity_Destroy(rootidentity);
+    if (!doc)
+        return NULL;
+
+    success = DIDDocument_PublishDID(doc, NULL, false, storepass);
+    if (!success) {
+        DIDDocument_Destroy(doc);
+        return NULL;
+    }
+
+    DID_Copy(did, DIDDocument_GetSubject(doc));
+    return doc;
+}
+
+static void test_resolvecache_returns_copy(void)
+{
+    DIDDocument *doc, *resolvedoc1, *resolvedoc2;
+    int status;
+    DID did;
+
+    doc = publish_newdid(&did);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+
+    resolvedoc1 = DID_Resolve(&did, &status, true);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resolvedoc1);
+    CU_ASSERT_EQUAL(DIDStatus_Valid, status);
+
+    resolvedoc2 = DID_Resolve(&did, &status, false);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resolvedoc2);
+    CU_ASSERT_EQUAL(DIDStatus_Valid, status);
+    CU_ASSERT_PTR_NOT_EQUAL(resolvedoc1, resolvedoc2);
+    CU_ASSERT_STRING_EQUAL(DIDDocument_GetProofSignature(doc, 0),
+            DIDDocument_GetProofSignature(resolvedoc2, 0));
+    CU_ASSERT_STRING_EQUAL(DIDMetadata_GetTxid(DIDDocument_GetMetadata(resolvedoc1)),
+            DIDMetadata_GetTxid(DIDDocument_GetMetadata(resolvedoc2)));
+
+    //changing the returned document must not leak into the cache.
+    CU_ASSERT_NOT_EQUAL(-1, DIDMetadata_SetAlias(DIDDocument_GetMetadata(resolvedoc2), "cached"));
+    DIDDocument_Destroy(resolvedoc2);
+
+    resolvedoc2 = DID_Resolve(&did, &status, false);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resolvedoc2);
+    CU_ASSERT_PTR_NULL(DIDMetadata_GetAlias(DIDDocument_GetMetadata(resolvedoc2)));
+
+    DIDDocument_Destroy(resolvedoc2);
+    DIDDocument_Destroy(resolvedoc1);
+    DIDDocument_Destroy(doc);
+}
+
+static void test_resolvecache_invalidate_after_update(void)
+{
+    DIDDocument *doc, *resolvedoc;
+    DIDDocumentBuilder *builder;
+    char publickeybase58[PUBLICKEY_BASE58_BYTES];
+    const char *keybase;
+    DIDURL *keyid;
+    int status, rc;
+    DID did;
+
+    doc = publish_newdid(&did);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+
+    resolvedoc = DID_Resolve(&did, &status, false);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resolvedoc);
+    CU_ASSERT_EQUAL(1, DIDDocument_GetPublicKeyCount(resolvedoc));
+    DIDDocument_Destroy(resolvedoc);
+
+    builder = DIDDocument_Edit(doc, NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(builder);
+    DIDDocument_Destroy(doc);
+
+    keybase = Generater_Publickey(publickeybase58, sizeof(publickeybase58));
+    CU_ASSERT_PTR_NOT_NULL(keybase);
+    keyid = DIDURL_NewFromDid(&did, "key1");
+    CU_ASSERT_PTR_NOT_NULL(keyid);
+    rc = DIDDocumentBuilder_AddAuthenticationKey(builder, keyid, keybase);
+    CU_ASSERT_NOT_EQUAL(rc, -1);
+    DIDURL_Destroy(keyid);
+
+    doc = DIDDocumentBuilder_Seal(builder, storepass);
+    DIDDocumentBuilder_Destroy(builder);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+
+    rc = DIDStore_StoreDID(store, doc);
+    CU_ASSERT_NOT_EQUAL(rc, -1);
+
+    CU_ASSERT_TRUE(DIDDocument_PublishDID(doc, NULL, false, storepass));
+
+    resolvedoc = DID_Resolve(&did, &status, false);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resolvedoc);
+    CU_ASSERT_EQUAL(2, DIDDocument_GetPublicKeyCount(resolvedoc));
+    CU_ASSERT_STRING_EQUAL(DIDDocument_GetProofSignature(doc, 0),
+            DIDDocument_GetProofSignature(resolvedoc, 0));
+
+    DIDDocument_Destroy(resolvedoc);
+    DIDDocument_Destroy(doc);
+}
+
+static void test_resolvecache_disabled(void)
+{
+    DIDDocument *doc, *resolvedoc;
+    int status;
+    DID did;
+
+    DIDBackend_SetMemoryCacheSize(0);
+
+    doc = publish_newdid(&did);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+
+    resolvedoc = DID_Resolve(&did, &status, false);
+    CU_ASSERT_PTR_NOT_NULL(resolvedoc);
+    CU_ASSERT_EQUAL(DIDStatus_Valid, status);
+    DIDDocument_Destroy(resolvedoc);
+
+    resolvedoc = DID_Resolve(&did, &status, false);
+    CU_ASSERT_PTR_NOT_NULL(resolvedoc);
+    CU_ASSERT_EQUAL(DIDStatus_Valid, status);
+    DIDDocument_Destroy(resolvedoc);
+
+    DIDDocument_Destroy(doc);
+    DIDBackend_SetMemoryCacheSize(MEMORY_CACHE_SIZE);
+}
+
+static void test_resolvecache_verified_result(void)
+{
+    DIDDocument *doc, *resolvedoc;
+    int status;
+    DID did;
+
+    //bypass the memory cache to load the result from the cache directory.
+    DIDBackend_SetMemoryCacheSize(0);
+
+    doc = publish_newdid(&did);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+
+    resolvedoc = DID_Resolve(&did, &status, true);
+    CU_ASSERT_PTR_NOT_NULL(resolvedoc);
+    DIDDocument_Destroy(resolvedoc);
+
+    resolvedoc = DID_Resolve(&did, &status, false);
+    CU_ASSERT_PTR_NOT_NULL(resolvedoc);
+    CU_ASSERT_EQUAL(DIDStatus_Valid, status);
+    CU_ASSERT_STRING_EQUAL(DIDDocument_GetProofSignature(doc, 0),
+            DIDDocument_GetProofSignature(resolvedoc, 0));
+    DIDDocument_Destroy(resolvedoc);
+
+    DIDBackend_SetVerifyOnLoad(true);
+    resolvedoc = DID_Resolve(&did, &status, false);
+    CU_ASSERT_PTR_NOT_NULL(resolvedoc);
+    CU_ASSERT_EQUAL(DIDStatus_Valid, status);
+    DIDDocument_Destroy(resolvedoc);
+    DIDBackend_SetVerifyOnLoad(false);
+
+    DIDDocument_Destroy(doc);
+    DIDBackend_SetMemoryCacheSize(MEMORY_CACHE_SIZE);
+}
+
+static void test_resolvecache_binary_entry(void)
+{
+    DIDDocument *doc, *resolvedoc;
+    ResolveResult result;
+    const uint8_t *data, *encoded;
+    const char *json;
+    char root[PATH_MAX], path[PATH_MAX];
+    size_t len, size;
+    int status, rc;
+    DID did;
+
+    DIDBackend_SetMemoryCacheSize(0);
+
+    doc = publish_newdid(&did);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+
+    resolvedoc = DID_Resolve(&did, &status, true);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resolvedoc);
+    DIDDocument_Destroy(resolvedoc);
+
+    //the entry is binary and decodes back to the same bytes.
+    CU_ASSERT_PTR_NOT_NULL_FATAL(ResolverCache_GetCacheDir(&DIDBackend_GetCurrent()->cache, root, sizeof(root)));
+    snprintf(path, sizeof(path), "%s%s%s", root, PATH_SEP, did.idstring);
+    data = (const uint8_t*)load_data(path, &len);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(data);
+    CU_ASSERT_TRUE(ResolveResult_IsBinary(data, len));
+
+    memset(&result, 0, sizeof(result));
+    rc = ResolveResult_FromBinary(&result, data, len, true);
+    CU_ASSERT_EQUAL_FATAL(rc, 0);
+    CU_ASSERT_EQUAL(DIDStatus_Valid, result.status);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(result.txs.txs[0].request.doc);
+    CU_ASSERT_STRING_EQUAL(DIDDocument_GetProofSignature(doc, 0),
+            DIDDocument_GetProofSignature(result.txs.txs[0].request.doc, 0));
+
+    encoded = ResolveResult_ToBinary(&result, &size);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(encoded);
+    CU_ASSERT_EQUAL(size, len);
+    CU_ASSERT_EQUAL(memcmp(encoded, data, len), 0);
+    free((void*)encoded);
+    free((void*)data);
+
+    //a json entry from an earlier version is still loaded.
+    json = ResolveResult_ToJson(&result);
+    ResolveResult_Destroy(&result);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(json);
+    CU_ASSERT_NOT_EQUAL(store_file(path, json), -1);
+    free((void*)json);
+
+    resolvedoc = DID_Resolve(&did, &status, false);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resolvedoc);
+    CU_ASSERT_EQUAL(DIDStatus_Valid, status);
+    CU_ASSERT_STRING_EQUAL(DIDDocument_GetProofSignature(doc, 0),
+            DIDDocument_GetProofSignature(resolvedoc, 0));
+    DIDDocument_Destroy(resolvedoc);
+
+    DIDDocument_Destroy(doc);
+    DIDBackend_SetMemoryCacheSize(MEMORY_CACHE_SIZE);
+}
+
+static void test_resolvecache_forged_document(void)
+{
+    DIDDocument *doc, *resolvedoc;
+    ResolveResult result;
+    const char *key;
+    char root[PATH_MAX], path[PATH_MAX];
+    uint8_t *data;
+    size_t len, keylen, i;
+    int status;
+    DID did;
+
+    DIDBackend_SetMemoryCacheSize(0);
+
+    doc = publish_newdid(&did);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+
+    resolvedoc = DID_Resolve(&did, &status, true);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resolvedoc);
+    DIDDocument_Destroy(resolvedoc);
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(ResolverCache_GetCacheDir(&DIDBackend_GetCurrent()->cache, root, sizeof(root)));
+    snprintf(path, sizeof(path), "%s%s%s", root, PATH_SEP, did.idstring);
+    data = (uint8_t*)load_data(path, &len);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(data);
+
+    //the key only shows in clear in the decoded document next to the payload.
+    key = DIDDocument_GetPublicKey(doc, DIDDocument_GetDefaultPublicKey(doc))->publicKeyBase58;
+    keylen = strlen(key);
+    for (i = 0; i + keylen <= len; i++) {
+        if (!memcmp(data + i, key, keylen))
+            break;
+    }
+    CU_ASSERT_FATAL(i + keylen <= len);
+    data[i + keylen - 1] = data[i + keylen - 1] == 'A' ? 'B' : 'A';
+
+    memset(&result, 0, sizeof(result));
+    CU_ASSERT_EQUAL(ResolveResult_FromBinary(&result, data, len, true), -1);
+    ResolveResult_Destroy(&result);
+
+    CU_ASSERT_NOT_EQUAL(store_data(path, data, len), -1);
+    free(data);
+
+    //the forged entry is dropped, the document is resolved again.
+    resolvedoc = DID_Resolve(&did, &status, false);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resolvedoc);
+    CU_ASSERT_STRING_EQUAL(key, DIDDocument_GetPublicKey(resolvedoc,
+            DIDDocument_GetDefaultPublicKey(resolvedoc))->publicKeyBase58);
+    DIDDocument_Destroy(resolvedoc);
+
+    DIDDocument_Destroy(doc);
+    DIDBackend_SetMemoryCacheSize(MEMORY_CACHE_SIZE);
+}
+
+static void test_resolvecache_marker_key(void)
+{
+    DIDDocument *doc, *resolvedoc;
+    ResolverCache cache;
+    ResolveResult result;
+    char root[PATH_MAX], path[PATH_MAX];
+    struct stat st;
+    bool verified = false;
+    int status;
+    DID did;
+
+    DIDBackend_SetMemoryCacheSize(0);
+
+    doc = publish_newdid(&did);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+
+    resolvedoc = DID_Resolve(&did, &status, true);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resolvedoc);
+    DIDDocument_Destroy(resolvedoc);
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(ResolverCache_GetCacheDir(&DIDBackend_GetCurrent()->cache, root, sizeof(root)));
+    snprintf(path, sizeof(path), "%s%s%s", root, PATH_SEP, ".markkey");
+    CU_ASSERT_EQUAL_FATAL(stat(path, &st), 0);
+#if !defined(_WIN32) && !defined(_WIN64)
+    CU_ASSERT_EQUAL(st.st_mode & (S_IRWXG | S_IRWXO), 0);
+#endif
+
+    //mark the entry with one cache, then read it with another one on the
+    //same directory as a restarted process would.
+    CU_ASSERT_EQUAL_FATAL(ResolverCache_Init(&cache), 0);
+    CU_ASSERT_NOT_EQUAL(ResolverCache_SetCacheDir(&cache, root), -1);
+    memset(&result, 0, sizeof(result));
+    CU_ASSERT_EQUAL_FATAL(ResolverCache_LoadDID(&cache, &result, &did, 3600, NULL, NULL), 0);
+    CU_ASSERT_NOT_EQUAL(ResolveCache_MarkDIDVerified(&cache, &result, &did), -1);
+    ResolveResult_Destroy(&result);
+    ResolverCache_Free(&cache);
+
+    CU_ASSERT_EQUAL_FATAL(ResolverCache_Init(&cache), 0);
+    CU_ASSERT_NOT_EQUAL(ResolverCache_SetCacheDir(&cache, root), -1);
+    memset(&result, 0, sizeof(result));
+    CU_ASSERT_EQUAL(ResolverCache_LoadDID(&cache, &result, &did, 3600, &verified, NULL), 0);
+    CU_ASSERT_TRUE(verified);
+    ResolveResult_Destroy(&result);
+    ResolverCache_Free(&cache);
+
+    DIDDocument_Destroy(doc);
+    DIDBackend_SetMemoryCacheSize(MEMORY_CACHE_SIZE);
+}
+
+static void test_resolvecache_memory_ttl(void)
+{
+    DIDDocument *doc, *resolvedoc;
+    char root[PATH_MAX], path[PATH_MAX];
+    struct utimbuf times;
+    int status;
+    DID did;
+
+    doc = publish_newdid(&did);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+
+    resolvedoc = DID_Resolve(&did, &status, true);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resolvedoc);
+    DIDDocument_Destroy(resolvedoc);
+
+    //the cached result was fetched 100 seconds ago.
+    CU_ASSERT_PTR_NOT_NULL_FATAL(ResolverCache_GetCacheDir(&DIDBackend_GetCurrent()->cache, root, sizeof(root)));
+    snprintf(path, sizeof(path), "%s%s%s", root, PATH_SEP, did.idstring);
+    times.actime = times.modtime = time(NULL) - 100;
+    CU_ASSERT_EQUAL_FATAL(utime(path, &times), 0);
+
+    //empty the memory tier, the next resolve fills it from the file.
+    DIDBackend_SetMemoryCacheSize(0);
+    DIDBackend_SetMemoryCacheSize(MEMORY_CACHE_SIZE);
+
+    resolvedoc = DID_Resolve(&did, &status, false);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resolvedoc);
+    DIDDocument_Destroy(resolvedoc);
+
+    //the memory copy is as old as the file it came from.
+    resolvedoc = ResolverCache_LoadDocument(&DIDBackend_GetCurrent()->cache, &did, 3600, &status);
+    CU_ASSERT_PTR_NOT_NULL(resolvedoc);
+    DIDDocument_Destroy(resolvedoc);
+
+    CU_ASSERT_PTR_NULL(ResolverCache_LoadDocument(&DIDBackend_GetCurrent()->cache, &did, 50, &status));
+
+    DIDDocument_Destroy(doc);
+}
+
+static void test_resolve_batch(void)
+{
+    DIDDocument *doc1, *doc2, *docs[5];
+    DIDStatus statuses[5];
+    DID did1, did2, *unknown, *dids[5];
+    int i, rc;
+
+    doc1 = publish_newdid(&did1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc1);
+    doc2 = publish_newdid(&did2);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc2);
+    unknown = DID_New("iZFrhZLetd6i6qPu2MsYvE2aKrgw7Af4Ww");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(unknown);
+
+    dids[0] = &did1;
+    dids[1] = &did2;
+    dids[2] = unknown;
+    dids[3] = &did1;
+    dids[4] = &did2;
+
+    rc = DID_ResolveBatch(dids, 5, docs, statuses, false);
+    CU_ASSERT_EQUAL(0, rc);
+
+    CU_ASSERT_PTR_NOT_NULL(docs[0]);
+    CU_ASSERT_PTR_NOT_NULL(docs[1]);
+    CU_ASSERT_PTR_NULL(docs[2]);
+    CU_ASSERT_PTR_NOT_NULL(docs[3]);
+    CU_ASSERT_PTR_NOT_NULL(docs[4]);
+    CU_ASSERT_EQUAL(DIDStatus_Valid, statuses[0]);
+    CU_ASSERT_EQUAL(DIDStatus_Valid, statuses[1]);
+    CU_ASSERT_EQUAL(DIDStatus_NotFound, statuses[2]);
+    CU_ASSERT_EQUAL(DIDStatus_Valid, statuses[3]);
+    CU_ASSERT_EQUAL(DIDStatus_Valid, statuses[4]);
+
+    //the repeated dids get their own documents.
+    CU_ASSERT_PTR_NOT_EQUAL(docs[0], docs[3]);
+    CU_ASSERT_PTR_NOT_EQUAL(docs[1], docs[4]);
+    CU_ASSERT_TRUE(DID_Equals(&did1, DIDDocument_GetSubject(docs[3])));
+    CU_ASSERT_TRUE(DID_Equals(&did2, DIDDocument_GetSubject(docs[4])));
+    CU_ASSERT_STRING_EQUAL(DIDDocument_GetProofSignature(doc1, 0),
+            DIDDocument_GetProofSignature(docs[0], 0));
+    CU_ASSERT_STRING_EQUAL(DIDDocument_GetProofSignature(doc2, 0),
+            DIDDocument_GetProofSignature(docs[1], 0));
+
+    for (i = 0; i < 5; i++)
+        DIDDocument_Destroy(docs[i]);
+
+    rc = DID_ResolveBatch(dids, 5, docs, statuses, true);
+    CU_ASSERT_EQUAL(0, rc);
+    CU_ASSERT_EQUAL(DIDStatus_Valid, statuses[0]);
+    CU_ASSERT_EQUAL(DIDStatus_NotFound, statuses[2]);
+    CU_ASSERT_EQUAL(DIDStatus_Valid, statuses[4]);
+
+    for (i = 0; i < 5; i++)
+        DIDDocument_Destroy(docs[i]);
+
+    DID_Destroy(unknown);
+    DIDDocument_Destroy(doc2);
+    DIDDocument_Destroy(doc1);
+}
+
+typedef struct AsyncResult {
+    int calls;
+    DIDDocument *doc;
+    DIDStatus status;
+} AsyncResult;
+
+static void resolve_done(DID *did, DIDDocument *document, DIDStatus status, void *context)
+{
+    AsyncResult *result = (AsyncResult*)context;
+
+    CU_ASSERT_PTR_NOT_NULL(did);
+    result->calls++;
+    result->doc = document;
+    result->status = status;
+}
+
+static void test_resolve_async(void)
+{
+    DIDDocument *doc;
+    AsyncResult results[3];
+    DID did, *unknown;
+    int i, rc;
+
+    doc = publish_newdid(&did);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+    unknown = DID_New("iZFrhZLetd6i6qPu2MsYvE2aKrgw7Af4Ww");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(unknown);
+
+    memset(results, 0, sizeof(results));
+    CU_ASSERT_EQUAL(0, DID_ResolveAsync(&did, true, resolve_done, &results[0]));
+    CU_ASSERT_EQUAL(0, DID_ResolveAsync(&did, false, resolve_done, &results[1]));
+    CU_ASSERT_EQUAL(0, DID_ResolveAsync(unknown, false, resolve_done, &results[2]));
+
+    while ((rc = DIDBackend_Poll(100)) > 0);
+    CU_ASSERT_EQUAL(0, rc);
+
+    for (i = 0; i < 3; i++)
+        CU_ASSERT_EQUAL(1, results[i].calls);
+
+    CU_ASSERT_EQUAL(DIDStatus_Valid, results[0].status);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(results[0].doc);
+    CU_ASSERT_STRING_EQUAL(DIDDocument_GetProofSignature(doc, 0),
+            DIDDocument_GetProofSignature(results[0].doc, 0));
+    CU_ASSERT_EQUAL(DIDStatus_Valid, results[1].status);
+    CU_ASSERT_PTR_NOT_NULL(results[1].doc);
+    CU_ASSERT_EQUAL(DIDStatus_NotFound, results[2].status);
+    CU_ASSERT_PTR_NULL(results[2].doc);
+
+    //nothing in flight.
+    CU_ASSERT_EQUAL(0, DIDBackend_Poll(0));
+
+    DIDDocument_Destroy(results[0].doc);
+    DIDDocument_Destroy(results[1].doc);
+    DID_Destroy(unknown);
+    DIDDocument_Destroy(doc);
+}
+
+static const char *offline_resolve(const char *request)
+{
+    return NULL;
+}
+
+static void test_backend_context(void)
+{
+    DIDBackend *backend, *previous;
+    DIDDocument *doc, *resolvedoc;
+    char cachedir[PATH_MAX];
+    int status;
+    DID did;
+
+    doc = publish_newdid(&did);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(doc);
+
+    resolvedoc = DID_Resolve(&did, &status, false);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resolvedoc);
+    DIDDocument_Destroy(resolvedoc);
+
+    snprintf(cachedir, sizeof(cachedir), "%s%s%s", getenv("HOME"), PATH_STEP, ".cache.did.offline");
+    backend = DIDBackend_Create(NULL, offline_resolve, cachedir);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(backend);
+
+    //the second backend shares neither the resolver nor the cache.
+    previous = DIDBackend_Use(backend);
+    CU_ASSERT_PTR_NULL(previous);
+    CU_ASSERT_TRUE(DIDBackend_IsInitialized());
+
+    resolvedoc = DID_Resolve(&did, &status, false);
+    CU_ASSERT_PTR_NULL(resolvedoc);
+    CU_ASSERT_EQUAL(-1, DIDDocument_PublishDID(doc, NULL, true, storepass));
+
+    previous = DIDBackend_Use(NULL);
+    CU_ASSERT_PTR_EQUAL(previous, backend);
+    DIDBackend_Destroy(backend);
+
+    resolvedoc = DID_Resolve(&did, &status, false);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resolvedoc);
+    CU_ASSERT_EQUAL(DIDStatus_Valid, status);
+    DIDDocument_Destroy(resolvedoc);
+
+    DIDDocument_Destroy(doc);
+}
+
+static int idchain_resolvecache_test_suite_init(void)
+{
+    store = TestData_SetupStore(true);
+    if (!store)
+        return -1;
+
+    return 0;
+}
+
+static int idchain_resolvecache_test_suite_cleanup(void)
+{
+    TestData_Free();
+    return 0;
+}
+
+static CU_TestInfo cases[] = {
+    { "test_resolvecache_returns_copy",               test_resolvecache_returns_copy              },
+    { "test_resolvecache_invalidate_after_update",    test_resolvecache_invalidate_after_update   },
+    { "test_resolvecache_disabled",                   test_resolvecache_disabled                  },
+    { "test_resolvecache_verified_result",            test_resolvecache_verified_result           },
+    { "test_resolvecache_binary_entry",               test_resolvecache_binary_entry              },
+    { "test_resolvecache_forged_document",            test_resolvecache_forged_document           },
+    { "test_resolvecache_marker_key",                 test_resolvecache_marker_key                },
+    { "test_resolvecache_memory_ttl",                 test_resolvecache_memory_ttl                },
+    { "test_resolve_batch",                           test_resolve_batch                          },
+    { "test_resolve_async",                           test_resolve_async                          },
+    { "test_backend_context",                         test_backend_context                        },
+    {  NULL,                                          NULL                                        }
+};
+
+static CU_SuiteInfo suite[] = {
+    { "idchain resolve cache test", idchain_resolvecache_test_suite_init, idchain_resolvecache_test_suite_cleanup, NULL, NULL, cases },
+    {  NULL,                        NULL,                                 NULL,                                    NULL, NULL, NULL  }
+};
+
+CU_SuiteInfo* idchain_resolvecache_test_suite_info(void)
+{
+    return suite;
+}
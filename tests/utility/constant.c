@@ -51,4 +51,5 @@ const char *DOCUMENT_FILE = "document";
 const char *CREDENTIALS_DIR = "credentials";
 const char *CREDENTIAL_FILE = "credential";
 const char *PRIVATEKEYS_DIR = "privatekeys";
-const char *META_FILE = ".metadata";
\ No newline at end of file
+const char *META_FILE = ".metadata";
+const char *STORE_INDEX_FILE = ".index";
\ No newline at end of file
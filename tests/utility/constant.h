@@ -32,5 +32,6 @@ const char *CREDENTIALS_DIR;
 const char *CREDENTIAL_FILE;
 const char *PRIVATEKEYS_DIR;
 const char *META_FILE;
+const char *STORE_INDEX_FILE;
 
 #endif /* __CONTANTS_H__ */